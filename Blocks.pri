@@ -0,0 +1,12 @@
+# Settings shared by every part of Blocks (see Blocks.pro).
+
+CONFIG += c++17
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# Uncomment to compile in the tracing spans (see tracing.h), dumped with Shift+T.
+#DEFINES += BLOCKS_TRACING
+
+QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
@@ -1,39 +1,19 @@
-QT       += core gui
+# The data model, serialisation and file access are built as a library of their own (no
+# widgets) which both the app and the command-line tool link against.
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+SUBDIRS += \
+    core \
+    app \
+    cli
 
-CONFIG += c++17
+core.file = BlocksCore.pro
+core.makefile = Makefile.core
 
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+app.file = BlocksApp.pro
+app.makefile = Makefile.app
+app.depends = core
 
-QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
-
-SOURCES += \
-    annotation.cpp \
-    bookmark.cpp \
-    codeeditor.cpp \
-    filenavigationtree.cpp \
-    main.cpp \
-    mainwindow.cpp \
-    project.cpp
-
-HEADERS += \
-    annotation.h \
-    bookmark.h \
-    codeeditor.h \
-    configuration.h \
-    filenavigationtree.h \
-    mainwindow.h \
-    project.h \
-    utils.h
-
-FORMS += \
-    annotationeditor.ui \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+cli.file = BlocksCLI.pro
+cli.makefile = Makefile.cli
+cli.depends = core
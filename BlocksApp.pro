@@ -0,0 +1,42 @@
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = Blocks
+
+include(Blocks.pri)
+include(BlocksLinkCore.pri)
+
+SOURCES += \
+    annotationtextedit.cpp \
+    attachmentsdialog.cpp \
+    codeeditor.cpp \
+    filenavigationtree.cpp \
+    findingsview.cpp \
+    main.cpp \
+    mainwindow.cpp \
+    navigationmodel.cpp \
+    quickopendialog.cpp \
+    shortcutdispatcher.cpp
+
+HEADERS += \
+    accounteditemmodel.h \
+    annotationtextedit.h \
+    attachmentsdialog.h \
+    codeeditor.h \
+    filenavigationtree.h \
+    findingsview.h \
+    mainwindow.h \
+    navigationmodel.h \
+    quickopendialog.h \
+    shortcutdispatcher.h \
+    utils.h
+
+FORMS += \
+    annotationeditor.ui \
+    mainwindow.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,17 @@
+# blocks-cli: validates, converts, merges and reports on many project files at once.
+TEMPLATE = app
+TARGET = blocks-cli
+QT = core
+CONFIG += console
+CONFIG -= app_bundle
+
+include(Blocks.pri)
+include(BlocksLinkCore.pri)
+
+SOURCES += \
+    blockscli.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,80 @@
+# Projects, annotations, bookmarks, their (de)serialisation and file access, Qt Core only.
+TEMPLATE = lib
+TARGET = BlocksCore
+CONFIG += staticlib
+QT = core
+
+include(Blocks.pri)
+
+SOURCES += \
+    annotation.cpp \
+    annotationhistory.cpp \
+    annotationquery.cpp \
+    attachmentstore.cpp \
+    bookmark.cpp \
+    cachefile.cpp \
+    contentcache.cpp \
+    directoryscanner.cpp \
+    fuzzyfinder.cpp \
+    ignorerules.cpp \
+    intervalset.cpp \
+    intervaltree.cpp \
+    jsonreader.cpp \
+    memoryaccounting.cpp \
+    pagedfile.cpp \
+    parallel.cpp \
+    pathcounts.cpp \
+    project.cpp \
+    projectio.cpp \
+    projectmerge.cpp \
+    projectserializer.cpp \
+    recordschema.cpp \
+    reportgenerator.cpp \
+    reviewcoverage.cpp \
+    stallwatchdog.cpp \
+    symbolindex.cpp \
+    tagtrie.cpp \
+    textdelta.cpp \
+    textindex.cpp \
+    textkernels.cpp \
+    tracing.cpp \
+    workspace.cpp
+
+HEADERS += \
+    annotation.h \
+    annotationhistory.h \
+    annotationquery.h \
+    attachmentstore.h \
+    binarycodec.h \
+    bookmark.h \
+    cachefile.h \
+    configuration.h \
+    contentcache.h \
+    directoryscanner.h \
+    fuzzyfinder.h \
+    ignorerules.h \
+    intervalset.h \
+    intervaltree.h \
+    jsonreader.h \
+    jsonwriter.h \
+    memoryaccounting.h \
+    pagedfile.h \
+    parallel.h \
+    pathcounts.h \
+    progress.h \
+    project.h \
+    projectio.h \
+    projectmerge.h \
+    projectserializer.h \
+    recordschema.h \
+    reportgenerator.h \
+    reviewcoverage.h \
+    snapshotmap.h \
+    stallwatchdog.h \
+    symbolindex.h \
+    tagtrie.h \
+    textdelta.h \
+    textindex.h \
+    textkernels.h \
+    tracing.h \
+    workspace.h
@@ -0,0 +1,11 @@
+# Links against the core library built by BlocksCore.pro (in the same build directory).
+
+win32:CONFIG(release, debug|release): BLOCKS_CORE_DIR = $$OUT_PWD/release
+else:win32:CONFIG(debug, debug|release): BLOCKS_CORE_DIR = $$OUT_PWD/debug
+else: BLOCKS_CORE_DIR = $$OUT_PWD
+
+LIBS += -L$$BLOCKS_CORE_DIR -lBlocksCore
+
+win32-g++: PRE_TARGETDEPS += $$BLOCKS_CORE_DIR/libBlocksCore.a
+else:win32:!win32-g++: PRE_TARGETDEPS += $$BLOCKS_CORE_DIR/BlocksCore.lib
+else: PRE_TARGETDEPS += $$BLOCKS_CORE_DIR/libBlocksCore.a
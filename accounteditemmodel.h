@@ -0,0 +1,32 @@
+#ifndef ACCOUNTEDITEMMODEL_H
+#define ACCOUNTEDITEMMODEL_H
+#include <QStandardItemModel>
+#include <string>
+#include "memoryaccounting.h"
+
+// QStandardItemModel that reports an estimate of its footprint to the LIST_MODELS subsystem.
+class AccountedItemModel : public QStandardItemModel {
+public:
+    AccountedItemModel(const std::string& accountKey, QObject* const parent = nullptr) :
+        QStandardItemModel(parent), account(MemoryAccounting::LIST_MODELS, accountKey) {}
+
+    // Re-estimates the footprint, call this after (re)populating the model.
+    void UpdateAccounting() {
+        // Roughly a QStandardItem plus its role->value storage, excluding the text itself:
+        const static std::size_t itemOverhead = 128;
+        std::size_t footprintBytes = 0;
+        for (int row = 0; row < this->rowCount(); row++) {
+            for (int column = 0; column < this->columnCount(); column++) {
+                const QStandardItem* const cell = this->item(row, column);
+                if (cell != nullptr) {
+                    footprintBytes += itemOverhead + static_cast<std::size_t>(cell->text().capacity()) * sizeof(QChar);
+                }
+            }
+        }
+        this->account.Set(footprintBytes);
+    }
+private:
+    MemoryAccounting::Account account;
+};
+
+#endif // ACCOUNTEDITEMMODEL_H
@@ -1,107 +1,301 @@
 #include "annotation.h"
 #include <algorithm>
-#include <QJsonArray>
-#include <QFile>
+#include "tracing.h"
+#include "parallel.h"
+#include <QStringList>
 
 void AnnotationCollection::AddNewAnnotation(Annotation annotationData) {
+    std::vector<Annotation> additions;
+    additions.push_back(std::move(annotationData));
+    this->ApplyEdits({}, std::move(additions));
+}
+
+void AnnotationCollection::AddNewAnnotations(std::vector<Annotation> annotationsData) {
+    this->ApplyEdits({}, std::move(annotationsData));
+}
 
+void AnnotationCollection::RemoveAnnotation(const std::string& path, const std::size_t lineRef) {
+    this->ApplyEdits({ std::make_pair(path, lineRef) }, {});
+}
+
+void AnnotationCollection::ApplyEdits(const std::vector<std::pair<std::string, std::size_t>>& removals,
+                                      std::vector<Annotation> additions) {
+    TRACE_SCOPE("AnnotationCollection::ApplyEdits");
+
+    // Deriving keywords is by far the most expensive part of adding an annotation, so that's
+    // spread across all cores for large batches:
+    const static std::size_t parallelBatchSize = 1024;
+    Parallel::For((additions.size() + parallelBatchSize - 1) / parallelBatchSize, [&additions](const std::size_t batch) {
+        const std::size_t batchEnd = std::min(additions.size(), (batch + 1) * parallelBatchSize);
+        for (std::size_t i = batch * parallelBatchSize; i < batchEnd; i++) {
+            AnnotationCollection::PrepareAnnotation(additions[i]);
+        }
+    });
+
+    // Each touched file's annotations are copied once, edited and then published together. Removals
+    // are all found before anything's counted, so a missing one leaves the collection as it was:
+    SnapshotMap<Annotation>::Batch batch(this->annotations);
+    std::unordered_map<std::string, std::ptrdiff_t /* Heap delta */> heapDeltas;
+    std::unordered_map<std::string, std::vector<std::size_t>> removedLines;
+    for (const std::pair<std::string, std::size_t>& removal : removals) {
+        removedLines[removal.first].push_back(removal.second);
+    }
+    std::vector<Annotation> removed;
+    removed.reserve(removals.size());
+    for (std::pair<const std::string, std::vector<std::size_t>>& file : removedLines) {
+        // Both sorted by line, so one pass removes them all (a line given twice losing two of its annotations):
+        std::vector<std::size_t>& lines = file.second;
+        std::sort(lines.begin(), lines.end());
+        std::vector<Annotation>& fileAnnotations = batch.Edit(file.first);
+        std::size_t nextLine = 0, kept = 0;
+        for (std::size_t i = 0; i < fileAnnotations.size(); i++) {
+            if (nextLine < lines.size() && lines[nextLine] < fileAnnotations[i].lineRef) {
+                break; // Not annotated.
+            }
+            if (nextLine < lines.size() && lines[nextLine] == fileAnnotations[i].lineRef) {
+                heapDeltas[file.first] -= static_cast<std::ptrdiff_t>(fileAnnotations[i].HeapBytes());
+                removed.push_back(std::move(fileAnnotations[i]));
+                nextLine++;
+            }
+            else {
+                if (kept != i) {
+                    fileAnnotations[kept] = std::move(fileAnnotations[i]);
+                }
+                kept++;
+            }
+        }
+        if (nextLine != lines.size()) {
+            throw std::runtime_error("Unable to find annotation");
+        }
+        fileAnnotations.erase(fileAnnotations.begin() + static_cast<std::ptrdiff_t>(kept), fileAnnotations.end());
+    }
+    for (const Annotation& annotation : removed) {
+        this->UncountAnnotation(annotation);
+    }
+
+    std::unordered_map<std::string, std::size_t /* Annotations before the additions */> extendedFiles;
+    for (Annotation& annotationData : additions) {
+        std::vector<Annotation>& fileAnnotations = batch.Edit(annotationData.fileRef);
+        extendedFiles.emplace(annotationData.fileRef, fileAnnotations.size());
+        heapDeltas[annotationData.fileRef] += static_cast<std::ptrdiff_t>(annotationData.HeapBytes());
+        this->CountAnnotation(annotationData);
+        fileAnnotations.push_back(std::move(annotationData));
+    }
+    // Only the additions need sorting, they're then merged into the (already sorted) rest. Both
+    // are stable so that annotations sharing a line keep their insertion order:
+    for (const std::pair<const std::string, std::size_t>& extendedFile : extendedFiles) {
+        std::vector<Annotation>& fileAnnotations = batch.Edit(extendedFile.first);
+        const auto byLine = [](const Annotation& a, const Annotation& b) {
+            return a.lineRef < b.lineRef;
+        };
+        const std::vector<Annotation>::iterator firstAddition = fileAnnotations.begin() + static_cast<std::ptrdiff_t>(extendedFile.second);
+        std::stable_sort(firstAddition, fileAnnotations.end(), byLine);
+        std::inplace_merge(fileAnnotations.begin(), firstAddition, fileAnnotations.end(), byLine);
+    }
+
+    for (const std::string& path : batch.Publish()) {
+        this->IndexRanges(path);
+        this->UpdateFootprint(path, heapDeltas[path]);
+    }
+}
+
+void AnnotationCollection::PrepareAnnotation(Annotation& annotationData) {
     // Handle the linesOccupied member calculation here to avoid code duplication:
     annotationData.linesOccupied = std::count(
         annotationData.contents.cbegin(),
         annotationData.contents.cend(),
         '\n'
-    ) + 1;
+    ) + 1 + annotationData.attachments.size(); // A line for each attachment, below the contents.
 
+    annotationData.endLineRef = std::max(annotationData.endLineRef, annotationData.lineRef);
     annotationData.UpdateKeywords();
+}
 
-    const std::string& filePath = annotationData.fileRef;
-    std::unordered_map<std::string, std::vector<Annotation>>::iterator annotationsVec;
-    if ((annotationsVec = this->annotations.find(filePath)) == this->annotations.end()) {
-        // Need to *insert* an annotation:
-        annotationsVec = this->annotations.insert(
-            annotationsVec,
-            std::pair<std::string, std::vector<Annotation>>(
-                filePath, std::vector<Annotation>{annotationData}
-            )
-        );
+void AnnotationCollection::IndexRanges(const std::string& path) {
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    const std::vector<Annotation>& fileAnnotations = snapshot->Get(path);
+    std::vector<IntervalTree::Interval> fileRanges;
+    for (std::size_t i = 0; i < fileAnnotations.size(); i++) {
+        if (fileAnnotations[i].IsRange()) {
+            fileRanges.push_back(IntervalTree::Interval {
+                .begin = fileAnnotations[i].lineRef, .end = fileAnnotations[i].endLineRef + 1, .value = i
+            });
+        }
+    }
+    if (fileRanges.empty()) {
+        this->ranges.erase(path);
     }
     else {
-        // Append to the iterator:
-        annotationsVec->second.push_back(annotationData);
+        this->ranges[path] = IntervalTree(std::move(fileRanges));
     }
+}
 
-    // Sort the annotations vector into ascending order:
-    std::sort(annotationsVec->second.begin(), annotationsVec->second.end(),
-        [](const Annotation& a, const Annotation& b) {
-            return a.lineRef < b.lineRef;
-        }
+void AnnotationCollection::UpdateFootprint(const std::string& path, const std::ptrdiff_t annotationHeapDelta) {
+    std::unordered_map<std::string, FileFootprint>::iterator footprint = this->footprints.find(path);
+    if (footprint == this->footprints.end()) {
+        footprint = this->footprints.emplace(path, FileFootprint {
+            .account = MemoryAccounting::Account(MemoryAccounting::COLLECTIONS, "annotations: " + path),
+            .annotationHeapBytes = 0
+        }).first;
+    }
+    footprint->second.annotationHeapBytes += annotationHeapDelta;
+
+    // The annotations themselves (and their heap allocations) plus the map entry holding them:
+    const std::size_t vectorBytes = this->annotations.Current()->Get(path).capacity() * sizeof(Annotation);
+    footprint->second.account.Set(
+        vectorBytes + footprint->second.annotationHeapBytes +
+        sizeof(std::pair<const std::string, std::shared_ptr<const std::vector<Annotation>>>) + MemoryAccounting::StringHeapBytes(path)
     );
 }
 
-std::vector<Annotation> AnnotationCollection::GetAnnotations(const std::string& path) const {
-    std::unordered_map<std::string, std::vector<Annotation>>::const_iterator matchingVec = this->annotations.find(path);
-    if (matchingVec == this->annotations.cend()) {
-        return std::vector<Annotation>(0); // Return an empty array upon failure.
+void AnnotationCollection::CountAnnotation(const Annotation& annotation) {
+    for (const std::string& keyword : annotation.UniqueKeywords()) {
+        this->tags.Add(keyword);
+        KeywordPostings& keywordPostings = this->postings[keyword];
+        keywordPostings.uses++;
+        keywordPostings.files[annotation.fileRef]++;
     }
-    return matchingVec->second;
+    this->pathCounts.Add(annotation.fileRef);
+    this->text.Add(annotation.fileRef, annotation.lineRef, annotation.id, annotation.contents);
 }
 
-std::vector<Annotation> AnnotationCollection::GetAnnotations() const {
-    std::vector<Annotation> annotations;
-
-    for (std::unordered_map<std::string, std::vector<Annotation>>::const_iterator i = this->annotations.cbegin();
-         i != this->annotations.cend(); i++) {
-        for (const Annotation& annotation : i->second) {
-            annotations.push_back(annotation);
+void AnnotationCollection::UncountAnnotation(const Annotation& annotation) {
+    for (const std::string& keyword : annotation.UniqueKeywords()) {
+        this->tags.Remove(keyword);
+        const std::unordered_map<std::string, KeywordPostings>::iterator keywordPostings = this->postings.find(keyword);
+        if (keywordPostings == this->postings.end()) {
+            continue;
+        }
+        const std::unordered_map<std::string, std::size_t>::iterator file = keywordPostings->second.files.find(annotation.fileRef);
+        if (file != keywordPostings->second.files.end() && --file->second == 0) {
+            keywordPostings->second.files.erase(file);
+        }
+        if (--keywordPostings->second.uses == 0) {
+            this->postings.erase(keywordPostings);
         }
     }
+    this->pathCounts.Remove(annotation.fileRef);
+    this->text.Remove(annotation.fileRef, annotation.lineRef, annotation.id, annotation.contents);
+}
 
-    return annotations;
+std::size_t AnnotationCollection::CountUnder(const std::string& path) const {
+    return this->pathCounts.Get(path);
 }
 
-void AnnotationCollection::RemoveAnnotation(const std::string& path, const std::size_t lineRef) {
-    std::unordered_map<std::string, std::vector<Annotation>>::iterator matchingVec;
-    if ((matchingVec = this->annotations.find(path)) == this->annotations.end()) {
-        throw std::runtime_error("Unable to find annotation file entry");
+std::vector<TagTrie::Completion> AnnotationCollection::CompleteTag(const std::string& prefix) const {
+    return this->tags.Complete(prefix);
+}
+
+std::size_t AnnotationCollection::KeywordUses(const std::string& keyword) const {
+    const std::unordered_map<std::string, KeywordPostings>::const_iterator keywordPostings = this->postings.find(keyword);
+    return keywordPostings == this->postings.cend() ? 0 : keywordPostings->second.uses;
+}
+
+std::vector<std::string> AnnotationCollection::FilesUsingKeyword(const std::string& keyword) const {
+    std::vector<std::string> files;
+    const std::unordered_map<std::string, KeywordPostings>::const_iterator keywordPostings = this->postings.find(keyword);
+    if (keywordPostings != this->postings.cend()) {
+        for (const std::pair<const std::string, std::size_t>& file : keywordPostings->second.files) {
+            files.push_back(file.first);
+        }
     }
-    std::vector<Annotation>& fileAnnotations = matchingVec->second;
-    fileAnnotations.erase(this->GetAnnotationIter(path, lineRef));
+    return files;
 }
 
-std::vector<Annotation>::const_iterator AnnotationCollection::GetAnnotationIter(
-        const std::string& path, const std::size_t lineRef) const {
-    std::unordered_map<std::string, std::vector<Annotation>>::const_iterator matchingVec = this->annotations.find(path);
-    if (matchingVec == this->annotations.end()) {
-        throw std::runtime_error("Unable to find annotation");
+std::vector<TextIndex::Hit> AnnotationCollection::SearchText(const std::vector<TextIndex::Clause>& clauses) const {
+    TRACE_SCOPE("AnnotationCollection::SearchText");
+    return this->text.Search(clauses);
+}
+
+std::size_t AnnotationCollection::EstimateText(const std::vector<TextIndex::Clause>& clauses) const {
+    return this->text.Estimate(clauses);
+}
+
+std::size_t Annotation::HeapBytes() const {
+    std::size_t heapBytes = MemoryAccounting::StringHeapBytes(this->contents) +
+        MemoryAccounting::StringHeapBytes(this->fileRef) +
+        this->keywords.capacity() * sizeof(std::string);
+    for (const std::string& keyword : this->keywords) {
+        heapBytes += MemoryAccounting::StringHeapBytes(keyword);
+    }
+    heapBytes += this->tags.capacity() * sizeof(std::string);
+    for (const std::string& tag : this->tags) {
+        heapBytes += MemoryAccounting::StringHeapBytes(tag);
+    }
+    if (this->history) {
+        heapBytes += this->history->HeapBytes();
+    }
+    heapBytes += this->attachments.capacity() * sizeof(Attachment);
+    for (const Attachment& attachment : this->attachments) {
+        heapBytes += MemoryAccounting::StringHeapBytes(attachment.id) + MemoryAccounting::StringHeapBytes(attachment.name);
     }
+    return heapBytes;
+}
+
+std::vector<Annotation> AnnotationCollection::GetAnnotations(const std::string& path) const {
+    return this->annotations.Current()->Get(path);
+}
 
-    const std::vector<Annotation>& fileAnnotations = matchingVec->second;
+std::vector<Annotation> AnnotationCollection::GetAnnotations() const {
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    std::vector<Annotation> annotations;
+    annotations.reserve(snapshot->ItemCount());
+    snapshot->ForEach([&annotations](const std::string&, const std::vector<Annotation>& fileAnnotations) {
+        annotations.insert(annotations.end(), fileAnnotations.cbegin(), fileAnnotations.cend());
+    });
+    return annotations;
+}
 
+Annotation AnnotationCollection::GetAnnotation(const std::string& path,
+                                               const std::size_t lineRef) const {
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    const std::vector<Annotation>& fileAnnotations = snapshot->Get(path);
     const std::vector<Annotation>::const_iterator matchingAnnotation = std::find_if(
-        fileAnnotations.begin(), fileAnnotations.end(), [&lineRef](const Annotation& sample){
+        fileAnnotations.cbegin(), fileAnnotations.cend(), [&lineRef](const Annotation& sample) {
             return sample.lineRef == lineRef;
         }
     );
     if (matchingAnnotation == fileAnnotations.cend()) {
         throw std::runtime_error("Unable to find annotation");
     }
-
-    return matchingAnnotation;
+    return *matchingAnnotation;
 }
 
-Annotation AnnotationCollection::GetAnnotation(const std::string& path,
-                                               const std::size_t lineRef) const {
-    return *this->GetAnnotationIter(path, lineRef);
+std::size_t AnnotationCollection::Count() const {
+    return this->annotations.Current()->ItemCount();
 }
 
 std::unordered_map<std::string, std::vector<Annotation>> AnnotationCollection::GetRawAnnotations() const {
-    return this->annotations;
+    std::unordered_map<std::string, std::vector<Annotation>> rawAnnotations;
+    this->annotations.Current()->ForEach([&rawAnnotations](const std::string& path, const std::vector<Annotation>& fileAnnotations) {
+        rawAnnotations.emplace(path, fileAnnotations);
+    });
+    return rawAnnotations;
+}
+
+std::vector<Annotation> AnnotationCollection::GetRangesOverlapping(const std::string& path, const std::size_t firstLine,
+                                                                   const std::size_t endLine) const {
+    const std::unordered_map<std::string, IntervalTree>::const_iterator fileRanges = this->ranges.find(path);
+    if (fileRanges == this->ranges.cend()) {
+        return {};
+    }
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    const std::vector<Annotation>& fileAnnotations = snapshot->Get(path);
+    std::vector<Annotation> overlapping;
+    for (const std::size_t i : fileRanges->second.Overlapping(firstLine, endLine)) {
+        overlapping.push_back(fileAnnotations[i]);
+    }
+    return overlapping;
+}
+
+std::shared_ptr<const AnnotationCollection::Snapshot> AnnotationCollection::GetSnapshot() const {
+    return this->annotations.Current();
 }
 
 std::size_t AnnotationCollection::ResolveToEditLineRef(const std::string& path,
                                                        const std::size_t codeLineRef) const {
-
-    const std::vector<Annotation> annotations = this->GetAnnotations(path);
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    const std::vector<Annotation>& annotations = snapshot->Get(path);
     std::size_t adjustedLineRef = codeLineRef/* + delta (= 0)*/;
     for (const Annotation& iterativeAnnotation : annotations) {
         const std::size_t curDelta = adjustedLineRef - codeLineRef;
@@ -118,7 +312,8 @@ std::size_t AnnotationCollection::ResolveToEditLineRef(const std::string& path,
 
 std::size_t AnnotationCollection::ResolveToCodeLineRef(const std::string& path,
                                                        const std::size_t rawLineRef) const {
-    const std::vector<Annotation> annotations = this->GetAnnotations(path);
+    const std::shared_ptr<const Snapshot> snapshot = this->annotations.Current();
+    const std::vector<Annotation>& annotations = snapshot->Get(path);
     std::size_t currentDelta = 0;
     for (const Annotation& iterativeAnnotation : annotations) {
         const std::size_t iterativeLinesOccupied = iterativeAnnotation.linesOccupied;
@@ -151,110 +346,32 @@ std::size_t AnnotationCollection::ResolveToCodeLineRef(const std::string& path,
     return rawLineRef - currentDelta;
 }
 
-QJsonObject Annotation::SerializeToJSON(const Config::VR_Specifications conformingSpecification) const {
-
-    QJsonObject serialized;
-    switch (conformingSpecification) {
-        case Config::VR_Specifications::SNIPPET: {
-            // In Snippet, the JSON schema outlines:
-            // string("id") - DB table index
-            // string("filename") - *Relative* path & filename of this file
-            // int("linenum") - Line number *indexed from 1*
-            // string("txt") - Annotation contents
-            // string("author") - User ID of the author
-            // string("timestamp") - Most recent edit timestamp
-            // string("ctimestamp") - Creation timestamp
-            // string[]("tags") - Tokens/Keywords associated w/ this annotation
-            // string("version") - *File* version (not Blocks/Snippet version)
-
-            //...
-            throw std::runtime_error("Unsupported");
-
-            break;
-        }
-        case Config::VR_Specifications::BLOCKS: {
-            // In Blocks, the JSON schema is just the entire relevant structure.
-            // There is some overlap with Snippet's members (lineRef, fileRef, contents, tags, etc)
-            // but the naming of those variables differs wildly and Blocks is open
-            // to more rapid incremental adjustments (including member types).
-//            serialized["file"] = this->fileRef.c_str();
-            serialized["line"] = static_cast<qint64>(this->lineRef);
-            serialized["contents"] = this->contents.c_str();
-            QJsonArray keywordsArr = {};
-            for (const std::string& keyword : this->keywords) {
-                // Inserting at the start to maintain ordering, not required but a nice touch:
-                keywordsArr.insert(0, keyword.c_str());
-            }
-            serialized["keywords"] = keywordsArr;
-            break;
-        }
-        default:
-            throw std::runtime_error("Invalid specification");
-            break;
-    }
+bool Annotation::IsRange() const {
+    return this->endLineRef > this->lineRef || this->startColumn != 0 || this->endColumn != 0;
+}
 
-    return serialized;
+void Annotation::RecordRevision(const Annotation& previous, const std::string& editor) {
+    // Until its first edit an annotation's only version is its author's, written when it was created:
+    const AnnotationHistory::Revision previousRevision {
+        .contents = previous.contents,
+        .author = previous.history ? previous.history->LatestAuthor() : previous.author,
+        .timestamp = previous.modifiedTimestamp.empty() ? previous.createdTimestamp : previous.modifiedTimestamp
+    };
+    this->history = AnnotationHistory::Record(previous.history, previousRevision, this->contents, editor);
 }
 
-void AnnotationCollection::AddToModel(QStandardItemModel* const model, const std::string& basePath) const {
-    std::size_t rowIndex = model->rowCount();
-    for (const std::pair<std::string, std::vector<Annotation>>& annotationSet : this->annotations) {
-        // Read the annotated file's contents. TODO: Find a way to only read the lines in question (not the entire contents).
-        QFile fileObj(QString::fromStdString(basePath + annotationSet.first));
-        fileObj.open(QIODevice::ReadOnly | QIODevice::Text);
-        QByteArray rawFileContents = fileObj.readAll();
-        fileObj.close();
-
-        // Cast the file's bytes to a string
-        const QStringList fileLines = QString::fromStdString(rawFileContents.toStdString()).split('\n');
-
-        // Iterate over and insert the annotations
-        for (const Annotation& annotation : annotationSet.second) {
-            if (fileLines.length() <= annotation.lineRef) {
-                throw std::runtime_error("OOB annotation");
-            }
-            model->setItem(rowIndex, 0, new QStandardItem(QString::fromStdString(annotation.fileRef)));
-            model->setItem(rowIndex, 1, new QStandardItem(QString::number(annotation.lineRef)));
-            model->setItem(rowIndex, 2, new QStandardItem(fileLines[annotation.lineRef].simplified()));
-            model->setItem(rowIndex, 3, new QStandardItem(QString::fromStdString(annotation.contents)));
-            ++rowIndex;
+std::vector<std::string> Annotation::UniqueKeywords() const {
+    std::vector<std::string> uniqueKeywords;
+    for (const std::string& keyword : this->keywords) {
+        if (std::find(uniqueKeywords.cbegin(), uniqueKeywords.cend(), keyword) == uniqueKeywords.cend()) {
+            uniqueKeywords.push_back(keyword);
         }
     }
+    return uniqueKeywords;
 }
 
 AnnotationCollection::AnnotationCollection() {}
 
-AnnotationCollection::AnnotationCollection(QJsonObject annotationsJSON, Config::VR_Specifications specification) {
-    if (specification != Config::VR_Specifications::BLOCKS) {
-        throw std::runtime_error("Invalid/Unsupported specification whilst deserializing to annotation");
-    }
-
-    annotationsJSON = annotationsJSON["annotations"].toObject();
-
-    const QStringList filePaths = annotationsJSON.keys();
-
-    for (const QString& iterativeFile : filePaths) {
-
-        const QJsonObject fileEntry = annotationsJSON[iterativeFile].toObject();
-        const QString filePath = fileEntry["file"].toString();
-        const QJsonArray fileAnnotations = fileEntry["annotations"].toArray();
-
-        for (const QJsonValueRef& iterativeAnnotation : fileAnnotations) {
-            const QJsonObject annotationObject = iterativeAnnotation.toObject();
-
-            // No need to fill 'keywords' or 'linesOccupied' as these members are
-            // dynamically calculated by the addition function (AddNewAnnotation())
-            Annotation annotationVar {
-                .contents = annotationObject["contents"].toString().toStdString(),
-                .lineRef = static_cast<std::size_t>(annotationObject["line"].toInt()),
-                .fileRef = filePath.toStdString()
-            };
-
-            this->AddNewAnnotation(std::move(annotationVar));
-        }
-    }
-}
-
 void Annotation::UpdateKeywords() {
     this->keywords.clear();
 
@@ -280,7 +397,11 @@ void Annotation::UpdateKeywords() {
                 break;
             }
         }
-        const std::size_t tokenLength = (cutoffIndex - 1) - ++searchPos;
+        // Tags running to the end of the contents from an opening bracket/quote lose the closing
+        // character, otherwise the tag ends just before the cutoff:
+        const std::size_t tokenEnd = oppositeCutoff != Annotation::OppositeCutoffs.cend() &&
+            cutoffIndex == annotationContents.length() ? cutoffIndex - 1 : cutoffIndex;
+        const std::size_t tokenLength = tokenEnd > ++searchPos ? tokenEnd - searchPos : 0;
         if (tokenLength > 0) {
             this->keywords.push_back(annotationContents.substr(searchPos, tokenLength));
         }
@@ -293,4 +414,5 @@ void Annotation::UpdateKeywords() {
         }
         this->keywords.push_back(iterativeKeyword.toStdString());
     }
+    this->keywords.insert(this->keywords.end(), this->tags.cbegin(), this->tags.cend());
 }
@@ -3,17 +3,42 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include <QJsonObject>
-#include <QStandardItemModel>
-#include <QTreeView>
+#include "annotationhistory.h"
+#include "attachmentstore.h"
 #include "configuration.h"
+#include "intervaltree.h"
+#include "memoryaccounting.h"
+#include "pathcounts.h"
+#include "progress.h"
+#include "snapshotmap.h"
+#include "tagtrie.h"
+#include "textindex.h"
 
 struct Annotation {
     std::string contents;
     std::size_t linesOccupied;
     std::size_t lineRef;
+    // Range annotations also cover the lines after lineRef up to endLineRef (inclusive),
+    // optionally starting/ending part way into the first/last line (in characters, endColumn
+    // being exclusive and 0 for the rest of the line). They're still written above lineRef.
+    std::size_t endLineRef = 0; // Raised to lineRef (if before it) when added to a collection.
+    std::size_t startColumn = 0;
+    std::size_t endColumn = 0;
     std::string fileRef;
-    std::vector<std::string> keywords;
+    std::vector<std::string> keywords; // The #tags in 'contents', followed by 'tags'.
+    // Keywords given alongside the contents rather than in them (e.g. Snippet's tags).
+    std::vector<std::string> tags;
+
+    // Metadata carried for Snippet (SAND2019-10279R) interoperability:
+    std::string id; // Assigned when created in the editor, empty if it was loaded without one.
+    std::string author;
+    std::string createdTimestamp; // ISO 8601
+    std::string modifiedTimestamp; // ISO 8601
+    std::string fileVersion; // Version of the *file* that was annotated.
+    // Earlier versions of 'contents', null if it's never been edited. Not carried by Snippet.
+    std::shared_ptr<const AnnotationHistory> history;
+    // Evidence too large to keep in 'contents', held in the project's AttachmentStore.
+    std::vector<Attachment> attachments;
 
     const inline static std::vector<char> CutoffChars = {
         ' ', '\t', '\n', '\r', '\v', '.'
@@ -26,20 +51,55 @@ struct Annotation {
         { '\"', '\"' },
         { '*', '*' }
     };
-    QJsonObject SerializeToJSON(const Config::VR_Specifications conformingSpecification) const;
-
+    bool IsRange() const;
+    // Records 'previous' (this annotation before an edit) as the latest of the earlier
+    // versions, the current contents having been written by 'editor'.
+    void RecordRevision(const Annotation& previous, const std::string& editor);
     void UpdateKeywords();
+    // Keywords without duplicates, in order of first appearance.
+    std::vector<std::string> UniqueKeywords() const;
+    // Bytes owned on the heap by this annotation's members (for memory accounting).
+    std::size_t HeapBytes() const;
 };
 
+// Annotations grouped by file (each file's sorted by line). Edits are made on the GUI thread,
+// the annotations themselves can be read from any thread: through GetSnapshot(), or the getters
+// below which each read the latest snapshot. The keyword and per-path counts, the range index
+// and the full-text index are GUI thread only.
 class AnnotationCollection {
+public:
+    typedef SnapshotMap<Annotation>::Snapshot Snapshot;
 private:
-    std::unordered_map<std::string /* File Path */, std::vector<Annotation>> annotations;
-    std::vector<Annotation>::const_iterator GetAnnotationIter(const std::string& path, const std::size_t lineRef) const;
+    SnapshotMap<Annotation> annotations; // By file path.
+
+    struct FileFootprint {
+        MemoryAccounting::Account account;
+        std::size_t annotationHeapBytes;
+    };
+    std::unordered_map<std::string /* File Path */, FileFootprint> footprints;
+    void UpdateFootprint(const std::string& path, std::ptrdiff_t annotationHeapDelta);
+    static void PrepareAnnotation(Annotation& annotationData);
+
+    // Each file's range annotations by the lines they span, values being indexes into the
+    // file's (current) annotations. Rebuilt for a file whenever its annotations change.
+    std::unordered_map<std::string /* File Path */, IntervalTree> ranges;
+    void IndexRanges(const std::string& path);
+
+    TagTrie tags; // Number of annotations using each keyword.
+    // Annotations using each keyword, overall and per file, so queries can visit only those files.
+    struct KeywordPostings {
+        std::size_t uses = 0;
+        std::unordered_map<std::string /* File Path */, std::size_t> files;
+    };
+    std::unordered_map<std::string, KeywordPostings> postings;
+    PathCounts pathCounts; // Number of annotations in each file/directory.
+    TextIndex text; // Every annotation's contents.
+    void CountAnnotation(const Annotation& annotation);
+    void UncountAnnotation(const Annotation& annotation);
 
 public:
 
     AnnotationCollection();
-    AnnotationCollection(QJsonObject annotationsJSON, Config::VR_Specifications specification);
 
     // Reverse of ResolveToCodeLineRef.
     std::size_t ResolveToEditLineRef(const std::string& path, const std::size_t codeLineRef) const;
@@ -47,13 +107,33 @@ public:
     // with actual immutable data/code on it.
     std::size_t ResolveToCodeLineRef(const std::string& path, const std::size_t rawLineRef) const;
     void AddNewAnnotation(Annotation annotationData);
+    // Equivalent to AddNewAnnotation() on each element but only sorts each file once.
+    void AddNewAnnotations(std::vector<Annotation> annotationsData);
     void RemoveAnnotation(const std::string& path, const std::size_t lineRef);
+    // Removes an annotation on each of 'removals' (path, line) and adds 'additions' as one edit,
+    // copying each touched file's annotations once. Throws, having changed nothing, if any of
+    // 'removals' isn't annotated.
+    void ApplyEdits(const std::vector<std::pair<std::string, std::size_t>>& removals, std::vector<Annotation> additions);
     std::vector<Annotation> GetAnnotations(const std::string& path) const;
     std::vector<Annotation> GetAnnotations() const;
     std::unordered_map<std::string, std::vector<Annotation>> GetRawAnnotations() const;
+    // A consistent view of every annotation as of now, unaffected by later edits.
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
     Annotation GetAnnotation(const std::string& path, const std::size_t lineRef) const;
-
-    void AddToModel(QStandardItemModel* const model, const std::string& basePath) const;
+    // 'path''s range annotations spanning any of the lines [firstLine, endLine), by first line.
+    std::vector<Annotation> GetRangesOverlapping(const std::string& path, std::size_t firstLine, std::size_t endLine) const;
+    std::size_t Count() const;
+    // Annotations in the file/directory 'path' ("" for the whole codebase).
+    std::size_t CountUnder(const std::string& path) const;
+    // The keywords used most across the collection that start with 'prefix'.
+    std::vector<TagTrie::Completion> CompleteTag(const std::string& prefix) const;
+    std::size_t KeywordUses(const std::string& keyword) const;
+    std::vector<std::string> FilesUsingKeyword(const std::string& keyword) const;
+    // Annotations whose contents match every one of 'clauses', ranked best first. Unlike the
+    // rest, safe to call from any thread whilst the collection's being edited.
+    std::vector<TextIndex::Hit> SearchText(const std::vector<TextIndex::Clause>& clauses) const;
+    // At most how many annotations SearchText() would find, without searching.
+    std::size_t EstimateText(const std::vector<TextIndex::Clause>& clauses) const;
 };
 
 #endif // ANNOTATION_H
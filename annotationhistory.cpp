@@ -0,0 +1,83 @@
+#include "annotationhistory.h"
+#include "configuration.h"
+#include "memoryaccounting.h"
+#include "textdelta.h"
+
+std::shared_ptr<const AnnotationHistory> AnnotationHistory::Record(const std::shared_ptr<const AnnotationHistory>& history,
+                                                                   const Revision& previous, const std::string& current,
+                                                                   const std::string& currentAuthor) {
+    std::shared_ptr<AnnotationHistory> recorded = history ?
+        std::make_shared<AnnotationHistory>(*history) : std::make_shared<AnnotationHistory>();
+    recorded->latestAuthor = currentAuthor;
+
+    // The previous version is stored in full if the deltas since the last full copy have
+    // reached the interval, as it's the one all of them are now applied on top of:
+    std::size_t trailingDeltas = 0;
+    for (std::vector<StoredRevision>::const_reverse_iterator entry = recorded->entries.crbegin();
+         entry != recorded->entries.crend() && !entry->full; ++entry) {
+        trailingDeltas++;
+    }
+    StoredRevision entry {
+        .author = previous.author,
+        .timestamp = previous.timestamp,
+        .full = true,
+        .data = previous.contents
+    };
+    if (trailingDeltas + 1 < Config::History::SnapshotInterval) {
+        std::string delta = TextDelta::Encode(current, previous.contents);
+        if (delta.size() < previous.contents.size()) {
+            entry.full = false;
+            entry.data = std::move(delta);
+        }
+    }
+    recorded->entries.reserve(recorded->entries.size() + 1); // Never grown again.
+    recorded->entries.push_back(std::move(entry));
+    return recorded;
+}
+
+std::size_t AnnotationHistory::Count() const {
+    return this->entries.size();
+}
+
+const std::string& AnnotationHistory::LatestAuthor() const {
+    return this->latestAuthor;
+}
+
+std::vector<AnnotationHistory::Revision> AnnotationHistory::GetAll(const std::string& currentContents) const {
+    std::vector<Revision> revisions(this->entries.size());
+    std::string contents = currentContents;
+    for (std::size_t i = this->entries.size(); i-- > 0;) {
+        const StoredRevision& entry = this->entries[i];
+        contents = entry.full ? entry.data : TextDelta::Apply(contents, entry.data);
+        revisions[i] = Revision {
+            .contents = contents,
+            .author = entry.author,
+            .timestamp = entry.timestamp
+        };
+    }
+    return revisions;
+}
+
+std::size_t AnnotationHistory::HeapBytes() const {
+    std::size_t heapBytes = this->entries.capacity() * sizeof(StoredRevision) + MemoryAccounting::StringHeapBytes(this->latestAuthor);
+    for (const StoredRevision& entry : this->entries) {
+        heapBytes += MemoryAccounting::StringHeapBytes(entry.author) + MemoryAccounting::StringHeapBytes(entry.timestamp) +
+                     MemoryAccounting::StringHeapBytes(entry.data);
+    }
+    return heapBytes;
+}
+
+const std::vector<AnnotationHistory::StoredRevision>& AnnotationHistory::GetStored() const {
+    return this->entries;
+}
+
+std::shared_ptr<const AnnotationHistory> AnnotationHistory::FromStored(std::string latestAuthor,
+                                                                       std::vector<StoredRevision> revisions) {
+    if (revisions.empty()) {
+        return nullptr;
+    }
+    std::shared_ptr<AnnotationHistory> history = std::make_shared<AnnotationHistory>();
+    history->latestAuthor = std::move(latestAuthor);
+    history->entries = std::move(revisions);
+    return history;
+}
@@ -0,0 +1,53 @@
+#ifndef ANNOTATIONHISTORY_H
+#define ANNOTATIONHISTORY_H
+#include <memory>
+#include <string>
+#include <vector>
+
+// Earlier versions of an annotation's contents, who wrote each and when. Only the annotation
+// keeps its latest text in full: every earlier version is stored as a TextDelta against the
+// version that followed it, with a full copy every Config::History::SnapshotInterval
+// revisions (or wherever a delta wouldn't be any smaller). Immutable once recorded, so
+// annotations (and their snapshots) share one history between copies.
+
+class AnnotationHistory {
+public:
+    struct Revision {
+        std::string contents;
+        std::string author;
+        std::string timestamp; // ISO 8601, when this version was written.
+    };
+
+    // 'history' (null if there's none yet) with the version 'previous' superseded by
+    // 'current', written by 'currentAuthor'.
+    static std::shared_ptr<const AnnotationHistory> Record(const std::shared_ptr<const AnnotationHistory>& history,
+                                                           const Revision& previous, const std::string& current,
+                                                           const std::string& currentAuthor);
+
+    // Number of earlier versions.
+    std::size_t Count() const;
+    // Who wrote the annotation's current contents.
+    const std::string& LatestAuthor() const;
+    // Every earlier version, oldest first, rebuilt from the annotation's current contents.
+    // Throws std::runtime_error if the history has been damaged.
+    std::vector<Revision> GetAll(const std::string& currentContents) const;
+    // Bytes owned on the heap (for memory accounting).
+    std::size_t HeapBytes() const;
+
+
+    // Earlier versions as they're kept, for RecordSchema to save and load as they are.
+    struct StoredRevision {
+        std::string author;
+        std::string timestamp;
+        bool full; // 'data' is the text itself rather than a delta against the next version.
+        std::string data;
+    };
+    const std::vector<StoredRevision>& GetStored() const; // Oldest first.
+    // Null if there are no 'revisions'.
+    static std::shared_ptr<const AnnotationHistory> FromStored(std::string latestAuthor, std::vector<StoredRevision> revisions);
+private:
+    std::vector<StoredRevision> entries; // Oldest first.
+    std::string latestAuthor;
+};
+
+#endif // ANNOTATIONHISTORY_H
@@ -0,0 +1,399 @@
+#include "annotationquery.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include "configuration.h"
+#include "pagedfile.h"
+#include "parallel.h"
+#include "tracing.h"
+
+namespace {
+    // Splits 'text' on spaces, bar those in double quotes. Quoted terms come back flagged.
+    std::vector<std::pair<std::string, bool /* Quoted */>> Tokenize(const std::string& text) {
+        std::vector<std::pair<std::string, bool>> tokens;
+        std::size_t position = 0;
+        while (position < text.size()) {
+            if (std::isspace(static_cast<unsigned char>(text[position]))) {
+                position++;
+            }
+            else if (text[position] == '"') {
+                const std::size_t closingQuote = text.find('"', position + 1);
+                if (closingQuote == std::string::npos) {
+                    throw std::invalid_argument("Unterminated quote in \"" + text.substr(position) + "\"");
+                }
+                tokens.emplace_back(text.substr(position + 1, closingQuote - position - 1), true);
+                position = closingQuote + 1;
+            }
+            else {
+                std::size_t tokenEnd = position;
+                while (tokenEnd < text.size() && !std::isspace(static_cast<unsigned char>(text[tokenEnd]))) {
+                    tokenEnd++;
+                }
+                tokens.emplace_back(text.substr(position, tokenEnd - position), false);
+                position = tokenEnd;
+            }
+        }
+        return tokens;
+    }
+
+    std::size_t ParseLine(const std::string& number, const std::string& term) {
+        if (number.empty() || !std::all_of(number.cbegin(), number.cend(), [](const unsigned char c) { return std::isdigit(c); })) {
+            throw std::invalid_argument("Expected a line number in \"" + term + "\"");
+        }
+        try {
+            return static_cast<std::size_t>(std::stoull(number));
+        } catch (const std::out_of_range&) {
+            throw std::invalid_argument("Line number out of range in \"" + term + "\"");
+        }
+    }
+}
+
+AnnotationQuery::AnnotationQuery(const std::string& text) {
+    for (const std::pair<std::string, bool>& token : Tokenize(text)) {
+        const std::string& term = token.first;
+        if (token.second) {
+            std::vector<std::string> words = TextIndex::Tokenize(term);
+            if (!words.empty()) {
+                this->textClauses.push_back(TextIndex::Clause { .terms = std::move(words), .prefix = false });
+            }
+            continue;
+        }
+
+        const std::size_t colon = term.find(':');
+        const std::string field = colon == std::string::npos ? "" : term.substr(0, colon);
+        const std::string value = colon == std::string::npos ? "" : term.substr(colon + 1);
+        if (term.size() > 1 && term.front() == '#') {
+            this->keywords.push_back(term.substr(1));
+        }
+        else if (field == "in" || field == "path") {
+            // Paths are matched as a file or a directory, so trailing wildcards add nothing:
+            std::string path = value;
+            while (!path.empty() && (path.back() == '*' || path.back() == '/')) {
+                path.pop_back();
+            }
+            if (path.find_first_of("*?[") != std::string::npos) {
+                throw std::invalid_argument("Only trailing wildcards are supported in \"" + term + "\"");
+            }
+            this->pathPrefix = path;
+        }
+        else if (field == "line" || field == "lines") {
+            const std::size_t dash = value.find('-');
+            this->firstLine = ParseLine(value.substr(0, dash), term);
+            this->lastLine = dash == std::string::npos ? this->firstLine : ParseLine(value.substr(dash + 1), term);
+            if (this->lastLine < this->firstLine) {
+                throw std::invalid_argument("Empty line range in \"" + term + "\"");
+            }
+        }
+        else if (field == "is") {
+            if (value == "annotation" || value == "annotations") {
+                this->kind = Kind::ANNOTATION;
+            }
+            else if (value == "bookmark" || value == "bookmarks") {
+                this->kind = Kind::BOOKMARK;
+            }
+            else if (value == "any") {
+                this->kind = Kind::ANY;
+            }
+            else {
+                throw std::invalid_argument("Expected annotation, bookmark or any in \"" + term + "\"");
+            }
+        }
+        else {
+            // A word, or a prefix ending in '*'. Punctuation splits words so "use-after" is a phrase:
+            std::string words = term;
+            const bool prefix = words.back() == '*';
+            while (!words.empty() && words.back() == '*') {
+                words.pop_back();
+            }
+            TextIndex::Clause clause { .terms = TextIndex::Tokenize(words), .prefix = prefix };
+            if (clause.terms.empty()) {
+                throw std::invalid_argument("No words to search for in \"" + term + "\"");
+            }
+            if (prefix && clause.terms.size() > 1) {
+                throw std::invalid_argument("Only a single word can be a prefix in \"" + term + "\"");
+            }
+            this->textClauses.push_back(std::move(clause));
+        }
+    }
+}
+
+AnnotationQuery::Plan AnnotationQuery::MakePlan(const AnnotationCollection& annotations, const BookmarkCollection& bookmarks) const {
+    const bool wantAnnotations = this->kind != Kind::BOOKMARK;
+    const bool wantBookmarks = this->kind != Kind::ANNOTATION;
+    Plan plan {
+        .access = Access::SCAN,
+        .files = {},
+        .annotations = nullptr,
+        .estimate = (wantAnnotations ? annotations.Count() : 0) + (wantBookmarks ? bookmarks.Count() : 0)
+    };
+
+    // The full-text index finds exactly the annotations using the words (bookmarks have none),
+    // and ranks them, so whatever else the query says only filters its hits. Searching it can
+    // take a while, so that's left to Run():
+    if (!this->textClauses.empty()) {
+        plan.access = Access::TEXT;
+        if (wantAnnotations) {
+            plan.annotations = &annotations;
+            plan.estimate = annotations.EstimateText(this->textClauses);
+        }
+        else {
+            plan.estimate = 0;
+        }
+        return plan;
+    }
+
+    // Whichever index leaves the fewest items to check wins, the per-file line order narrows
+    // things down further whatever's picked:
+    if (!this->pathPrefix.empty()) {
+        const std::size_t underPath = (wantAnnotations ? annotations.CountUnder(this->pathPrefix) : 0) +
+                                      (wantBookmarks ? bookmarks.CountUnder(this->pathPrefix) : 0);
+        if (underPath < plan.estimate) {
+            plan.access = Access::PATH_PREFIX;
+            plan.estimate = underPath;
+        }
+    }
+    for (const std::string& keyword : this->keywords) {
+        // Only annotations have keywords, so bookmarks can't match anything here anyway:
+        const std::size_t uses = annotations.KeywordUses(keyword);
+        if (uses < plan.estimate) {
+            plan.access = Access::KEYWORD;
+            plan.estimate = uses;
+            plan.files = annotations.FilesUsingKeyword(keyword);
+        }
+    }
+    return plan;
+}
+
+std::string AnnotationQuery::DescribePlan(const Plan& plan) {
+    const std::string candidates = std::to_string(plan.estimate) + " candidate(s)";
+    switch (plan.access) {
+    case Access::PATH_PREFIX:
+        return candidates + " by path";
+    case Access::KEYWORD:
+        return candidates + " by keyword, in " + std::to_string(plan.files.size()) + " file(s)";
+    case Access::TEXT:
+        return "Up to " + candidates + " by full-text search, ranked";
+    default:
+        return candidates + " by scanning every file";
+    }
+}
+
+bool AnnotationQuery::InPath(const std::string& fileRef) const {
+    return this->pathPrefix.empty() || (fileRef.compare(0, this->pathPrefix.size(), this->pathPrefix) == 0 &&
+        (fileRef.size() == this->pathPrefix.size() || fileRef[this->pathPrefix.size()] == '/'));
+}
+
+bool AnnotationQuery::Matches(const Annotation& annotation) const {
+    return this->MatchesFilters(annotation) && TextIndex::Matches(this->textClauses, annotation.contents);
+}
+
+bool AnnotationQuery::MatchesFilters(const Annotation& annotation) const {
+    if (this->kind == Kind::BOOKMARK || annotation.lineRef < this->firstLine || annotation.lineRef > this->lastLine ||
+            !this->InPath(annotation.fileRef)) {
+        return false;
+    }
+    for (const std::string& keyword : this->keywords) {
+        if (std::find(annotation.keywords.cbegin(), annotation.keywords.cend(), keyword) == annotation.keywords.cend()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AnnotationQuery::Matches(const Bookmark& bookmark) const {
+    // Bookmarks have neither keywords nor text:
+    return this->kind != Kind::ANNOTATION && this->keywords.empty() && this->textClauses.empty() &&
+        bookmark.lineRef >= this->firstLine && bookmark.lineRef <= this->lastLine && this->InPath(bookmark.fileRef);
+}
+
+AnnotationQuery::Kind AnnotationQuery::GetKind() const {
+    return this->kind;
+}
+
+template<typename T>
+std::pair<typename std::vector<T>::const_iterator, typename std::vector<T>::const_iterator> AnnotationQuery::OnLines(const std::vector<T>& items) const {
+    const typename std::vector<T>::const_iterator first = std::lower_bound(items.cbegin(), items.cend(), this->firstLine,
+        [](const T& item, const std::size_t line) { return item.lineRef < line; });
+    const typename std::vector<T>::const_iterator end = std::upper_bound(first, items.cend(), this->lastLine,
+        [](const std::size_t line, const T& item) { return line < item.lineRef; });
+    return { first, end };
+}
+
+void AnnotationQuery::MatchFile(const std::string& fileRef, const std::vector<Annotation>& fileAnnotations,
+                                const std::vector<Bookmark>& fileBookmarks, const std::string& codebasePath,
+                                std::vector<Finding>& findings) const {
+    const std::size_t firstFinding = findings.size();
+    if (this->kind != Kind::BOOKMARK) {
+        const std::pair<std::vector<Annotation>::const_iterator, std::vector<Annotation>::const_iterator> onLines = this->OnLines(fileAnnotations);
+        for (std::vector<Annotation>::const_iterator annotation = onLines.first; annotation != onLines.second; ++annotation) {
+            if (this->Matches(*annotation)) {
+                findings.push_back(Finding {
+                    .fileRef = fileRef, .lineRef = annotation->lineRef, .endLineRef = annotation->endLineRef,
+                    .isBookmark = false, .contents = annotation->contents, .code = "", .score = 0
+                });
+            }
+        }
+    }
+    if (this->kind != Kind::ANNOTATION) {
+        const std::pair<std::vector<Bookmark>::const_iterator, std::vector<Bookmark>::const_iterator> onLines = this->OnLines(fileBookmarks);
+        for (std::vector<Bookmark>::const_iterator bookmark = onLines.first; bookmark != onLines.second; ++bookmark) {
+            if (this->Matches(*bookmark)) {
+                findings.push_back(Finding {
+                    .fileRef = fileRef, .lineRef = bookmark->lineRef, .endLineRef = bookmark->lineRef,
+                    .isBookmark = true, .contents = "", .code = "", .score = 0
+                });
+            }
+        }
+    }
+    if (findings.size() == firstFinding) {
+        return;
+    }
+
+    // Only the found lines are read, in order so that it's a single pass over the file:
+    std::sort(findings.begin() + static_cast<std::ptrdiff_t>(firstFinding), findings.end(), [](const Finding& a, const Finding& b) {
+        return a.lineRef < b.lineRef;
+    });
+    PagedFile file(codebasePath + fileRef, false);
+    for (std::size_t i = firstFinding; i < findings.size(); i++) {
+        const std::vector<std::string> foundLine = file.ReadLines(findings[i].lineRef, 1);
+        if (!foundLine.empty()) {
+            findings[i].code = foundLine.front();
+        }
+    }
+}
+
+std::vector<AnnotationQuery::Finding> AnnotationQuery::MatchHits(const std::vector<TextIndex::Hit>& hits,
+                                                                  const AnnotationCollection::Snapshot& annotations,
+                                                                  const std::string& codebasePath) const {
+    // The hits' files are visited in parallel, each a single pass in line order:
+    std::unordered_map<std::string, std::vector<std::size_t>> fileHits;
+    std::vector<std::string> files;
+    for (std::size_t i = 0; i < hits.size(); i++) {
+        std::vector<std::size_t>& hitIndexes = fileHits[hits[i].fileRef];
+        if (hitIndexes.empty()) {
+            files.push_back(hits[i].fileRef);
+        }
+        hitIndexes.push_back(i);
+    }
+
+    std::vector<Finding> findings(hits.size());
+    std::vector<char> resolved(hits.size(), false);
+    Parallel::For(files.size(), [&](const std::size_t f) {
+        const std::vector<Annotation>& fileAnnotations = annotations.Get(files[f]);
+        std::vector<std::size_t> hitIndexes = fileHits.at(files[f]);
+        std::sort(hitIndexes.begin(), hitIndexes.end(), [&hits](const std::size_t a, const std::size_t b) {
+            return hits[a].lineRef < hits[b].lineRef;
+        });
+
+        std::vector<const Annotation*> used; // Should two annotations on a line share an id (or have none).
+        std::vector<std::size_t> found;
+        for (const std::size_t hitIndex : hitIndexes) {
+            const TextIndex::Hit& hit = hits[hitIndex];
+            const std::vector<Annotation>::const_iterator onLine = std::lower_bound(fileAnnotations.cbegin(), fileAnnotations.cend(), hit.lineRef,
+                [](const Annotation& annotation, const std::size_t line) { return annotation.lineRef < line; });
+            for (std::vector<Annotation>::const_iterator annotation = onLine;
+                 annotation != fileAnnotations.cend() && annotation->lineRef == hit.lineRef; ++annotation) {
+                // The index may have moved on from the snapshot, so the words are checked again:
+                if (annotation->id != hit.id || std::find(used.cbegin(), used.cend(), &*annotation) != used.cend() ||
+                        !TextIndex::Matches(this->textClauses, annotation->contents)) {
+                    continue;
+                }
+                used.push_back(&*annotation);
+                if (this->MatchesFilters(*annotation)) {
+                    findings[hitIndex] = Finding {
+                        .fileRef = hit.fileRef, .lineRef = annotation->lineRef, .endLineRef = annotation->endLineRef,
+                        .isBookmark = false, .contents = annotation->contents, .code = "", .score = hit.score
+                    };
+                    resolved[hitIndex] = true;
+                    found.push_back(hitIndex);
+                }
+                break;
+            }
+        }
+        if (found.empty()) {
+            return;
+        }
+
+        PagedFile file(codebasePath + files[f], false);
+        for (const std::size_t hitIndex : found) {
+            const std::vector<std::string> foundLine = file.ReadLines(findings[hitIndex].lineRef, 1);
+            if (!foundLine.empty()) {
+                findings[hitIndex].code = foundLine.front();
+            }
+        }
+    });
+
+    std::vector<Finding> rankedFindings;
+    for (std::size_t i = 0; i < hits.size(); i++) {
+        if (resolved[i]) {
+            rankedFindings.push_back(std::move(findings[i]));
+        }
+    }
+    return rankedFindings;
+}
+
+void AnnotationQuery::Run(const Plan& plan, const AnnotationCollection::Snapshot& annotations, const BookmarkCollection::Snapshot& bookmarks,
+                          const std::string& codebasePath, const FindingsCallback& found, const std::atomic<bool>& cancelled) const {
+    TRACE_SCOPE("AnnotationQuery::Run");
+    if (plan.access == Access::TEXT) {
+        const std::vector<TextIndex::Hit> hits = plan.annotations != nullptr ?
+            plan.annotations->SearchText(this->textClauses) : std::vector<TextIndex::Hit>();
+        // Best first, a chunk of hits at a time:
+        for (std::size_t chunkStart = 0; chunkStart < hits.size() && !cancelled; chunkStart += Config::Query::ChunkHits) {
+            const std::size_t chunkEnd = std::min(hits.size(), chunkStart + Config::Query::ChunkHits);
+            std::vector<Finding> chunkFindings = this->MatchHits(
+                std::vector<TextIndex::Hit>(hits.cbegin() + static_cast<std::ptrdiff_t>(chunkStart),
+                                            hits.cbegin() + static_cast<std::ptrdiff_t>(chunkEnd)),
+                annotations, codebasePath);
+            if (!chunkFindings.empty() && !cancelled) {
+                found(std::move(chunkFindings));
+            }
+        }
+        return;
+    }
+
+    std::vector<std::string> files;
+    if (plan.access == Access::KEYWORD) {
+        files = plan.files;
+    }
+    else {
+        // Every file with something in it (under the path, if that's what was planned):
+        std::unordered_set<std::string> seenFiles;
+        const auto visit = [this, &plan, &files, &seenFiles](const std::string& fileRef) {
+            if ((plan.access == Access::SCAN || this->InPath(fileRef)) && seenFiles.insert(fileRef).second) {
+                files.push_back(fileRef);
+            }
+        };
+        if (this->kind != Kind::BOOKMARK) {
+            annotations.ForEach([&visit](const std::string& fileRef, const std::vector<Annotation>&) { visit(fileRef); });
+        }
+        if (this->kind != Kind::ANNOTATION) {
+            bookmarks.ForEach([&visit](const std::string& fileRef, const std::vector<Bookmark>&) { visit(fileRef); });
+        }
+    }
+
+    // A chunk of files at a time is matched across all cores, and whatever it found handed over
+    // before moving on to the next:
+    for (std::size_t chunkStart = 0; chunkStart < files.size() && !cancelled; chunkStart += Config::Query::ChunkFiles) {
+        const std::size_t chunkSize = std::min(Config::Query::ChunkFiles, files.size() - chunkStart);
+        std::vector<std::vector<Finding>> fileFindings(chunkSize);
+        Parallel::For(chunkSize, [&](const std::size_t i) {
+            if (cancelled) {
+                return;
+            }
+            const std::string& fileRef = files[chunkStart + i];
+            this->MatchFile(fileRef, annotations.Get(fileRef), bookmarks.Get(fileRef), codebasePath, fileFindings[i]);
+        });
+
+        std::vector<Finding> chunkFindings;
+        for (std::vector<Finding>& findings : fileFindings) {
+            std::move(findings.begin(), findings.end(), std::back_inserter(chunkFindings));
+        }
+        if (!chunkFindings.empty() && !cancelled) {
+            found(std::move(chunkFindings));
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef ANNOTATIONQUERY_H
+#define ANNOTATIONQUERY_H
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+#include "annotation.h"
+#include "bookmark.h"
+#include "textindex.h"
+
+// Filters a project's annotations and bookmarks by a query made of space separated terms, all
+// of which must match:
+//
+//     #uaf                 Annotations using the keyword "uaf".
+//     in:src/net/**        Anything in the file/directory src/net ("path:" works too).
+//     lines:100-900        Anything on lines 100 to 900 ("line:42" for one), ranges by their first line.
+//     is:bookmark          Only bookmarks ("is:annotation" is the default, "is:any" for both).
+//     free  "use after"    Annotations using the word/phrase (ignoring case).
+//     alloc*               Annotations using a word starting with "alloc".
+//
+// Queries are planned on the GUI thread, where the collections' counts, keyword postings and
+// full-text index can be consulted, and then run against snapshots from any thread. Queries
+// with words in them are answered by the full-text index, searched when the query's run (any
+// annotations it finds that aren't in the snapshot are left out), their findings ranked (BM25)
+// and handed over best first. Otherwise the plan visits only the files that the most selective
+// term allows (a directory's, or those using the rarest keyword) and narrows each file's (line
+// sorted) items to the requested lines, falling back to a parallel scan of every file when
+// nothing narrows it down.
+
+class AnnotationQuery {
+public:
+    enum class Kind {
+        ANNOTATION,
+        BOOKMARK,
+        ANY
+    };
+
+    // How the items to check are found.
+    enum class Access {
+        PATH_PREFIX, // Files under pathPrefix.
+        KEYWORD, // Files using the rarest keyword.
+        TEXT, // The full-text index's hits.
+        SCAN // Every file.
+    };
+
+    struct Plan {
+        Access access;
+        std::vector<std::string> files; // For KEYWORD.
+        // For TEXT, whose full-text index to search. Must outlive running the plan.
+        const AnnotationCollection* annotations;
+        std::size_t estimate; // Items expected to be checked.
+    };
+
+    struct Finding {
+        std::string fileRef;
+        std::size_t lineRef;
+        std::size_t endLineRef;
+        bool isBookmark;
+        std::string contents; // Empty for bookmarks.
+        std::string code; // The (first) line found on.
+        double score; // Relevance to the query's words, 0 when it has none.
+    };
+    // Called with findings as they're found, in batches.
+    typedef std::function<void(std::vector<Finding>)> FindingsCallback;
+
+    // Throws std::invalid_argument describing the first malformed term.
+    explicit AnnotationQuery(const std::string& text);
+
+    // GUI thread only, alongside whichever edits 'annotations'/'bookmarks' are subject to.
+    Plan MakePlan(const AnnotationCollection& annotations, const BookmarkCollection& bookmarks) const;
+    static std::string DescribePlan(const Plan& plan);
+
+    // Any thread. Reads each finding's line of code from the files under 'codebasePath', stops
+    // early once 'cancelled'.
+    void Run(const Plan& plan, const AnnotationCollection::Snapshot& annotations, const BookmarkCollection::Snapshot& bookmarks,
+             const std::string& codebasePath, const FindingsCallback& found, const std::atomic<bool>& cancelled) const;
+
+    bool Matches(const Annotation& annotation) const;
+    bool Matches(const Bookmark& bookmark) const;
+    // Which sort of items it finds ('is:').
+    Kind GetKind() const;
+private:
+    Kind kind = Kind::ANNOTATION;
+    std::string pathPrefix; // Without a trailing '/', empty for everywhere.
+    std::vector<std::string> keywords;
+    std::vector<TextIndex::Clause> textClauses;
+    std::size_t firstLine = 0;
+    std::size_t lastLine = std::numeric_limits<std::size_t>::max(); // Inclusive.
+
+    bool InPath(const std::string& fileRef) const;
+    // Matches() bar the words, which the full-text index has already checked.
+    bool MatchesFilters(const Annotation& annotation) const;
+    // The line sorted 'items' on the requested lines.
+    template<typename T>
+    std::pair<typename std::vector<T>::const_iterator, typename std::vector<T>::const_iterator> OnLines(const std::vector<T>& items) const;
+    // Findings from one file's items, appended to 'findings'.
+    void MatchFile(const std::string& fileRef, const std::vector<Annotation>& fileAnnotations,
+                   const std::vector<Bookmark>& fileBookmarks, const std::string& codebasePath,
+                   std::vector<Finding>& findings) const;
+    // Findings for one chunk of the full-text index's ranked hits, in the same order.
+    std::vector<Finding> MatchHits(const std::vector<TextIndex::Hit>& hits, const AnnotationCollection::Snapshot& annotations,
+                                   const std::string& codebasePath) const;
+};
+
+#endif // ANNOTATIONQUERY_H
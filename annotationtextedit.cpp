@@ -0,0 +1,125 @@
+#include "annotationtextedit.h"
+#include <QAbstractItemView>
+#include <QKeyEvent>
+#include <QMimeData>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <algorithm>
+
+AnnotationTextEdit::AnnotationTextEdit(QWidget* const parent) : QPlainTextEdit(parent),
+    completer(new QCompleter(this)), completions(new QStandardItemModel(this)) {
+    // The trie has already ranked the tags, the completer only has to show them:
+    this->completer->setModel(this->completions);
+    this->completer->setModelSorting(QCompleter::UnsortedModel);
+    this->completer->setCompletionRole(Qt::UserRole);
+    this->completer->setCaseSensitivity(Qt::CaseSensitive);
+    this->completer->setCompletionMode(QCompleter::PopupCompletion);
+    this->completer->setWidget(this);
+
+    QObject::connect(this, SIGNAL(textChanged()), this, SLOT(UpdateCompletions()));
+    QObject::connect(this->completer, SIGNAL(activated(QString)), this, SLOT(InsertCompletion(QString)));
+}
+
+void AnnotationTextEdit::SetTagSource(const AnnotationCollection* const annotations) {
+    this->tagSource = annotations;
+}
+
+void AnnotationTextEdit::SetAttachmentSink(const std::function<bool(const QString&)>& sink) {
+    this->attachmentSink = sink;
+}
+
+void AnnotationTextEdit::insertFromMimeData(const QMimeData* const source) {
+    if (this->attachmentSink && source->hasText()) {
+        const QString text = source->text();
+        if (text.size() >= Config::Attachments::PasteThreshold && this->attachmentSink(text)) {
+            return;
+        }
+    }
+    QPlainTextEdit::insertFromMimeData(source);
+}
+
+int AnnotationTextEdit::TagStart() const {
+    const QTextCursor cursor = this->textCursor();
+    const QString blockText = cursor.block().text();
+    for (int i = cursor.positionInBlock() - 1; i >= 0; i--) {
+        const QChar character = blockText[i];
+        if (character == '#') {
+            return cursor.block().position() + i + 1;
+        }
+        if (character.unicode() < 0x80 &&
+            std::find(Annotation::CutoffChars.cbegin(), Annotation::CutoffChars.cend(),
+                      static_cast<char>(character.unicode())) != Annotation::CutoffChars.cend()) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void AnnotationTextEdit::UpdateCompletions() {
+    if (this->insertingCompletion) {
+        return;
+    }
+    const int tagStart = this->TagStart();
+    if (this->tagSource == nullptr || tagStart < 0 || this->textCursor().hasSelection()) {
+        this->completer->popup()->hide();
+        return;
+    }
+
+    QTextCursor prefixCursor = this->textCursor();
+    prefixCursor.setPosition(tagStart, QTextCursor::KeepAnchor);
+    const QString prefix = prefixCursor.selectedText();
+    const std::vector<TagTrie::Completion> tags = this->tagSource->CompleteTag(prefix.toStdString());
+    // Nothing to offer once the tag is typed out in full and nothing longer shares its prefix:
+    if (tags.empty() || (tags.size() == 1 && tags.front().keyword == prefix.toStdString())) {
+        this->completer->popup()->hide();
+        return;
+    }
+
+    this->completions->clear();
+    for (const TagTrie::Completion& tag : tags) {
+        QStandardItem* const item = new QStandardItem(
+            QString::fromStdString("#" + tag.keyword + "  (" + std::to_string(tag.uses) + ")")
+        );
+        item->setData(QString::fromStdString(tag.keyword), Qt::UserRole);
+        item->setEditable(false);
+        this->completions->appendRow(item);
+    }
+    this->completer->setCompletionPrefix(prefix);
+    this->completer->popup()->setCurrentIndex(this->completer->completionModel()->index(0, 0));
+
+    QRect popupRect = this->cursorRect();
+    popupRect.setWidth(this->completer->popup()->sizeHintForColumn(0) +
+                       this->completer->popup()->verticalScrollBar()->sizeHint().width());
+    this->completer->complete(popupRect);
+}
+
+void AnnotationTextEdit::InsertCompletion(const QString& tag) {
+    const int tagStart = this->TagStart();
+    if (tagStart < 0) {
+        return;
+    }
+    QTextCursor tagCursor = this->textCursor();
+    tagCursor.setPosition(tagStart, QTextCursor::KeepAnchor);
+    this->insertingCompletion = true;
+    tagCursor.insertText(tag);
+    this->insertingCompletion = false;
+    this->setTextCursor(tagCursor);
+}
+
+void AnnotationTextEdit::keyPressEvent(QKeyEvent* event) {
+    // Whilst the popup's open the completer acts on these itself (after offering them to us):
+    if (this->completer->popup()->isVisible()) {
+        switch (event->key()) {
+            case Qt::Key_Enter:
+            case Qt::Key_Return:
+            case Qt::Key_Escape:
+            case Qt::Key_Tab:
+            case Qt::Key_Backtab:
+                event->ignore();
+                return;
+            default:
+                break;
+        }
+    }
+    QPlainTextEdit::keyPressEvent(event);
+}
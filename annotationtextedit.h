@@ -0,0 +1,42 @@
+#ifndef ANNOTATIONTEXTEDIT_H
+#define ANNOTATIONTEXTEDIT_H
+#include <QCompleter>
+#include <QObject>
+#include <QPlainTextEdit>
+#include <QStandardItemModel>
+#include <QWidget>
+#include <functional>
+#include "annotation.h"
+
+// The annotation editor's text box, offers the project's most used #tags as the user types
+// one (the popup follows the cursor and Enter/Tab accepts the highlighted tag). Large pastes
+// can be diverted into attachments.
+class AnnotationTextEdit : public QPlainTextEdit
+{
+    Q_OBJECT
+public:
+    AnnotationTextEdit(QWidget* const parent = nullptr);
+
+    // Tags are completed from 'annotations', which must outlive this editor.
+    void SetTagSource(const AnnotationCollection* const annotations);
+    // Text at least Config::Attachments::PasteThreshold long that's pasted or dropped is given to
+    // 'sink' instead of being inserted, unless it returns false.
+    void SetAttachmentSink(const std::function<bool(const QString&)>& sink);
+private slots:
+    void UpdateCompletions();
+    void InsertCompletion(const QString& tag);
+private:
+    const AnnotationCollection* tagSource = nullptr;
+    std::function<bool(const QString&)> attachmentSink;
+    QCompleter* const completer;
+    QStandardItemModel* const completions;
+    bool insertingCompletion = false;
+
+    // Document position just after the '#' of the tag being typed at the cursor, or -1.
+    int TagStart() const;
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+    void insertFromMimeData(const QMimeData* source) override;
+};
+
+#endif // ANNOTATIONTEXTEDIT_H
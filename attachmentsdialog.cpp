@@ -0,0 +1,55 @@
+#include "attachmentsdialog.h"
+#include <QVBoxLayout>
+#include <stdexcept>
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+AttachmentsDialog::AttachmentsDialog(std::vector<Attachment> attachments, std::shared_ptr<const AttachmentStore> store,
+                                     QWidget* const parent) : QDialog(parent),
+    attachments(std::move(attachments)), store(std::move(store)), attachmentList(new QListWidget(this)),
+    contentsView(new QPlainTextEdit(this)), detachButton(new QPushButton("Detach", this)) {
+    this->setWindowTitle("Attachments");
+    this->contentsView->setReadOnly(true);
+    this->contentsView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    for (const Attachment& attachment : this->attachments) {
+        this->attachmentList->addItem(QString::fromStdString(AttachmentStore::Describe(attachment)));
+    }
+
+    QVBoxLayout* const layout = new QVBoxLayout(this);
+    layout->addWidget(this->attachmentList, 1);
+    layout->addWidget(this->contentsView, 4);
+    layout->addWidget(this->detachButton);
+    this->resize(800, 600);
+
+    QObject::connect(this->attachmentList, SIGNAL(currentRowChanged(int)), this, SLOT(ShowAttachment(int)));
+    QObject::connect(this->detachButton, SIGNAL(clicked()), this, SLOT(DetachCurrent()));
+    this->attachmentList->setCurrentRow(0);
+}
+
+const std::vector<Attachment>& AttachmentsDialog::Attachments() const {
+    return this->attachments;
+}
+
+void AttachmentsDialog::ShowAttachment(const int row) {
+    this->detachButton->setEnabled(row >= 0);
+    if (row < 0 || static_cast<std::size_t>(row) >= this->attachments.size()) {
+        this->contentsView->clear();
+        return;
+    }
+    const Attachment& attachment = this->attachments[static_cast<std::size_t>(row)];
+    WATCHDOG_TRACE_SCOPE_DETAIL("AttachmentsDialog::ShowAttachment", attachment.id);
+    try {
+        this->contentsView->setPlainText(QString::fromStdString(this->store->Get(attachment.id)));
+    } catch (const std::runtime_error& failure) {
+        this->contentsView->setPlainText(QString::fromStdString(failure.what()));
+    }
+}
+
+void AttachmentsDialog::DetachCurrent() {
+    const int row = this->attachmentList->currentRow();
+    if (row < 0) {
+        return;
+    }
+    this->attachments.erase(this->attachments.begin() + row);
+    delete this->attachmentList->takeItem(row);
+}
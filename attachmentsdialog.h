@@ -0,0 +1,35 @@
+#ifndef ATTACHMENTSDIALOG_H
+#define ATTACHMENTSDIALOG_H
+#include <QDialog>
+#include <QListWidget>
+#include <QObject>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QWidget>
+#include <memory>
+#include <vector>
+#include "attachmentstore.h"
+
+// An annotation's attachments, each read in from the project's store only once it's selected.
+// Attachments can be detached from the annotation (Attachments() being what's left), the store
+// keeps them either way.
+class AttachmentsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    AttachmentsDialog(std::vector<Attachment> attachments, std::shared_ptr<const AttachmentStore> store,
+                      QWidget* const parent = nullptr);
+
+    const std::vector<Attachment>& Attachments() const;
+private slots:
+    void ShowAttachment(int row);
+    void DetachCurrent();
+private:
+    std::vector<Attachment> attachments;
+    const std::shared_ptr<const AttachmentStore> store;
+    QListWidget* const attachmentList;
+    QPlainTextEdit* const contentsView;
+    QPushButton* const detachButton;
+};
+
+#endif // ATTACHMENTSDIALOG_H
@@ -0,0 +1,235 @@
+#include "attachmentstore.h"
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "configuration.h"
+
+namespace {
+    // The first byte of each stored attachment:
+    const static char RawFlag = 'r';
+    const static char CompressedFlag = 'z';
+    // qCompress() and qUncompress() handle at most this much at once (zlib's lengths are
+    // 32 bit), anything larger is stored raw.
+    const static std::size_t MaxCompressibleSize = static_cast<std::size_t>(std::numeric_limits<int>::max());
+
+    std::string HashContents(const std::string& contents) {
+        return QCryptographicHash::hash(QByteArray::fromRawData(contents.data(), static_cast<qsizetype>(contents.size())),
+                                        QCryptographicHash::Sha256).toHex().toStdString();
+    }
+
+    std::string Store(const std::string& contents) {
+        if (contents.size() >= Config::Attachments::CompressedSize && contents.size() <= MaxCompressibleSize) {
+            const QByteArray compressed = qCompress(
+                reinterpret_cast<const uchar*>(contents.data()), static_cast<qsizetype>(contents.size()));
+            if (static_cast<std::size_t>(compressed.size()) <=
+                contents.size() - contents.size() / Config::Attachments::CompressionSaving) {
+                return CompressedFlag + compressed.toStdString();
+            }
+        }
+        return RawFlag + contents;
+    }
+
+    std::string Restore(const std::string& stored, const std::string& id) {
+        std::string contents;
+        if (!stored.empty() && stored.front() == RawFlag) {
+            contents = stored.substr(1);
+        }
+        else if (!stored.empty() && stored.front() == CompressedFlag && stored.size() - 1 <= MaxCompressibleSize) {
+            const QByteArray uncompressed = qUncompress(
+                reinterpret_cast<const uchar*>(stored.data() + 1), static_cast<qsizetype>(stored.size() - 1));
+            contents = uncompressed.toStdString();
+        }
+        // qUncompress() gives nothing for bad data (and nothing larger than it handles is ever
+        // stored compressed), so this catches that as well:
+        if (stored.empty() || HashContents(contents) != id) {
+            throw std::runtime_error("Attachment " + id + " is corrupt");
+        }
+        return contents;
+    }
+
+    bool IsValidId(const std::string& id) {
+        return id.size() == 64 && std::all_of(id.cbegin(), id.cend(), [](const char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+        });
+    }
+}
+
+AttachmentStore::AttachmentStore() : account(MemoryAccounting::COLLECTIONS, "attachments") {}
+
+Attachment AttachmentStore::Add(const std::string& contents, const std::string& name) {
+    const Attachment attachment {
+        .id = HashContents(contents),
+        .name = name,
+        .size = contents.size(),
+        .lines = static_cast<std::size_t>(std::count(contents.cbegin(), contents.cend(), '\n')) +
+                 (!contents.empty() && contents.back() != '\n' ? 1 : 0)
+    };
+
+    {
+        const std::lock_guard<std::mutex> storeLock(this->mutex);
+        if (this->unsaved.find(attachment.id) != this->unsaved.cend()) {
+            return attachment;
+        }
+        for (const std::filesystem::path& directory : this->directories) {
+            std::error_code existsError;
+            if (std::filesystem::exists(directory / attachment.id, existsError)) {
+                return attachment;
+            }
+        }
+    }
+
+    // Compressed without holding the lock (it's the slow part), should it be added twice at once
+    // the first one in is kept:
+    const std::shared_ptr<const std::string> stored = std::make_shared<const std::string>(Store(contents));
+    const std::lock_guard<std::mutex> storeLock(this->mutex);
+    if (this->unsaved.emplace(attachment.id, stored).second) {
+        this->unsavedBytes += stored->size();
+        this->account.Set(this->unsavedBytes);
+    }
+    return attachment;
+}
+
+std::string AttachmentStore::ReadStored(const std::string& id) const {
+    std::vector<std::filesystem::path> directories;
+    {
+        const std::lock_guard<std::mutex> storeLock(this->mutex);
+        const std::unordered_map<std::string, std::shared_ptr<const std::string>>::const_iterator stored = this->unsaved.find(id);
+        if (stored != this->unsaved.cend()) {
+            return *stored->second;
+        }
+        directories = this->directories;
+    }
+
+    // Ids end up in paths, so anything that isn't one is never looked for:
+    if (IsValidId(id)) {
+        for (const std::filesystem::path& directory : directories) {
+            std::ifstream input(directory / id, std::ios::binary);
+            if (input.is_open()) {
+                return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            }
+        }
+    }
+    throw std::runtime_error("Attachment " + id + " is missing");
+}
+
+std::string AttachmentStore::Get(const std::string& id) const {
+    return Restore(this->ReadStored(id), id);
+}
+
+void AttachmentStore::Include(const AttachmentStore& other) {
+    if (&other == this) {
+        return;
+    }
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> otherUnsaved;
+    std::vector<std::filesystem::path> otherDirectories;
+    {
+        const std::lock_guard<std::mutex> otherLock(other.mutex);
+        otherUnsaved = other.unsaved;
+        otherDirectories = other.directories;
+    }
+
+    const std::lock_guard<std::mutex> storeLock(this->mutex);
+    for (const std::pair<const std::string, std::shared_ptr<const std::string>>& stored : otherUnsaved) {
+        if (this->unsaved.insert(stored).second) {
+            this->unsavedBytes += stored.second->size();
+        }
+    }
+    this->account.Set(this->unsavedBytes);
+    // After this store's own, which are more likely to be the ones looked for:
+    for (const std::filesystem::path& directory : otherDirectories) {
+        if (std::find(this->directories.cbegin(), this->directories.cend(), directory) == this->directories.cend()) {
+            this->directories.push_back(directory);
+        }
+    }
+}
+
+void AttachmentStore::AddDirectory(const std::filesystem::path& directory) {
+    const std::lock_guard<std::mutex> storeLock(this->mutex);
+    this->directories.erase(std::remove(this->directories.begin(), this->directories.end(), directory), this->directories.end());
+    this->directories.insert(this->directories.begin(), directory);
+}
+
+void AttachmentStore::Save(const std::filesystem::path& directory, const std::vector<std::string>& ids) const {
+    if (ids.empty()) {
+        return;
+    }
+    std::error_code directoryError;
+    std::filesystem::create_directories(directory, directoryError);
+    if (directoryError) {
+        throw std::runtime_error("Unable to create " + directory.string() + ": " + directoryError.message());
+    }
+
+    // Attachments are immutable (being named by their contents), so any already there are kept:
+    std::string missingIds;
+    for (const std::string& id : ids) {
+        const std::filesystem::path path = directory / id;
+        std::error_code existsError;
+        if (IsValidId(id) && std::filesystem::exists(path, existsError)) {
+            continue;
+        }
+        std::string stored;
+        try {
+            stored = this->ReadStored(id);
+        } catch (const std::runtime_error&) {
+            // Lost (e.g. its directory was deleted), the rest are still written so as few as
+            // possible are:
+            missingIds += (missingIds.empty() ? "" : ", ") + id;
+            continue;
+        }
+        // Written alongside and renamed into place, so an attachment is never left half written:
+        const std::filesystem::path temporaryPath = directory / (id + ".tmp");
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            output.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+            if (!output.flush()) {
+                throw std::runtime_error("Unable to write " + temporaryPath.string());
+            }
+        }
+        std::error_code renameError;
+        std::filesystem::rename(temporaryPath, path, renameError);
+        if (renameError) {
+            std::filesystem::remove(temporaryPath, renameError);
+            throw std::runtime_error("Unable to write " + path.string());
+        }
+    }
+    if (!missingIds.empty()) {
+        throw std::runtime_error("Attachment(s) " + missingIds + " can no longer be found");
+    }
+
+    // Everything in 'ids' is now in 'directory', so there's no need to hold on to it:
+    const std::lock_guard<std::mutex> storeLock(this->mutex);
+    for (const std::string& id : ids) {
+        const std::unordered_map<std::string, std::shared_ptr<const std::string>>::const_iterator stored = this->unsaved.find(id);
+        if (stored != this->unsaved.cend()) {
+            this->unsavedBytes -= stored->second->size();
+            this->unsaved.erase(stored);
+        }
+    }
+    this->account.Set(this->unsavedBytes);
+    if (std::find(this->directories.cbegin(), this->directories.cend(), directory) == this->directories.cend()) {
+        this->directories.insert(this->directories.begin(), directory);
+    }
+}
+
+std::filesystem::path AttachmentStore::DirectoryFor(const std::filesystem::path& projectPath) {
+    std::filesystem::path directory = projectPath;
+    directory += ".attachments";
+    return directory;
+}
+
+std::string AttachmentStore::Describe(const Attachment& attachment) {
+    std::string size;
+    if (attachment.size < 1024) {
+        size = std::to_string(attachment.size) + " B";
+    }
+    else if (attachment.size < 1024 * 1024) {
+        size = std::to_string((attachment.size + 512) / 1024) + " KiB";
+    }
+    else {
+        size = std::to_string((attachment.size + 512 * 1024) / (1024 * 1024)) + " MiB";
+    }
+    return attachment.name + " (" + std::to_string(attachment.lines) + " line(s), " + size + ")";
+}
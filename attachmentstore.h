@@ -0,0 +1,62 @@
+#ifndef ATTACHMENTSTORE_H
+#define ATTACHMENTSTORE_H
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "memoryaccounting.h"
+
+// Large evidence pasted into annotations (crash logs, hexdumps, proofs of concept) is kept out
+// of the annotations themselves, which only refer to it, so that loading, saving, exporting and
+// rendering a project never has to go through it. Each attachment is stored once under the
+// SHA-256 of its contents however many annotations (or merged projects) refer to it, compressed
+// when that's worthwhile. A saved project's attachments live in a directory alongside it (see
+// DirectoryFor()), a file each, and are only read when one is opened.
+
+// What an annotation holds of an attachment.
+struct Attachment {
+    std::string id; // SHA-256 of the contents, in hex.
+    std::string name; // Shown in place of the contents.
+    std::size_t size; // Of the contents, in bytes.
+    std::size_t lines;
+};
+
+// Safe to use from any thread.
+class AttachmentStore {
+public:
+    AttachmentStore();
+
+    // Stores 'contents' (unless an identical attachment already is) and returns a reference to it.
+    Attachment Add(const std::string& contents, const std::string& name);
+    // The contents of attachment 'id', read in (and checked against its id) on each call. Throws
+    // std::runtime_error if it can't be found or has been corrupted.
+    std::string Get(const std::string& id) const;
+    // Makes 'other''s attachments available from this store too, e.g. once projects are merged.
+    void Include(const AttachmentStore& other);
+    // Where to look for attachments that aren't held in memory, e.g. a loaded project's.
+    void AddDirectory(const std::filesystem::path& directory);
+    // Writes each of 'ids' that isn't there already to 'directory' (created if need be), throws
+    // on failure, naming any that can't be found (after writing the rest). Those held in memory
+    // are read from there afterwards instead.
+    void Save(const std::filesystem::path& directory, const std::vector<std::string>& ids) const;
+
+    // The directory kept alongside the project saved at 'projectPath'.
+    static std::filesystem::path DirectoryFor(const std::filesystem::path& projectPath);
+    // "<name> (<lines> line(s), <size>)", shown in place of the attachment.
+    static std::string Describe(const Attachment& attachment);
+private:
+    mutable std::mutex mutex;
+    // Attachments not yet saved anywhere (as they're stored), by id. Shared with stores they've
+    // been included into.
+    mutable std::unordered_map<std::string, std::shared_ptr<const std::string>> unsaved;
+    mutable std::vector<std::filesystem::path> directories; // Searched most recently added first.
+    mutable MemoryAccounting::Account account;
+    mutable std::size_t unsavedBytes = 0;
+
+    // The stored form of attachment 'id' (a flag byte, then the contents, compressed or not).
+    std::string ReadStored(const std::string& id) const;
+};
+
+#endif // ATTACHMENTSTORE_H
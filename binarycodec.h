@@ -0,0 +1,73 @@
+#ifndef BINARYCODEC_H
+#define BINARYCODEC_H
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Blocks' binary project format's building blocks, laid out like CacheFile's (numbers as they
+// are in memory, strings as a 32-bit length then the bytes) but written to and read from
+// memory so that records can be rendered in parallel. Reading past the end of the data (or
+// any count that couldn't fit in what's left) throws std::runtime_error.
+
+namespace BinaryCodec {
+    inline void AppendUnsigned(std::string& output, const std::uint64_t value) {
+        output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    inline void AppendString(std::string& output, const std::string& value) {
+        const std::uint32_t length = static_cast<std::uint32_t>(value.size());
+        output.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        output += value;
+    }
+
+    class Reader {
+    public:
+        Reader(const char* data, std::size_t length) : data(data), length(length) {}
+
+        std::uint64_t ReadUnsigned() {
+            std::uint64_t value;
+            this->ReadBytes(&value, sizeof(value));
+            return value;
+        }
+        // For counts of things at least 'elementBytes' long each.
+        std::uint64_t ReadCount(const std::size_t elementBytes) {
+            const std::uint64_t count = this->ReadUnsigned();
+            if (count > (this->length - this->position) / elementBytes) {
+                throw std::runtime_error("Invalid project file: impossible count at byte " + std::to_string(this->position));
+            }
+            return count;
+        }
+        void ReadString(std::string& value) {
+            std::uint32_t stringLength;
+            this->ReadBytes(&stringLength, sizeof(stringLength));
+            this->Require(stringLength);
+            value.assign(this->data + this->position, stringLength);
+            this->position += stringLength;
+        }
+
+        bool AtEnd() const {
+            return this->position == this->length;
+        }
+        std::size_t Position() const {
+            return this->position;
+        }
+    private:
+        const char* const data;
+        const std::size_t length;
+        std::size_t position = 0;
+
+        void Require(const std::size_t bytes) const {
+            if (this->length - this->position < bytes) {
+                throw std::runtime_error("Invalid project file: truncated at byte " + std::to_string(this->position));
+            }
+        }
+        void ReadBytes(void* const destination, const std::size_t bytes) {
+            this->Require(bytes);
+            std::memcpy(destination, this->data + this->position, bytes);
+            this->position += bytes;
+        }
+    };
+};
+
+#endif // BINARYCODEC_H
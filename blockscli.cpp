@@ -0,0 +1,438 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "parallel.h"
+#include "project.h"
+#include "projectio.h"
+#include "projectmerge.h"
+#include "tracing.h"
+
+// Batch operations on project files, built on the core library alone (no widgets):
+//   validate  every project parses, its findings lie within the codebase's files and its attachments are intact
+//   stats     annotation/bookmark/tag counts and review coverage, per project and in total
+//   convert   rewrites each project in another format (--to) into --output-dir
+//   merge     combines the projects (onto --base, if given) into --output
+//   history   every earlier version of each edited annotation, oldest first
+// Every project named is loaded (and checked) in parallel, one failing doesn't stop the rest.
+// Exits with 1 if any project failed, 2 for a bad command line.
+
+namespace {
+    enum ExitCode {
+        SUCCESS = 0,
+        FAILURE = 1,
+        USAGE = 2
+    };
+
+    struct LoadedProject {
+        QString path;
+        std::unique_ptr<Project> project; // Null if it couldn't be loaded.
+        std::string error;
+    };
+
+    bool ParseSpecification(const QString& name, Config::VR_Specifications& specification) {
+        if (name.compare("blocks", Qt::CaseInsensitive) == 0) {
+            specification = Config::VR_Specifications::BLOCKS;
+            return true;
+        }
+        if (name.compare("snippet", Qt::CaseInsensitive) == 0) {
+            specification = Config::VR_Specifications::SNIPPET;
+            return true;
+        }
+        if (name.compare("binary", Qt::CaseInsensitive) == 0) {
+            specification = Config::VR_Specifications::BINARY;
+            return true;
+        }
+        return false;
+    }
+
+    // Loads every one of 'paths' at once. Each project's own loading is split across cores
+    // too, which oversubscribes them somewhat but keeps a lone large project quick.
+    std::vector<LoadedProject> LoadProjects(const QStringList& paths, const std::string& codebasePath,
+                                            const Config::VR_Specifications specification) {
+        TRACE_SCOPE("LoadProjects");
+        std::vector<LoadedProject> loaded(static_cast<std::size_t>(paths.size()));
+        Parallel::For(loaded.size(), [&](const std::size_t i) {
+            loaded[i].path = paths[static_cast<int>(i)];
+            try {
+                ProjectIO::Job job;
+                loaded[i].project = ProjectIO::Load(loaded[i].path, codebasePath, specification, job);
+            } catch (const std::exception& failure) {
+                loaded[i].error = failure.what();
+            }
+        });
+        return loaded;
+    }
+
+    // Reports the projects that failed to load, returns whether any did.
+    bool ReportLoadFailures(const std::vector<LoadedProject>& loaded) {
+        bool anyFailed = false;
+        for (const LoadedProject& entry : loaded) {
+            if (!entry.project) {
+                std::cerr << entry.path.toStdString() << ": " << entry.error << std::endl;
+                anyFailed = true;
+            }
+        }
+        return anyFailed;
+    }
+
+    int Validate(const std::vector<LoadedProject>& loaded, const std::string& codebasePath) {
+        TRACE_SCOPE("Validate");
+        // Every project's findings are checked against the lengths of the files they refer to, and
+        // their attachments for being there and intact:
+        std::vector<std::vector<std::string>> problems(loaded.size());
+        Parallel::For(loaded.size(), [&](const std::size_t i) {
+            if (!loaded[i].project) {
+                return;
+            }
+            const Project::Snapshot snapshot = loaded[i].project->GetSnapshot();
+            std::set<std::string> fileRefSet;
+            snapshot.annotations->ForEach([&](const std::string& fileRef, const std::vector<Annotation>&) {
+                fileRefSet.insert(fileRef);
+            });
+            snapshot.bookmarks->ForEach([&](const std::string& fileRef, const std::vector<Bookmark>&) {
+                fileRefSet.insert(fileRef);
+            });
+            const std::vector<std::string> fileRefs(fileRefSet.begin(), fileRefSet.end());
+            const std::atomic<bool> cancelled {false};
+            const std::vector<std::size_t> lineCounts = ReviewCoverage::CountLines(codebasePath, fileRefs, cancelled);
+
+            for (std::size_t f = 0; f < fileRefs.size(); f++) {
+                if (lineCounts[f] == 0) {
+                    problems[i].push_back(fileRefs[f] + ": missing, unreadable or empty");
+                    continue;
+                }
+                const auto checkLine = [&](const std::size_t lineRef, const char* const kind) {
+                    if (lineRef >= lineCounts[f]) {
+                        problems[i].push_back(fileRefs[f] + ":" + std::to_string(lineRef) + ": " + kind + " past the end of the file (" +
+                                              std::to_string(lineCounts[f]) + " line(s))");
+                    }
+                };
+                for (const Annotation& annotation : snapshot.annotations->Get(fileRefs[f])) {
+                    checkLine(annotation.endLineRef, "annotation");
+                    for (const Attachment& attachment : annotation.attachments) {
+                        try {
+                            snapshot.attachments->Get(attachment.id);
+                        } catch (const std::runtime_error& failure) {
+                            problems[i].push_back(fileRefs[f] + ":" + std::to_string(annotation.lineRef) + ": " + failure.what());
+                        }
+                    }
+                }
+                for (const Bookmark& bookmark : snapshot.bookmarks->Get(fileRefs[f])) {
+                    checkLine(bookmark.lineRef, "bookmark");
+                }
+            }
+        });
+
+        bool anyFailed = ReportLoadFailures(loaded);
+        for (std::size_t i = 0; i < loaded.size(); i++) {
+            if (!loaded[i].project) {
+                continue;
+            }
+            for (const std::string& problem : problems[i]) {
+                std::cerr << loaded[i].path.toStdString() << ": " << problem << std::endl;
+            }
+            anyFailed = anyFailed || !problems[i].empty();
+            std::cout << loaded[i].path.toStdString() << ": " << (problems[i].empty() ? "valid" : "invalid") << std::endl;
+        }
+        return anyFailed ? FAILURE : SUCCESS;
+    }
+
+    int Stats(const std::vector<LoadedProject>& loaded) {
+        TRACE_SCOPE("Stats");
+        struct Counts {
+            std::size_t annotations = 0;
+            std::size_t bookmarks = 0;
+            std::size_t files = 0;
+            std::size_t reviewedLines = 0;
+            std::size_t knownLines = 0;
+            std::map<std::string, std::size_t> tags;
+        };
+        const auto describe = [](const Counts& counts) {
+            const std::size_t percent = counts.knownLines == 0 ? 0 : counts.reviewedLines * 100 / counts.knownLines;
+            return std::to_string(counts.annotations) + " annotation(s), " + std::to_string(counts.bookmarks) + " bookmark(s) in " +
+                   std::to_string(counts.files) + " file(s), " + std::to_string(counts.tags.size()) + " tag(s), " +
+                   std::to_string(counts.reviewedLines) + "/" + std::to_string(counts.knownLines) + " line(s) reviewed (" +
+                   std::to_string(percent) + "%)";
+        };
+
+        std::vector<Counts> projectCounts(loaded.size());
+        Parallel::For(loaded.size(), [&](const std::size_t i) {
+            if (!loaded[i].project) {
+                return;
+            }
+            const Project& project = *loaded[i].project;
+            const Project::Snapshot snapshot = project.GetSnapshot();
+            Counts& counts = projectCounts[i];
+            counts.annotations = snapshot.annotations->ItemCount();
+            counts.bookmarks = snapshot.bookmarks->ItemCount();
+            std::set<std::string> files;
+            snapshot.annotations->ForEach([&](const std::string& fileRef, const std::vector<Annotation>& fileAnnotations) {
+                files.insert(fileRef);
+                for (const Annotation& annotation : fileAnnotations) {
+                    for (const std::string& keyword : annotation.UniqueKeywords()) {
+                        ++counts.tags[keyword];
+                    }
+                }
+            });
+            snapshot.bookmarks->ForEach([&](const std::string& fileRef, const std::vector<Bookmark>&) {
+                files.insert(fileRef);
+            });
+            counts.files = files.size();
+            counts.reviewedLines = project.coverage.ReviewedUnder("");
+            counts.knownLines = project.coverage.LinesUnder("");
+        });
+
+        const bool anyFailed = ReportLoadFailures(loaded);
+        // Files are totalled per project, the same file in two projects counts twice:
+        Counts total;
+        for (std::size_t i = 0; i < loaded.size(); i++) {
+            if (!loaded[i].project) {
+                continue;
+            }
+            const Counts& counts = projectCounts[i];
+            std::cout << loaded[i].path.toStdString() << ": " << describe(counts) << std::endl;
+            total.annotations += counts.annotations;
+            total.bookmarks += counts.bookmarks;
+            total.files += counts.files;
+            total.reviewedLines += counts.reviewedLines;
+            total.knownLines += counts.knownLines;
+            for (const std::pair<const std::string, std::size_t>& tag : counts.tags) {
+                total.tags[tag.first] += tag.second;
+            }
+        }
+        if (loaded.size() > 1) {
+            std::cout << "Total: " << describe(total) << std::endl;
+        }
+        for (const std::pair<const std::string, std::size_t>& tag : total.tags) {
+            std::cout << "  #" << tag.first << ": " << tag.second << std::endl;
+        }
+        return anyFailed ? FAILURE : SUCCESS;
+    }
+
+    int Convert(const std::vector<LoadedProject>& loaded, const QString& outputDirectory, const Config::VR_Specifications specification) {
+        TRACE_SCOPE("Convert");
+        // Each project keeps its file name, so two of the same name would overwrite each other:
+        std::set<QString> outputNames;
+        for (const LoadedProject& entry : loaded) {
+            if (!outputNames.insert(QFileInfo(entry.path).fileName()).second) {
+                std::cerr << "More than one project is named " << QFileInfo(entry.path).fileName().toStdString() << std::endl;
+                return USAGE;
+            }
+        }
+        std::error_code directoryError;
+        std::filesystem::create_directories(outputDirectory.toStdString(), directoryError);
+        if (directoryError) {
+            std::cerr << "Unable to create " << outputDirectory.toStdString() << ": " << directoryError.message() << std::endl;
+            return FAILURE;
+        }
+
+        std::vector<std::string> errors(loaded.size());
+        Parallel::For(loaded.size(), [&](const std::size_t i) {
+            if (!loaded[i].project) {
+                return;
+            }
+            try {
+                ProjectIO::Job job;
+                ProjectIO::Save(loaded[i].project->GetSnapshot(), outputDirectory + "/" + QFileInfo(loaded[i].path).fileName(), specification, job);
+            } catch (const std::exception& failure) {
+                errors[i] = failure.what();
+            }
+        });
+
+        bool anyFailed = ReportLoadFailures(loaded);
+        for (std::size_t i = 0; i < loaded.size(); i++) {
+            if (!errors[i].empty()) {
+                std::cerr << loaded[i].path.toStdString() << ": " << errors[i] << std::endl;
+                anyFailed = true;
+            }
+        }
+        return anyFailed ? FAILURE : SUCCESS;
+    }
+
+    int History(const std::vector<LoadedProject>& loaded) {
+        TRACE_SCOPE("History");
+        const auto printContents = [](const std::string& contents) {
+            std::size_t lineStart = 0;
+            do {
+                const std::size_t lineEnd = std::min(contents.find('\n', lineStart), contents.size());
+                std::cout << "      " << contents.substr(lineStart, lineEnd - lineStart) << std::endl;
+                lineStart = lineEnd + 1;
+            } while (lineStart <= contents.size());
+        };
+
+        bool anyFailed = ReportLoadFailures(loaded);
+        for (const LoadedProject& entry : loaded) {
+            if (!entry.project) {
+                continue;
+            }
+            std::cout << entry.path.toStdString() << ":" << std::endl;
+            const Project::Snapshot snapshot = entry.project->GetSnapshot();
+            std::vector<std::string> fileRefs;
+            snapshot.annotations->ForEach([&fileRefs](const std::string& fileRef, const std::vector<Annotation>&) {
+                fileRefs.push_back(fileRef);
+            });
+            std::sort(fileRefs.begin(), fileRefs.end());
+            for (const std::string& fileRef : fileRefs) {
+                for (const Annotation& annotation : snapshot.annotations->Get(fileRef)) {
+                    if (!annotation.history) {
+                        continue;
+                    }
+                    std::cout << "  " << fileRef << ":" << annotation.lineRef << " (" << annotation.history->Count()
+                              << " earlier version(s))" << std::endl;
+                    std::vector<AnnotationHistory::Revision> revisions;
+                    try {
+                        revisions = annotation.history->GetAll(annotation.contents);
+                    } catch (const std::runtime_error& failure) {
+                        std::cerr << entry.path.toStdString() << ": " << fileRef << ":" << annotation.lineRef << ": " << failure.what() << std::endl;
+                        anyFailed = true;
+                        continue;
+                    }
+                    revisions.push_back(AnnotationHistory::Revision {
+                        .contents = annotation.contents,
+                        .author = annotation.history->LatestAuthor(),
+                        .timestamp = annotation.modifiedTimestamp
+                    });
+                    for (std::size_t i = 0; i < revisions.size(); i++) {
+                        std::cout << "    [" << (i + 1 == revisions.size() ? "current" : std::to_string(i + 1)) << "] "
+                                  << revisions[i].timestamp << " " << revisions[i].author << std::endl;
+                        printContents(revisions[i].contents);
+                    }
+                }
+            }
+        }
+        return anyFailed ? FAILURE : SUCCESS;
+    }
+
+    int Merge(const std::vector<LoadedProject>& loaded, const QString& basePath, const QString& outputPath,
+              const std::string& codebasePath) {
+        TRACE_SCOPE("Merge");
+        // A merge is all or nothing, the base (if any) is loaded along with the sides:
+        if (ReportLoadFailures(loaded)) {
+            return FAILURE;
+        }
+        const Project* const base = basePath.isEmpty() ? nullptr : loaded.front().project.get();
+        std::vector<const Project*> sides;
+        for (std::size_t i = base == nullptr ? 0 : 1; i < loaded.size(); i++) {
+            sides.push_back(loaded[i].project.get());
+        }
+
+        Project merged(codebasePath);
+        const ProjectMerge::Report report = ProjectMerge::Merge(base, sides, merged);
+        merged.excludePatterns = loaded.front().project->excludePatterns;
+        try {
+            ProjectIO::Job job;
+            ProjectIO::Save(merged.GetSnapshot(), outputPath, Config::VR_Specifications::BLOCKS, job);
+        } catch (const std::exception& failure) {
+            std::cerr << outputPath.toStdString() << ": " << failure.what() << std::endl;
+            return FAILURE;
+        }
+
+        std::cout << report.annotations << " annotation(s) and " << report.bookmarks << " bookmark(s) merged." << std::endl
+                  << report.duplicates << " duplicate finding(s) combined, " << report.relocatedDuplicates
+                  << " identical finding(s) left on different lines." << std::endl
+                  << report.deletions << " annotation(s) deleted." << std::endl
+                  << report.conflicts.size() << " conflict(s), tagged #" << ProjectMerge::ConflictKeyword << "." << std::endl;
+        for (const ProjectMerge::Conflict& conflict : report.conflicts) {
+            std::cout << "  " << conflict.fileRef << ":" << conflict.lineRef << " (" << conflict.versions << " version(s)" <<
+                         (conflict.editedAndDeleted ? ", edited and deleted)" : ")") << std::endl;
+        }
+        return SUCCESS;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    // Shares the app's per-codebase caches (line indexes and the like):
+    QCoreApplication::setApplicationName("Blocks");
+    Tracing::SetThreadName("Main");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch operations on Blocks project files.\n\n"
+        "Commands:\n"
+        "  validate  Check each project loads, its findings lie within the codebase's files and its attachments are intact.\n"
+        "  stats     Count each project's annotations, bookmarks and tags, and its review coverage.\n"
+        "  convert   Write each project in another format (--to) into --output-dir.\n"
+        "  merge     Merge the projects (onto --base, if given) into --output.\n"
+        "  history   List every earlier version of each edited annotation, oldest first.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "validate, stats, convert, merge or history.");
+    parser.addPositionalArgument("projects", "Project files.", "<project>...");
+    const QCommandLineOption codebaseOption("codebase", "Codebase the projects refer to (the current directory by default).", "directory", ".");
+    const QCommandLineOption fromOption("from", "Format of the projects read: blocks (default), binary or snippet.", "format", "blocks");
+    const QCommandLineOption toOption("to", "convert: format to write, blocks, binary or snippet.", "format");
+    const QCommandLineOption outputDirectoryOption("output-dir", "convert: directory to write the converted projects to.", "directory");
+    const QCommandLineOption outputOption("output", "merge: project file to write.", "file");
+    const QCommandLineOption baseOption("base", "merge: common ancestor of the projects, for a three-way merge.", "file");
+    parser.addOptions({ codebaseOption, fromOption, toOption, outputDirectoryOption, outputOption, baseOption });
+    parser.process(application);
+
+    const QStringList arguments = parser.positionalArguments();
+    const QString command = arguments.value(0);
+    QStringList projectPaths = arguments.mid(1);
+    const auto usageError = [&parser](const std::string& message) {
+        std::cerr << message << std::endl << std::endl << parser.helpText().toStdString();
+        return USAGE;
+    };
+    if (command.isEmpty()) {
+        return usageError("No command given.");
+    }
+    if (projectPaths.isEmpty()) {
+        return usageError("No projects given.");
+    }
+
+    Config::VR_Specifications fromSpecification;
+    if (!ParseSpecification(parser.value(fromOption), fromSpecification)) {
+        return usageError("Unknown format " + parser.value(fromOption).toStdString() + ".");
+    }
+    std::string codebasePath = parser.value(codebaseOption).toStdString();
+    if (!std::filesystem::is_directory(codebasePath)) {
+        return usageError("Codebase " + codebasePath + " isn't a directory.");
+    }
+    if (codebasePath.back() != '/') {
+        codebasePath += '/'; // File references are appended to it.
+    }
+
+    if (command == "validate") {
+        return Validate(LoadProjects(projectPaths, codebasePath, fromSpecification), codebasePath);
+    }
+    if (command == "stats") {
+        return Stats(LoadProjects(projectPaths, codebasePath, fromSpecification));
+    }
+    if (command == "convert") {
+        Config::VR_Specifications toSpecification;
+        if (!parser.isSet(toOption) || !ParseSpecification(parser.value(toOption), toSpecification)) {
+            return usageError("convert needs --to blocks, --to binary or --to snippet.");
+        }
+        if (!parser.isSet(outputDirectoryOption)) {
+            return usageError("convert needs --output-dir.");
+        }
+        return Convert(LoadProjects(projectPaths, codebasePath, fromSpecification), parser.value(outputDirectoryOption), toSpecification);
+    }
+    if (command == "history") {
+        return History(LoadProjects(projectPaths, codebasePath, fromSpecification));
+    }
+    if (command == "merge") {
+        if (!parser.isSet(outputOption)) {
+            return usageError("merge needs --output.");
+        }
+        if (!parser.isSet(baseOption) && projectPaths.size() < 2) {
+            return usageError("merge needs --base or at least two projects.");
+        }
+        if (parser.isSet(baseOption)) {
+            projectPaths.prepend(parser.value(baseOption));
+        }
+        return Merge(LoadProjects(projectPaths, codebasePath, fromSpecification), parser.value(baseOption), parser.value(outputOption),
+                     codebasePath);
+    }
+    return usageError("Unknown command " + command.toStdString() + ".");
+}
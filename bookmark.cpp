@@ -1,139 +1,138 @@
 #include "bookmark.h"
 #include <algorithm>
-#include <QFile>
-#include <QJsonArray>
-
-QJsonObject Bookmark::SerializeToJSON(const Config::VR_Specifications conformingSpecification) const {
-    QJsonObject serialized;
-    switch (conformingSpecification) {
-        case Config::VR_Specifications::BLOCKS: {
-            // In Blocks, the JSON schema is just the entire relevant structure.
-            // There is some overlap with Snippet's members (lineRef, fileRef, contents, tags, etc)
-            // but the naming of those variables differs wildly and Blocks is open
-            // to more rapid incremental adjustments (including member types).
-//            serialized["file"] = this->fileRef.c_str();
-            serialized["line"] = static_cast<qint64>(this->lineRef);
-            break;
-        }
-        case Config::VR_Specifications::SNIPPET: // Snippet doesn't support bookmarks.
-        default:
-            throw std::runtime_error("Invalid specification");
-            break;
-    }
-
-    return serialized;
-}
+#include "tracing.h"
 
 BookmarkCollection::BookmarkCollection() {}
 
-BookmarkCollection::BookmarkCollection(QJsonObject bookmarksJSON, Config::VR_Specifications specification) {
-    if (specification != Config::VR_Specifications::BLOCKS) {
-        throw std::runtime_error("Invalid/Unsupported specification whilst deserializing to bookmarks");
-    }
-
-    bookmarksJSON = bookmarksJSON["bookmarks"].toObject();
-
-    const QStringList filePaths = bookmarksJSON.keys();
-
-    for (const QString& iterativeFile : filePaths) {
-
-        const QJsonObject fileEntry = bookmarksJSON[iterativeFile].toObject();
-        const QString filePath = fileEntry["file"].toString();
-        const QJsonArray fileBookmarks = fileEntry["bookmarks"].toArray();
-
-        for (const QJsonValueRef& iterativeBookmark : fileBookmarks) {
-            const QJsonObject bookmarkObject = iterativeBookmark.toObject();
+void BookmarkCollection::AddBookmark(const Bookmark& bookmarkData) {
+    this->ApplyEdits({}, { bookmarkData });
+}
 
-            Bookmark bookmarkVar (
-                filePath.toStdString(), static_cast<std::size_t>(bookmarkObject["line"].toInt())
-            );
+void BookmarkCollection::AddBookmarks(std::vector<Bookmark> bookmarksData) {
+    this->ApplyEdits({}, std::move(bookmarksData));
+}
 
-            this->AddBookmark(std::move(bookmarkVar));
-        }
-    }
+void BookmarkCollection::RemoveBookmark(const std::string& fileRef, std::size_t lineRef) {
+    this->ApplyEdits({ std::make_pair(fileRef, lineRef) }, {});
 }
 
-void BookmarkCollection::AddBookmark(const Bookmark& bookmarkData) {
-    std::unordered_map<std::string, std::vector<Bookmark>>::iterator fileElement = this->bookmarks.find(bookmarkData.fileRef);
-    if (fileElement == this->bookmarks.cend()) {
-        this->bookmarks[bookmarkData.fileRef] = std::vector<Bookmark>{bookmarkData};
+void BookmarkCollection::ApplyEdits(const std::vector<std::pair<std::string, std::size_t>>& removals,
+                                    std::vector<Bookmark> additions) {
+    TRACE_SCOPE("BookmarkCollection::ApplyEdits");
+
+    // Each touched file's bookmarks are copied once, edited and then published together. Removals
+    // are all found before anything's counted, so a missing one leaves the collection as it was:
+    SnapshotMap<Bookmark>::Batch batch(this->bookmarks);
+    std::unordered_map<std::string, std::vector<std::size_t>> removedLines;
+    for (const std::pair<std::string, std::size_t>& removal : removals) {
+        removedLines[removal.first].push_back(removal.second);
     }
-    else {
-        for (std::size_t i = 0; i < fileElement->second.size(); i++) {
-            if (bookmarkData.lineRef < fileElement->second[i].lineRef) {
-                fileElement->second.insert(fileElement->second.begin() + i, bookmarkData);
-                return;
+    for (std::pair<const std::string, std::vector<std::size_t>>& file : removedLines) {
+        // Both sorted by line, so one pass removes them all:
+        std::vector<std::size_t>& lines = file.second;
+        std::sort(lines.begin(), lines.end());
+        std::vector<Bookmark>& fileBookmarks = batch.Edit(file.first);
+        std::size_t nextLine = 0, kept = 0;
+        for (std::size_t i = 0; i < fileBookmarks.size(); i++) {
+            if (nextLine < lines.size() && lines[nextLine] < fileBookmarks[i].lineRef) {
+                break; // Not bookmarked.
             }
+            if (nextLine < lines.size() && lines[nextLine] == fileBookmarks[i].lineRef) {
+                nextLine++;
+            }
+            else {
+                if (kept != i) {
+                    fileBookmarks[kept] = std::move(fileBookmarks[i]);
+                }
+                kept++;
+            }
+        }
+        if (nextLine != lines.size()) {
+            throw std::runtime_error("Unable to locate bookmark");
         }
-        fileElement->second.push_back(bookmarkData);
+        fileBookmarks.erase(fileBookmarks.begin() + static_cast<std::ptrdiff_t>(kept), fileBookmarks.end());
+    }
+    for (const std::pair<std::string, std::size_t>& removal : removals) {
+        this->pathCounts.Remove(removal.first);
     }
-}
 
-void BookmarkCollection::RemoveBookmark(const std::string& fileRef, std::size_t lineRef) {
-    std::unordered_map<std::string, std::vector<Bookmark>>::iterator file = this->bookmarks.find(fileRef);
-    if (file == this->bookmarks.end()) {
-        throw std::runtime_error("Unable to locate bookmark");
+    std::unordered_map<std::string, std::size_t /* Bookmarks before the additions */> extendedFiles;
+    for (Bookmark& bookmarkData : additions) {
+        std::vector<Bookmark>& fileBookmarks = batch.Edit(bookmarkData.fileRef);
+        extendedFiles.emplace(bookmarkData.fileRef, fileBookmarks.size());
+        this->pathCounts.Add(bookmarkData.fileRef);
+        fileBookmarks.push_back(std::move(bookmarkData));
+    }
+    // Only the additions need sorting, they're then merged into the (already sorted) rest:
+    for (const std::pair<const std::string, std::size_t>& extendedFile : extendedFiles) {
+        std::vector<Bookmark>& fileBookmarks = batch.Edit(extendedFile.first);
+        const auto byLine = [](const Bookmark& a, const Bookmark& b) {
+            return a.lineRef < b.lineRef;
+        };
+        const std::vector<Bookmark>::iterator firstAddition = fileBookmarks.begin() + static_cast<std::ptrdiff_t>(extendedFile.second);
+        std::stable_sort(firstAddition, fileBookmarks.end(), byLine);
+        std::inplace_merge(fileBookmarks.begin(), firstAddition, fileBookmarks.end(), byLine);
     }
 
-    for (std::vector<Bookmark>::iterator sample = file->second.begin(); sample < file->second.end(); sample++) {
-        if (sample->lineRef == lineRef) {
-            file->second.erase(sample);
-            if (file->second.size() == 0) {
-                this->bookmarks.erase(file);
-            }
-            return;
-        }
+    // A file left without bookmarks is dropped by Publish():
+    for (const std::string& fileRef : batch.Publish()) {
+        this->UpdateFootprint(fileRef);
     }
+}
 
-    throw std::runtime_error("Unable to locate bookmark");
+void BookmarkCollection::UpdateFootprint(const std::string& fileRef) {
+    // Bookmarks only own their fileRef on the heap so this is cheap enough to recount in full:
+    const std::shared_ptr<const Snapshot> snapshot = this->bookmarks.Current();
+    const std::vector<Bookmark>& fileBookmarks = snapshot->Get(fileRef);
+    if (fileBookmarks.empty()) {
+        this->footprints.erase(fileRef);
+        return;
+    }
+    std::unordered_map<std::string, MemoryAccounting::Account>::iterator footprint = this->footprints.find(fileRef);
+    if (footprint == this->footprints.end()) {
+        footprint = this->footprints.emplace(
+            fileRef, MemoryAccounting::Account(MemoryAccounting::COLLECTIONS, "bookmarks: " + fileRef)
+        ).first;
+    }
+    std::size_t footprintBytes = fileBookmarks.capacity() * sizeof(Bookmark) +
+        sizeof(std::pair<const std::string, std::shared_ptr<const std::vector<Bookmark>>>) + MemoryAccounting::StringHeapBytes(fileRef);
+    for (const Bookmark& bookmark : fileBookmarks) {
+        footprintBytes += MemoryAccounting::StringHeapBytes(bookmark.fileRef);
+    }
+    footprint->second.Set(footprintBytes);
 }
 
+
 std::vector<Bookmark> BookmarkCollection::GetBookmarks(const std::string& fileRef) const {
-    std::unordered_map<std::string, std::vector<Bookmark>>::const_iterator file = this->bookmarks.find(fileRef);
-    return (file == this->bookmarks.cend()) ? std::vector<Bookmark>{} : file->second;
+    return this->bookmarks.Current()->Get(fileRef);
 }
 
 std::vector<Bookmark> BookmarkCollection::GetBookmarks() const {
+    const std::shared_ptr<const Snapshot> snapshot = this->bookmarks.Current();
     std::vector<Bookmark> bookmarks;
-
-    for (std::unordered_map<std::string, std::vector<Bookmark>>::const_iterator bookmarkIterator = this->bookmarks.cbegin();
-                    bookmarkIterator != this->bookmarks.cend(); bookmarkIterator++) {
-
-        std::for_each(bookmarkIterator->second.cbegin(), bookmarkIterator->second.cend(), [&bookmarks](const Bookmark& bookmark) {
-            bookmarks.push_back(bookmark);
-        });
-
-    }
-
+    bookmarks.reserve(snapshot->ItemCount());
+    snapshot->ForEach([&bookmarks](const std::string&, const std::vector<Bookmark>& fileBookmarks) {
+        bookmarks.insert(bookmarks.end(), fileBookmarks.cbegin(), fileBookmarks.cend());
+    });
     return bookmarks;
 }
 
-std::unordered_map<std::string, std::vector<Bookmark>> BookmarkCollection::GetRawBookmarks() const {
-    return this->bookmarks;
+std::size_t BookmarkCollection::Count() const {
+    return this->bookmarks.Current()->ItemCount();
 }
 
-void BookmarkCollection::AddToModel(QStandardItemModel* const model, const std::string& basePath) const {
-    std::size_t rowIndex = model->rowCount();
-    for (const std::pair<std::string, std::vector<Bookmark>>& bookmarkCollection : this->bookmarks) {
-        // Read the annotated file's contents. TODO: Find a way to only read relevant lines (not the entire contents).
-        QFile fileObj(QString::fromStdString(basePath + bookmarkCollection.first));
-        fileObj.open(QIODevice::ReadOnly | QIODevice::Text);
-        QByteArray rawFileContents = fileObj.readAll();
-        fileObj.close();
-
-        // Cast the file's data (in the form of bytes) to a string and format it:
-        const QStringList fileLines = QString::fromStdString(rawFileContents.toStdString()).split('\n');
-
-        for (const Bookmark& bookmark : bookmarkCollection.second) {
+std::size_t BookmarkCollection::CountUnder(const std::string& path) const {
+    return this->pathCounts.Get(path);
+}
 
-            if (fileLines.length() <= bookmark.lineRef) {
-                throw std::runtime_error("OOB bookmark");
-            }
+std::unordered_map<std::string, std::vector<Bookmark>> BookmarkCollection::GetRawBookmarks() const {
+    std::unordered_map<std::string, std::vector<Bookmark>> rawBookmarks;
+    this->bookmarks.Current()->ForEach([&rawBookmarks](const std::string& fileRef, const std::vector<Bookmark>& fileBookmarks) {
+        rawBookmarks.emplace(fileRef, fileBookmarks);
+    });
+    return rawBookmarks;
+}
 
-            model->setItem(rowIndex, 0, new QStandardItem(QString::fromStdString(bookmark.fileRef)));
-            model->setItem(rowIndex, 1, new QStandardItem(QString::number(bookmark.lineRef)));
-            model->setItem(rowIndex, 2, new QStandardItem(fileLines[bookmark.lineRef].simplified()));
-            ++rowIndex;
-        }
-    }
+std::shared_ptr<const BookmarkCollection::Snapshot> BookmarkCollection::GetSnapshot() const {
+    return this->bookmarks.Current();
 }
@@ -1,34 +1,50 @@
 #ifndef BOOKMARK_H
 #define BOOKMARK_H
 #include <iostream>
-#include <QJsonObject>
 #include <map>
-#include <QStandardItemModel>
-#include <QTreeView>
 #include "configuration.h"
+#include "memoryaccounting.h"
+#include "pathcounts.h"
+#include "progress.h"
+#include "snapshotmap.h"
 
 struct Bookmark {
     std::string fileRef;
     std::size_t lineRef;
     Bookmark(const std::string& fileRef, const std::size_t lineRef) :
         fileRef(fileRef), lineRef(lineRef) {}
-    QJsonObject SerializeToJSON(const Config::VR_Specifications conformingSpecification) const;
 };
 
+// Like AnnotationCollection: edited on the GUI thread, the bookmarks themselves readable from any
+// thread through GetSnapshot() or the getters. The per-path counts are GUI thread only.
 struct BookmarkCollection {
 public: // Default:
+    typedef SnapshotMap<Bookmark>::Snapshot Snapshot;
+
     BookmarkCollection();
-    BookmarkCollection(QJsonObject bookmarksJSON, Config::VR_Specifications specification);
 
     void AddBookmark(const Bookmark& bookmarkData);
+    // Equivalent to AddBookmark() on each element but only sorts each file once.
+    void AddBookmarks(std::vector<Bookmark> bookmarksData);
     void RemoveBookmark(const std::string& fileRef, std::size_t lineRef);
+    // Removes the bookmark on each of 'removals' (file, line) and adds 'additions' as one edit,
+    // copying each touched file's bookmarks once. Throws, having changed nothing, if any of
+    // 'removals' isn't bookmarked.
+    void ApplyEdits(const std::vector<std::pair<std::string, std::size_t>>& removals, std::vector<Bookmark> additions);
     std::vector<Bookmark> GetBookmarks(const std::string& fileRef) const;
     std::vector<Bookmark> GetBookmarks() const;
     std::unordered_map<std::string, std::vector<Bookmark>> GetRawBookmarks() const;
-
-    void AddToModel(QStandardItemModel* const model, const std::string& basePath) const;
+    // A consistent view of every bookmark as of now, unaffected by later edits.
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+    std::size_t Count() const;
+    // Bookmarks in the file/directory 'path' ("" for the whole codebase).
+    std::size_t CountUnder(const std::string& path) const;
 private:
-    std::unordered_map<std::string, std::vector<Bookmark>> bookmarks;
+    SnapshotMap<Bookmark> bookmarks; // By file path.
+    PathCounts pathCounts;
+
+    std::unordered_map<std::string, MemoryAccounting::Account> footprints;
+    void UpdateFootprint(const std::string& fileRef);
 };
 
 //typedef std::vector<Bookmark> BookmarkCollection;
@@ -0,0 +1,91 @@
+#include "cachefile.h"
+#include <cstdio>
+
+std::uint64_t CacheFile::Hash(const char* const data, const std::size_t length) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string CacheFile::HashName(const std::string& text) {
+    char hashHex[17];
+    std::snprintf(hashHex, sizeof(hashHex), "%016llx", static_cast<unsigned long long>(CacheFile::Hash(text.data(), text.size())));
+    return hashHex;
+}
+
+CacheFile::Reader::Reader(const std::filesystem::path& path, const std::uint32_t magic, const std::uint32_t version) :
+    stream(path, std::ios::binary) {
+    std::error_code sizeError;
+    const std::uintmax_t size = std::filesystem::file_size(path, sizeError);
+    if (!this->stream.is_open() || sizeError) {
+        return;
+    }
+    this->remaining = static_cast<std::uint64_t>(size);
+    this->good = true;
+
+    std::uint32_t fileMagic = 0, fileVersion = 0;
+    if (this->Read(fileMagic) && this->Read(fileVersion) && (fileMagic != magic || fileVersion != version)) {
+        this->Fail();
+    }
+}
+
+bool CacheFile::Reader::Good() const {
+    return this->good;
+}
+
+bool CacheFile::Reader::ReadString(std::string& value) {
+    std::uint32_t length = 0;
+    if (!this->Read(length) || length > this->remaining) {
+        return this->Fail();
+    }
+    value.resize(length);
+    return this->ReadBytes(value.data(), length);
+}
+
+bool CacheFile::Reader::ReadBytes(void* const destination, const std::uint64_t length) {
+    if (!this->good || length > this->remaining) {
+        return this->Fail();
+    }
+    this->stream.read(static_cast<char*>(destination), static_cast<std::streamsize>(length));
+    this->remaining -= length;
+    if (!this->stream) {
+        return this->Fail();
+    }
+    return true;
+}
+
+bool CacheFile::Reader::Fail() {
+    this->good = false;
+    return false;
+}
+
+CacheFile::Writer::Writer(const std::filesystem::path& path, const std::uint32_t magic, const std::uint32_t version) :
+    path(path), temporaryPath(std::filesystem::path(path) += ".tmp") {
+    std::error_code directoryError;
+    std::filesystem::create_directories(this->path.parent_path(), directoryError);
+    this->stream.open(this->temporaryPath, std::ios::binary | std::ios::trunc);
+    this->Write(magic);
+    this->Write(version);
+}
+
+void CacheFile::Writer::WriteString(const std::string& value) {
+    this->Write(static_cast<std::uint32_t>(value.size()));
+    this->stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+bool CacheFile::Writer::Commit() {
+    std::error_code fileError;
+    if (!this->stream.is_open()) {
+        return false;
+    }
+    this->stream.close();
+    if (!this->stream) {
+        std::filesystem::remove(this->temporaryPath, fileError);
+        return false;
+    }
+    std::filesystem::rename(this->temporaryPath, this->path, fileError);
+    return !fileError;
+}
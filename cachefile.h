@@ -0,0 +1,82 @@
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary files of derived data kept in a project's cache directory between sessions. Each one
+// starts with a magic number and a format version; one that's missing, from another version or
+// cut short reads as nothing and whatever it held is simply rebuilt. Files are written
+// alongside and then renamed over the old one so that they're never left half written.
+
+namespace CacheFile {
+    // FNV-1a (64-bit).
+    std::uint64_t Hash(const char* data, std::size_t length);
+    // Hash() of 'text' as 16 hex digits, for naming cache files after paths.
+    std::string HashName(const std::string& text);
+
+    class Reader {
+    public:
+        Reader(const std::filesystem::path& path, std::uint32_t magic, std::uint32_t version);
+
+        // False once anything (including the header) has failed to read.
+        bool Good() const;
+
+        template<typename T>
+        bool Read(T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read directly");
+            return this->ReadBytes(&value, sizeof(value));
+        }
+        // A 32-bit length then the characters.
+        bool ReadString(std::string& value);
+        // A 64-bit count then the elements as they are in memory.
+        template<typename T>
+        bool ReadVector(std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read directly");
+            std::uint64_t count = 0;
+            if (!this->Read(count) || count > this->remaining / sizeof(T)) {
+                return this->Fail();
+            }
+            values.resize(count);
+            return this->ReadBytes(values.data(), count * sizeof(T));
+        }
+    private:
+        std::ifstream stream;
+        std::uint64_t remaining = 0; // Unread bytes, so that corrupt counts can't allocate wildly.
+        bool good = false;
+
+        bool ReadBytes(void* destination, std::uint64_t length);
+        bool Fail();
+    };
+
+    class Writer {
+    public:
+        Writer(const std::filesystem::path& path, std::uint32_t magic, std::uint32_t version);
+
+        template<typename T>
+        void Write(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written directly");
+            this->stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        void WriteString(const std::string& value);
+        template<typename T>
+        void WriteVector(const std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written directly");
+            this->Write(static_cast<std::uint64_t>(values.size()));
+            this->stream.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+        }
+
+        // Puts the file in place of the old one, unless anything failed to write (in which case the
+        // old one is left as it was). Returns whether it was replaced.
+        bool Commit();
+    private:
+        const std::filesystem::path path;
+        const std::filesystem::path temporaryPath;
+        std::ofstream stream;
+    };
+};
+
+#endif // CACHEFILE_H
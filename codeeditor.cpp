@@ -1,20 +1,78 @@
 #include "codeeditor.h"
 #include "configuration.h"
-#include <QFile>
+#include <QDateTime>
 #include <QDebug>
+#include <QInputDialog>
+#include <QMdiArea>
+#include <QMdiSubWindow>
 #include <QKeyEvent>
 #include <QPushButton>
 #include <QTextDocument>
 #include <QScrollBar>
 #include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
+#include <QUuid>
 #include <algorithm>
+#include <limits>
 #include <math.h>
 #include "ui_annotationeditor.h"
 #include "annotation.h"
+#include "attachmentsdialog.h"
 #include "utils.h"
+#include "cachefile.h"
+#include "textkernels.h"
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+namespace {
+    // A window of a file as CodeEditor::LoadFile() last rendered it.
+    struct RenderedView {
+        QString html;
+        std::size_t codeColumnOffset;
+    };
+
+    // Identifies a file's marks as they affect rendering, for keying its rendered views.
+    std::string MarksFingerprint(const std::vector<Annotation>& annotations, const std::vector<Bookmark>& bookmarks) {
+        std::string marks;
+        for (const Annotation& annotation : annotations) {
+            for (const std::size_t value : { annotation.lineRef, annotation.endLineRef, annotation.startColumn, annotation.endColumn,
+                                             annotation.contents.size() }) {
+                marks.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+            marks += annotation.contents;
+            for (const Attachment& attachment : annotation.attachments) {
+                marks += attachment.id + attachment.name;
+            }
+        }
+        for (const Bookmark& bookmark : bookmarks) {
+            marks.append(reinterpret_cast<const char*>(&bookmark.lineRef), sizeof(bookmark.lineRef));
+        }
+        return std::to_string(annotations.size()) + ':' + std::to_string(bookmarks.size()) + ':' +
+               CacheFile::HashName(marks);
+    }
+
+    // Attachments are named after their first line with anything in it (a log's first line, say).
+    std::string AttachmentName(const std::string& contents) {
+        const static std::size_t maximumLength = 60;
+        std::size_t lineStart = 0;
+        while (lineStart < contents.size()) {
+            std::size_t lineEnd = contents.find('\n', lineStart);
+            lineEnd = lineEnd == std::string::npos ? contents.size() : lineEnd;
+            const std::size_t textStart = contents.find_first_not_of(" \t\r", lineStart);
+            if (textStart < lineEnd) {
+                const std::size_t textEnd = contents.find_last_not_of(" \t\r", lineEnd - 1) + 1;
+                const QString line = QString::fromStdString(contents.substr(textStart, textEnd - textStart));
+                return line.length() > static_cast<int>(maximumLength) ?
+                    (line.left(static_cast<int>(maximumLength)) + "...").toStdString() : line.toStdString();
+            }
+            lineStart = lineEnd + 1;
+        }
+        return "Attachment";
+    }
+}
 
-CodeEditor::CodeEditor(Project& project, const std::string& path, QWidget* const parent) :
-    filePath(path), activeProject(project)
+CodeEditor::CodeEditor(Project& project, ContentCache& cache, const std::string& path, QWidget* const parent) :
+    filePath(path), activeProject(project), contentCache(cache), documentAccount(MemoryAccounting::EDITORS, path)
 {
     this->setParent(parent);
 
@@ -23,25 +81,40 @@ CodeEditor::CodeEditor(Project& project, const std::string& path, QWidget* const
     // https://www.qtcentre.org/threads/39941-readonly-QTextEdit-with-visible-Cursor
     this->setTextInteractionFlags(Qt::TextSelectableByKeyboard | Qt::TextSelectableByMouse);
 
-    // Setup shortcuts:
-    std::unique_ptr<QAction> generalActionUniquePtr;
-    QAction* generalActionPtr = nullptr;
+    // Windowed (large) files move their window along as the edges are scrolled to:
+    QObject::connect(this->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(WindowScrolled(int)));
+
+    this->reviewDwell.setSingleShot(true);
+    this->reviewDwell.setInterval(Config::Coverage::ReviewDwell);
+    QObject::connect(&this->reviewDwell, SIGNAL(timeout()), this, SLOT(MarkViewReviewed()));
+    QObject::connect(this->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(RestartReviewDwell()));
 
-    NEW_KEYBIND("TGL_BOOKMARK", QKeySequence(Qt::Key_B), ToggleBookmark, this)
-    NEW_KEYBIND("ADD_ANNOTATION", QKeySequence(Qt::Key_Semicolon), BeginAnnotation, this)
-    NEW_KEYBIND("DEL_ANNOTATION", QKeySequence(Qt::Key_Backspace), DeleteAnnotation, this)
-    NEW_KEYBIND("RLD_ANNOTATION", QKeySequence(Qt::Key_R), ReloadFile, this)
+    this->indexPoll.setInterval(Config::Paging::IndexPoll);
+    QObject::connect(&this->indexPoll, SIGNAL(timeout()), this, SLOT(CheckIndexProgress()));
 
     this->ReloadFile();
 }
 
+void CodeEditor::AddBindings(ShortcutDispatcher& dispatcher) {
+    NEW_TARGETED_KEYBIND("TGL_BOOKMARK", QKeySequence(Qt::Key_B), ToggleBookmark, dispatcher)
+    NEW_TARGETED_KEYBIND("ADD_ANNOTATION", QKeySequence(Qt::Key_Semicolon), BeginAnnotation, dispatcher)
+    NEW_TARGETED_KEYBIND("DEL_ANNOTATION", QKeySequence(Qt::Key_Backspace), DeleteAnnotation, dispatcher)
+    NEW_TARGETED_KEYBIND("VIEW_ATTACHMENTS", QKeySequence(Qt::Key_A), ViewAttachments, dispatcher)
+    NEW_TARGETED_KEYBIND("RLD_ANNOTATION", QKeySequence(Qt::Key_R), ReloadFile, dispatcher)
+    NEW_TARGETED_KEYBIND("GOTO_LINE", QKeySequence(Qt::Key_G), GoToLine, dispatcher)
+    NEW_TARGETED_KEYBIND("FIND_DEFINITION", QKeySequence(Qt::Key_D), RequestDefinition, dispatcher)
+    NEW_TARGETED_KEYBIND("FIND_REFERENCES", QKeySequence(Qt::Key_U), RequestReferences, dispatcher)
+    NEW_TARGETED_KEYBIND("MRK_REVIEWED", QKeySequence(Qt::Key_V), MarkSelectionReviewed, dispatcher)
+    NEW_TARGETED_KEYBIND("MRK_UNREVIEWED", QKeySequence(Qt::SHIFT | Qt::Key_V), MarkSelectionUnreviewed, dispatcher)
+}
+
 void CodeEditor::ToggleBookmark() {
-    std::size_t lineReference = static_cast<std::size_t>(this->textCursor().blockNumber());
-    lineReference = this->activeProject.get().annotations.ResolveToCodeLineRef(this->filePath, lineReference);
+    const std::size_t lineReference = this->BlockToCodeLine(static_cast<std::size_t>(this->textCursor().blockNumber()));
 
     // Try to delete:
     try {
         this->activeProject.get().bookmarks.RemoveBookmark(this->filePath, lineReference);
+        emit this->MarksChanged(QString::fromStdString(this->filePath));
         this->ReloadFile();
         return;
     } catch (...) {}
@@ -50,12 +123,12 @@ void CodeEditor::ToggleBookmark() {
     this->activeProject.get().bookmarks.AddBookmark(
         Bookmark(this->filePath, lineReference)
     );
-    this->ReloadFile();
+    emit this->MarksChanged(QString::fromStdString(this->filePath));
+    this->LoadFile(this->filePath);
 }
 
 void CodeEditor::DeleteAnnotation() {
-    std::size_t lineReference = static_cast<std::size_t>(this->textCursor().blockNumber());
-    lineReference = this->activeProject.get().annotations.ResolveToCodeLineRef(this->filePath, lineReference);
+    const std::size_t lineReference = this->BlockToCodeLine(static_cast<std::size_t>(this->textCursor().blockNumber()));
     try {
         this->activeProject.get().annotations.RemoveAnnotation(this->filePath, lineReference);
     } catch (...) {
@@ -70,7 +143,36 @@ void CodeEditor::DeleteAnnotation() {
             return;
         }
     }
-    this->ReloadFile();
+    emit this->MarksChanged(QString::fromStdString(this->filePath));
+    this->LoadFile(this->filePath);
+}
+
+void CodeEditor::ViewAttachments() {
+    const std::size_t lineReference = this->BlockToCodeLine(static_cast<std::size_t>(this->textCursor().blockNumber()));
+    Annotation annotation {};
+    try {
+        annotation = this->activeProject.get().annotations.GetAnnotation(this->filePath, lineReference);
+    } catch (...) {
+        return; // Nothing annotated here.
+    }
+    if (annotation.attachments.empty()) {
+        return;
+    }
+
+    AttachmentsDialog dialog(annotation.attachments, this->activeProject.get().attachments, this);
+    dialog.exec();
+    if (dialog.Attachments().size() == annotation.attachments.size()) {
+        return;
+    }
+    // Some were detached, the annotation's replaced (or removed, if that's all it had) in one edit:
+    annotation.attachments = dialog.Attachments();
+    std::vector<Annotation> replacement;
+    if (!annotation.contents.empty() || !annotation.attachments.empty()) {
+        replacement.push_back(std::move(annotation));
+    }
+    this->activeProject.get().annotations.ApplyEdits({ std::make_pair(this->filePath, lineReference) }, std::move(replacement));
+    emit this->MarksChanged(QString::fromStdString(this->filePath));
+    this->LoadFile(this->filePath);
 }
 
 void CodeEditor::AnnotationSubmit() {
@@ -89,30 +191,64 @@ void CodeEditor::AnnotationSubmit() {
 }
 
 void CodeEditor::BeginAnnotation() {
-    const QTextBlock block = this->textCursor().block();
-    std::size_t lineReference = static_cast<std::size_t>(block.blockNumber());
-    lineReference = this->activeProject.get().annotations.ResolveToCodeLineRef(this->filePath, lineReference);
+    const QTextCursor cursor = this->textCursor();
+    const QTextBlock block = this->document()->findBlock(cursor.selectionStart());
+    const std::size_t lineReference = this->BlockToCodeLine(static_cast<std::size_t>(block.blockNumber()));
+
+    // Selections spanning lines, or only part of one, are annotated as a range:
+    std::size_t endLineReference = lineReference, startColumn = 0, endColumn = 0;
+    if (cursor.hasSelection()) {
+        const QTextBlock endBlock = this->document()->findBlock(cursor.selectionEnd());
+        const std::size_t startPosition = static_cast<std::size_t>(cursor.selectionStart() - block.position());
+        const std::size_t endPosition = static_cast<std::size_t>(cursor.selectionEnd() - endBlock.position());
+        startColumn = startPosition > this->codeColumnOffset ? startPosition - this->codeColumnOffset : 0;
+        endLineReference = this->BlockToCodeLine(static_cast<std::size_t>(endBlock.blockNumber()));
+        if (endPosition > this->codeColumnOffset) {
+            endColumn = endPosition - this->codeColumnOffset;
+            if (endColumn >= static_cast<std::size_t>(endBlock.length() - 1) - this->codeColumnOffset) {
+                endColumn = 0; // Up to the end of the line.
+            }
+        }
+        else if (endLineReference > lineReference) {
+            endLineReference--; // Ends before the last line's code.
+        }
+        if (endLineReference == lineReference && endColumn != 0 && endColumn <= startColumn) {
+            startColumn = endColumn = 0;
+        }
+    }
 
     // Implied 'editing' if there already exists an annotation at the user's chosen line:
-    std::string duplicateAnnotationContents("");
-    std::size_t duplicateAnnotationHeight = 0;
+    Annotation duplicateAnnotation {};
     bool isEdit = false;
     try {
-        const Annotation duplicateAnnotation =
-            this->activeProject.get().annotations.GetAnnotation(this->filePath, lineReference);
-        duplicateAnnotationContents = duplicateAnnotation.contents;
-        duplicateAnnotationHeight = duplicateAnnotation.linesOccupied;
+        duplicateAnnotation = this->activeProject.get().annotations.GetAnnotation(this->filePath, lineReference);
         isEdit = true;
     } catch (...) {
         // The above code will throw if there was not an annotation at lineReference.
         isEdit = false; // Default value anyway.
     }
+    const std::string duplicateAnnotationContents = duplicateAnnotation.contents;
+    const std::string now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toStdString();
+    const std::string user = qEnvironmentVariable(qEnvironmentVariableIsSet("USER") ? "USER" : "USERNAME").toStdString();
     this->activeAnnotationData.activeAnnotation = {
         .contents = isEdit ? duplicateAnnotationContents : "",
-        .linesOccupied = duplicateAnnotationHeight,
+        .linesOccupied = duplicateAnnotation.linesOccupied,
         .lineRef = lineReference,
+        // Edits without a selection keep the original span:
+        .endLineRef = isEdit && !cursor.hasSelection() ? duplicateAnnotation.endLineRef : endLineReference,
+        .startColumn = isEdit && !cursor.hasSelection() ? duplicateAnnotation.startColumn : startColumn,
+        .endColumn = isEdit && !cursor.hasSelection() ? duplicateAnnotation.endColumn : endColumn,
         .fileRef = this->filePath,
-        .keywords = std::vector<std::string>(0)
+        .keywords = std::vector<std::string>(0),
+        .tags = duplicateAnnotation.tags,
+        // Edits keep the original identity/creation time, new annotations get theirs here:
+        .id = isEdit ? duplicateAnnotation.id : QUuid::createUuid().toString(QUuid::WithoutBraces).toStdString(),
+        .author = isEdit && !duplicateAnnotation.author.empty() ? duplicateAnnotation.author : user,
+        .createdTimestamp = isEdit && !duplicateAnnotation.createdTimestamp.empty() ? duplicateAnnotation.createdTimestamp : now,
+        .modifiedTimestamp = now,
+        .fileVersion = duplicateAnnotation.fileVersion,
+        .history = duplicateAnnotation.history,
+        .attachments = duplicateAnnotation.attachments
     };
 
     // UI Setup:
@@ -126,26 +262,57 @@ void CodeEditor::BeginAnnotation() {
     Ui_Dialog* const editorDialog = this->activeAnnotationData.editor.get();
     editorDialog->setupUi(newDialog);
     editorDialog->plainTextEdit->setPlainText(QString::fromStdString(duplicateAnnotationContents));
+    editorDialog->plainTextEdit->SetTagSource(&this->activeProject.get().annotations);
     const std::string ctaText = isEdit ? "Edit Annotation" : "New Annotation";
-    editorDialog->label->setText(QString::fromStdString(ctaText));
+    this->activeAnnotationData.pastedAttachments.clear();
+    const auto updateLabel = [this, editorDialog, ctaText]() {
+        const std::size_t attachmentCount = this->activeAnnotationData.activeAnnotation.attachments.size() +
+                                            this->activeAnnotationData.pastedAttachments.size();
+        editorDialog->label->setText(QString::fromStdString(ctaText +
+            (attachmentCount != 0 ? " (" + std::to_string(attachmentCount) + " attachment(s))" : "")));
+    };
+    updateLabel();
     editorDialog->okBtn->setText(QString::fromStdString(ctaText.substr(0, ctaText.find(' '))));
 
+    // Large pastes (crash logs, hexdumps, ...) are attached rather than written into the contents:
+    editorDialog->plainTextEdit->SetAttachmentSink([this, updateLabel](const QString& text) {
+        this->activeAnnotationData.pastedAttachments.push_back(text.toStdString());
+        updateLabel();
+        return true;
+    });
+
     // Bind the submit button to write the annotation to memory:
     QObject::connect(editorDialog->okBtn, SIGNAL(clicked()), SLOT(AnnotationSubmit()));
 
     if (newDialog->exec() != QDialog::Accepted) {
+        // Never stored, so a cancelled annotation leaves nothing behind:
+        this->activeAnnotationData.pastedAttachments.clear();
         return;
     }
     this->activeAnnotationData.editor.release();
     this->activeAnnotationData.editorParentDialog.release();
+    for (const std::string& contents : this->activeAnnotationData.pastedAttachments) {
+        this->activeAnnotationData.activeAnnotation.attachments.push_back(
+            this->activeProject.get().attachments->Add(contents, AttachmentName(contents)));
+    }
+    this->activeAnnotationData.pastedAttachments.clear();
 
-    // Add the annotation:
+    // Add the annotation (replacing the one edited in the same edit), an edit to the text keeping
+    // what it replaced in the annotation's history:
+    std::vector<std::pair<std::string, std::size_t>> removals;
     if (isEdit) {
-        this->activeProject.get().annotations.RemoveAnnotation(this->filePath, lineReference);
+        removals.emplace_back(this->filePath, lineReference);
+        if (this->activeAnnotationData.activeAnnotation.contents != duplicateAnnotationContents) {
+            this->activeAnnotationData.activeAnnotation.RecordRevision(duplicateAnnotation, user);
+        }
     }
-    if (this->activeAnnotationData.activeAnnotation.contents.length() != 0) {
-        this->activeProject.get().annotations.AddNewAnnotation(this->activeAnnotationData.activeAnnotation);
+    std::vector<Annotation> additions;
+    if (this->activeAnnotationData.activeAnnotation.contents.length() != 0 ||
+        !this->activeAnnotationData.activeAnnotation.attachments.empty()) {
+        additions.push_back(this->activeAnnotationData.activeAnnotation);
     }
+    this->activeProject.get().annotations.ApplyEdits(removals, std::move(additions));
+    emit this->MarksChanged(QString::fromStdString(this->filePath));
     this->LoadFile(this->filePath);
 }
 
@@ -188,22 +355,36 @@ std::string CodeEditor::HTMLFormatAnnotation(const Annotation& sample, const std
         hashPos = keywordEndPos;
     }
 
+    // A line for each attachment, described rather than read in:
+    for (const Attachment& attachment : sample.attachments) {
+        formatted += "\n<span style=\"" + Config::Style::HTML::AnnotationMarker + "\">" + linePrefix + "</span> <span style=\"" +
+            Config::Style::HTML::AttachmentText + "\">[" +
+            QString::fromStdString(AttachmentStore::Describe(attachment)).toHtmlEscaped().toStdString() + "]</span>";
+    }
+
     return formatted;
 }
 
-std::string CodeEditor::AnnotateCode(const std::string& codeStr,
-    const std::vector<Annotation>& applicableAnnotations) {
+void CodeEditor::AnnotateCode(const std::vector<std::string>& codeLines, const std::size_t firstLine,
+    const std::vector<Annotation>& applicableAnnotations, QString& html) {
+    TRACE_SCOPE_DETAIL("CodeEditor::AnnotateCode", this->filePath);
+
+    const std::size_t codeLinesCount = codeLines.size();
+    const std::size_t lastLine = firstLine + codeLinesCount;
 
-    const QStringList codeLines = QString::fromStdString(codeStr).split('\n');
+    // Only what falls within [firstLine, lastLine) is shown:
+    const std::vector<Annotation>::const_iterator firstAnnotation = std::lower_bound(
+        applicableAnnotations.cbegin(), applicableAnnotations.cend(), firstLine,
+        [](const Annotation& annotation, const std::size_t line) { return annotation.lineRef < line; });
+    const std::vector<Annotation>::const_iterator lastAnnotation = std::lower_bound(
+        firstAnnotation, applicableAnnotations.cend(), lastLine,
+        [](const Annotation& annotation, const std::size_t line) { return annotation.lineRef < line; });
 
-    const std::size_t combinedSize = codeLines.size() + applicableAnnotations.size();
+    const std::size_t combinedSize = codeLinesCount + static_cast<std::size_t>(lastAnnotation - firstAnnotation);
 
-    QStringList annotatedCode(combinedSize);
-    std::vector<std::size_t> annotatedLines;
     const QString annotationPrefix = ">";
 
-    const std::size_t codeLinesCount = codeLines.size();
-    const std::uint16_t maxLineLength = codeLinesCount > 9 ? std::log10(static_cast<double>(codeLinesCount)) + 1: 1; // https://stackoverflow.com/a/1489928
+    const std::uint16_t maxLineLength = lastLine > 9 ? std::log10(static_cast<double>(lastLine)) + 1: 1; // https://stackoverflow.com/a/1489928
     std::vector<QString> cachedSpaces(std::max(static_cast<std::size_t>(maxLineLength), static_cast<std::size_t>(annotationPrefix.length())));
     for (std::size_t spaces = 0; spaces < cachedSpaces.size(); spaces++) {
         for (std::size_t i = 0; i < spaces; i++) {
@@ -211,86 +392,477 @@ std::string CodeEditor::AnnotateCode(const std::string& codeStr,
         }
     }
 
+    // The rendered annotations, keyed by the (window relative) line they're written on:
+    const std::size_t windowEditOffset =
+        this->activeProject.get().annotations.ResolveToEditLineRef(this->filePath, firstLine);
     const QString fullAnnotationPrefix = annotationPrefix + cachedSpaces[cachedSpaces.size() - (annotationPrefix.length())] + " |";
-    for (const Annotation& iterativeAnnotation : applicableAnnotations) {
+    std::vector<std::pair<std::size_t, QString>> annotatedLines;
+    for (std::vector<Annotation>::const_iterator iterativeAnnotation = firstAnnotation;
+         iterativeAnnotation != lastAnnotation; ++iterativeAnnotation) {
         const std::size_t writePos =
                 this->activeProject.get().annotations.ResolveToEditLineRef(
-                    this->filePath, iterativeAnnotation.lineRef
-                );
+                    this->filePath, iterativeAnnotation->lineRef
+                ) - windowEditOffset;
 
-        annotatedCode[writePos] =
+        annotatedLines.emplace_back(writePos,
             "<span style=\"" + QString::fromStdString(Config::Style::HTML::AnnotationMarker) +
             "\">" + fullAnnotationPrefix + "</span> <span style=\"" + QString::fromStdString(Config::Style::HTML::AnnotationContents) + "\">" +
-            QString::fromStdString(this->HTMLFormatAnnotation(iterativeAnnotation, fullAnnotationPrefix.toStdString())) + "</span>";
+            QString::fromStdString(this->HTMLFormatAnnotation(*iterativeAnnotation, fullAnnotationPrefix.toStdString())) + "</span>");
+    }
+
+    const QString codeMarkerStart = "<span style=\"" + QString::fromStdString(Config::Style::HTML::CodeMarker);
+    const QString bookmarkMarker = QString::fromStdString(Config::Style::HTML::BookmarkMarker);
+    const QString rangeMarker = QString::fromStdString(Config::Style::HTML::RangeMarker);
+    const QString rangeTextStart = "<span style=\"" + QString::fromStdString(Config::Style::HTML::RangeText) + "\">";
+    this->codeColumnOffset = static_cast<std::size_t>(cachedSpaces.size()) + 3;
+
+    // The characters of each (window relative) line within a range annotation, [from, to): lines
+    // inside a range are covered whole, the first/last lines of one from/to its columns:
+    const std::size_t wholeLine = std::numeric_limits<std::size_t>::max();
+    std::vector<std::ptrdiff_t> insideRanges(codeLinesCount + 1, 0); // Difference array.
+    std::vector<std::pair<std::size_t, std::size_t>> rangeColumns(codeLinesCount, { wholeLine, 0 });
+    for (const Annotation& range : this->activeProject.get().annotations.GetRangesOverlapping(this->filePath, firstLine, lastLine)) {
+        const std::size_t endColumn = range.endColumn == 0 ? wholeLine : range.endColumn;
+        if (range.lineRef >= firstLine) {
+            std::pair<std::size_t, std::size_t>& columns = rangeColumns[range.lineRef - firstLine];
+            columns.first = std::min(columns.first, range.startColumn);
+            columns.second = std::max(columns.second, range.endLineRef == range.lineRef ? endColumn : wholeLine);
+        }
+        if (range.endLineRef > range.lineRef && range.endLineRef < lastLine) {
+            std::pair<std::size_t, std::size_t>& columns = rangeColumns[range.endLineRef - firstLine];
+            columns.first = 0;
+            columns.second = std::max(columns.second, endColumn);
+        }
+        const std::size_t insideFirst = std::max(range.lineRef + 1, firstLine);
+        const std::size_t insideEnd = std::min(range.endLineRef, lastLine);
+        if (insideFirst < insideEnd) {
+            insideRanges[insideFirst - firstLine]++;
+            insideRanges[insideEnd - firstLine]--;
+        }
+    }
+    std::ptrdiff_t insideDepth = 0;
+    for (std::size_t i = 0; i < codeLinesCount; i++) {
+        insideDepth += insideRanges[i];
+        if (insideDepth > 0) {
+            rangeColumns[i] = { 0, wholeLine };
+        }
+    }
 
-        annotatedLines.push_back(writePos);
+    // Rendered straight into 'html', the code itself is decoded (and escaped) from the raw lines:
+    std::size_t codeBytes = 0;
+    for (const std::string& codeLine : codeLines) {
+        codeBytes += codeLine.size();
     }
+    html.reserve(html.size() + static_cast<qsizetype>(codeBytes + codeLinesCount * (codeMarkerStart.size() + maxLineLength + 16)));
 
     std::vector<Bookmark> existingBookmarks = this->activeProject.get().bookmarks.GetBookmarks(this->filePath);
+    std::vector<Bookmark>::const_iterator nextBookmark = std::lower_bound(existingBookmarks.cbegin(), existingBookmarks.cend(), firstLine,
+        [](const Bookmark& bookmark, const std::size_t line) { return bookmark.lineRef < line; });
+    std::vector<std::pair<std::size_t, QString>>::const_iterator nextAnnotation = annotatedLines.cbegin();
     for (std::size_t writeLine = 0, codeLineIndex = 0;
          writeLine < combinedSize && codeLineIndex < codeLinesCount;
          writeLine++) {
+        if (writeLine > 0) {
+            html += '\n';
+        }
 
-        const bool isBookmark = (existingBookmarks.size() > 0 && existingBookmarks.front().lineRef == codeLineIndex);
-
-        // Remember: The annotatedLines vector is *sorted* due to the applicableAnnotations vector being sorted.
+        // Remember: annotatedLines is *sorted* due to the applicableAnnotations vector being sorted.
         //           (in ascending order)
-        if (annotatedLines.size() > 0 && annotatedLines[0] == writeLine) {
-            annotatedLines.erase(annotatedLines.begin());
+        if (nextAnnotation != annotatedLines.cend() && nextAnnotation->first == writeLine) {
+            html += nextAnnotation->second;
+            ++nextAnnotation;
             continue;
         }
 
+        const bool isBookmark = (nextBookmark != existingBookmarks.cend() && nextBookmark->lineRef == firstLine + codeLineIndex);
         if (isBookmark) {
-            existingBookmarks.erase(existingBookmarks.begin());
+            ++nextBookmark;
         }
 
-        const QString lineNumber = QString::number(codeLineIndex);
+        const QString lineNumber = QString::number(firstLine + codeLineIndex);
         const QString& spacesBuf = cachedSpaces[cachedSpaces.size() - lineNumber.length()];
 
-        annotatedCode[writeLine] =
-                "<span style=\"" + QString::fromStdString(Config::Style::HTML::CodeMarker) +
-                (isBookmark ? QString::fromStdString(Config::Style::HTML::BookmarkMarker) : QString("")) +
-                "\">" +
-                lineNumber + spacesBuf + " |</span> " +
-                codeLines[codeLineIndex].toHtmlEscaped();
+        const std::pair<std::size_t, std::size_t>& columns = rangeColumns[codeLineIndex];
+        const bool inRange = columns.first < columns.second;
+
+        html += codeMarkerStart;
+        if (isBookmark) {
+            html += bookmarkMarker;
+        }
+        if (inRange) {
+            html += rangeMarker;
+        }
+        html += "\">";
+        html += lineNumber;
+        html += spacesBuf;
+        html += " |</span> ";
+        const std::string& codeLine = codeLines[codeLineIndex];
+        if (!inRange) {
+            TextKernels::AppendUTF8(html, codeLine.data(), codeLine.size(), true);
+        }
+        else if (columns.first == 0 && columns.second == wholeLine) {
+            html += rangeTextStart;
+            TextKernels::AppendUTF8(html, codeLine.data(), codeLine.size(), true);
+            html += "</span>";
+        }
+        else {
+            // Columns count characters, so only partly covered lines need decoding up front:
+            const QString decoded = QString::fromUtf8(codeLine.data(), static_cast<qsizetype>(codeLine.size()));
+            const qsizetype from = static_cast<qsizetype>(std::min(columns.first, static_cast<std::size_t>(decoded.size())));
+            const qsizetype to = static_cast<qsizetype>(std::min(columns.second, static_cast<std::size_t>(decoded.size())));
+            html += decoded.left(from).toHtmlEscaped();
+            html += rangeTextStart;
+            html += decoded.mid(from, to - from).toHtmlEscaped();
+            html += "</span>";
+            html += decoded.mid(to).toHtmlEscaped();
+        }
 
         ++codeLineIndex;
     }
-    return annotatedCode.join('\n').toStdString();
+}
+
+std::size_t CodeEditor::BlockToCodeLine(const std::size_t blockNumber) const {
+    const AnnotationCollection& annotations = this->activeProject.get().annotations;
+    const std::size_t windowEditOffset = annotations.ResolveToEditLineRef(this->filePath, this->windowFirstLine);
+    return annotations.ResolveToCodeLineRef(this->filePath, windowEditOffset + blockNumber);
+}
+
+void CodeEditor::ScrollToCodeLine(const std::size_t codeLine) {
+    const AnnotationCollection& annotations = this->activeProject.get().annotations;
+    const std::size_t blockNumber = annotations.ResolveToEditLineRef(this->filePath, codeLine) -
+        annotations.ResolveToEditLineRef(this->filePath, this->windowFirstLine);
+    const QTextBlock block = this->document()->findBlockByNumber(static_cast<int>(blockNumber));
+    if (!block.isValid()) {
+        return;
+    }
+    this->setTextCursor(QTextCursor(block));
+    this->verticalScrollBar()->setValue(static_cast<int>(this->document()->documentLayout()->blockBoundingRect(block).top()));
+}
+
+void CodeEditor::RecenterWindow(const std::size_t codeLine) {
+    this->updatingWindow = true;
+    if (this->windowed) {
+        const std::size_t halfWindow = Config::Paging::WindowLines / 2;
+        this->windowFirstLine = codeLine > halfWindow ? codeLine - halfWindow : 0;
+        this->LoadFile(this->filePath);
+    }
+    this->ScrollToCodeLine(codeLine);
+    this->updatingWindow = false;
+}
+
+void CodeEditor::WindowScrolled(const int value) {
+    if (!this->windowed || this->updatingWindow || !this->pagedFile) {
+        return;
+    }
+    const QScrollBar* const scrollBar = this->verticalScrollBar();
+    const bool atStart = value == scrollBar->minimum() && this->windowFirstLine > 0;
+    const bool atEnd = value == scrollBar->maximum() &&
+        this->pagedFile->HasLine(this->windowFirstLine + Config::Paging::WindowLines);
+    if (value == scrollBar->maximum() && !atEnd && !this->awaitingLine && !this->pagedFile->IsIndexComplete()) {
+        this->indexPoll.start(); // The index hasn't got past the window yet, this is tried again as it does.
+    }
+    if (!atStart && !atEnd) {
+        return;
+    }
+
+    // Keep whatever's at the top of the view where it is whilst the window moves around it:
+    const std::size_t topLine = this->BlockToCodeLine(static_cast<std::size_t>(this->cursorForPosition(QPoint(0, 0)).blockNumber()));
+    this->RecenterWindow(topLine);
+}
+
+std::pair<std::size_t, std::size_t> CodeEditor::BlocksToCodeLines(const int firstBlock, const int lastBlock) const {
+    return std::make_pair(this->BlockToCodeLine(static_cast<std::size_t>(firstBlock)),
+                          this->BlockToCodeLine(static_cast<std::size_t>(lastBlock)) + 1);
+}
+
+std::pair<std::size_t, std::size_t> CodeEditor::SelectedCodeLines() const {
+    // Just the cursor's line without a selection:
+    const QTextCursor cursor = this->textCursor();
+    return this->BlocksToCodeLines(this->document()->findBlock(cursor.selectionStart()).blockNumber(),
+                                   this->document()->findBlock(cursor.selectionEnd()).blockNumber());
+}
+
+void CodeEditor::SetReviewed(const std::pair<std::size_t, std::size_t> codeLines, const bool reviewed) {
+    ReviewCoverage& coverage = this->activeProject.get().coverage;
+    const std::size_t changed = reviewed ? coverage.MarkReviewed(this->filePath, codeLines.first, codeLines.second) :
+                                           coverage.MarkUnreviewed(this->filePath, codeLines.first, codeLines.second);
+    if (changed != 0) {
+        emit this->CoverageChanged(QString::fromStdString(this->filePath));
+    }
+}
+
+bool CodeEditor::IsBeingViewed() const {
+    // Editors behind other subwindows, or in a window that's in the background, aren't being read:
+    const QMdiSubWindow* const subWindow = qobject_cast<const QMdiSubWindow*>(this->parentWidget());
+    return this->isVisible() && this->window()->isActiveWindow() && subWindow != nullptr &&
+        subWindow->mdiArea() != nullptr && subWindow->mdiArea()->activeSubWindow() == subWindow;
+}
+
+void CodeEditor::RestartReviewDwell() {
+    if (this->IsBeingViewed()) {
+        this->reviewDwell.start();
+    }
+    else {
+        this->reviewDwell.stop();
+    }
+}
+
+void CodeEditor::changeEvent(QEvent* const event) {
+    QTextBrowser::changeEvent(event);
+    // The window coming to the front/going to the back:
+    if (event->type() == QEvent::ActivationChange) {
+        this->RestartReviewDwell();
+    }
+}
+
+void CodeEditor::MarkViewReviewed() {
+    // Checked again, it may have stopped being looked at without anything stopping the wait:
+    if (!this->IsBeingViewed() || this->document()->isEmpty()) {
+        return;
+    }
+    const int firstBlock = this->cursorForPosition(QPoint(0, 0)).blockNumber();
+    const int lastBlock = this->cursorForPosition(QPoint(0, this->viewport()->height() - 1)).blockNumber();
+    this->SetReviewed(this->BlocksToCodeLines(firstBlock, lastBlock), true);
+}
+
+void CodeEditor::MarkSelectionReviewed() {
+    this->SetReviewed(this->SelectedCodeLines(), true);
+}
+
+void CodeEditor::MarkSelectionUnreviewed() {
+    this->SetReviewed(this->SelectedCodeLines(), false);
+}
+
+void CodeEditor::GoToLine() {
+    bool accepted = false;
+    const int currentLine = static_cast<int>(this->BlockToCodeLine(static_cast<std::size_t>(this->textCursor().blockNumber())));
+    // The line count isn't known until the file has been indexed, so don't bound it until then:
+    const int lastLine = this->pagedFile && this->pagedFile->IsIndexComplete() ?
+        static_cast<int>(this->pagedFile->KnownLineCount() - 1) : std::numeric_limits<int>::max();
+    const std::size_t line = static_cast<std::size_t>(QInputDialog::getInt(this, "Go to Line", "Line:", currentLine, 0, lastLine, 1, &accepted));
+    if (!accepted) {
+        return;
+    }
+    this->GoToCodeLine(line);
+}
+
+void CodeEditor::GoToCodeLine(std::size_t codeLine) {
+    WATCHDOG_TRACE_SCOPE_DETAIL("CodeEditor::GoToCodeLine", this->filePath);
+    this->Resume();
+    if (!this->pagedFile) {
+        return;
+    }
+    this->StopAwaitingLine();
+    if (this->pagedFile->HasLine(codeLine) || this->pagedFile->IsIndexComplete()) {
+        this->RecenterWindow(std::min(codeLine, this->pagedFile->KnownLineCount() - 1));
+        return;
+    }
+    // As far as the index has got for now:
+    this->RecenterWindow(this->pagedFile->KnownLineCount() - 1);
+    this->AwaitLine(codeLine);
+}
+
+void CodeEditor::AwaitLine(const std::size_t codeLine) {
+    this->awaitedLine = codeLine;
+    this->awaitingLine = true;
+    if (this->indexProgress == nullptr) {
+        this->indexProgress = new QProgressDialog(this);
+        this->indexProgress->setRange(0, 100);
+        this->indexProgress->setMinimumDuration(250);
+        QObject::connect(this->indexProgress, SIGNAL(canceled()), this, SLOT(StopAwaitingLine()));
+    }
+    this->indexProgress->setLabelText("Indexing up to line " + QString::number(codeLine) + " of " +
+                                      QString::fromStdString(this->filePath) + "...");
+    this->indexProgress->setValue(0);
+    this->indexPoll.start();
+}
+
+void CodeEditor::CheckIndexProgress() {
+    if (!this->pagedFile) {
+        this->StopAwaitingLine();
+        return;
+    }
+    if (!this->awaitingLine) {
+        // Waiting to move the window along:
+        this->indexPoll.stop();
+        this->WindowScrolled(this->verticalScrollBar()->value());
+        return;
+    }
+    const bool indexComplete = this->pagedFile->IsIndexComplete();
+    const std::size_t knownLines = this->pagedFile->KnownLineCount();
+    if (this->awaitedLine < knownLines || indexComplete) {
+        const std::size_t codeLine = std::min(this->awaitedLine, knownLines - 1);
+        this->StopAwaitingLine();
+        this->RecenterWindow(codeLine);
+        return;
+    }
+    this->indexProgress->setValue(static_cast<int>(knownLines * 100 / (this->awaitedLine + 1)));
+}
+
+void CodeEditor::StopAwaitingLine() {
+    this->awaitingLine = false;
+    this->indexPoll.stop();
+    if (this->indexProgress != nullptr) {
+        this->indexProgress->reset(); // Hides it (auto-closing).
+    }
+}
+
+QString CodeEditor::SymbolUnderCursor() const {
+    QTextCursor cursor = this->textCursor();
+    cursor.select(QTextCursor::WordUnderCursor);
+    return cursor.selectedText();
+}
+
+void CodeEditor::RequestDefinition() {
+    const QString symbol = this->SymbolUnderCursor();
+    if (!symbol.isEmpty()) {
+        emit this->FindDefinition(symbol);
+    }
+}
+
+void CodeEditor::RequestReferences() {
+    const QString symbol = this->SymbolUnderCursor();
+    if (!symbol.isEmpty()) {
+        emit this->FindReferences(symbol);
+    }
 }
 
 void CodeEditor::ReloadFile() {
+    this->pagedFile.reset(); // Re-read the file from disk.
     this->LoadFile(this->filePath);
 }
 
 void CodeEditor::Reload() {
+    this->pagedFile.reset();
+    if (!this->suspended) { // Otherwise it's loaded afresh when resumed anyway.
+        this->LoadFile(this->filePath);
+    }
+}
+
+void CodeEditor::Suspend() {
+    if (this->suspended) {
+        return;
+    }
+    WATCHDOG_TRACE_SCOPE_DETAIL("CodeEditor::Suspend", this->filePath);
+    const QTextCursor cursor = this->textCursor();
+    this->suspendedView = {
+        .anchor = cursor.anchor(),
+        .position = cursor.position(),
+        .scrollValue = this->verticalScrollBar()->value()
+    };
+    this->suspended = true;
+
+    const bool wasUpdatingWindow = this->updatingWindow;
+    this->updatingWindow = true;
+    this->clear();
+    this->updatingWindow = wasUpdatingWindow;
+    this->reviewDwell.stop();
+    this->StopAwaitingLine();
+    // The file's pages go too, its line index is kept in the project's cache if it's costly to rebuild:
+    this->pagedFile.reset();
+    this->documentAccount.Set(0);
+}
+
+void CodeEditor::Resume() {
+    if (!this->suspended) {
+        return;
+    }
+    WATCHDOG_TRACE_SCOPE_DETAIL("CodeEditor::Resume", this->filePath);
+    this->suspended = false;
     this->LoadFile(this->filePath);
+
+    // The rebuilt document matches the old one bar any marks added meanwhile, so positions are only clamped:
+    const int lastPosition = std::max(0, this->document()->characterCount() - 1);
+    QTextCursor cursor(this->document());
+    cursor.setPosition(std::min(this->suspendedView.anchor, lastPosition));
+    cursor.setPosition(std::min(this->suspendedView.position, lastPosition), QTextCursor::KeepAnchor);
+    const bool wasUpdatingWindow = this->updatingWindow;
+    this->updatingWindow = true;
+    this->setTextCursor(cursor);
+    this->verticalScrollBar()->setValue(this->suspendedView.scrollValue);
+    this->updatingWindow = wasUpdatingWindow;
+}
+
+bool CodeEditor::IsSuspended() const {
+    return this->suspended;
+}
+
+Project& CodeEditor::GetProject() const {
+    return this->activeProject.get();
 }
 
 void CodeEditor::LoadFile(const std::string& relativePath) {
+    WATCHDOG_TRACE_SCOPE_DETAIL("CodeEditor::LoadFile", relativePath);
     const std::string path = this->activeProject.get().GetCodebasePath() + relativePath;
+    Watchdog::SetProjectSize(this->activeProject.get().annotations.Count(), this->activeProject.get().bookmarks.Count());
     const int previousScrollValue = this->verticalScrollBar()->value();
 
-    // Open the specified file and read its contents into a byte array:
-    QFile fileObj(QString::fromStdString(path));
-    fileObj.open(QIODevice::ReadOnly | QIODevice::Text);
-    QByteArray rawFileContents = fileObj.readAll();
-    fileObj.close();
+    // The file is only read a page at a time as lines are needed (and indexed in the background):
+    if (!this->pagedFile) {
+        // Saves rescanning big files for their line index next time they're opened:
+        this->pagedFile = std::make_unique<PagedFile>(path, true,
+            Project::GetLineIndexCachePath(this->activeProject.get().GetCacheDirectory(), relativePath, path), &this->contentCache);
+    }
+    this->windowed = this->pagedFile->Size() > Config::Paging::WindowedFileSize;
+    if (!this->windowed) {
+        this->windowFirstLine = 0;
+    }
 
-    // Cast that byte array into a string and format it:
-    const std::string fileContentsStr = rawFileContents.toStdString();
+    // The same window of the same version of the file with the same marks (as when an editor's
+    // resumed, or the file's open elsewhere) is taken as it was last rendered:
     const std::vector<Annotation> annotationsVec = this->activeProject.get().annotations.GetAnnotations(relativePath);
-    const std::string annotatedContents = this->AnnotateCode(fileContentsStr, annotationsVec);
+    const std::string marksFingerprint = MarksFingerprint(annotationsVec, this->activeProject.get().bookmarks.GetBookmarks(relativePath));
+    const auto renderKey = [&]() {
+        return "render:" + path + '\n' + std::to_string(this->pagedFile->Size()) + '\n' +
+               std::to_string(this->pagedFile->ModifiedTime()) + '\n' + std::to_string(this->windowFirstLine) + '\n' + marksFingerprint;
+    };
+    std::shared_ptr<const RenderedView> rendered = this->contentCache.Get<RenderedView>(renderKey());
+    if (!rendered) {
+        std::vector<std::string> codeLines = this->pagedFile->ReadLines(this->windowFirstLine,
+            this->windowed ? Config::Paging::WindowLines : std::numeric_limits<std::size_t>::max());
+        if (codeLines.empty()) {
+            // The file has shrunk to before the window, or (reopened) hasn't been indexed that
+            // far again yet, in which case the window's returned to once it has:
+            if (!this->pagedFile->IsIndexComplete() && !this->awaitingLine) {
+                this->AwaitLine(this->windowFirstLine + Config::Paging::WindowLines / 2);
+            }
+            this->windowFirstLine = 0;
+            codeLines = this->pagedFile->ReadLines(0, Config::Paging::WindowLines);
+        }
 
-    const QString editorHTML = QString::fromStdString("<style>* {white-space: pre; " +
-        Config::Style::HTML::UniversalText +
-        "}</style><p>" +
-        annotatedContents +
-        "</p>");
+        // Format it:
+        QString editorHTML = QString::fromStdString("<style>* {white-space: pre; " +
+            Config::Style::HTML::UniversalText +
+            "}</style><p>");
+        this->AnnotateCode(codeLines, this->windowFirstLine, annotationsVec, editorHTML);
+        editorHTML += "</p>";
+        const std::size_t renderedBytes = static_cast<std::size_t>(editorHTML.capacity()) * sizeof(QChar);
+        rendered = std::make_shared<const RenderedView>(RenderedView {
+            .html = std::move(editorHTML),
+            .codeColumnOffset = this->codeColumnOffset
+        });
+        this->contentCache.Put(renderKey(), rendered, renderedBytes);
+    }
+    this->codeColumnOffset = rendered->codeColumnOffset;
+
+    // Set QTextArea contents to the HTML-formatted string (without that scrolling the window along):
+    const bool wasUpdatingWindow = this->updatingWindow;
+    this->updatingWindow = true;
+    {
+        TRACE_SCOPE_DETAIL("CodeEditor::setHtml", relativePath);
+        this->setHtml(rendered->html);
+    }
 
-    // Set QTextArea contents to the HTML-formatted string:
-    this->setHtml(editorHTML);
+    // Rough estimate of the QTextDocument's footprint: its text plus per-block layout/format data.
+    const static std::size_t blockOverhead = 160;
+    const QTextDocument* const document = this->document();
+    this->documentAccount.Set(
+        static_cast<std::size_t>(document->characterCount()) * sizeof(QChar) +
+        static_cast<std::size_t>(document->blockCount()) * blockOverhead
+    );
 
     // Correct the selected line:
     this->verticalScrollBar()->setValue(previousScrollValue);
+    this->updatingWindow = wasUpdatingWindow;
+    this->RestartReviewDwell();
 }
@@ -6,41 +6,128 @@
 #include <QAction>
 #include <QDialog>
 #include <QObject>
+#include <QProgressDialog>
+#include <QTimer>
 #include <QWidget>
 #include <memory>
 #include "annotation.h"
+#include "contentcache.h"
 #include "ui_annotationeditor.h"
 #include "project.h"
+#include "memoryaccounting.h"
+#include "pagedfile.h"
+#include "shortcutdispatcher.h"
 
 class CodeEditor : public QTextBrowser
 {
     Q_OBJECT
 public:
-    CodeEditor(Project& project, const std::string& path, QWidget* const parent = nullptr);
+    // Pages of the file and rendered views of it are kept in 'cache', shared with other editors.
+    CodeEditor(Project& project, ContentCache& cache, const std::string& path, QWidget* const parent = nullptr);
     void LoadFile(const std::string& relativePath);
     void Reload();
+    // Scrolls to (and places the cursor on) 'codeLine', clamped to the end of the file.
+    void GoToCodeLine(std::size_t codeLine);
+    // Binds the editor's shortcuts, dispatched to whichever editor is the target.
+    static void AddBindings(ShortcutDispatcher& dispatcher);
+
+    // A suspended editor has dropped its document (whilst hidden), keeping just its cursor and
+    // scroll position to rebuild it as it was when resumed.
+    void Suspend();
+    void Resume();
+    bool IsSuspended() const;
+    // The project the editor was opened for.
+    Project& GetProject() const;
+public slots:
+    // (Re)starts the wait before the lines in view count as reviewed, if this is the editor being
+    // looked at (the active subwindow of the active window), otherwise stops it.
+    void RestartReviewDwell();
+signals:
+    void FindDefinition(const QString& symbol);
+    void FindReferences(const QString& symbol);
+    // An annotation or bookmark was added to/removed from 'fileRef'.
+    void MarksChanged(const QString& fileRef);
+    // Lines of 'fileRef' were marked as reviewed/unreviewed.
+    void CoverageChanged(const QString& fileRef);
 
 private:
     std::string filePath;
     std::reference_wrapper<Project> activeProject;
+    ContentCache& contentCache;
+    MemoryAccounting::Account documentAccount;
+
+    // Large files are rendered a window of lines at a time, starting at windowFirstLine:
+    std::unique_ptr<PagedFile> pagedFile;
+    std::size_t windowFirstLine = 0;
+    bool windowed = false;
+    bool updatingWindow = false;
+    // Characters before a line's code in its block (line number, padding and " | "), as last rendered:
+    std::size_t codeColumnOffset = 0;
+
+    // Restarted whenever the view moves, whatever's still in view once it fires has been reviewed:
+    QTimer reviewDwell;
 
-    std::unordered_map<std::string, std::vector<std::unique_ptr<QAction>>> keyBindings;
+    // Lines the background index hasn't reached yet are waited for, rather than scanned to
+    // here: a line to go to once it's indexed (if awaitingLine), or the window to move along
+    // once the index is past its end.
+    std::size_t awaitedLine = 0;
+    bool awaitingLine = false;
+    QTimer indexPoll;
+    QProgressDialog* indexProgress = nullptr; // Created on first use.
+    // Goes to 'codeLine' once the index has reached it, showing how far it's got meanwhile.
+    void AwaitLine(std::size_t codeLine);
+
+    bool suspended = false;
+    struct {
+        int anchor;
+        int position;
+        int scrollValue;
+    } suspendedView;
 
     struct {
         Annotation activeAnnotation;
         std::unique_ptr<Ui_Dialog> editor; // For getting the form's state to write to activeAnnotation.
         std::unique_ptr<QDialog> editorParentDialog; // For closing the window.
+        // Pasted in, only stored (and attached) once the annotation's submitted:
+        std::vector<std::string> pastedAttachments;
     } activeAnnotationData;
 
-    std::string AnnotateCode(const std::string& codeStr, const std::vector<Annotation>& applicableAnnotations);
+    // Appends the HTML for 'codeLines' (starting at 'firstLine') and their annotations/bookmarks
+    // (and any range annotations spanning them) to 'html'.
+    void AnnotateCode(const std::vector<std::string>& codeLines, std::size_t firstLine,
+                      const std::vector<Annotation>& applicableAnnotations, QString& html);
     std::string HTMLFormatAnnotation(const Annotation& sample, const std::string& linePrefix = "| ");
 
+    // Code line (of the whole file) that the document's block 'blockNumber' shows.
+    std::size_t BlockToCodeLine(std::size_t blockNumber) const;
+    void RecenterWindow(std::size_t codeLine);
+    QString SymbolUnderCursor() const;
+    void ScrollToCodeLine(std::size_t codeLine);
+    // The code lines [first, end) spanned by the document blocks [firstBlock, lastBlock].
+    std::pair<std::size_t, std::size_t> BlocksToCodeLines(int firstBlock, int lastBlock) const;
+    std::pair<std::size_t, std::size_t> SelectedCodeLines() const;
+    void SetReviewed(std::pair<std::size_t, std::size_t> codeLines, bool reviewed);
+    bool IsBeingViewed() const;
+
 private slots:
     void ReloadFile();
     void ToggleBookmark();
     void DeleteAnnotation();
+    // Opens the attachments of the annotation at the cursor.
+    void ViewAttachments();
     void BeginAnnotation();
     void AnnotationSubmit();
+    void GoToLine();
+    void RequestDefinition();
+    void RequestReferences();
+    void WindowScrolled(int value);
+    void CheckIndexProgress();
+    void StopAwaitingLine();
+    void MarkViewReviewed();
+    void MarkSelectionReviewed();
+    void MarkSelectionUnreviewed();
+protected:
+    void changeEvent(QEvent* event) override;
  };
 
 #endif // CODEEDITOR_H
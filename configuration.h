@@ -1,7 +1,11 @@
 #ifndef CONFIGURATION_H
 #define CONFIGURATION_H
 
-#include <QKeyEvent>
+#include <QtCore/qnamespace.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace Config {
     namespace Keybinds {
@@ -14,14 +18,73 @@ namespace Config {
             const static std::string AnnotationMarker = "background-color: rgba(150, 150, 230, 1); color:black;";
             const static std::string AnnotationContents = "color: rgba(255, 255, 255, 0.7);";
             const static std::string AnnotationToken = "color: rgba(150, 150, 230, 1); text-decoration: underline;";//font-weight: bold;";
+            const static std::string AttachmentText = "color: rgba(150, 150, 230, 1); font-style: italic;";
             const static std::string CodeMarker = "color: rgba(255, 255, 255, 0.5);";
             const static std::string BookmarkMarker = "background-color: rgba(230, 230, 50, 1); color: black;";
+            const static std::string RangeMarker = "border-left: 2px solid rgba(150, 150, 230, 1);";
+            const static std::string RangeText = "background-color: rgba(150, 150, 230, 0.2);";
         };
         const static bool DisplayKeywordHashtag = false;
     };
+    namespace Responsiveness {
+        // How long the event loop may go without turning over before it counts as a stall.
+        const static std::chrono::milliseconds StallThreshold(200);
+    };
+    namespace Editors {
+        // Hidden (minimised or covered) editors kept as they are, most recently active first.
+        // Any others drop their document until they're next shown.
+        const static std::size_t ResidentHiddenEditors = 4;
+    };
+    namespace Coverage {
+        // How long lines must stay in view in a CodeEditor before they count as reviewed.
+        const static std::chrono::milliseconds ReviewDwell(2000);
+    };
+    namespace Paging {
+        // Files larger than this are shown a window of lines at a time rather than all at once.
+        const static std::uint64_t WindowedFileSize = 8 * 1024 * 1024;
+        const static std::size_t WindowLines = 4000;
+        // Line indexes of files larger than this are kept in the project's cache between sessions.
+        const static std::uint64_t CachedIndexFileSize = 8 * 1024 * 1024;
+        // How often an editor waiting on its file's line index (to go to a line) checks on it.
+        const static std::chrono::milliseconds IndexPoll(100);
+    };
+    namespace Navigation {
+        // Entries handed from the directory scanner to the navigation tree at a time.
+        const static std::size_t ScanBatchSize = 256;
+        // Always hidden, whatever the codebase's .gitignore files and the project say.
+        const static std::vector<std::string> DefaultExcludes = { ".git/" };
+        // Best matches listed by the "go to file" palette.
+        const static std::size_t QuickOpenResults = 100;
+    };
+    namespace Workspace {
+        // File pages and rendered editor views kept for every open codebase together.
+        const static std::size_t CacheBudget = 256 * 1024 * 1024;
+    };
+    namespace Report {
+        // Lines of code shown either side of each finding in an audit report, by default.
+        const static int ContextLines = 3;
+    };
+    namespace History {
+        // Earlier versions of an annotation kept as deltas in a row before one is stored in full.
+        const static std::size_t SnapshotInterval = 16;
+    };
+    namespace Query {
+        // Files an annotation query matches (in parallel) before handing over what it's found.
+        const static std::size_t ChunkFiles = 64;
+        // Ranked (full-text) findings handed over at a time, best first.
+        const static std::size_t ChunkHits = 512;
+    };
+    namespace Attachments {
+        // Text at least this long pasted into an annotation is attached to it instead.
+        const static int PasteThreshold = 4 * 1024;
+        // Attachments this large are stored compressed when that saves 1/CompressionSaving of them.
+        const static std::size_t CompressedSize = 256;
+        const static std::size_t CompressionSaving = 8;
+    };
     enum VR_Specifications {
         BLOCKS,
-        SNIPPET // Sandia's specification 'SAND2019-10279R'
+        SNIPPET, // Sandia's specification 'SAND2019-10279R'
+        BINARY // Everything BLOCKS holds, smaller and quicker to read/write.
     };
 };
 
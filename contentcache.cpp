@@ -0,0 +1,63 @@
+#include "contentcache.h"
+
+ContentCache::ContentCache(const std::size_t budgetBytes, const std::string& name) :
+    budgetBytes(budgetBytes), account(MemoryAccounting::CACHES, name) {}
+
+std::shared_ptr<const void> ContentCache::GetEntry(const std::string& key) {
+    const std::lock_guard<std::mutex> cacheLock(this->mutex);
+    const std::unordered_map<std::string, std::list<Entry>::iterator>::const_iterator found = this->entriesByKey.find(key);
+    if (found == this->entriesByKey.cend()) {
+        return nullptr;
+    }
+    this->entries.splice(this->entries.begin(), this->entries, found->second);
+    return found->second->value;
+}
+
+void ContentCache::PutEntry(const std::string& key, std::shared_ptr<const void> value, const std::size_t bytes) {
+    // Released outside of the lock:
+    std::shared_ptr<const void> replaced;
+    std::list<Entry> evicted;
+    {
+        const std::lock_guard<std::mutex> cacheLock(this->mutex);
+        const std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = this->entriesByKey.find(key);
+        if (found != this->entriesByKey.end()) {
+            replaced = std::move(found->second->value);
+            this->heldBytes -= found->second->bytes;
+            this->entries.erase(found->second);
+            this->entriesByKey.erase(found);
+        }
+        if (bytes <= this->budgetBytes) {
+            this->entries.push_front(Entry {
+                .key = key,
+                .value = std::move(value),
+                .bytes = bytes
+            });
+            this->entriesByKey.emplace(key, this->entries.begin());
+            this->heldBytes += bytes;
+        }
+        this->Trim(evicted);
+    }
+}
+
+void ContentCache::SetBudget(const std::size_t budgetBytes) {
+    std::list<Entry> evicted;
+    {
+        const std::lock_guard<std::mutex> cacheLock(this->mutex);
+        this->budgetBytes = budgetBytes;
+        this->Trim(evicted);
+    }
+}
+
+void ContentCache::Trim(std::list<Entry>& evicted) {
+    while (this->heldBytes > this->budgetBytes) {
+        this->heldBytes -= this->entries.back().bytes;
+        this->entriesByKey.erase(this->entries.back().key);
+        evicted.splice(evicted.end(), this->entries, std::prev(this->entries.end()));
+    }
+    this->account.Set(this->heldBytes);
+}
+
+std::size_t ContentCache::Size() const {
+    const std::lock_guard<std::mutex> cacheLock(this->mutex);
+    return this->heldBytes;
+}
@@ -0,0 +1,57 @@
+#ifndef CONTENTCACHE_H
+#define CONTENTCACHE_H
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "memoryaccounting.h"
+
+// Derived data that's cheap to keep but costly to rebuild (file pages, rendered editor views)
+// shared between every project in a Workspace and held to one budget, least recently used
+// entries going first once it's exceeded. Entries are immutable and handed out shared so an
+// evicted one lives on for whoever still has it. Keys are namespaced by their users (e.g.
+// "page:") which also decide what type is stored under them. Safe from any thread.
+
+class ContentCache {
+public:
+    ContentCache(std::size_t budgetBytes, const std::string& name);
+    ContentCache(const ContentCache&) = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+
+    template<typename T>
+    std::shared_ptr<const T> Get(const std::string& key) {
+        return std::static_pointer_cast<const T>(this->GetEntry(key));
+    }
+    // Replaces whatever was under 'key'. 'bytes' is the value's (estimated) footprint, values
+    // larger than the whole budget aren't kept.
+    template<typename T>
+    void Put(const std::string& key, std::shared_ptr<const T> value, std::size_t bytes) {
+        this->PutEntry(key, std::static_pointer_cast<const void>(std::move(value)), bytes);
+    }
+
+    void SetBudget(std::size_t budgetBytes);
+    std::size_t Size() const; // Bytes held.
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const void> value;
+        std::size_t bytes;
+    };
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> entriesByKey;
+    std::size_t budgetBytes;
+    std::size_t heldBytes = 0;
+    MemoryAccounting::Account account;
+
+    std::shared_ptr<const void> GetEntry(const std::string& key);
+    void PutEntry(const std::string& key, std::shared_ptr<const void> value, std::size_t bytes);
+    // Moves the least recently used entries into 'evicted' (to be released once 'mutex', which
+    // must be held, is unlocked) until within budget.
+    void Trim(std::list<Entry>& evicted);
+};
+
+#endif // CONTENTCACHE_H
@@ -0,0 +1,185 @@
+#include "directoryscanner.h"
+#include <unordered_map>
+#include "cachefile.h"
+#include "tracing.h"
+
+namespace {
+    const static std::uint32_t ListingMagic = 0x5249444B; // "KDIR"
+    const static std::uint32_t ListingVersion = 1;
+    const static std::uint8_t DirectoryFlag = 1;
+    const static std::uint8_t SymlinkFlag = 2;
+}
+
+DirectoryScanner::DirectoryScanner(const std::string& codebasePath, const std::vector<std::string>& excludePatterns,
+                                   const std::size_t batchSize, BatchCallback onBatch) :
+    codebasePath(codebasePath), batchSize(batchSize), onBatch(std::move(onBatch)) {
+    this->ignoreRules.AddExcludePatterns(excludePatterns);
+    this->worker = std::thread(&DirectoryScanner::Run, this);
+}
+
+DirectoryScanner::~DirectoryScanner() {
+    {
+        const std::lock_guard<std::mutex> queueLock(this->queueMutex);
+        this->stopping = true;
+    }
+    this->queueCondition.notify_one();
+    this->worker.join();
+}
+
+void DirectoryScanner::Request(const std::string& directory) {
+    {
+        const std::lock_guard<std::mutex> queueLock(this->queueMutex);
+        this->queue.push_back(directory);
+    }
+    this->queueCondition.notify_one();
+}
+
+void DirectoryScanner::Run() {
+    for (;;) {
+        std::string directory;
+        {
+            std::unique_lock<std::mutex> queueLock(this->queueMutex);
+            this->queueCondition.wait(queueLock, [this]() {
+                return this->stopping || !this->queue.empty();
+            });
+            if (this->stopping) {
+                return;
+            }
+            directory = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        this->Scan(directory);
+    }
+}
+
+void DirectoryScanner::Scan(const std::string& directory) {
+    TRACE_SCOPE_DETAIL("DirectoryScanner::Scan", directory);
+    this->ignoreRules.LoadGitignore(this->codebasePath, directory);
+
+    std::vector<Entry> batch;
+    bool stopped = false;
+    DirectoryScanner::ReadEntries(this->codebasePath + directory, [&](Entry&& entry) {
+        if (this->ignoreRules.IsIgnored(directory.empty() ? entry.name : directory + "/" + entry.name, entry.isDirectory)) {
+            return true;
+        }
+        batch.push_back(std::move(entry));
+        if (batch.size() < this->batchSize) {
+            return true;
+        }
+        this->onBatch(directory, std::move(batch), false);
+        batch.clear();
+
+        const std::lock_guard<std::mutex> queueLock(this->queueMutex);
+        stopped = this->stopping;
+        return !stopped;
+    });
+    if (!stopped) {
+        this->onBatch(directory, std::move(batch), true);
+    }
+}
+
+std::vector<std::string> DirectoryScanner::ListFiles(const std::string& codebasePath, const std::vector<std::string>& excludePatterns,
+                                                     const std::atomic<bool>& cancelled, const std::filesystem::path& listingCachePath) {
+    TRACE_SCOPE("DirectoryScanner::ListFiles");
+    // Every directory's entries before filtering, so that changes to the ignore rules don't
+    // invalidate them:
+    struct Listing {
+        std::int64_t modified;
+        std::vector<Entry> entries;
+    };
+    std::unordered_map<std::string, Listing> cachedListings;
+    if (!listingCachePath.empty()) {
+        CacheFile::Reader listingFile(listingCachePath, ListingMagic, ListingVersion);
+        std::uint64_t directoryCount = 0;
+        listingFile.Read(directoryCount);
+        for (std::uint64_t directoryIndex = 0; directoryIndex < directoryCount && listingFile.Good(); directoryIndex++) {
+            std::string directory;
+            Listing listing;
+            std::uint64_t entryCount = 0;
+            listingFile.ReadString(directory);
+            listingFile.Read(listing.modified);
+            listingFile.Read(entryCount);
+            for (std::uint64_t entryIndex = 0; entryIndex < entryCount && listingFile.Good(); entryIndex++) {
+                Entry& entry = listing.entries.emplace_back();
+                std::uint8_t flags = 0;
+                listingFile.ReadString(entry.name);
+                listingFile.Read(flags);
+                entry.isDirectory = (flags & DirectoryFlag) != 0;
+                entry.isSymlink = (flags & SymlinkFlag) != 0;
+            }
+            cachedListings.emplace(std::move(directory), std::move(listing));
+        }
+        if (!listingFile.Good()) {
+            cachedListings.clear(); // Corrupt or from another version, everything's read again.
+        }
+    }
+
+    IgnoreRules ignoreRules;
+    ignoreRules.AddExcludePatterns(excludePatterns);
+    std::vector<std::string> files;
+    std::vector<std::pair<std::string, Listing>> listings;
+    bool listingsChanged = false;
+    std::vector<std::string> pending = { "" };
+    while (!pending.empty() && !cancelled) {
+        const std::string directory = std::move(pending.back());
+        pending.pop_back();
+        ignoreRules.LoadGitignore(codebasePath, directory);
+
+        std::error_code modifiedError;
+        const std::int64_t modified = static_cast<std::int64_t>(
+            std::filesystem::last_write_time(codebasePath + directory, modifiedError).time_since_epoch().count());
+        const std::unordered_map<std::string, Listing>::iterator cachedListing = cachedListings.find(directory);
+        Listing listing;
+        if (cachedListing != cachedListings.end() && cachedListing->second.modified == modified && !modifiedError) {
+            listing = std::move(cachedListing->second);
+        }
+        else {
+            listing.modified = modified;
+            DirectoryScanner::ReadEntries(codebasePath + directory, [&listing, &cancelled](Entry&& entry) {
+                listing.entries.push_back(std::move(entry));
+                return !cancelled;
+            });
+            listingsChanged = true;
+        }
+
+        for (const Entry& entry : listing.entries) {
+            const std::string entryPath = directory.empty() ? entry.name : directory + "/" + entry.name;
+            if (entry.isDirectory && entry.isSymlink) {
+                continue; // It could lead back up the tree.
+            }
+            if (!ignoreRules.IsIgnored(entryPath, entry.isDirectory)) {
+                (entry.isDirectory ? pending : files).push_back(entryPath);
+            }
+        }
+        listings.emplace_back(directory, std::move(listing));
+    }
+
+    // Directories that have since disappeared (or been ignored) drop out of the cache too:
+    if (!listingCachePath.empty() && !cancelled && (listingsChanged || listings.size() != cachedListings.size())) {
+        CacheFile::Writer listingFile(listingCachePath, ListingMagic, ListingVersion);
+        listingFile.Write(static_cast<std::uint64_t>(listings.size()));
+        for (const std::pair<std::string, Listing>& listing : listings) {
+            listingFile.WriteString(listing.first);
+            listingFile.Write(listing.second.modified);
+            listingFile.Write(static_cast<std::uint64_t>(listing.second.entries.size()));
+            for (const Entry& entry : listing.second.entries) {
+                listingFile.WriteString(entry.name);
+                listingFile.Write(static_cast<std::uint8_t>((entry.isDirectory ? DirectoryFlag : 0) | (entry.isSymlink ? SymlinkFlag : 0)));
+            }
+        }
+        listingFile.Commit();
+    }
+    return files;
+}
+
+void DirectoryScanner::ReadEntries(const std::string& path, const std::function<bool(Entry&&)>& onEntry) {
+    std::error_code iterationError;
+    std::filesystem::directory_iterator entry(path, iterationError);
+    for (; !iterationError && entry != std::filesystem::directory_iterator(); entry.increment(iterationError)) {
+        std::error_code statusError, symlinkError;
+        if (!onEntry({ .name = entry->path().filename().string(), .isDirectory = entry->is_directory(statusError),
+                       .isSymlink = entry->is_symlink(symlinkError) })) {
+            return;
+        }
+    }
+}
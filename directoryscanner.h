@@ -0,0 +1,62 @@
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ignorerules.h"
+
+// Lists directories of the codebase on a worker thread, skipping whatever the ignore rules
+// hide. Directories are listed in the order they're requested and each one's entries are
+// handed over in batches as they're read so that huge directories show up straight away.
+
+class DirectoryScanner {
+public:
+    struct Entry {
+        std::string name;
+        bool isDirectory;
+        bool isSymlink; // Symlinked directories are never descended into by ListFiles().
+    };
+    // Called on the worker thread, 'complete' is set on the last batch of a directory (which
+    // may be empty).
+    typedef std::function<void(const std::string& directory, std::vector<Entry> batch, bool complete)> BatchCallback;
+
+    DirectoryScanner(const std::string& codebasePath, const std::vector<std::string>& excludePatterns,
+                     std::size_t batchSize, BatchCallback onBatch);
+    ~DirectoryScanner();
+
+    // Queues 'directory' (relative to the codebase, "" for the root) to be listed. Only
+    // directories that have been listed themselves as entries (or the root) may be requested.
+    void Request(const std::string& directory);
+
+    // Every file in the codebase the ignore rules don't hide (relative to it), listed on the
+    // calling thread. Returns whatever's been found so far once 'cancelled' is set. Given a
+    // cache, directories whose modification time is unchanged since it was saved are taken
+    // from it rather than being read again, and it's updated to match.
+    static std::vector<std::string> ListFiles(const std::string& codebasePath, const std::vector<std::string>& excludePatterns,
+                                              const std::atomic<bool>& cancelled,
+                                              const std::filesystem::path& listingCachePath = std::filesystem::path());
+private:
+    const std::string codebasePath;
+    const std::size_t batchSize;
+    const BatchCallback onBatch;
+    IgnoreRules ignoreRules; // Only touched by the worker.
+
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<std::string> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void Run();
+    void Scan(const std::string& directory);
+    // Hands each entry of the directory at 'path' to 'onEntry', stopping early if that returns false.
+    static void ReadEntries(const std::string& path, const std::function<bool(Entry&&)>& onEntry);
+};
+
+#endif // DIRECTORYSCANNER_H
@@ -0,0 +1,131 @@
+#include "findingsview.h"
+#include <QVBoxLayout>
+#include <cmath>
+#include <stdexcept>
+#include "textkernels.h"
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+FindingsView::FindingsView(Project& project, QWidget* const parent) : QWidget(parent),
+    activeProject(project), queryEdit(new QLineEdit(this)), planLabel(new QLabel(this)), listView(new QTreeView(this)),
+    itemModel(new AccountedItemModel("annotations list", this)) {
+    this->queryEdit->setPlaceholderText("#tag in:src/dir/** lines:100-900 is:any \"some text\"");
+    this->listView->setModel(this->itemModel);
+    this->listView->setSortingEnabled(true);
+    this->listView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Force readonly
+
+    QVBoxLayout* const layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(this->queryEdit);
+    layout->addWidget(this->planLabel);
+    layout->addWidget(this->listView);
+
+    QObject::connect(this->queryEdit, SIGNAL(returnPressed()), this, SLOT(RunQuery()));
+}
+
+FindingsView::~FindingsView() {
+    this->StopQuery();
+}
+
+void FindingsView::Rerun() {
+    this->RunQuery();
+}
+
+void FindingsView::StopQuery() {
+    if (this->queryThread == nullptr) {
+        return;
+    }
+    // Checked between files, so this doesn't wait long:
+    *this->queryCancelled = true;
+    this->queryThread->wait();
+    delete this->queryThread;
+    this->queryThread = nullptr;
+}
+
+void FindingsView::ResetModel() {
+    this->itemModel->clear();
+    this->itemModel->setHorizontalHeaderLabels({"File", "Line #", "Code", "Annotation", "Relevance"});
+    this->itemModel->UpdateAccounting();
+    this->annotationsFound = 0;
+    this->bookmarksFound = 0;
+}
+
+QString FindingsView::Title() const {
+    switch (this->queryKind) {
+    case AnnotationQuery::Kind::ANNOTATION:
+        return QString::number(this->annotationsFound) + " annotation(s)";
+    case AnnotationQuery::Kind::BOOKMARK:
+        return QString::number(this->bookmarksFound) + " bookmark(s)";
+    default:
+        return QString::number(this->annotationsFound) + " annotation(s) and " + QString::number(this->bookmarksFound) + " bookmark(s)";
+    }
+}
+
+void FindingsView::RunQuery() {
+    WATCHDOG_TRACE_SCOPE("FindingsView::RunQuery");
+    this->StopQuery();
+    this->ResetModel();
+
+    std::shared_ptr<const AnnotationQuery> query;
+    try {
+        query = std::make_shared<const AnnotationQuery>(this->queryEdit->text().toStdString());
+    } catch (const std::invalid_argument& malformed) {
+        this->planLabel->setText(QString::fromStdString(malformed.what()));
+        emit this->TitleChanged("0 finding(s)");
+        return;
+    }
+
+    // Planned against the collections' indexes as they are now, then run against a snapshot of
+    // them taken at the same moment (the project outlives the query thread, which is waited
+    // for, so a plan's full-text search can still be done on it):
+    const Project& project = this->activeProject.get();
+    const std::shared_ptr<const AnnotationQuery::Plan> plan =
+        std::make_shared<const AnnotationQuery::Plan>(query->MakePlan(project.annotations, project.bookmarks));
+    const Project::Snapshot snapshot = project.GetSnapshot();
+    this->planLabel->setText(QString::fromStdString(AnnotationQuery::DescribePlan(*plan)));
+    if (plan->access == AnnotationQuery::Access::TEXT) {
+        this->listView->sortByColumn(4, Qt::DescendingOrder); // Most relevant first.
+    }
+    this->queryKind = query->GetKind();
+    emit this->TitleChanged(this->Title());
+
+    const std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+    this->queryCancelled = cancelled;
+    this->queryThread = QThread::create([this, query, plan, snapshot, cancelled]() {
+        Tracing::SetThreadName("Annotation query");
+        query->Run(*plan, *snapshot.annotations, *snapshot.bookmarks, snapshot.codebasePath,
+            [this, cancelled](std::vector<AnnotationQuery::Finding> findings) {
+                QMetaObject::invokeMethod(this, [this, cancelled, findings = std::move(findings)]() {
+                    if (!*cancelled) {
+                        this->AddFindings(findings);
+                    }
+                }, Qt::QueuedConnection);
+            }, *cancelled);
+    });
+    this->queryThread->start();
+}
+
+void FindingsView::AddFindings(const std::vector<AnnotationQuery::Finding>& findings) {
+    // Sorting as rows arrive would shuffle the list under the user, so it's re-applied once per batch:
+    this->listView->setSortingEnabled(false);
+    int rowIndex = this->itemModel->rowCount();
+    for (const AnnotationQuery::Finding& finding : findings) {
+        QString codeText;
+        TextKernels::AppendUTF8(codeText, finding.code.data(), finding.code.size(), false);
+        this->itemModel->setItem(rowIndex, 0, new QStandardItem(QString::fromStdString(finding.fileRef)));
+        this->itemModel->setItem(rowIndex, 1, new QStandardItem(finding.endLineRef > finding.lineRef ?
+            QString::number(finding.lineRef) + "-" + QString::number(finding.endLineRef) : QString::number(finding.lineRef)));
+        this->itemModel->setItem(rowIndex, 2, new QStandardItem(codeText.simplified()));
+        this->itemModel->setItem(rowIndex, 3, new QStandardItem(finding.isBookmark ? "(bookmark)" : QString::fromStdString(finding.contents)));
+        QStandardItem* const relevanceItem = new QStandardItem();
+        if (finding.score > 0) {
+            relevanceItem->setData(std::round(finding.score * 100) / 100, Qt::DisplayRole); // Numeric, so it sorts as such.
+        }
+        this->itemModel->setItem(rowIndex, 4, relevanceItem);
+        ++(finding.isBookmark ? this->bookmarksFound : this->annotationsFound);
+        ++rowIndex;
+    }
+    this->listView->setSortingEnabled(true);
+    this->itemModel->UpdateAccounting();
+    emit this->TitleChanged(this->Title());
+}
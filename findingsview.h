@@ -0,0 +1,52 @@
+#ifndef FINDINGSVIEW_H
+#define FINDINGSVIEW_H
+#include <QLabel>
+#include <QLineEdit>
+#include <QThread>
+#include <QTreeView>
+#include <QWidget>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "accounteditemmodel.h"
+#include "annotationquery.h"
+#include "project.h"
+
+// The annotation list: a query box over a sortable list of whatever the query finds. Queries
+// are planned here and run on a thread of their own, their findings added to the list a batch
+// at a time as they come in. A new query (or Rerun()) abandons the one before it.
+class FindingsView : public QWidget
+{
+    Q_OBJECT
+public:
+    FindingsView(Project& project, QWidget* const parent = nullptr);
+    ~FindingsView();
+
+    // Runs the current query again, for after the project's changed.
+    void Rerun();
+signals:
+    // The window title to show, updated as findings come in.
+    void TitleChanged(const QString& title);
+private slots:
+    void RunQuery();
+private:
+    std::reference_wrapper<Project> activeProject;
+    QLineEdit* const queryEdit;
+    QLabel* const planLabel;
+    QTreeView* const listView;
+    AccountedItemModel* const itemModel;
+
+    QThread* queryThread = nullptr;
+    std::shared_ptr<std::atomic<bool>> queryCancelled;
+    // What the current query lists, and how many of each it's found so far:
+    AnnotationQuery::Kind queryKind = AnnotationQuery::Kind::ANNOTATION;
+    std::size_t annotationsFound = 0;
+    std::size_t bookmarksFound = 0;
+
+    void StopQuery();
+    void AddFindings(const std::vector<AnnotationQuery::Finding>& findings);
+    void ResetModel();
+    QString Title() const;
+};
+
+#endif // FINDINGSVIEW_H
@@ -0,0 +1,233 @@
+#include "fuzzyfinder.h"
+#include <algorithm>
+#include "parallel.h"
+#include "textkernels.h"
+#include "tracing.h"
+
+namespace {
+    // Paths handed to each worker at a time.
+    const static std::size_t ChunkSize = 16384;
+    // Revisiting the previous matches one by one only beats a fresh pass over everything once
+    // they're down to this fraction of all paths.
+    const static std::size_t NarrowingRatio = 4;
+
+    inline char FoldCase(const char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    inline bool IsWordSeparator(const char c) {
+        return c == '_' || c == '-' || c == '.' || c == ' ';
+    }
+
+    bool RanksBefore(const FuzzyFinder::Match& a, const FuzzyFinder::Match& b) {
+        return a.score != b.score ? a.score > b.score : a.path < b.path;
+    }
+}
+
+FuzzyFinder::FuzzyFinder() : offsets(1, 0), account(MemoryAccounting::CACHES, "file finder") {}
+
+void FuzzyFinder::SetPaths(const std::vector<std::string>& paths) {
+    TRACE_SCOPE("FuzzyFinder::SetPaths");
+    std::size_t totalLength = 0;
+    for (const std::string& path : paths) {
+        totalLength += path.size() + 1;
+    }
+
+    this->paths.clear();
+    this->paths.reserve(totalLength);
+    this->offsets.assign(1, 0);
+    this->offsets.reserve(paths.size() + 1);
+    for (const std::string& path : paths) {
+        this->paths += path;
+        this->paths += '\0';
+        this->offsets.push_back(static_cast<std::uint32_t>(this->paths.size()));
+    }
+    this->foldedPaths.resize(this->paths.size());
+    std::transform(this->paths.cbegin(), this->paths.cend(), this->foldedPaths.begin(), FoldCase);
+
+    this->characterSets.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++) {
+        this->characterSets[i] = FuzzyFinder::CharacterSet(this->foldedPaths.data() + this->offsets[i],
+                                                           this->foldedPaths.data() + this->offsets[i + 1] - 1);
+    }
+
+    this->lastMatchesValid = false;
+    this->lastMatches.clear();
+    this->lastMatches.shrink_to_fit();
+    this->account.Set(this->paths.capacity() + this->foldedPaths.capacity() +
+                      this->offsets.capacity() * sizeof(std::uint32_t) + this->characterSets.capacity() * sizeof(std::uint64_t));
+}
+
+std::size_t FuzzyFinder::PathCount() const {
+    return this->offsets.size() - 1;
+}
+
+std::string FuzzyFinder::Path(const std::uint32_t index) const {
+    return this->paths.substr(this->offsets[index], this->offsets[index + 1] - this->offsets[index] - 1);
+}
+
+std::uint64_t FuzzyFinder::CharacterSet(const char* position, const char* const end) {
+    std::uint64_t characterSet = 0;
+    for (; position < end; ++position) {
+        const unsigned char c = static_cast<unsigned char>(*position);
+        if (c >= 'a' && c <= 'z') {
+            characterSet |= 1ULL << (c - 'a');
+        }
+        else if (c >= '0' && c <= '9') {
+            characterSet |= 1ULL << (26 + c - '0');
+        }
+        else {
+            characterSet |= 1ULL << (36 + c % 28);
+        }
+    }
+    return characterSet;
+}
+
+int FuzzyFinder::Score(const std::uint32_t path, const std::string& foldedQuery, const char* const matchEnd) const {
+    const char* const original = this->paths.data() + this->offsets[path];
+    const char* const folded = this->foldedPaths.data() + this->offsets[path];
+    const std::size_t length = this->offsets[path + 1] - this->offsets[path] - 1;
+    const std::size_t end = static_cast<std::size_t>(matchEnd - folded);
+
+    // The leftmost match can be needlessly spread out ("ab" in "a/x/ab"), walk back from its
+    // end to find the latest start and score the tighter match from there:
+    std::size_t start = end;
+    for (std::size_t position = end, queryIndex = foldedQuery.size(); position-- > 0;) {
+        if (folded[position] == foldedQuery[queryIndex - 1] && --queryIndex == 0) {
+            start = position;
+            break;
+        }
+    }
+
+    std::size_t nameStart = length;
+    while (nameStart > 0 && original[nameStart - 1] != '/') {
+        nameStart--;
+    }
+
+    int score = start >= nameStart ? 24 : 0; // All within the file name.
+    int runLength = 0;
+    std::size_t previous = length;
+    std::size_t queryIndex = 0;
+    for (std::size_t position = start; position < end && queryIndex < foldedQuery.size(); position++) {
+        if (folded[position] != foldedQuery[queryIndex]) {
+            continue;
+        }
+        int characterScore = 16;
+        const char preceding = position == 0 ? '/' : original[position - 1];
+        if (preceding == '/') {
+            characterScore += 10;
+        }
+        else if (IsWordSeparator(preceding) ||
+                 (preceding >= 'a' && preceding <= 'z' && original[position] >= 'A' && original[position] <= 'Z')) {
+            characterScore += 8;
+        }
+        if (previous != length && position == previous + 1) {
+            characterScore += 4 * ++runLength;
+        }
+        else {
+            if (previous != length) {
+                score -= 2 + static_cast<int>(std::min<std::size_t>(position - previous - 1, 12));
+            }
+            runLength = 0;
+        }
+        score += characterScore;
+        previous = position;
+        queryIndex++;
+    }
+    // Shorter paths win ties:
+    return score - static_cast<int>(length / 8);
+}
+
+std::vector<FuzzyFinder::Match> FuzzyFinder::Find(const std::string& query, const std::size_t limit) {
+    TRACE_SCOPE_DETAIL("FuzzyFinder::Find", query);
+    std::string foldedQuery(query.size(), '\0');
+    std::transform(query.cbegin(), query.cend(), foldedQuery.begin(), FoldCase);
+    if (foldedQuery.empty() || limit == 0) {
+        this->lastMatchesValid = false;
+        return {};
+    }
+    const std::uint64_t queryCharacterSet = FuzzyFinder::CharacterSet(foldedQuery.data(), foldedQuery.data() + foldedQuery.size());
+
+    // Anything matching a longer query also matched its prefix:
+    const bool narrowing = this->lastMatchesValid && foldedQuery.compare(0, this->lastQuery.size(), this->lastQuery) == 0 &&
+        this->lastMatches.size() * NarrowingRatio < this->PathCount();
+    const std::size_t candidateCount = narrowing ? this->lastMatches.size() : this->PathCount();
+    const std::size_t chunkCount = (candidateCount + ChunkSize - 1) / ChunkSize;
+
+    struct ChunkResult {
+        std::vector<std::uint32_t> matches;
+        std::vector<Match> best;
+    };
+    std::vector<ChunkResult> chunkResults(chunkCount);
+    Parallel::For(chunkCount, [&](const std::size_t chunk) {
+        ChunkResult& result = chunkResults[chunk];
+        const std::size_t chunkStart = chunk * ChunkSize;
+        const std::size_t chunkEnd = std::min(candidateCount, chunkStart + ChunkSize);
+        result.matches.reserve(chunkEnd - chunkStart);
+        result.best.reserve(limit < chunkEnd - chunkStart ? limit : chunkEnd - chunkStart);
+        const auto addMatch = [&](const std::uint32_t path, const char* const matchEnd) {
+            result.matches.push_back(path);
+            // result.best is kept as a heap of the chunk's best 'limit' so far, worst on top:
+            const Match match = { .path = path, .score = this->Score(path, foldedQuery, matchEnd) };
+            if (result.best.size() < limit) {
+                result.best.push_back(match);
+                std::push_heap(result.best.begin(), result.best.end(), RanksBefore);
+            }
+            else if (RanksBefore(match, result.best.front())) {
+                std::pop_heap(result.best.begin(), result.best.end(), RanksBefore);
+                result.best.back() = match;
+                std::push_heap(result.best.begin(), result.best.end(), RanksBefore);
+            }
+        };
+
+        if (narrowing) {
+            for (std::size_t candidate = chunkStart; candidate < chunkEnd; candidate++) {
+                const std::uint32_t path = this->lastMatches[candidate];
+                if ((this->characterSets[path] & queryCharacterSet) != queryCharacterSet) {
+                    continue;
+                }
+                const char* const matchEnd = TextKernels::MatchSubsequence(
+                    this->foldedPaths.data() + this->offsets[path], this->foldedPaths.data() + this->offsets[path + 1] - 1,
+                    foldedQuery.data(), foldedQuery.size()
+                );
+                if (matchEnd != nullptr) {
+                    addMatch(path, matchEnd);
+                }
+            }
+        }
+        else {
+            // Paths passing the character set check are scanned a run at a time:
+            std::vector<TextKernels::SubsequenceMatch> runMatches;
+            std::size_t runStart = chunkStart;
+            for (std::size_t path = chunkStart; path <= chunkEnd; path++) {
+                if (path < chunkEnd && (this->characterSets[path] & queryCharacterSet) == queryCharacterSet) {
+                    continue;
+                }
+                if (runStart < path) {
+                    TextKernels::MatchSubsequences(this->foldedPaths.data() + this->offsets[runStart],
+                                                   this->foldedPaths.data() + this->offsets[path], '\0',
+                                                   foldedQuery.data(), foldedQuery.size(), runStart, runMatches);
+                }
+                runStart = path + 1;
+            }
+            for (const TextKernels::SubsequenceMatch& runMatch : runMatches) {
+                addMatch(static_cast<std::uint32_t>(runMatch.record), runMatch.end);
+            }
+        }
+    });
+
+    std::vector<std::uint32_t> matches;
+    std::vector<Match> best;
+    for (ChunkResult& result : chunkResults) {
+        matches.insert(matches.end(), result.matches.cbegin(), result.matches.cend());
+        best.insert(best.end(), result.best.cbegin(), result.best.cend());
+    }
+    const std::size_t kept = std::min(limit, best.size());
+    std::partial_sort(best.begin(), best.begin() + kept, best.end(), RanksBefore);
+    best.resize(kept);
+
+    this->lastQuery = foldedQuery;
+    this->lastMatches = std::move(matches);
+    this->lastMatchesValid = true;
+    return best;
+}
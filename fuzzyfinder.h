@@ -0,0 +1,51 @@
+#ifndef FUZZYFINDER_H
+#define FUZZYFINDER_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "memoryaccounting.h"
+
+// Ranks paths against a typed query for the quick-open palette. A path matches if the query's
+// characters appear in it in order (ignoring ASCII case); matches at the start of a path
+// component or word, runs of consecutive characters and matches inside the file name score
+// higher. All paths are matched in one vectorised pass (TextKernels::MatchSubsequences) and
+// scored, split across all cores. A query extending the previous one only revisits the
+// previous query's matches once they've been narrowed down enough for that to be cheaper.
+
+class FuzzyFinder {
+public:
+    struct Match {
+        std::uint32_t path; // Index into the paths given to SetPaths().
+        int score;
+    };
+
+    FuzzyFinder();
+
+    void SetPaths(const std::vector<std::string>& paths);
+    std::size_t PathCount() const;
+    std::string Path(std::uint32_t index) const;
+
+    // The best 'limit' matches for 'query', best first.
+    std::vector<Match> Find(const std::string& query, std::size_t limit);
+private:
+    // All paths back to back, each followed by a '\0' (as given, and ASCII lower-cased for
+    // matching), path i starts at offsets[i].
+    std::string paths;
+    std::string foldedPaths;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint64_t> characterSets; // Per path, see CharacterSet().
+
+    std::string lastQuery; // Folded.
+    std::vector<std::uint32_t> lastMatches; // Every path that matched lastQuery, ascending.
+    bool lastMatchesValid = false;
+
+    MemoryAccounting::Account account;
+
+    // A bit per letter/digit (others share the remaining bits), a path can only match a
+    // query whose set is a subset of its own. Used to skip revisited paths without a scan.
+    static std::uint64_t CharacterSet(const char* begin, const char* end);
+    // 'matchEnd' is where MatchSubsequence() found the query to end in the folded path.
+    int Score(std::uint32_t path, const std::string& foldedQuery, const char* matchEnd) const;
+};
+
+#endif // FUZZYFINDER_H
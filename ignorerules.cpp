@@ -0,0 +1,195 @@
+#include "ignorerules.h"
+#include <fstream>
+
+namespace {
+    // Matches a [...] class at 'pattern' (just after the '['), advancing 'pattern' past the ']'.
+    bool MatchClass(const char*& pattern, const char character) {
+        const bool negated = *pattern == '!' || *pattern == '^';
+        if (negated) {
+            pattern++;
+        }
+        bool matched = false;
+        bool first = true;
+        for (; *pattern != '\0' && (first || *pattern != ']'); pattern++, first = false) {
+            if (pattern[1] == '-' && pattern[2] != ']' && pattern[2] != '\0') {
+                matched |= pattern[0] <= character && character <= pattern[2];
+                pattern += 2;
+            }
+            else {
+                matched |= *pattern == character;
+            }
+        }
+        if (*pattern == ']') {
+            pattern++;
+        }
+        return matched != negated;
+    }
+
+    bool GlobMatch(const char* pattern, const char* path) {
+        for (;;) {
+            switch (*pattern) {
+                case '\0':
+                    return *path == '\0';
+                case '*': {
+                    if (pattern[1] == '*') {
+                        // '**/' matches zero or more whole directories, any other '**' matches anything:
+                        if (pattern[2] == '/') {
+                            for (const char* rest = path;; rest++) {
+                                if ((rest == path || rest[-1] == '/') && GlobMatch(pattern + 3, rest)) {
+                                    return true;
+                                }
+                                if (*rest == '\0') {
+                                    return false;
+                                }
+                            }
+                        }
+                        for (const char* rest = path;; rest++) {
+                            if (GlobMatch(pattern + 2, rest)) {
+                                return true;
+                            }
+                            if (*rest == '\0') {
+                                return false;
+                            }
+                        }
+                    }
+                    for (const char* rest = path;; rest++) {
+                        if (GlobMatch(pattern + 1, rest)) {
+                            return true;
+                        }
+                        if (*rest == '\0' || *rest == '/') {
+                            return false;
+                        }
+                    }
+                }
+                case '?':
+                    if (*path == '\0' || *path == '/') {
+                        return false;
+                    }
+                    break;
+                case '[':
+                    if (*path == '\0' || *path == '/' || !MatchClass(++pattern, *path)) {
+                        return false;
+                    }
+                    path++;
+                    continue;
+                case '\\':
+                    if (pattern[1] != '\0') {
+                        pattern++;
+                    }
+                    [[fallthrough]];
+                default:
+                    if (*pattern != *path) {
+                        return false;
+                    }
+                    break;
+            }
+            pattern++;
+            path++;
+        }
+    }
+}
+
+std::vector<IgnoreRules::Rule> IgnoreRules::ParseRules(const std::vector<std::string>& lines) {
+    std::vector<Rule> rules;
+    for (std::string line : lines) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        // Trailing spaces are dropped unless escaped:
+        while (!line.empty() && line.back() == ' ' && (line.size() < 2 || line[line.size() - 2] != '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Rule rule {
+            .pattern = line,
+            .negated = false,
+            .directoryOnly = false,
+            .anchored = false
+        };
+        if (rule.pattern[0] == '!') {
+            rule.negated = true;
+            rule.pattern.erase(0, 1);
+        }
+        else if (rule.pattern[0] == '\\' && rule.pattern.size() > 1 && (rule.pattern[1] == '!' || rule.pattern[1] == '#')) {
+            rule.pattern.erase(0, 1);
+        }
+        if (!rule.pattern.empty() && rule.pattern.back() == '/') {
+            rule.directoryOnly = true;
+            rule.pattern.pop_back();
+        }
+        rule.anchored = rule.pattern.find('/') != std::string::npos;
+        if (!rule.pattern.empty() && rule.pattern[0] == '/') {
+            rule.pattern.erase(0, 1);
+        }
+        if (!rule.pattern.empty()) {
+            rules.push_back(std::move(rule));
+        }
+    }
+    return rules;
+}
+
+void IgnoreRules::AddPatterns(const std::string& directory, const std::vector<std::string>& lines) {
+    std::vector<Rule> parsedRules = IgnoreRules::ParseRules(lines);
+    if (parsedRules.empty()) {
+        return;
+    }
+    std::vector<Rule>& rules = this->directoryRules[directory];
+    rules.insert(rules.end(), std::make_move_iterator(parsedRules.begin()), std::make_move_iterator(parsedRules.end()));
+}
+
+void IgnoreRules::AddExcludePatterns(const std::vector<std::string>& lines) {
+    std::vector<Rule> parsedRules = IgnoreRules::ParseRules(lines);
+    this->excludeRules.insert(this->excludeRules.end(),
+        std::make_move_iterator(parsedRules.begin()), std::make_move_iterator(parsedRules.end()));
+}
+
+void IgnoreRules::LoadGitignore(const std::string& codebasePath, const std::string& directory) {
+    std::ifstream gitignoreFile(codebasePath + (directory.empty() ? "" : directory + "/") + ".gitignore");
+    if (!gitignoreFile) {
+        return;
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(gitignoreFile, line);) {
+        lines.push_back(std::move(line));
+    }
+    this->AddPatterns(directory, lines);
+}
+
+void IgnoreRules::ApplyRules(const std::vector<Rule>& rules, const std::string& relativePath,
+                             const std::string& name, const bool isDirectory, bool& ignored) {
+    for (auto rule = rules.crbegin(); rule != rules.crend(); rule++) {
+        if (rule->directoryOnly && !isDirectory) {
+            continue;
+        }
+        if (GlobMatch(rule->pattern.c_str(), rule->anchored ? relativePath.c_str() : name.c_str())) {
+            ignored = !rule->negated;
+            return;
+        }
+    }
+}
+
+bool IgnoreRules::IsIgnored(const std::string& path, const bool isDirectory) const {
+    const std::size_t nameStart = path.rfind('/') == std::string::npos ? 0 : path.rfind('/') + 1;
+    const std::string name = path.substr(nameStart);
+
+    // Walk from the root down to the path's own directory so that deeper rules win:
+    bool ignored = false;
+    std::size_t directoryEnd = 0;
+    for (;;) {
+        const std::string directory = directoryEnd == 0 ? "" : path.substr(0, directoryEnd);
+        const auto rules = this->directoryRules.find(directory);
+        if (rules != this->directoryRules.cend()) {
+            IgnoreRules::ApplyRules(rules->second, path.substr(directoryEnd == 0 ? 0 : directoryEnd + 1), name, isDirectory, ignored);
+        }
+        const std::size_t nextSlash = path.find('/', directoryEnd == 0 ? 0 : directoryEnd + 1);
+        if (nextSlash == std::string::npos) {
+            break;
+        }
+        directoryEnd = nextSlash;
+    }
+    IgnoreRules::ApplyRules(this->excludeRules, path, name, isDirectory, ignored);
+    return ignored;
+}
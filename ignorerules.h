@@ -0,0 +1,41 @@
+#ifndef IGNORERULES_H
+#define IGNORERULES_H
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Decides which paths (relative to the codebase) are hidden from navigation, following
+// .gitignore semantics: each directory's rules apply beneath it with deeper directories and
+// later lines taking precedence, '!' re-includes, a trailing '/' only matches directories and
+// a pattern containing a '/' is anchored to its directory ('*', '?', '[...]' and '**' globs).
+// Exclude patterns (same syntax, anchored at the root) override everything else.
+
+class IgnoreRules {
+public:
+    // 'directory' is relative to the codebase ("" for the root), as are all paths below.
+    void AddPatterns(const std::string& directory, const std::vector<std::string>& lines);
+    void AddExcludePatterns(const std::vector<std::string>& lines);
+    // Reads 'directory'/.gitignore if there is one.
+    void LoadGitignore(const std::string& codebasePath, const std::string& directory);
+
+    // Ancestors of 'path' are assumed to have been checked already (an ignored directory's
+    // contents are never looked at).
+    bool IsIgnored(const std::string& path, bool isDirectory) const;
+private:
+    struct Rule {
+        std::string pattern;
+        bool negated;
+        bool directoryOnly;
+        bool anchored; // Matched against the whole path below the directory, not just the name.
+    };
+
+    std::unordered_map<std::string /* Directory */, std::vector<Rule>> directoryRules;
+    std::vector<Rule> excludeRules;
+
+    static std::vector<Rule> ParseRules(const std::vector<std::string>& lines);
+    // Whether the last matching rule (if any) ignores 'relativePath', leaves 'ignored' alone otherwise.
+    static void ApplyRules(const std::vector<Rule>& rules, const std::string& relativePath,
+                           const std::string& name, bool isDirectory, bool& ignored);
+};
+
+#endif // IGNORERULES_H
@@ -0,0 +1,86 @@
+#include "intervalset.h"
+#include <algorithm>
+
+std::size_t IntervalSet::Insert(const std::size_t begin, const std::size_t end) {
+    if (begin >= end) {
+        return 0;
+    }
+    // Every run touching [begin, end) (adjacent ones included) is folded into one:
+    const std::vector<Run>::iterator first = std::lower_bound(this->runs.begin(), this->runs.end(), begin,
+        [](const Run& run, const std::size_t line) { return run.end < line; });
+    const std::vector<Run>::iterator last = std::upper_bound(first, this->runs.end(), end,
+        [](const std::size_t line, const Run& run) { return line < run.begin; });
+    if (first == last) {
+        this->runs.insert(first, Run { .begin = begin, .end = end });
+        this->count += end - begin;
+        return end - begin;
+    }
+
+    std::size_t alreadyPresent = 0;
+    for (std::vector<Run>::const_iterator run = first; run != last; ++run) {
+        alreadyPresent += run->end - run->begin;
+    }
+    const Run merged = { .begin = std::min(begin, first->begin), .end = std::max(end, (last - 1)->end) };
+    *first = merged;
+    this->runs.erase(first + 1, last);
+
+    const std::size_t added = (merged.end - merged.begin) - alreadyPresent;
+    this->count += added;
+    return added;
+}
+
+std::size_t IntervalSet::Erase(const std::size_t begin, const std::size_t end) {
+    if (begin >= end) {
+        return 0;
+    }
+    // Runs overlapping [begin, end):
+    const std::vector<Run>::iterator first = std::upper_bound(this->runs.begin(), this->runs.end(), begin,
+        [](const std::size_t line, const Run& run) { return line < run.end; });
+    const std::vector<Run>::iterator last = std::lower_bound(first, this->runs.end(), end,
+        [](const Run& run, const std::size_t line) { return run.begin < line; });
+    if (first == last) {
+        return 0;
+    }
+
+    std::size_t removed = 0;
+    for (std::vector<Run>::const_iterator run = first; run != last; ++run) {
+        removed += std::min(end, run->end) - std::max(begin, run->begin);
+    }
+    // Whatever's left either side of the erased range survives:
+    const Run before = { .begin = first->begin, .end = begin };
+    const Run after = { .begin = end, .end = (last - 1)->end };
+    const std::vector<Run>::iterator position = this->runs.erase(first, last);
+    std::vector<Run> remnants;
+    if (before.begin < before.end) {
+        remnants.push_back(before);
+    }
+    if (after.begin < after.end) {
+        remnants.push_back(after);
+    }
+    this->runs.insert(position, remnants.cbegin(), remnants.cend());
+
+    this->count -= removed;
+    return removed;
+}
+
+bool IntervalSet::Contains(const std::size_t line) const {
+    const std::vector<Run>::const_iterator run = std::upper_bound(this->runs.cbegin(), this->runs.cend(), line,
+        [](const std::size_t sample, const Run& run) { return sample < run.end; });
+    return run != this->runs.cend() && run->begin <= line;
+}
+
+std::size_t IntervalSet::Count() const {
+    return this->count;
+}
+
+bool IntervalSet::Empty() const {
+    return this->runs.empty();
+}
+
+const std::vector<IntervalSet::Run>& IntervalSet::Runs() const {
+    return this->runs;
+}
+
+std::size_t IntervalSet::HeapBytes() const {
+    return this->runs.capacity() * sizeof(Run);
+}
@@ -0,0 +1,33 @@
+#ifndef INTERVALSET_H
+#define INTERVALSET_H
+#include <cstddef>
+#include <vector>
+
+// A set of line numbers stored as runs: sorted, disjoint and non-adjacent [begin, end) ranges.
+// Reviewed code tends to come in long stretches so a file's worth is usually a handful of runs
+// however long the file, and inserting/erasing a range reports how many lines it actually
+// changed so that running totals can be kept without recounting.
+
+class IntervalSet {
+public:
+    struct Run {
+        std::size_t begin;
+        std::size_t end; // Exclusive.
+    };
+
+    // Adds [begin, end), returns the number of lines that weren't already in the set.
+    std::size_t Insert(std::size_t begin, std::size_t end);
+    // Removes [begin, end), returns the number of lines that were in the set.
+    std::size_t Erase(std::size_t begin, std::size_t end);
+
+    bool Contains(std::size_t line) const;
+    std::size_t Count() const;
+    bool Empty() const;
+    const std::vector<Run>& Runs() const;
+    std::size_t HeapBytes() const;
+private:
+    std::vector<Run> runs;
+    std::size_t count = 0;
+};
+
+#endif // INTERVALSET_H
@@ -0,0 +1,95 @@
+#include "intervaltree.h"
+#include <algorithm>
+
+IntervalTree::IntervalTree(std::vector<Interval> intervals) {
+    std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) {
+        return a.begin < b.begin;
+    });
+    this->nodes.reserve(intervals.size());
+    for (const Interval& interval : intervals) {
+        this->nodes.push_back(Node { .interval = interval, .maxEnd = interval.end });
+    }
+    const std::size_t count = this->nodes.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Leaves (even indexes) are their own subtrees. Working up a level at a time, each node's
+    // children are 'half' either side of it; a right child past the end of the array stands for
+    // the rightmost real subtree at that level (tracked in lastNode/lastMaxEnd):
+    std::size_t lastNode = 0;
+    std::size_t lastMaxEnd = 0;
+    for (std::size_t i = 0; i < count; i += 2) {
+        lastNode = i;
+        lastMaxEnd = this->nodes[i].maxEnd;
+    }
+    int level = 1;
+    for (; (static_cast<std::size_t>(1) << level) <= count; level++) {
+        const std::size_t half = static_cast<std::size_t>(1) << (level - 1);
+        for (std::size_t i = (half << 1) - 1; i < count; i += half << 2) {
+            const std::size_t leftMaxEnd = this->nodes[i - half].maxEnd;
+            const std::size_t rightMaxEnd = i + half < count ? this->nodes[i + half].maxEnd : lastMaxEnd;
+            this->nodes[i].maxEnd = std::max({ this->nodes[i].interval.end, leftMaxEnd, rightMaxEnd });
+        }
+        lastNode = (lastNode >> level & 1) ? lastNode - half : lastNode + half;
+        if (lastNode < count) {
+            lastMaxEnd = std::max(lastMaxEnd, this->nodes[lastNode].maxEnd);
+        }
+    }
+    this->rootLevel = level - 1;
+}
+
+std::vector<std::size_t> IntervalTree::Overlapping(const std::size_t begin, const std::size_t end) const {
+    std::vector<std::size_t> overlapping;
+    if (this->nodes.empty() || begin >= end) {
+        return overlapping;
+    }
+    const std::size_t count = this->nodes.size();
+    // Small subtrees are cheaper to scan than to descend:
+    const static int scanLevel = 3;
+
+    struct Visit {
+        int level;
+        std::size_t node;
+        bool leftDone;
+    };
+    std::vector<Visit> stack;
+    stack.push_back(Visit { .level = this->rootLevel, .node = (static_cast<std::size_t>(1) << this->rootLevel) - 1, .leftDone = false });
+    while (!stack.empty()) {
+        const Visit visit = stack.back();
+        stack.pop_back();
+        if (visit.level <= scanLevel) {
+            const std::size_t first = visit.node >> visit.level << visit.level;
+            const std::size_t last = std::min(count, first + (static_cast<std::size_t>(1) << (visit.level + 1)) - 1);
+            for (std::size_t i = first; i < last && this->nodes[i].interval.begin < end; i++) {
+                if (begin < this->nodes[i].interval.end) {
+                    overlapping.push_back(this->nodes[i].interval.value);
+                }
+            }
+        }
+        else if (!visit.leftDone) {
+            // Come back for this node and its right subtree once the left subtree's been visited:
+            const std::size_t left = visit.node - (static_cast<std::size_t>(1) << (visit.level - 1));
+            stack.push_back(Visit { .level = visit.level, .node = visit.node, .leftDone = true });
+            if (left >= count || this->nodes[left].maxEnd > begin) {
+                stack.push_back(Visit { .level = visit.level - 1, .node = left, .leftDone = false });
+            }
+        }
+        else if (visit.node < count && this->nodes[visit.node].interval.begin < end) {
+            if (begin < this->nodes[visit.node].interval.end) {
+                overlapping.push_back(this->nodes[visit.node].interval.value);
+            }
+            stack.push_back(Visit { .level = visit.level - 1,
+                                    .node = visit.node + (static_cast<std::size_t>(1) << (visit.level - 1)), .leftDone = false });
+        }
+    }
+    return overlapping;
+}
+
+std::size_t IntervalTree::Size() const {
+    return this->nodes.size();
+}
+
+std::size_t IntervalTree::HeapBytes() const {
+    return this->nodes.capacity() * sizeof(Node);
+}
@@ -0,0 +1,37 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+#include <cstddef>
+#include <vector>
+
+// A static set of possibly overlapping/nested [begin, end) intervals answering "which of them
+// overlap [begin, end)" in O(log n + matches). The intervals are kept in a sorted array that
+// doubles as an implicit balanced binary tree (the element at index i is a node at the level of
+// its lowest unset bit), each node also recording the furthest end within its subtree so that
+// whole subtrees ending before the query can be skipped. Rebuilt whole whenever its intervals
+// change, which is cheap next to the per-frame queries it serves.
+
+class IntervalTree {
+public:
+    struct Interval {
+        std::size_t begin;
+        std::size_t end; // Exclusive.
+        std::size_t value; // Whatever the caller uses to identify the interval.
+    };
+
+    IntervalTree() = default;
+    explicit IntervalTree(std::vector<Interval> intervals);
+
+    // The values of every interval overlapping [begin, end), ordered by the intervals' begin.
+    std::vector<std::size_t> Overlapping(std::size_t begin, std::size_t end) const;
+    std::size_t Size() const;
+    std::size_t HeapBytes() const;
+private:
+    struct Node {
+        Interval interval;
+        std::size_t maxEnd; // Over this node's subtree.
+    };
+    std::vector<Node> nodes; // Sorted by begin.
+    int rootLevel = -1;
+};
+
+#endif // INTERVALTREE_H
@@ -0,0 +1,378 @@
+#include "jsonreader.h"
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    bool IsWhitespace(const char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    int HexValue(const char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    int Base64Value(const char c) {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+' || c == '-') {
+            return 62;
+        }
+        if (c == '/' || c == '_') {
+            return 63;
+        }
+        return -1;
+    }
+
+    void AppendUTF8(std::string& output, const std::uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            output += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800) {
+            output += static_cast<char>(0xC0 | (codePoint >> 6));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000) {
+            output += static_cast<char>(0xE0 | (codePoint >> 12));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else {
+            output += static_cast<char>(0xF0 | (codePoint >> 18));
+            output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+}
+
+JSONReader::JSONReader(const char* const data, const std::size_t length) : data(data), length(length) {}
+
+void JSONReader::Fail(const char* const problem) const {
+    throw std::runtime_error(std::string("Invalid JSON (") + problem + ") at byte " + std::to_string(this->position));
+}
+
+char JSONReader::Peek() {
+    while (this->position < this->length && IsWhitespace(this->data[this->position])) {
+        this->position++;
+    }
+    if (this->position == this->length) {
+        this->Fail("unexpected end");
+    }
+    return this->data[this->position];
+}
+
+void JSONReader::Expect(const char c) {
+    if (this->Peek() != c) {
+        this->Fail("unexpected character");
+    }
+    this->position++;
+}
+
+void JSONReader::BeginObject() {
+    this->Expect('{');
+    this->firstMember = true;
+}
+
+bool JSONReader::NextKey(std::string_view& key) {
+    if (this->Peek() == '}') {
+        this->position++;
+        this->firstMember = false;
+        return false;
+    }
+    if (!this->firstMember) {
+        this->Expect(',');
+    }
+    this->firstMember = false;
+    if (this->Peek() != '"') {
+        this->Fail("expected a key");
+    }
+
+    // Keys are almost never escaped, so they're used in place when they aren't:
+    const std::size_t start = this->position + 1;
+    std::size_t end = start;
+    while (end < this->length && this->data[end] != '"' && this->data[end] != '\\') {
+        end++;
+    }
+    if (end < this->length && this->data[end] == '"') {
+        key = std::string_view(this->data + start, end - start);
+        this->position = end + 1;
+    }
+    else {
+        this->unescaped.clear();
+        this->ReadStringBody(this->unescaped);
+        key = this->unescaped;
+    }
+    this->Expect(':');
+    return true;
+}
+
+void JSONReader::BeginArray() {
+    this->Expect('[');
+    this->firstMember = true;
+}
+
+bool JSONReader::NextElement() {
+    if (this->Peek() == ']') {
+        this->position++;
+        this->firstMember = false;
+        return false;
+    }
+    if (!this->firstMember) {
+        this->Expect(',');
+    }
+    this->firstMember = false;
+    return true;
+}
+
+bool JSONReader::TryBeginObject() {
+    if (this->Peek() != '{') {
+        this->Skip();
+        return false;
+    }
+    this->BeginObject();
+    return true;
+}
+
+bool JSONReader::TryBeginArray() {
+    if (this->Peek() != '[') {
+        this->Skip();
+        return false;
+    }
+    this->BeginArray();
+    return true;
+}
+
+void JSONReader::ReadStringBody(std::string& value) {
+    this->position++; // Opening quote.
+    for (;;) {
+        // Copy up to the next quote or escape in one go:
+        const std::size_t runStart = this->position;
+        while (this->position < this->length && this->data[this->position] != '"' && this->data[this->position] != '\\') {
+            this->position++;
+        }
+        value.append(this->data + runStart, this->position - runStart);
+        if (this->position == this->length) {
+            this->Fail("unterminated string");
+        }
+        if (this->data[this->position++] == '"') {
+            return;
+        }
+
+        if (this->position == this->length) {
+            this->Fail("unterminated string");
+        }
+        const char escaped = this->data[this->position++];
+        switch (escaped) {
+            case '"': value += '"'; break;
+            case '\\': value += '\\'; break;
+            case '/': value += '/'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u': {
+                const auto readUnit = [this]() {
+                    if (this->length - this->position < 4) {
+                        this->Fail("truncated escape");
+                    }
+                    std::uint32_t unit = 0;
+                    for (int i = 0; i < 4; i++) {
+                        const int digit = HexValue(this->data[this->position++]);
+                        if (digit < 0) {
+                            this->Fail("invalid escape");
+                        }
+                        unit = unit << 4 | static_cast<std::uint32_t>(digit);
+                    }
+                    return unit;
+                };
+                std::uint32_t codePoint = readUnit();
+                // Characters outside of the BMP come as surrogate pairs:
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && this->length - this->position >= 6 &&
+                    this->data[this->position] == '\\' && this->data[this->position + 1] == 'u') {
+                    this->position += 2;
+                    const std::uint32_t low = readUnit();
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    else {
+                        AppendUTF8(value, 0xFFFD);
+                        codePoint = low;
+                    }
+                }
+                else if (codePoint >= 0xD800 && codePoint < 0xE000) {
+                    codePoint = 0xFFFD; // Unpaired.
+                }
+                AppendUTF8(value, codePoint);
+                break;
+            }
+            default:
+                this->Fail("invalid escape");
+        }
+    }
+}
+
+std::string_view JSONReader::NumberText() {
+    const std::size_t start = this->position;
+    while (this->position < this->length) {
+        const char c = this->data[this->position];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+            break;
+        }
+        this->position++;
+    }
+    if (this->position == start) {
+        this->Fail("invalid number");
+    }
+    return std::string_view(this->data + start, this->position - start);
+}
+
+bool JSONReader::SkipLiteral() {
+    for (const std::string_view literal : { std::string_view("true"), std::string_view("false"), std::string_view("null") }) {
+        if (std::string_view(this->data + this->position, this->length - this->position).substr(0, literal.size()) == literal) {
+            this->position += literal.size();
+            return true;
+        }
+    }
+    return false;
+}
+
+void JSONReader::ReadString(std::string& value) {
+    value.clear();
+    const char next = this->Peek();
+    if (next == '"') {
+        this->ReadStringBody(value);
+    }
+    else if (next == '-' || (next >= '0' && next <= '9')) {
+        value = this->NumberText();
+    }
+    else {
+        this->Skip();
+    }
+}
+
+std::int64_t JSONReader::ReadInteger() {
+    const char next = this->Peek();
+    if (next != '-' && (next < '0' || next > '9')) {
+        this->Skip();
+        return 0;
+    }
+    const std::string_view text = this->NumberText();
+    const std::string number(text);
+    // Whole numbers (the usual case) exactly, anything else through a double like QJsonValue:
+    if (text.find_first_of(".eE") == std::string_view::npos) {
+        return std::strtoll(number.c_str(), nullptr, 10);
+    }
+    // Clamped first, converting a double outside of the int64 range (e.g. 1e30) is undefined:
+    const double value = std::strtod(number.c_str(), nullptr);
+    if (std::isnan(value)) {
+        return 0;
+    }
+    if (value >= 9223372036854775807.0) {
+        return std::numeric_limits<std::int64_t>::max();
+    }
+    if (value <= -9223372036854775808.0) {
+        return std::numeric_limits<std::int64_t>::min();
+    }
+    return static_cast<std::int64_t>(value);
+}
+
+void JSONReader::ReadBase64(std::string& value) {
+    std::string encoded;
+    this->ReadString(encoded);
+    value.clear();
+    value.reserve(encoded.size() / 4 * 3);
+    std::uint32_t accumulated = 0;
+    int bits = 0;
+    for (const char c : encoded) {
+        const int digit = Base64Value(c);
+        if (digit < 0) {
+            continue; // Padding (or anything else that isn't a digit).
+        }
+        accumulated = accumulated << 6 | static_cast<std::uint32_t>(digit);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            value += static_cast<char>((accumulated >> bits) & 0xFF);
+        }
+    }
+}
+
+void JSONReader::Skip() {
+    // Containers are skipped by depth alone, only strings need looking into (for brackets/quotes):
+    std::size_t depth = 0;
+    do {
+        const char next = this->Peek();
+        switch (next) {
+            case '{':
+            case '[':
+                depth++;
+                this->position++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    this->Fail("unexpected character");
+                }
+                depth--;
+                this->position++;
+                break;
+            case ',':
+            case ':':
+                if (depth == 0) {
+                    this->Fail("unexpected character");
+                }
+                this->position++;
+                break;
+            case '"': {
+                this->position++;
+                while (this->position < this->length && this->data[this->position] != '"') {
+                    this->position += this->data[this->position] == '\\' ? 2 : 1;
+                }
+                if (this->position >= this->length) {
+                    this->Fail("unterminated string");
+                }
+                this->position++;
+                break;
+            }
+            default:
+                if (next == '-' || (next >= '0' && next <= '9')) {
+                    this->NumberText();
+                }
+                else if (!this->SkipLiteral()) {
+                    this->Fail("unexpected character");
+                }
+                break;
+        }
+    } while (depth > 0);
+    this->firstMember = false;
+}
+
+bool JSONReader::AtEnd() {
+    while (this->position < this->length && IsWhitespace(this->data[this->position])) {
+        this->position++;
+    }
+    return this->position == this->length;
+}
+
+std::size_t JSONReader::Position() const {
+    return this->position;
+}
@@ -0,0 +1,57 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The reading counterpart of JSONWriter: a pull parser walking a JSON document in place, so
+// records can be read straight into their structs without building a QJsonDocument (and a
+// QJsonObject per record) first. Values of the wrong type read the way QJsonValue's
+// conversions would (e.g. a string where a number was expected reads as 0). Malformed input
+// throws std::runtime_error.
+
+class JSONReader {
+public:
+    JSONReader(const char* data, std::size_t length);
+
+    void BeginObject();
+    // Reads the next member's key (valid until the next call), false once the object has ended.
+    bool NextKey(std::string_view& key);
+    void BeginArray();
+    // Moves on to the next element, false once the array has ended.
+    bool NextElement();
+    // Begins the object/array next if that's what it is, otherwise skips the value and returns false.
+    bool TryBeginObject();
+    bool TryBeginArray();
+
+    // Numbers are read as their text, anything else but a string as "".
+    void ReadString(std::string& value);
+    // Fractions are truncated, anything else but a number reads as 0.
+    std::int64_t ReadInteger();
+    // Base64 (as written by JSONWriter::AppendBase64), anything else but a string as "".
+    void ReadBase64(std::string& value);
+    // Skips over the next value, whatever it is.
+    void Skip();
+
+    // False if there's anything but whitespace after the document.
+    bool AtEnd();
+    // Bytes read so far (for progress).
+    std::size_t Position() const;
+private:
+    const char* const data;
+    const std::size_t length;
+    std::size_t position = 0;
+    bool firstMember = false; // Of the innermost object/array begun, before its first key/element.
+    std::string unescaped; // Keys that needed unescaping.
+
+    char Peek();
+    void Expect(char c);
+    bool SkipLiteral();
+    // Reads a string (the opening quote being next) into 'value'.
+    void ReadStringBody(std::string& value);
+    // The extent of the number next.
+    std::string_view NumberText();
+    [[noreturn]] void Fail(const char* problem) const;
+};
+
+#endif // JSONREADER_H
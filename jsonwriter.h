@@ -0,0 +1,68 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+#include <charconv>
+#include <cstdint>
+#include <string>
+
+// Helpers for writing JSON straight into a byte buffer, used where building a QJsonDocument
+// first would mean holding a second (much larger) copy of the data.
+
+namespace JSONWriter {
+    // Appends 'value' (UTF-8) as a quoted and escaped JSON string.
+    inline void AppendString(std::string& output, const std::string& value) {
+        const static char hexDigits[] = "0123456789abcdef";
+        output += '"';
+        for (const char c : value) {
+            switch (c) {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        output += "\\u00";
+                        output += hexDigits[(c >> 4) & 0xF];
+                        output += hexDigits[c & 0xF];
+                    }
+                    else {
+                        output += c;
+                    }
+                    break;
+            }
+        }
+        output += '"';
+    }
+
+    inline void AppendUnsigned(std::string& output, const std::uint64_t value) {
+        char digits[20];
+        output.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+    }
+
+    // Appends binary 'value' as a quoted base64 string.
+    inline void AppendBase64(std::string& output, const std::string& value) {
+        const static char base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        output += '"';
+        std::size_t i = 0;
+        for (; i + 2 < value.size(); i += 3) {
+            const std::uint32_t group = static_cast<unsigned char>(value[i]) << 16 |
+                                        static_cast<unsigned char>(value[i + 1]) << 8 | static_cast<unsigned char>(value[i + 2]);
+            output += base64Digits[group >> 18];
+            output += base64Digits[(group >> 12) & 0x3F];
+            output += base64Digits[(group >> 6) & 0x3F];
+            output += base64Digits[group & 0x3F];
+        }
+        if (i < value.size()) {
+            const bool pair = i + 1 < value.size();
+            const std::uint32_t group = static_cast<unsigned char>(value[i]) << 16 |
+                                        (pair ? static_cast<unsigned char>(value[i + 1]) << 8 : 0);
+            output += base64Digits[group >> 18];
+            output += base64Digits[(group >> 12) & 0x3F];
+            output += pair ? base64Digits[(group >> 6) & 0x3F] : '=';
+            output += '=';
+        }
+        output += '"';
+    }
+};
+
+#endif // JSONWRITER_H
@@ -1,10 +1,12 @@
 #include "mainwindow.h"
+#include "tracing.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Tracing::SetThreadName("GUI");
     MainWindow w;
     w.show();
     return a.exec();
@@ -2,23 +2,45 @@
 #include "ui_mainwindow.h"
 #include "codeeditor.h"
 #include "utils.h"
+#include "tracing.h"
+#include "stallwatchdog.h"
+#include "memoryaccounting.h"
+#include "accounteditemmodel.h"
+#include "projectmerge.h"
+#include "projectio.h"
+#include "symbolindex.h"
+#include "directoryscanner.h"
+#include "findingsview.h"
+#include "quickopendialog.h"
+#include "textkernels.h"
 #include <functional>
+#include <unordered_set>
 #include <stdio.h>
 #include <QFile>
 #include <QListView>
+#include <QTreeView>
 #include <QHeaderView>
 #include <QTextEdit>
 #include <QMdiSubWindow>
 #include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QLocale>
+#include <QProgressDialog>
+#include <QThread>
 #include <QStandardItemModel>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QString>
 #include <QMdiArea>
+#include <QEvent>
+#include <QRegion>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow),
-    MDIArea(new QMdiArea(this)), currentCodebase("/Users/forseti/Desktop/GitHub/"),
-    codebaseModel(std::make_unique<QFileSystemModel>(this)),
+    MDIArea(new QMdiArea(this)), shortcuts(this),
     codebaseBrowseTree(new FileNavigationTree(this)) {
 
     this->MDIArea->setAttribute(Qt::WA_DeleteOnClose, true);
@@ -28,58 +50,190 @@ MainWindow::MainWindow(QWidget *parent)
     this->setCentralWidget(this->MDIArea);
     this->MDIArea->show();
 
-    // Setup the file browser:
-    QFileSystemModel* const codeModel = this->codebaseModel.get();
-    const QModelIndex rootIndex = codeModel->setRootPath(
-        QString::fromStdString(this->currentCodebase.GetCodebasePath())
-    );
-    codeModel->setResolveSymlinks(false);
-    this->codebaseBrowseTree->setModel(codeModel);
-    this->codebaseBrowseTree->setRootIndex(rootIndex);
+    // One set of shortcuts for the whole window, the editor's going to whichever editor is active:
+    this->AddBindings();
+    CodeEditor::AddBindings(this->shortcuts);
+    QObject::connect(this->MDIArea, SIGNAL(subWindowActivated(QMdiSubWindow*)), this, SLOT(SubWindowActivated(QMdiSubWindow*)));
+    this->editorSuspensionCheck.setSingleShot(true);
+    QObject::connect(&this->editorSuspensionCheck, SIGNAL(timeout()), this, SLOT(UpdateEditorSuspension()));
+
+    // Setup the file browser (its model is the current codebase's):
     QObject::connect(this->codebaseBrowseTree.get(), SIGNAL(OpenSelectedFile()), this, SLOT(OpenSelectedFile()));
-    QMdiSubWindow* const navSubWindow = this->AddSubWindow(this->codebaseBrowseTree.get());
-    navSubWindow->setWindowTitle("Project Navigation");
-    navSubWindow->resize(600, 400);
+    this->codebaseBrowseWindow = this->AddSubWindow(this->codebaseBrowseTree.get());
+    this->codebaseBrowseWindow->resize(600, 400);
+
+    // Beat from the event loop so that the watchdog thread can tell when it stops turning over:
+    Watchdog::Start(Config::Responsiveness::StallThreshold);
+    QObject::connect(&this->watchdogHeartbeat, &QTimer::timeout, &Watchdog::Heartbeat);
+    this->watchdogHeartbeat.start(Config::Responsiveness::StallThreshold / 4);
+
+    this->SetCurrentCodebase(this->workspace.Open("/Users/forseti/Desktop/GitHub/"));
+}
+
+void MainWindow::SetCurrentCodebase(Project& project) {
+    WATCHDOG_TRACE_SCOPE_DETAIL("MainWindow::SetCurrentCodebase", project.GetCodebasePath());
+    this->currentCodebase = &project;
+    this->ReportProjectSize();
+
+    // The file browser is listed in the background as directories are expanded:
+    const std::unique_ptr<NavigationModel> previousModel = std::move(this->codebaseModel);
+    this->codebaseModel = std::make_unique<NavigationModel>(project, this);
+    this->codebaseBrowseTree->setModel(this->codebaseModel.get());
+    this->codebaseBrowseTree->sortByColumn(NavigationModel::NAME, Qt::AscendingOrder);
+    this->codebaseBrowseTree->setColumnWidth(NavigationModel::NAME, 400);
+    this->codebaseBrowseWindow->setWindowTitle("Project Navigation: " + QString::fromStdString(project.GetCodebasePath()));
+
+    // Only the current codebase's symbol index is kept up to date, and the "go to file" palette
+    // only covers it, anything still updating for the last one is abandoned:
+    if (this->symbolIndexThread != nullptr) {
+        this->updatingSymbolIndex->Cancel();
+        this->symbolIndexStale = true;
+    }
+    this->UpdateSymbolIndex();
+
+    this->fileFinder = std::make_shared<FuzzyFinder>();
+    this->UpdateFileCatalogue();
+}
+
+void MainWindow::OpenCodebase() {
+    const QString codebasePath = QFileDialog::getExistingDirectory(this, "Open Codebase");
+    if (codebasePath.isEmpty()) {
+        return;
+    }
+    try {
+        this->SetCurrentCodebase(this->workspace.Open(codebasePath.toStdString()));
+    } catch (const std::exception& exception) {
+        QMessageBox::warning(this, "Open Codebase", QString::fromStdString(exception.what()));
+    }
+}
+
+void MainWindow::SwitchCodebase() {
+    QStringList codebasePaths;
+    for (const Project* const project : this->workspace.GetProjects()) {
+        codebasePaths.push_back(QString::fromStdString(project->GetCodebasePath()));
+    }
+    bool accepted = false;
+    const QString chosenPath = QInputDialog::getItem(this, "Switch Codebase", "Codebase:", codebasePaths,
+        static_cast<int>(codebasePaths.indexOf(QString::fromStdString(this->currentCodebase->GetCodebasePath()))), false, &accepted);
+    Project* const chosen = accepted ? this->workspace.Find(chosenPath.toStdString()) : nullptr;
+    if (chosen != nullptr && chosen != this->currentCodebase) {
+        this->SetCurrentCodebase(*chosen);
+    }
 }
 
 QMdiSubWindow* MainWindow::AddSubWindow(QWidget* const widget) {
     // Create the window:
     QMdiSubWindow* const subWindow = this->MDIArea->addSubWindow(widget);
 
-    this->AddBindings(reinterpret_cast<QWidget*>(widget));
+    // Whatever it's moved over (or away from) may need suspending/resuming:
+    subWindow->installEventFilter(this);
 
     return subWindow;
 }
 
-void MainWindow::SpawnCodeViewer(const std::string& filePath) {
-    // Create a memory-tracked CodeEditor (derived from QTextEdit):
-    const std::string relPath = this->ToRelativePath(filePath);
+bool MainWindow::eventFilter(QObject* const watched, QEvent* const event) {
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::WindowStateChange:
+        this->editorSuspensionCheck.start(0);
+        break;
+    default:
+        break;
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
 
-    CodeEditor* const mainEditorsPtr = new CodeEditor(std::ref(currentCodebase), relPath, this);
+void MainWindow::SubWindowActivated(QMdiSubWindow* const subWindow) {
+    CodeEditor* const editor = subWindow == nullptr ? nullptr : qobject_cast<CodeEditor*>(subWindow->widget());
+    this->shortcuts.SetTarget(editor);
+    // Straight away, so an editor's never seen suspended:
+    this->UpdateEditorSuspension();
+    if (editor != nullptr) {
+        editor->RestartReviewDwell();
+    }
+}
+
+void MainWindow::UpdateEditorSuspension() {
+    WATCHDOG_TRACE_SCOPE("MainWindow::UpdateEditorSuspension");
+    // Top down, a window can be seen if any of it isn't covered by those above it:
+    const QList<QMdiSubWindow*> stackingOrder = this->MDIArea->subWindowList(QMdiArea::StackingOrder);
+    std::unordered_set<const QMdiSubWindow*> seenWindows;
+    QRegion covered;
+    for (qsizetype i = stackingOrder.size() - 1; i >= 0; i--) {
+        const QMdiSubWindow* const subWindow = stackingOrder[i];
+        if (!subWindow->isVisible() || subWindow->isMinimized()) {
+            continue;
+        }
+        if (!QRegion(subWindow->geometry()).subtracted(covered).isEmpty()) {
+            seenWindows.insert(subWindow);
+        }
+        covered += subWindow->geometry();
+    }
+
+    // Most recently active first:
+    const QList<QMdiSubWindow*> activationOrder = this->MDIArea->subWindowList(QMdiArea::ActivationHistoryOrder);
+    std::size_t residentHidden = 0;
+    for (qsizetype i = activationOrder.size() - 1; i >= 0; i--) {
+        CodeEditor* const editor = qobject_cast<CodeEditor*>(activationOrder[i]->widget());
+        if (editor == nullptr) {
+            continue;
+        }
+        if (seenWindows.count(activationOrder[i]) != 0 || activationOrder[i] == this->MDIArea->activeSubWindow()) {
+            editor->Resume();
+        }
+        else if (residentHidden < Config::Editors::ResidentHiddenEditors) {
+            residentHidden++; // Left as it is.
+        }
+        else {
+            editor->Suspend();
+        }
+    }
+}
+
+CodeEditor* MainWindow::SpawnCodeViewer(Project& project, const std::string& fileRef) {
+    // Create a memory-tracked CodeEditor (derived from QTextEdit):
+    CodeEditor* const mainEditorsPtr = new CodeEditor(std::ref(project), this->workspace.GetCache(), fileRef, this);
     mainEditorsPtr->setAttribute(Qt::WA_DeleteOnClose, true);
+    QObject::connect(mainEditorsPtr, SIGNAL(FindDefinition(QString)), this, SLOT(FindDefinition(QString)));
+    QObject::connect(mainEditorsPtr, SIGNAL(FindReferences(QString)), this, SLOT(FindReferences(QString)));
+    QObject::connect(mainEditorsPtr, SIGNAL(MarksChanged(QString)), this, SLOT(NavigationCountsChanged(QString)));
+    QObject::connect(mainEditorsPtr, SIGNAL(CoverageChanged(QString)), this, SLOT(NavigationCountsChanged(QString)));
     mainEditorsPtr->show();
 
     // Spawn the CodeEditor as a sub window of the MDI area:
     QMdiSubWindow* const editorSubWindow = this->AddSubWindow(mainEditorsPtr);
     editorSubWindow->resize(400, 400);
-    editorSubWindow->setWindowTitle(/*"Code Viewer: "*/"\'" + QString::fromStdString(filePath).split('/').back() + "\'");
+    // Which codebase it's from is only worth saying once there are several:
+    const QString codebaseSuffix = this->workspace.GetProjects().size() < 2 ? QString() :
+        " (" + QString::fromStdString(project.GetCodebasePath()).section('/', -2, -2) + ")";
+    editorSubWindow->setWindowTitle(/*"Code Viewer: "*/"\'" + QString::fromStdString(fileRef).split('/').back() + "\'" + codebaseSuffix);
     editorSubWindow->show();
+    return mainEditorsPtr;
 }
 
-std::string MainWindow::ToRelativePath(const std::string& fullPath) const {
-    const std::size_t baseLen = this->currentCodebase.GetCodebasePath().length();
-    if (fullPath.length() <= baseLen) {
-        throw std::runtime_error("Invalid 'fullPath' length");
+MainWindow::~MainWindow() {
+    if (this->fileCatalogueThread != nullptr) {
+        *this->fileCatalogueCancelled = true;
+        this->fileCatalogueThread->wait();
     }
-    return fullPath.substr(baseLen);
-}
-
-std::string MainWindow::ToFullPath(const std::string& relPath) const {
-    return this->currentCodebase.GetCodebasePath() + relPath;
+    if (this->symbolIndexThread != nullptr) {
+        this->updatingSymbolIndex->Cancel();
+        this->symbolIndexThread->wait();
+    }
+    if (this->activeJobThread != nullptr) {
+        this->activeJob->Cancel();
+        this->activeJobThread->wait();
+    }
+    this->watchdogHeartbeat.stop();
+    Watchdog::Stop();
+    delete ui;
 }
 
-MainWindow::~MainWindow() {
-    delete ui;
+void MainWindow::ReportProjectSize() const {
+    Watchdog::SetProjectSize(this->currentCodebase->annotations.Count(), this->currentCodebase->bookmarks.Count());
 }
 
 void MainWindow::OpenSelectedFile() {
@@ -89,9 +243,37 @@ void MainWindow::OpenSelectedFile() {
 
     QModelIndexList::const_reference selectedFileIndex = selectedIndexes.back();
 
-    const QFileSystemModel* const localModel = reinterpret_cast<QFileSystemModel* const>(tree->model());
-    const std::string pathStr = localModel->filePath(selectedFileIndex).toStdString();
-    this->SpawnCodeViewer(pathStr);
+    const NavigationModel* const localModel = this->codebaseModel.get();
+    if (localModel->IsDirectory(selectedFileIndex)) {
+        return;
+    }
+    this->SpawnCodeViewer(*this->currentCodebase, localModel->FileRef(selectedFileIndex));
+}
+
+void MainWindow::NavigationCountsChanged(const QString& fileRef) {
+    this->codebaseModel->CountsChanged(fileRef.toStdString());
+}
+
+void MainWindow::EditExcludes() {
+    std::string currentPatterns;
+    for (const std::string& excludePattern : this->currentCodebase->excludePatterns) {
+        currentPatterns += excludePattern + "\n";
+    }
+    bool accepted = false;
+    const QString patterns = QInputDialog::getMultiLineText(this, "Navigation Excludes",
+        "Paths to hide from navigation, one .gitignore pattern per line:", QString::fromStdString(currentPatterns), &accepted);
+    if (!accepted) {
+        return;
+    }
+
+    this->currentCodebase->excludePatterns.clear();
+    for (const QString& pattern : patterns.split('\n', Qt::SkipEmptyParts)) {
+        if (!pattern.trimmed().isEmpty()) {
+            this->currentCodebase->excludePatterns.push_back(pattern.toStdString());
+        }
+    }
+    this->codebaseModel->Rescan();
+    this->UpdateFileCatalogue();
 }
 
 void MainWindow::OpenBookmarks() {
@@ -100,11 +282,12 @@ void MainWindow::OpenBookmarks() {
     // to currently.
     QTreeView* const listView = new QTreeView(this);
     listView->setAttribute(Qt::WA_DeleteOnClose, true);
-    QStandardItemModel* itemModel = new QStandardItemModel(this);
+    AccountedItemModel* itemModel = new AccountedItemModel("bookmarks list", this);
     itemModel->setHorizontalHeaderLabels({"File", "Line #", "Code"});
 
     // Add the bookmarks' information into a model that can be sent to listView:
-    this->currentCodebase.bookmarks.AddToModel(itemModel, this->currentCodebase.GetCodebasePath());
+    this->PopulateBookmarksList(itemModel);
+    itemModel->UpdateAccounting();
 
     // Apply the model to listView and then spawn a subwindow:
     listView->setModel(itemModel);
@@ -116,59 +299,395 @@ void MainWindow::OpenBookmarks() {
 }
 
 void MainWindow::OpenAnnotations() {
-    // Lots of dynamic allocation that isn't tracked here, note that from what I've read in Qt's documentation,
-    // each of these nontracked allocations have their ownership transfered to whichever function they are passed
-    // to currently.
+    FindingsView* const findingsView = new FindingsView(*this->currentCodebase, this);
+    findingsView->setAttribute(Qt::WA_DeleteOnClose, true);
+    QMdiSubWindow* const newWindow = this->AddSubWindow(findingsView);
+    QObject::connect(findingsView, SIGNAL(TitleChanged(QString)), newWindow, SLOT(setWindowTitle(QString)));
+    // Starts out listing every annotation:
+    findingsView->Rerun();
+    newWindow->show();
+}
+
+void MainWindow::RunProjectJob(const QString& title, const std::function<void(ProjectIO::Job&)>& work,
+                               const std::function<void()>& onSuccess) {
+    if (this->activeJobThread != nullptr) {
+        QMessageBox::information(this, title, "Please wait for the current import/export to finish.");
+        return;
+    }
+
+    const std::shared_ptr<ProjectIO::Job> job = std::make_shared<ProjectIO::Job>();
+    const std::shared_ptr<std::string> failure = std::make_shared<std::string>();
+    const std::shared_ptr<bool> wasCancelled = std::make_shared<bool>(false);
+
+    // Window-modal so the project can't be edited underneath the job, but the event loop
+    // (and so the rest of the UI) keeps running:
+    QProgressDialog* const progressDialog = new QProgressDialog(title, "Cancel", 0, 100, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(250);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+    QObject::connect(progressDialog, &QProgressDialog::canceled, [job]() {
+        job->Cancel();
+    });
+    QTimer* const progressPoll = new QTimer(progressDialog);
+    QObject::connect(progressPoll, &QTimer::timeout, progressDialog, [progressDialog, job, title]() {
+        progressDialog->setLabelText(title + ": " + QString::fromStdString(job->GetStage()) + "...");
+        progressDialog->setValue(job->GetProgress());
+    });
+    progressPoll->start(50);
+
+    this->activeJob = job;
+    this->activeJobThread = QThread::create([job, work, failure, wasCancelled]() {
+        try {
+            work(*job);
+        } catch (const OperationCancelled&) {
+            *wasCancelled = true;
+        } catch (const std::exception& exception) {
+            *failure = exception.what();
+            if (failure->empty()) {
+                *failure = "Unknown error";
+            }
+        }
+    });
+    QObject::connect(this->activeJobThread, &QThread::finished, this,
+        [this, title, progressDialog, failure, wasCancelled, onSuccess]() {
+            progressDialog->deleteLater();
+            this->activeJobThread->deleteLater();
+            this->activeJobThread = nullptr;
+            this->activeJob.reset();
+
+            if (*wasCancelled) {
+                return;
+            }
+            if (!failure->empty()) {
+                QMessageBox::warning(this, title, QString::fromStdString(*failure));
+                return;
+            }
+            onSuccess();
+        }
+    );
+    this->activeJobThread->start();
+}
+
+void MainWindow::UpdateSymbolIndex() {
+    if (this->symbolIndexThread != nullptr) {
+        return; // Already updating.
+    }
+
+    const std::shared_ptr<SymbolIndex> index = this->workspace.GetSymbolIndex(*this->currentCodebase);
+    this->updatingSymbolIndex = index;
+    this->symbolIndexThread = QThread::create([index]() {
+        Tracing::SetThreadName("Symbol indexer");
+        index->Update();
+    });
+    QObject::connect(this->symbolIndexThread, &QThread::finished, this, [this]() {
+        this->symbolIndexThread->deleteLater();
+        this->symbolIndexThread = nullptr;
+        this->updatingSymbolIndex.reset();
+        if (this->symbolIndexStale) {
+            this->symbolIndexStale = false;
+            this->UpdateSymbolIndex();
+        }
+    });
+    this->symbolIndexThread->start();
+}
+
+void MainWindow::UpdateFileCatalogue() {
+    if (this->fileCatalogueThread != nullptr) {
+        // Whatever it's listing may already be out of date:
+        *this->fileCatalogueCancelled = true;
+        this->fileCatalogueStale = true;
+        return;
+    }
+
+    const std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+    const std::shared_ptr<FuzzyFinder> finder = std::make_shared<FuzzyFinder>();
+    const std::string codebasePath = this->currentCodebase->GetCodebasePath();
+    const std::vector<std::string> excludePatterns = this->currentCodebase->excludePatterns;
+    const std::filesystem::path listingCachePath = this->currentCodebase->GetCacheDirectory() / "files.idx";
+    const std::shared_ptr<std::vector<std::string>> files = std::make_shared<std::vector<std::string>>();
+    const std::shared_ptr<std::vector<std::size_t>> lineCounts = std::make_shared<std::vector<std::size_t>>();
+    this->fileCatalogueCancelled = cancelled;
+    this->fileCatalogueThread = QThread::create([this, cancelled, finder, files, lineCounts, codebasePath, excludePatterns, listingCachePath]() {
+        Tracing::SetThreadName("File cataloguer");
+        *files = DirectoryScanner::ListFiles(codebasePath, excludePatterns, *cancelled, listingCachePath);
+        finder->SetPaths(*files);
+        // The palette can be used whilst the lines are counted:
+        QMetaObject::invokeMethod(this, [this, cancelled, finder]() {
+            if (!*cancelled) {
+                this->fileFinder = finder;
+            }
+        }, Qt::QueuedConnection);
+        // Review coverage is reported against every file's length:
+        *lineCounts = ReviewCoverage::CountLines(codebasePath, *files, *cancelled);
+    });
+    QObject::connect(this->fileCatalogueThread, &QThread::finished, this, [this, cancelled, files, lineCounts]() {
+        this->fileCatalogueThread->deleteLater();
+        this->fileCatalogueThread = nullptr;
+        if (!*cancelled) {
+            this->UpdateLineCounts(*files, *lineCounts);
+        }
+        if (this->fileCatalogueStale) {
+            this->fileCatalogueStale = false;
+            this->UpdateFileCatalogue();
+        }
+    });
+    this->fileCatalogueThread->start();
+}
+
+void MainWindow::UpdateLineCounts(const std::vector<std::string>& files, const std::vector<std::size_t>& lineCounts) {
+    WATCHDOG_TRACE_SCOPE("MainWindow::UpdateLineCounts");
+    ReviewCoverage& coverage = this->currentCodebase->coverage;
+    const std::unordered_set<std::string> listedFiles(files.cbegin(), files.cend());
+    // Files that have gone (or are now excluded) no longer count towards the totals:
+    std::vector<std::string> unlistedFiles;
+    for (const std::pair<const std::string, ReviewCoverage::File>& file : coverage.GetFiles()) {
+        if (file.second.lineCount != 0 && listedFiles.count(file.first) == 0) {
+            unlistedFiles.push_back(file.first);
+        }
+    }
+    for (const std::string& unlistedFile : unlistedFiles) {
+        coverage.SetLineCount(unlistedFile, 0);
+    }
+    for (std::size_t i = 0; i < files.size(); i++) {
+        coverage.SetLineCount(files[i], lineCounts[i]);
+    }
+    this->codebaseModel->AllCountsChanged();
+}
+
+void MainWindow::OpenQuickOpen() {
+    QuickOpenDialog* const quickOpen = new QuickOpenDialog(this->fileFinder, this);
+    quickOpen->setAttribute(Qt::WA_DeleteOnClose, true);
+    // Whichever codebase the palette was listing, even if the current one's changed since:
+    Project* const project = this->currentCodebase;
+    QObject::connect(quickOpen, &QuickOpenDialog::FileChosen, this, [this, project](const QString& fileRef) {
+        this->SpawnCodeViewer(*project, fileRef.toStdString());
+    });
+    quickOpen->show();
+}
+
+Project& MainWindow::EmittingProject() const {
+    const CodeEditor* const editor = qobject_cast<const CodeEditor*>(this->sender());
+    return editor != nullptr ? editor->GetProject() : *this->currentCodebase;
+}
+
+void MainWindow::FindDefinition(const QString& symbol) {
+    WATCHDOG_TRACE_SCOPE_DETAIL("MainWindow::FindDefinition", symbol.toStdString());
+    // Looked up in the codebase of the editor it was asked from, which needn't be the current one:
+    Project& project = this->EmittingProject();
+    this->ShowSymbolLocations(project, "Definition(s) of \'" + symbol + "\'",
+                              this->workspace.GetSymbolIndex(project)->FindDefinitions(symbol.toStdString()));
+}
+
+void MainWindow::FindReferences(const QString& symbol) {
+    WATCHDOG_TRACE_SCOPE_DETAIL("MainWindow::FindReferences", symbol.toStdString());
+    const static std::size_t maxReferences = 10000;
+    Project& project = this->EmittingProject();
+    this->ShowSymbolLocations(project, "Reference(s) to \'" + symbol + "\'",
+                              this->workspace.GetSymbolIndex(project)->FindReferences(symbol.toStdString(), maxReferences));
+}
+
+void MainWindow::ShowSymbolLocations(Project& project, const QString& title, const std::vector<SymbolIndex::Location>& locations) {
+    if (locations.empty()) {
+        QMessageBox::information(this, title, this->updatingSymbolIndex == this->workspace.GetSymbolIndex(project) ?
+            "Nothing found, the symbol index is still being updated." : "Nothing found.");
+        return;
+    }
+    if (locations.size() == 1) {
+        this->OpenLocation(project, locations.front().fileRef, locations.front().lineRef);
+        return;
+    }
+
+    // Several candidates, list them and open whichever is double-clicked:
     QTreeView* const listView = new QTreeView(this);
     listView->setAttribute(Qt::WA_DeleteOnClose, true);
-    QStandardItemModel* itemModel = new QStandardItemModel(this);
-
-    itemModel->setHorizontalHeaderLabels({"File", "Line #", "Code", "Annotation"});
-    this->currentCodebase.annotations.AddToModel(itemModel, this->currentCodebase.GetCodebasePath());
+    AccountedItemModel* itemModel = new AccountedItemModel("symbol results", this);
+    itemModel->setHorizontalHeaderLabels({"File", "Line #", "Kind"});
+    for (const SymbolIndex::Location& location : locations) {
+        const int rowIndex = itemModel->rowCount();
+        itemModel->setItem(rowIndex, 0, new QStandardItem(QString::fromStdString(location.fileRef)));
+        itemModel->setItem(rowIndex, 1, new QStandardItem(QString::number(location.lineRef)));
+        itemModel->setItem(rowIndex, 2, new QStandardItem(location.isDefinition ? "Definition" : "Reference"));
+    }
+    itemModel->UpdateAccounting();
 
     listView->setModel(itemModel);
     listView->setSortingEnabled(true);
     listView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Force readonly
+    QObject::connect(listView, &QTreeView::doubleClicked, this, [this, project = &project, itemModel](const QModelIndex& index) {
+        this->OpenLocation(*project, itemModel->item(index.row(), 0)->text().toStdString(),
+                           itemModel->item(index.row(), 1)->text().toULongLong());
+    });
     QMdiSubWindow* const newWindow = this->AddSubWindow(listView);
-    newWindow->setWindowTitle(QString::number(itemModel->rowCount()) + " annotation(s)");
+    newWindow->setWindowTitle(title + ": " + QString::number(itemModel->rowCount()));
     newWindow->show();
 }
 
+void MainWindow::OpenLocation(Project& project, const std::string& fileRef, const std::size_t lineRef) {
+    CodeEditor* const editor = this->SpawnCodeViewer(project, fileRef);
+    editor->GoToCodeLine(lineRef);
+}
+
 void MainWindow::ExportProject() {
+    this->ExportProjectAs(Config::VR_Specifications::BLOCKS);
+}
+
+void MainWindow::ExportSnippet() {
+    this->ExportProjectAs(Config::VR_Specifications::SNIPPET);
+}
+
+void MainWindow::ExportProjectAs(const Config::VR_Specifications specification) {
+    WATCHDOG_TRACE_SCOPE("MainWindow::ExportProject");
     const QUrl exportLocation = QFileDialog::getSaveFileUrl(this, "Export Location");
-    QJsonObject jsonFormatted = this->currentCodebase.SerializeToJSON(Config::VR_Specifications::BLOCKS);
+    if (exportLocation.isEmpty()) {
+        return;
+    }
 
-    QFile outputFile(exportLocation.toLocalFile());
-    outputFile.open(QFile::OpenModeFlag::NewOnly);
-    outputFile.write(QJsonDocument(jsonFormatted).toJson(QJsonDocument::Compact));
+    // The worker serializes a snapshot so that the project can't change underneath it, without
+    // copying it or holding up edits meanwhile:
+    const Project::Snapshot exportedCodebase = this->currentCodebase->GetSnapshot();
+    const QString exportPath = exportLocation.toLocalFile();
+    this->RunProjectJob("Exporting", [exportedCodebase, exportPath, specification](ProjectIO::Job& job) {
+        ProjectIO::Save(exportedCodebase, exportPath, specification, job);
+    }, []() {});
+}
+
+void MainWindow::ExportReport() {
+    WATCHDOG_TRACE_SCOPE("MainWindow::ExportReport");
+    QString selectedFilter;
+    const QUrl reportLocation = QFileDialog::getSaveFileUrl(this, "Report Location", QUrl(), "HTML (*.html);;Markdown (*.md)", &selectedFilter);
+    if (reportLocation.isEmpty()) {
+        return;
+    }
+    bool accepted = false;
+    const int contextLines = QInputDialog::getInt(this, "Export Report", "Lines of context:", Config::Report::ContextLines, 0, 1000, 1, &accepted);
+    if (!accepted) {
+        return;
+    }
+
+    const QString reportPath = reportLocation.toLocalFile();
+    const ReportGenerator::Options options {
+        .format = reportPath.endsWith(".md") || (!reportPath.endsWith(".html") && selectedFilter.startsWith("Markdown")) ?
+            ReportGenerator::Format::MARKDOWN : ReportGenerator::Format::HTML,
+        .contextLines = static_cast<std::size_t>(contextLines),
+        .cacheDirectory = this->currentCodebase->GetCacheDirectory()
+    };
+    const Project::Snapshot reportedCodebase = this->currentCodebase->GetSnapshot();
+    this->RunProjectJob("Exporting report", [reportedCodebase, reportPath, options](ProjectIO::Job& job) {
+        ProjectIO::SaveReport(reportedCodebase, reportPath, options, job);
+    }, []() {});
 }
 
 void MainWindow::ImportProject() {
+    this->ImportProjectAs(Config::VR_Specifications::BLOCKS);
+}
+
+void MainWindow::ImportSnippet() {
+    this->ImportProjectAs(Config::VR_Specifications::SNIPPET);
+}
+
+void MainWindow::ImportProjectAs(const Config::VR_Specifications specification) {
+    WATCHDOG_TRACE_SCOPE("MainWindow::ImportProject");
     // Open the project file:
     const QUrl importLocation = QFileDialog::getOpenFileUrl(this, "Import Location");
-    QFile inputFile(importLocation.toLocalFile());
-    inputFile.open(QIODevice::ReadOnly | QIODevice::Text);
+    if (importLocation.isEmpty()) {
+        return;
+    }
 
-    // Read the file's contents and perform some minor cleanup:
-    QByteArray fileBytes = inputFile.readAll();
-    const QJsonDocument projectJSON = QJsonDocument::fromJson(fileBytes);
-    fileBytes.clear();
-    inputFile.close();
+    // Load it in the background and only swap it in once it has loaded successfully:
+    const std::shared_ptr<std::unique_ptr<Project>> newCodebase = std::make_shared<std::unique_ptr<Project>>();
+    const QString importPath = importLocation.toLocalFile();
+    Project* const importedInto = this->currentCodebase;
+    const std::string codebasePath = importedInto->GetCodebasePath();
+    this->RunProjectJob("Importing", [newCodebase, importPath, codebasePath, specification](ProjectIO::Job& job) {
+        *newCodebase = ProjectIO::Load(importPath, codebasePath, specification, job);
+    }, [this, importedInto, newCodebase]() {
+        *importedInto = std::move(**newCodebase);
+        this->ReportProjectSize();
+        this->ReloadAll();
+    });
+}
 
-    if (!projectJSON.isObject() || projectJSON.isNull() || projectJSON.isEmpty()) {
+void MainWindow::MergeProjects() {
+    WATCHDOG_TRACE_SCOPE("MainWindow::MergeProjects");
+    const QList<QUrl> mergeLocations = QFileDialog::getOpenFileUrls(this, "Project(s) to Merge");
+    if (mergeLocations.isEmpty()) {
         return;
     }
 
-    Project newCodebase(this->currentCodebase.GetCodebasePath(), projectJSON.object(), Config::VR_Specifications::BLOCKS);
-    this->currentCodebase = newCodebase; // moving ownership isn't required.
+    // The current project is either the common ancestor of the others (three-way) or just
+    // another auditor's work to merge alongside them (two-way):
+    const QMessageBox::StandardButton mergeMode = QMessageBox::question(this, "Merge",
+        "Were the selected project(s) branched from the currently loaded project?\n\n"
+        "Yes: three-way merge, the current project is the common base.\n"
+        "No: two-way merge, the current project is merged alongside them.",
+        QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+    if (mergeMode == QMessageBox::Cancel) {
+        return;
+    }
 
-    this->ReloadAll();
+    // The other projects (in whichever format each is in) are read and merged in the background,
+    // the current project only replaced once that's succeeded:
+    QStringList mergePaths;
+    for (const QUrl& mergeLocation : mergeLocations) {
+        mergePaths.push_back(mergeLocation.toLocalFile());
+    }
+    Project* const mergedInto = this->currentCodebase;
+    const bool threeWay = mergeMode == QMessageBox::Yes;
+    const std::shared_ptr<std::unique_ptr<Project>> mergedCodebase = std::make_shared<std::unique_ptr<Project>>();
+    const std::shared_ptr<ProjectMerge::Report> report = std::make_shared<ProjectMerge::Report>();
+    this->RunProjectJob("Merging", [mergedInto, mergePaths, threeWay, mergedCodebase, report](ProjectIO::Job& job) {
+        const std::string codebasePath = mergedInto->GetCodebasePath();
+        std::vector<std::unique_ptr<Project>> loadedProjects;
+        std::vector<const Project*> sides;
+        if (!threeWay) {
+            sides.push_back(mergedInto);
+        }
+        for (const QString& mergePath : mergePaths) {
+            try {
+                loadedProjects.push_back(ProjectIO::Load(mergePath, codebasePath, job));
+            } catch (const OperationCancelled&) {
+                throw;
+            } catch (const std::exception& failure) {
+                throw std::runtime_error("Unable to read a project from " + mergePath.toStdString() + ": " + failure.what());
+            }
+            sides.push_back(loadedProjects.back().get());
+        }
+
+        job.SetStage("Merging");
+        *mergedCodebase = std::make_unique<Project>(codebasePath);
+        *report = ProjectMerge::Merge(threeWay ? mergedInto : nullptr, sides, **mergedCodebase);
+        (*mergedCodebase)->excludePatterns = mergedInto->excludePatterns;
+    }, [this, mergedInto, mergedCodebase, report]() {
+        *mergedInto = std::move(**mergedCodebase);
+        this->ReportProjectSize();
+        this->ReloadAll();
+
+        QMessageBox::information(this, "Merge",
+            QString::number(report->annotations) + " annotation(s) and " + QString::number(report->bookmarks) + " bookmark(s) merged.\n" +
+            QString::number(report->duplicates) + " duplicate finding(s) combined, " +
+            QString::number(report->relocatedDuplicates) + " identical finding(s) left on different lines.\n" +
+            QString::number(report->deletions) + " annotation(s) deleted.\n" +
+            QString::number(report->conflicts.size()) + " conflict(s), tagged #" + QString::fromStdString(ProjectMerge::ConflictKeyword) + "."
+        );
+    });
 }
 
 void MainWindow::ReloadAll() {
+    WATCHDOG_TRACE_SCOPE("MainWindow::ReloadAll");
+    // Files may have changed on disk, only those that have are re-indexed:
+    this->UpdateSymbolIndex();
+    this->UpdateFileCatalogue();
+    this->codebaseModel->Rescan();
+
     // Refresh the annotation/bookmark views:
     const QList<QMdiSubWindow*> subWindows = this->MDIArea->subWindowList();
     for (QMdiSubWindow* iterativeWindow : subWindows) {
+        FindingsView* const findingsView = qobject_cast<FindingsView*>(iterativeWindow->widget());
+        if (findingsView != nullptr) {
+            findingsView->Rerun();
+            continue;
+        }
         QTreeView* const treeView = qobject_cast<QTreeView*>(iterativeWindow->widget());
         if (treeView == nullptr) {
             CodeEditor* const codeWindow = qobject_cast<CodeEditor*>(iterativeWindow->widget());
@@ -179,17 +698,16 @@ void MainWindow::ReloadAll() {
         }
 
         const QString windowTitle = iterativeWindow->windowTitle();
-        QStandardItemModel* const treeModel = reinterpret_cast<QStandardItemModel*>(treeView->model());
-        if (windowTitle.endsWith(" annotation(s)")) {
-            treeModel->clear();
-            treeModel->setHorizontalHeaderLabels({"File", "Line #", "Code", "Annotation"});
-            this->currentCodebase.annotations.AddToModel(treeModel, this->currentCodebase.GetCodebasePath());
-            iterativeWindow->setWindowTitle(QString::number(treeModel->rowCount()) + " annotation(s)");
+        if (windowTitle == "Memory usage") {
+            this->PopulateMemoryPanel(reinterpret_cast<QStandardItemModel*>(treeView->model()));
+            continue;
         }
-        else if (windowTitle.endsWith(" bookmark(s)")) {
+        AccountedItemModel* const treeModel = reinterpret_cast<AccountedItemModel*>(treeView->model());
+        if (windowTitle.endsWith(" bookmark(s)")) {
             treeModel->clear();
             treeModel->setHorizontalHeaderLabels({"File", "Line #", "Code"});
-            this->currentCodebase.bookmarks.AddToModel(treeModel, this->currentCodebase.GetCodebasePath());
+            this->PopulateBookmarksList(treeModel);
+            treeModel->UpdateAccounting();
             iterativeWindow->setWindowTitle(QString::number(treeModel->rowCount()) + " bookmark(s)");
         }
         else {
@@ -198,13 +716,226 @@ void MainWindow::ReloadAll() {
     }
 }
 
-void MainWindow::AddBindings(QWidget* const widget) {
+void MainWindow::AddBindings() {
     // Assign the universal bindings:
-    std::unique_ptr<QAction> generalActionUniquePtr;
-    QAction* generalActionPtr = nullptr;
-    NEW_KEYBIND("OPN_BOOKMARKS", QKeySequence(Qt::SHIFT | Qt::Key_B), OpenBookmarks, widget);
-    NEW_KEYBIND("OPN_ANNOTATIONS", QKeySequence(Qt::SHIFT | Qt::Key_Semicolon), OpenAnnotations, widget);
-    NEW_KEYBIND("EXPORT", QKeySequence(Qt::SHIFT | Qt::Key_E), ExportProject, widget);
-    NEW_KEYBIND("IMPORT", QKeySequence(Qt::SHIFT | Qt::Key_I), ImportProject, widget);
-    NEW_KEYBIND("RELOAD", QKeySequence(Qt::SHIFT | Qt::Key_R), ReloadAll, widget);
+    NEW_KEYBIND("OPN_BOOKMARKS", QKeySequence(Qt::SHIFT | Qt::Key_B), OpenBookmarks, this->shortcuts);
+    NEW_KEYBIND("OPN_ANNOTATIONS", QKeySequence(Qt::SHIFT | Qt::Key_Semicolon), OpenAnnotations, this->shortcuts);
+    NEW_KEYBIND("EXPORT", QKeySequence(Qt::SHIFT | Qt::Key_E), ExportProject, this->shortcuts);
+    NEW_KEYBIND("IMPORT", QKeySequence(Qt::SHIFT | Qt::Key_I), ImportProject, this->shortcuts);
+    NEW_KEYBIND("EXPORT_SNIPPET", QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_E), ExportSnippet, this->shortcuts);
+    NEW_KEYBIND("IMPORT_SNIPPET", QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_I), ImportSnippet, this->shortcuts);
+    NEW_KEYBIND("EXPORT_REPORT", QKeySequence(Qt::SHIFT | Qt::Key_P), ExportReport, this->shortcuts);
+    NEW_KEYBIND("MERGE", QKeySequence(Qt::SHIFT | Qt::Key_G), MergeProjects, this->shortcuts);
+    NEW_KEYBIND("RELOAD", QKeySequence(Qt::SHIFT | Qt::Key_R), ReloadAll, this->shortcuts);
+    NEW_KEYBIND("DUMP_TRACE", QKeySequence(Qt::SHIFT | Qt::Key_T), DumpTrace, this->shortcuts);
+    NEW_KEYBIND("OPN_STALLS", QKeySequence(Qt::SHIFT | Qt::Key_W), OpenStallReport, this->shortcuts);
+    NEW_KEYBIND("DUMP_STALLS", QKeySequence(Qt::SHIFT | Qt::Key_D), DumpStallReport, this->shortcuts);
+    NEW_KEYBIND("OPN_MEMORY", QKeySequence(Qt::SHIFT | Qt::Key_M), OpenMemoryPanel, this->shortcuts);
+    NEW_KEYBIND("DUMP_MEMORY", QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M), DumpMemoryReport, this->shortcuts);
+    NEW_KEYBIND("EDIT_EXCLUDES", QKeySequence(Qt::SHIFT | Qt::Key_X), EditExcludes, this->shortcuts);
+    NEW_KEYBIND("OPN_QUICK_OPEN", QKeySequence(Qt::SHIFT | Qt::Key_O), OpenQuickOpen, this->shortcuts);
+    NEW_KEYBIND("OPN_CODEBASE", QKeySequence(Qt::SHIFT | Qt::Key_C), OpenCodebase, this->shortcuts);
+    NEW_KEYBIND("SWITCH_CODEBASE", QKeySequence(Qt::SHIFT | Qt::Key_S), SwitchCodebase, this->shortcuts);
+}
+
+void MainWindow::DumpTrace() {
+    if (!Tracing::Enabled()) {
+        QMessageBox::information(this, "Tracing", "Tracing wasn't compiled in, rebuild with 'DEFINES += BLOCKS_TRACING'.");
+        return;
+    }
+
+    const QUrl dumpLocation = QFileDialog::getSaveFileUrl(this, "Trace Location", QUrl(), "Trace (*.json)");
+    if (dumpLocation.isEmpty()) {
+        return;
+    }
+    if (!Tracing::DumpChromeTrace(dumpLocation.toLocalFile().toStdString())) {
+        QMessageBox::warning(this, "Tracing", "Unable to write the trace to " + dumpLocation.toLocalFile());
+    }
+}
+
+void MainWindow::OpenStallReport() {
+    const Watchdog::Report report = Watchdog::GetReport();
+
+    QTreeView* const listView = new QTreeView(this);
+    listView->setAttribute(Qt::WA_DeleteOnClose, true);
+    QStandardItemModel* itemModel = new QStandardItemModel(this);
+    itemModel->setHorizontalHeaderLabels({"When", "Duration", "Operation", "Detail", "Annotations", "Bookmarks"});
+
+    // Durations histogram first, then the individual (most recent) stalls:
+    QStandardItem* const histogramRoot = new QStandardItem(
+        "Histogram (threshold: " + QString::number(report.threshold.count()) + "ms)"
+    );
+    for (std::size_t bucket = 0; bucket < report.histogram.size(); bucket++) {
+        histogramRoot->appendRow({
+            new QStandardItem(QString::fromStdString(Watchdog::HistogramBucketLabel(bucket))),
+            new QStandardItem(QString::number(report.histogram[bucket]) + " stall(s)")
+        });
+    }
+    itemModel->appendRow(histogramRoot);
+
+    QStandardItem* const stallsRoot = new QStandardItem(
+        QString::number(report.stalls.size()) + " recent stall(s)" +
+        (report.stallInProgress ? " [stalled right now]" : "")
+    );
+    for (std::vector<Watchdog::StallRecord>::const_reverse_iterator stall = report.stalls.crbegin();
+         stall != report.stalls.crend(); stall++) {
+        const QDateTime began = QDateTime::fromMSecsSinceEpoch(std::chrono::duration_cast<std::chrono::milliseconds>(
+            stall->began.time_since_epoch()).count());
+        stallsRoot->appendRow({
+            new QStandardItem(began.toString(Qt::ISODateWithMs)),
+            new QStandardItem(QString::number(stall->duration.count()) + "ms"),
+            new QStandardItem(stall->operation.empty() ? "(uninstrumented)" : QString::fromStdString(stall->operation)),
+            new QStandardItem(QString::fromStdString(stall->detail)),
+            new QStandardItem(QString::number(stall->projectAnnotations)),
+            new QStandardItem(QString::number(stall->projectBookmarks))
+        });
+    }
+    itemModel->appendRow(stallsRoot);
+
+    listView->setModel(itemModel);
+    listView->expandAll();
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Force readonly
+    QMdiSubWindow* const newWindow = this->AddSubWindow(listView);
+    newWindow->setWindowTitle("Stall report");
+    newWindow->show();
+}
+
+void MainWindow::DumpStallReport() {
+    const QUrl dumpLocation = QFileDialog::getSaveFileUrl(this, "Stall Report Location", QUrl(), "JSON (*.json)");
+    if (dumpLocation.isEmpty()) {
+        return;
+    }
+
+    const Watchdog::Report report = Watchdog::GetReport();
+    QJsonObject reportJSON;
+    reportJSON["thresholdMs"] = static_cast<qint64>(report.threshold.count());
+    QJsonArray histogramArr;
+    for (std::size_t bucket = 0; bucket < report.histogram.size(); bucket++) {
+        QJsonObject bucketObject;
+        bucketObject["bucket"] = QString::fromStdString(Watchdog::HistogramBucketLabel(bucket));
+        bucketObject["count"] = static_cast<qint64>(report.histogram[bucket]);
+        histogramArr.push_back(bucketObject);
+    }
+    reportJSON["histogram"] = histogramArr;
+    QJsonArray stallsArr;
+    for (const Watchdog::StallRecord& stall : report.stalls) {
+        QJsonObject stallObject;
+        stallObject["began"] = static_cast<qint64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            stall.began.time_since_epoch()).count());
+        stallObject["durationMs"] = static_cast<qint64>(stall.duration.count());
+        stallObject["operation"] = QString::fromStdString(stall.operation);
+        stallObject["detail"] = QString::fromStdString(stall.detail);
+        stallObject["annotations"] = static_cast<qint64>(stall.projectAnnotations);
+        stallObject["bookmarks"] = static_cast<qint64>(stall.projectBookmarks);
+        stallsArr.push_back(stallObject);
+    }
+    reportJSON["stalls"] = stallsArr;
+
+    QFile outputFile(dumpLocation.toLocalFile());
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Stall Report", "Unable to write the report to " + dumpLocation.toLocalFile());
+        return;
+    }
+    outputFile.write(QJsonDocument(reportJSON).toJson(QJsonDocument::Indented));
+}
+
+void MainWindow::PopulateBookmarksList(QStandardItemModel* const model) const {
+    WATCHDOG_TRACE_SCOPE("MainWindow::PopulateBookmarksList");
+    const std::string basePath = this->currentCodebase->GetCodebasePath();
+    int rowIndex = model->rowCount();
+    this->currentCodebase->bookmarks.GetSnapshot()->ForEach([&](const std::string& fileRef, const std::vector<Bookmark>& fileBookmarks) {
+        // Only the bookmarked lines are read, bookmarks are sorted so this is a single pass over the file:
+        PagedFile file(basePath + fileRef, false, std::filesystem::path(), &this->workspace.GetCache());
+
+        for (const Bookmark& bookmark : fileBookmarks) {
+            const std::vector<std::string> bookmarkedLine = file.ReadLines(bookmark.lineRef, 1);
+            if (bookmarkedLine.empty()) {
+                throw std::runtime_error("OOB bookmark");
+            }
+            QString lineText;
+            TextKernels::AppendUTF8(lineText, bookmarkedLine.front().data(), bookmarkedLine.front().size(), false);
+
+            model->setItem(rowIndex, 0, new QStandardItem(QString::fromStdString(bookmark.fileRef)));
+            model->setItem(rowIndex, 1, new QStandardItem(QString::number(bookmark.lineRef)));
+            model->setItem(rowIndex, 2, new QStandardItem(lineText.simplified()));
+            ++rowIndex;
+        }
+    });
+}
+
+void MainWindow::PopulateMemoryPanel(QStandardItemModel* const model) const {
+    const MemoryAccounting::Snapshot snapshot = MemoryAccounting::TakeSnapshot();
+    const std::function<QString(std::size_t)> formatBytes = [](const std::size_t bytes) {
+        return QLocale::system().formattedDataSize(static_cast<qint64>(bytes));
+    };
+
+    model->clear();
+    model->setHorizontalHeaderLabels({"Subsystem / Key", "Live", "Peak"});
+    std::vector<MemoryAccounting::KeyUsage>::const_iterator key = snapshot.keys.cbegin();
+    for (std::size_t i = 0; i < MemoryAccounting::SUBSYSTEM_COUNT; i++) {
+        const MemoryAccounting::Subsystem subsystem = static_cast<MemoryAccounting::Subsystem>(i);
+        QStandardItem* const subsystemItem = new QStandardItem(MemoryAccounting::SubsystemName(subsystem));
+        // The keys are sorted by subsystem so each subsystem's keys are contiguous:
+        for (; key != snapshot.keys.cend() && key->subsystem == subsystem; key++) {
+            subsystemItem->appendRow({
+                new QStandardItem(QString::fromStdString(key->key)),
+                new QStandardItem(formatBytes(key->usage.live)),
+                new QStandardItem(formatBytes(key->usage.peak))
+            });
+        }
+        model->appendRow({
+            subsystemItem,
+            new QStandardItem(formatBytes(snapshot.subsystems[i].live)),
+            new QStandardItem(formatBytes(snapshot.subsystems[i].peak))
+        });
+    }
+}
+
+void MainWindow::OpenMemoryPanel() {
+    QTreeView* const listView = new QTreeView(this);
+    listView->setAttribute(Qt::WA_DeleteOnClose, true);
+    QStandardItemModel* itemModel = new QStandardItemModel(this);
+    this->PopulateMemoryPanel(itemModel);
+
+    listView->setModel(itemModel);
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Force readonly
+    QMdiSubWindow* const newWindow = this->AddSubWindow(listView);
+    newWindow->setWindowTitle("Memory usage"); // ReloadAll() (Shift+R) refreshes this.
+    newWindow->show();
+}
+
+void MainWindow::DumpMemoryReport() {
+    const QUrl dumpLocation = QFileDialog::getSaveFileUrl(this, "Memory Report Location", QUrl(), "JSON (*.json)");
+    if (dumpLocation.isEmpty()) {
+        return;
+    }
+
+    const MemoryAccounting::Snapshot snapshot = MemoryAccounting::TakeSnapshot();
+    QJsonObject reportJSON;
+    for (std::size_t i = 0; i < MemoryAccounting::SUBSYSTEM_COUNT; i++) {
+        const MemoryAccounting::Subsystem subsystem = static_cast<MemoryAccounting::Subsystem>(i);
+        QJsonObject subsystemObject;
+        subsystemObject["live"] = static_cast<qint64>(snapshot.subsystems[i].live);
+        subsystemObject["peak"] = static_cast<qint64>(snapshot.subsystems[i].peak);
+        QJsonArray keysArr;
+        for (const MemoryAccounting::KeyUsage& key : snapshot.keys) {
+            if (key.subsystem != subsystem) {
+                continue;
+            }
+            QJsonObject keyObject;
+            keyObject["key"] = QString::fromStdString(key.key);
+            keyObject["live"] = static_cast<qint64>(key.usage.live);
+            keyObject["peak"] = static_cast<qint64>(key.usage.peak);
+            keysArr.push_back(keyObject);
+        }
+        subsystemObject["keys"] = keysArr;
+        reportJSON[MemoryAccounting::SubsystemName(subsystem)] = subsystemObject;
+    }
+
+    QFile outputFile(dumpLocation.toLocalFile());
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Memory Report", "Unable to write the report to " + dumpLocation.toLocalFile());
+        return;
+    }
+    outputFile.write(QJsonDocument(reportJSON).toJson(QJsonDocument::Indented));
 }
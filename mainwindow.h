@@ -9,8 +9,17 @@
 #include "codeeditor.h"
 #include "project.h"
 #include "filenavigationtree.h"
-#include <QFileSystemModel>
+#include "fuzzyfinder.h"
+#include "navigationmodel.h"
+#include "projectio.h"
+#include "shortcutdispatcher.h"
+#include "symbolindex.h"
+#include "workspace.h"
 #include <QStandardItemModel>
+#include <QTimer>
+#include <QThread>
+#include <atomic>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -27,25 +36,85 @@ public:
 private:
     Ui::MainWindow *const ui;
     QMdiArea* const MDIArea;
-    std::unique_ptr<QFileSystemModel> codebaseModel;
+    std::unique_ptr<NavigationModel> codebaseModel;
     std::unique_ptr<FileNavigationTree> codebaseBrowseTree;
+    QMdiSubWindow* codebaseBrowseWindow = nullptr;
 
-    std::unordered_map<std::string, std::vector<std::unique_ptr<QAction>>> keyBindings;
+    ShortcutDispatcher shortcuts;
+    QTimer watchdogHeartbeat;
+    // Re-evaluates which editors are hidden once subwindows have finished moving around:
+    QTimer editorSuspensionCheck;
 
-    Project currentCodebase;
-    void SpawnCodeViewer(const std::string& filePath);
+    // Only one import/export runs at a time:
+    std::shared_ptr<ProjectIO::Job> activeJob;
+    QThread* activeJobThread = nullptr;
+    void RunProjectJob(const QString& title, const std::function<void(ProjectIO::Job&)>& work,
+                       const std::function<void()>& onSuccess);
+
+    // Each codebase's symbol index (kept by the workspace) is updated in the background whilst
+    // it's the current one, lookups are served from its last completed update:
+    std::shared_ptr<SymbolIndex> updatingSymbolIndex;
+    QThread* symbolIndexThread = nullptr;
+    bool symbolIndexStale = false; // Update (the current codebase's index) once the current update finishes.
+    void UpdateSymbolIndex();
+    // The project of the editor whose signal is being handled, the current one otherwise.
+    Project& EmittingProject() const;
+    void ShowSymbolLocations(Project& project, const QString& title, const std::vector<SymbolIndex::Location>& locations);
+    void OpenLocation(Project& project, const std::string& fileRef, std::size_t lineRef);
+
+    // Every file for the "go to file" palette, replaced whole once a fresh listing completes:
+    std::shared_ptr<FuzzyFinder> fileFinder;
+    std::shared_ptr<std::atomic<bool>> fileCatalogueCancelled;
+    QThread* fileCatalogueThread = nullptr;
+    bool fileCatalogueStale = false; // Relist once the current listing finishes.
+    // The listing also recounts every file's lines, for review coverage.
+    void UpdateFileCatalogue();
+    void UpdateLineCounts(const std::vector<std::string>& files, const std::vector<std::size_t>& lineCounts);
+
+    // Every codebase open, the current one being what's navigated (and imported into, exported,
+    // etc.). Editors and annotation lists carry on with whichever codebase they were opened for.
+    Workspace workspace;
+    Project* currentCodebase = nullptr;
+    void SetCurrentCodebase(Project& project);
+    CodeEditor* SpawnCodeViewer(Project& project, const std::string& fileRef);
     QMdiSubWindow* AddSubWindow(QWidget* const widget);
-    void AddBindings(QWidget* const widget);
+    void AddBindings();
 
-    std::string ToRelativePath(const std::string& fullPath) const;
-    std::string ToFullPath(const std::string& relPath) const;
+    void ReportProjectSize() const;
+    void ImportProjectAs(Config::VR_Specifications specification);
+    void ExportProjectAs(Config::VR_Specifications specification);
+    void PopulateMemoryPanel(QStandardItemModel* const model) const;
+    void PopulateBookmarksList(QStandardItemModel* const model) const;
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+private slots:
+    void SubWindowActivated(QMdiSubWindow* subWindow);
+    // Editors that can't be seen (minimised, or covered by the windows above them) and aren't
+    // among the most recently active are suspended, those that can be seen resumed.
+    void UpdateEditorSuspension();
 public slots:
     void ReloadAll();
+    void OpenCodebase();
+    void SwitchCodebase();
     void ImportProject();
     void ExportProject();
+    void ImportSnippet();
+    void ExportSnippet();
+    void ExportReport();
+    void MergeProjects();
     void OpenBookmarks();
     void OpenAnnotations();
     void OpenSelectedFile();
+    void DumpTrace();
+    void OpenStallReport();
+    void DumpStallReport();
+    void OpenMemoryPanel();
+    void DumpMemoryReport();
+    void FindDefinition(const QString& symbol);
+    void FindReferences(const QString& symbol);
+    void EditExcludes();
+    void OpenQuickOpen();
+    void NavigationCountsChanged(const QString& fileRef);
 };
 
 #endif // MAINWINDOW_H
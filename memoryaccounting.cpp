@@ -0,0 +1,146 @@
+#include "memoryaccounting.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+    struct SubsystemCounters {
+        std::atomic<std::size_t> live {0};
+        std::atomic<std::size_t> peak {0};
+    };
+    std::array<SubsystemCounters, MemoryAccounting::SUBSYSTEM_COUNT> subsystemCounters;
+
+    struct KeyCounters {
+        std::size_t live;
+        std::size_t peak;
+        std::size_t accounts; // The entry is dropped once no accounts reference it.
+    };
+    std::mutex keysMutex;
+    std::map<std::pair<MemoryAccounting::Subsystem, std::string>, KeyCounters> keyCounters;
+
+    void RaisePeak(std::atomic<std::size_t>& peak, const std::size_t live) {
+        std::size_t observedPeak = peak.load(std::memory_order_relaxed);
+        while (live > observedPeak &&
+               !peak.compare_exchange_weak(observedPeak, live, std::memory_order_relaxed)) {}
+    }
+}
+
+const char* MemoryAccounting::SubsystemName(const Subsystem subsystem) {
+    switch (subsystem) {
+        case COLLECTIONS: return "Collections";
+        case EDITORS: return "Editors";
+        case LIST_MODELS: return "List models";
+        case CACHES: return "Caches";
+        case DIAGNOSTICS: return "Diagnostics";
+        default:
+            throw std::runtime_error("Invalid subsystem");
+    }
+}
+
+void MemoryAccounting::Allocate(const Subsystem subsystem, const std::size_t bytes) {
+    SubsystemCounters& counters = subsystemCounters[subsystem];
+    const std::size_t live = counters.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    RaisePeak(counters.peak, live);
+}
+
+void MemoryAccounting::Release(const Subsystem subsystem, const std::size_t bytes) {
+    subsystemCounters[subsystem].live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryAccounting::Snapshot MemoryAccounting::TakeSnapshot() {
+    MemoryAccounting::Snapshot snapshot;
+    for (std::size_t i = 0; i < SUBSYSTEM_COUNT; i++) {
+        snapshot.subsystems[i] = MemoryAccounting::Usage {
+            .live = subsystemCounters[i].live.load(std::memory_order_relaxed),
+            .peak = subsystemCounters[i].peak.load(std::memory_order_relaxed)
+        };
+    }
+
+    {
+        const std::lock_guard<std::mutex> keysLock(keysMutex);
+        snapshot.keys.reserve(keyCounters.size());
+        for (const std::pair<const std::pair<MemoryAccounting::Subsystem, std::string>, KeyCounters>& key : keyCounters) {
+            snapshot.keys.push_back(MemoryAccounting::KeyUsage {
+                .subsystem = key.first.first,
+                .key = key.first.second,
+                .usage = { .live = key.second.live, .peak = key.second.peak }
+            });
+        }
+    }
+    std::sort(snapshot.keys.begin(), snapshot.keys.end(),
+        [](const MemoryAccounting::KeyUsage& a, const MemoryAccounting::KeyUsage& b) {
+            if (a.subsystem != b.subsystem) {
+                return a.subsystem < b.subsystem;
+            }
+            return a.usage.live > b.usage.live;
+        }
+    );
+    return snapshot;
+}
+
+MemoryAccounting::Account::Account(const Subsystem subsystem, const std::string& key) :
+    subsystem(subsystem), key(key), bytes(0) {
+    const std::lock_guard<std::mutex> keysLock(keysMutex);
+    KeyCounters& counters = keyCounters.try_emplace({subsystem, key}, KeyCounters{0, 0, 0}).first->second;
+    ++counters.accounts;
+}
+
+MemoryAccounting::Account::Account(const Account& other) : Account(other.subsystem, other.key) {
+    this->Set(other.bytes);
+}
+
+MemoryAccounting::Account& MemoryAccounting::Account::operator=(const Account& other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (this->subsystem != other.subsystem || this->key != other.key) {
+        this->Set(0);
+        {
+            const std::lock_guard<std::mutex> keysLock(keysMutex);
+            std::map<std::pair<Subsystem, std::string>, KeyCounters>::iterator previous =
+                keyCounters.find({this->subsystem, this->key});
+            if (previous != keyCounters.end() && --previous->second.accounts == 0) {
+                keyCounters.erase(previous);
+            }
+            ++keyCounters.try_emplace({other.subsystem, other.key}, KeyCounters{0, 0, 0}).first->second.accounts;
+        }
+        this->subsystem = other.subsystem;
+        this->key = other.key;
+    }
+    this->Set(other.bytes);
+    return *this;
+}
+
+MemoryAccounting::Account::~Account() {
+    this->Set(0);
+    const std::lock_guard<std::mutex> keysLock(keysMutex);
+    std::map<std::pair<Subsystem, std::string>, KeyCounters>::iterator counters =
+        keyCounters.find({this->subsystem, this->key});
+    if (counters != keyCounters.end() && --counters->second.accounts == 0) {
+        keyCounters.erase(counters);
+    }
+}
+
+void MemoryAccounting::Account::Set(const std::size_t bytes) {
+    if (bytes == this->bytes) {
+        return;
+    }
+    if (bytes > this->bytes) {
+        MemoryAccounting::Allocate(this->subsystem, bytes - this->bytes);
+    }
+    else {
+        MemoryAccounting::Release(this->subsystem, this->bytes - bytes);
+    }
+
+    const std::lock_guard<std::mutex> keysLock(keysMutex);
+    KeyCounters& counters = keyCounters[{this->subsystem, this->key}];
+    counters.live = counters.live + bytes - this->bytes;
+    counters.peak = std::max(counters.peak, counters.live);
+    this->bytes = bytes;
+}
+
+std::size_t MemoryAccounting::Account::Get() const {
+    return this->bytes;
+}
@@ -0,0 +1,110 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Live/peak byte counts per subsystem (and per file, or other key, within a subsystem) so
+// that caches can be sized and leaks spotted during long sessions. Containers that we own
+// outright can use CountingAllocator, everything else (Qt objects, the collections' public
+// std::vector types) reports an estimate of its footprint through an Account.
+
+namespace MemoryAccounting {
+    enum Subsystem {
+        COLLECTIONS, // Annotation/bookmark/review coverage storage.
+        EDITORS, // QTextDocuments behind open CodeEditors.
+        LIST_MODELS, // QStandardItemModels behind annotation/bookmark lists.
+        CACHES, // Cached file contents/indexes.
+        DIAGNOSTICS, // Tracing buffers and the like.
+        SUBSYSTEM_COUNT
+    };
+
+    struct Usage {
+        std::size_t live;
+        std::size_t peak;
+    };
+
+    struct KeyUsage {
+        Subsystem subsystem;
+        std::string key;
+        Usage usage;
+    };
+
+    struct Snapshot {
+        std::array<Usage, SUBSYSTEM_COUNT> subsystems;
+        std::vector<KeyUsage> keys; // Sorted by subsystem and then by live bytes (descending).
+    };
+
+    const char* SubsystemName(Subsystem subsystem);
+
+    // Bytes a string owns outside of itself (none whilst its characters are held in the
+    // small-string buffer inside the object, whatever size the library makes that buffer).
+    inline std::size_t StringHeapBytes(const std::string& str) {
+        const char* const object = reinterpret_cast<const char*>(&str);
+        const std::less<const char*> before;
+        const bool isInline = !before(str.data(), object) && before(str.data(), object + sizeof(std::string));
+        return isInline ? 0 : str.capacity() + 1;
+    }
+
+    void Allocate(Subsystem subsystem, std::size_t bytes);
+    void Release(Subsystem subsystem, std::size_t bytes);
+    Snapshot TakeSnapshot();
+
+    // A tracked amount of memory attributed to a key (i.e. a file path) in a subsystem.
+    // Copies report the same amount again (they're modelling copied data), and several
+    // accounts can share a key in which case their amounts are summed.
+    class Account {
+    public:
+        Account(Subsystem subsystem, const std::string& key);
+        Account(const Account& other);
+        Account& operator=(const Account& other);
+        ~Account();
+
+        void Set(std::size_t bytes);
+        std::size_t Get() const;
+    private:
+        Subsystem subsystem;
+        std::string key;
+        std::size_t bytes;
+    };
+
+    // Standard allocator that attributes everything it hands out to SUBSYSTEM.
+    template<typename T, Subsystem SUBSYSTEM>
+    struct CountingAllocator {
+        typedef T value_type;
+
+        CountingAllocator() noexcept {}
+        template<typename U>
+        CountingAllocator(const CountingAllocator<U, SUBSYSTEM>&) noexcept {}
+
+        template<typename U>
+        struct rebind {
+            typedef CountingAllocator<U, SUBSYSTEM> other;
+        };
+
+        T* allocate(const std::size_t count) {
+            T* const allocated = std::allocator<T>().allocate(count);
+            MemoryAccounting::Allocate(SUBSYSTEM, count * sizeof(T));
+            return allocated;
+        }
+
+        void deallocate(T* const pointer, const std::size_t count) noexcept {
+            MemoryAccounting::Release(SUBSYSTEM, count * sizeof(T));
+            std::allocator<T>().deallocate(pointer, count);
+        }
+    };
+
+    template<typename T, typename U, Subsystem SUBSYSTEM>
+    bool operator==(const CountingAllocator<T, SUBSYSTEM>&, const CountingAllocator<U, SUBSYSTEM>&) {
+        return true;
+    }
+    template<typename T, typename U, Subsystem SUBSYSTEM>
+    bool operator!=(const CountingAllocator<T, SUBSYSTEM>&, const CountingAllocator<U, SUBSYSTEM>&) {
+        return false;
+    }
+};
+
+#endif // MEMORYACCOUNTING_H
@@ -0,0 +1,338 @@
+#include "navigationmodel.h"
+#include <QFileIconProvider>
+#include <algorithm>
+#include "configuration.h"
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+NavigationModel::NavigationModel(const Project& project, QObject* const parent) :
+    QAbstractItemModel(parent), project(project), account(MemoryAccounting::LIST_MODELS, "navigation tree") {
+    this->Rescan();
+}
+
+NavigationModel::~NavigationModel() {
+    // Stop the worker before the tree goes (its batches would be dropped regardless):
+    this->scanner.reset();
+}
+
+void NavigationModel::Rescan() {
+    WATCHDOG_TRACE_SCOPE("NavigationModel::Rescan");
+    this->beginResetModel();
+    this->scanner.reset();
+    this->generation++;
+    this->directories.clear();
+    this->root = std::make_unique<Node>(Node {
+        .name = QString(),
+        .fileRef = "",
+        .isDirectory = true,
+        .parent = nullptr,
+        .row = 0,
+        .listing = LISTING,
+        .children = {}
+    });
+    this->directories[""] = this->root.get();
+    this->nodeBytes = 0;
+    this->endResetModel();
+    this->account.Set(0);
+
+    std::vector<std::string> excludePatterns = Config::Navigation::DefaultExcludes;
+    excludePatterns.insert(excludePatterns.end(), this->project.excludePatterns.cbegin(), this->project.excludePatterns.cend());
+    const std::size_t scanGeneration = this->generation;
+    this->scanner = std::make_unique<DirectoryScanner>(this->project.GetCodebasePath(), excludePatterns,
+        Config::Navigation::ScanBatchSize,
+        [this, scanGeneration](const std::string& directory, std::vector<DirectoryScanner::Entry> batch, const bool complete) {
+            // Hand the batch over to the GUI thread:
+            QMetaObject::invokeMethod(this, [this, scanGeneration, directory, batch = std::move(batch), complete]() {
+                this->ReceiveBatch(scanGeneration, directory, batch, complete);
+            }, Qt::QueuedConnection);
+        }
+    );
+    this->scanner->Request("");
+}
+
+void NavigationModel::ReceiveBatch(const std::size_t batchGeneration, const std::string& directory,
+                                   const std::vector<DirectoryScanner::Entry>& batch, const bool complete) {
+    if (batchGeneration != this->generation) {
+        return;
+    }
+    const std::unordered_map<std::string, Node*>::const_iterator directoryNode = this->directories.find(directory);
+    if (directoryNode == this->directories.cend()) {
+        return;
+    }
+    Node* const node = directoryNode->second;
+
+    if (!batch.empty()) {
+        std::vector<std::unique_ptr<Node>> newNodes;
+        newNodes.reserve(batch.size());
+        for (const DirectoryScanner::Entry& entry : batch) {
+            newNodes.push_back(std::make_unique<Node>(Node {
+                .name = QString::fromStdString(entry.name),
+                .fileRef = directory.empty() ? entry.name : directory + "/" + entry.name,
+                .isDirectory = entry.isDirectory,
+                .parent = node,
+                .row = 0,
+                .listing = UNLISTED,
+                .children = {}
+            }));
+            this->nodeBytes += sizeof(Node) + sizeof(std::unique_ptr<Node>) +
+                static_cast<std::size_t>(newNodes.back()->name.capacity()) * sizeof(QChar) +
+                MemoryAccounting::StringHeapBytes(newNodes.back()->fileRef);
+        }
+        std::stable_sort(newNodes.begin(), newNodes.end(), [this](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) {
+            return this->SortsBefore(a.get(), b.get());
+        });
+
+        const int firstRow = static_cast<int>(node->children.size());
+        this->beginInsertRows(this->IndexFor(node, NAME), firstRow, firstRow + static_cast<int>(newNodes.size()) - 1);
+        for (std::unique_ptr<Node>& newNode : newNodes) {
+            newNode->row = static_cast<int>(node->children.size());
+            node->children.push_back(std::move(newNode));
+        }
+        this->endInsertRows();
+    }
+
+    if (complete) {
+        node->listing = LISTED;
+        if (node->children.size() > batch.size()) {
+            // Each batch was only sorted amongst itself:
+            const QList<QPersistentModelIndex> parents = { QPersistentModelIndex(this->IndexFor(node, NAME)) };
+            emit this->layoutAboutToBeChanged(parents, QAbstractItemModel::VerticalSortHint);
+            this->SortChildren(node);
+            this->UpdatePersistentIndexes();
+            emit this->layoutChanged(parents, QAbstractItemModel::VerticalSortHint);
+        }
+        else if (node->children.empty() && node != this->root.get()) {
+            // So that the view drops the expander it showed whilst the directory was unlisted:
+            emit this->dataChanged(this->IndexFor(node, NAME), this->IndexFor(node, NAME));
+        }
+        this->account.Set(this->nodeBytes);
+    }
+}
+
+void NavigationModel::CountsChanged(const std::string& fileRef) {
+    const auto countsChanged = [this](const Node* const node) {
+        emit this->dataChanged(this->IndexFor(node, ANNOTATIONS), this->IndexFor(node, REVIEWED));
+    };
+    emit this->headerDataChanged(Qt::Horizontal, REVIEWED, REVIEWED);
+    for (std::size_t slash = fileRef.find('/'); slash != std::string::npos; slash = fileRef.find('/', slash + 1)) {
+        const std::unordered_map<std::string, Node*>::const_iterator directoryNode = this->directories.find(fileRef.substr(0, slash));
+        if (directoryNode != this->directories.cend()) {
+            countsChanged(directoryNode->second);
+        }
+    }
+
+    const std::size_t nameStart = fileRef.rfind('/');
+    const std::unordered_map<std::string, Node*>::const_iterator parentNode =
+        this->directories.find(nameStart == std::string::npos ? "" : fileRef.substr(0, nameStart));
+    if (parentNode == this->directories.cend()) {
+        return;
+    }
+    for (const std::unique_ptr<Node>& child : parentNode->second->children) {
+        if (child->fileRef == fileRef) {
+            countsChanged(child.get());
+            break;
+        }
+    }
+}
+
+void NavigationModel::AllCountsChanged() {
+    // Every node is the child of a listed directory:
+    for (const std::pair<const std::string, Node*>& directory : this->directories) {
+        if (!directory.second->children.empty()) {
+            emit this->dataChanged(this->IndexFor(directory.second->children.front().get(), ANNOTATIONS),
+                                   this->IndexFor(directory.second->children.back().get(), REVIEWED));
+        }
+    }
+    emit this->headerDataChanged(Qt::Horizontal, REVIEWED, REVIEWED);
+}
+
+std::string NavigationModel::FileRef(const QModelIndex& index) const {
+    return this->NodeFor(index)->fileRef;
+}
+
+bool NavigationModel::IsDirectory(const QModelIndex& index) const {
+    return this->NodeFor(index)->isDirectory;
+}
+
+NavigationModel::Node* NavigationModel::NodeFor(const QModelIndex& index) const {
+    return index.isValid() ? static_cast<Node*>(index.internalPointer()) : this->root.get();
+}
+
+QModelIndex NavigationModel::IndexFor(const Node* const node, const int column) const {
+    if (node == nullptr || node == this->root.get()) {
+        return QModelIndex();
+    }
+    return this->createIndex(node->row, column, const_cast<Node*>(node));
+}
+
+std::size_t NavigationModel::Count(const Node* const node, const int column) const {
+    switch (column) {
+        case ANNOTATIONS:
+            return this->project.annotations.CountUnder(node->fileRef);
+        case BOOKMARKS:
+            return this->project.bookmarks.CountUnder(node->fileRef);
+        case REVIEWED:
+            return this->project.coverage.ReviewedUnder(node->fileRef);
+        default:
+            return 0;
+    }
+}
+
+double NavigationModel::Coverage(const std::string& path) const {
+    const std::size_t lines = this->project.coverage.LinesUnder(path);
+    return lines == 0 ? -1.0 : static_cast<double>(this->project.coverage.ReviewedUnder(path)) / static_cast<double>(lines);
+}
+
+QModelIndex NavigationModel::index(const int row, const int column, const QModelIndex& parent) const {
+    if (!this->hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    return this->createIndex(row, column, this->NodeFor(parent)->children[static_cast<std::size_t>(row)].get());
+}
+
+QModelIndex NavigationModel::parent(const QModelIndex& index) const {
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+    return this->IndexFor(this->NodeFor(index)->parent, NAME);
+}
+
+int NavigationModel::rowCount(const QModelIndex& parent) const {
+    if (parent.column() > 0) {
+        return 0;
+    }
+    return static_cast<int>(this->NodeFor(parent)->children.size());
+}
+
+int NavigationModel::columnCount(const QModelIndex&) const {
+    return COLUMN_COUNT;
+}
+
+QVariant NavigationModel::data(const QModelIndex& index, const int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    const Node* const node = this->NodeFor(index);
+    switch (role) {
+        case Qt::DisplayRole: {
+            if (index.column() == NAME) {
+                return node->name;
+            }
+            if (index.column() == REVIEWED) {
+                const double coverage = this->Coverage(node->fileRef);
+                return coverage < 0 ? QVariant() : QVariant(QString::number(coverage * 100, 'f', 1) + '%');
+            }
+            const std::size_t count = this->Count(node, index.column());
+            return count == 0 ? QVariant() : QVariant(static_cast<qulonglong>(count));
+        }
+        case Qt::DecorationRole: {
+            if (index.column() != NAME) {
+                return QVariant();
+            }
+            const static QFileIconProvider iconProvider;
+            return iconProvider.icon(node->isDirectory ? QFileIconProvider::Folder : QFileIconProvider::File);
+        }
+        case Qt::TextAlignmentRole:
+            return index.column() == NAME ? QVariant() : QVariant(Qt::AlignRight | Qt::AlignVCenter);
+        case Qt::ToolTipRole:
+            return QString::fromStdString(node->fileRef);
+        default:
+            return QVariant();
+    }
+}
+
+QVariant NavigationModel::headerData(const int section, const Qt::Orientation orientation, const int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+        case NAME:
+            return "Name";
+        case ANNOTATIONS:
+            return "Annotations";
+        case BOOKMARKS:
+            return "Bookmarks";
+        case REVIEWED: {
+            const double coverage = this->Coverage("");
+            return coverage < 0 ? QString("Reviewed") : "Reviewed (" + QString::number(coverage * 100, 'f', 1) + "%)";
+        }
+        default:
+            return QVariant();
+    }
+}
+
+bool NavigationModel::hasChildren(const QModelIndex& parent) const {
+    if (parent.column() > 0) {
+        return false;
+    }
+    const Node* const node = this->NodeFor(parent);
+    // Unlisted directories are assumed to have something in them until they're expanded:
+    return node->isDirectory && (node->listing != LISTED || !node->children.empty());
+}
+
+bool NavigationModel::canFetchMore(const QModelIndex& parent) const {
+    const Node* const node = this->NodeFor(parent);
+    return node->isDirectory && node->listing == UNLISTED;
+}
+
+void NavigationModel::fetchMore(const QModelIndex& parent) {
+    Node* const node = this->NodeFor(parent);
+    if (!node->isDirectory || node->listing != UNLISTED) {
+        return;
+    }
+    node->listing = LISTING;
+    this->directories[node->fileRef] = node;
+    this->scanner->Request(node->fileRef);
+}
+
+bool NavigationModel::SortsBefore(const Node* const a, const Node* const b) const {
+    // Directories always come first:
+    if (a->isDirectory != b->isDirectory) {
+        return a->isDirectory;
+    }
+    int comparison = 0;
+    if (this->sortColumn == REVIEWED) {
+        const double aCoverage = this->Coverage(a->fileRef);
+        const double bCoverage = this->Coverage(b->fileRef);
+        comparison = aCoverage < bCoverage ? -1 : (aCoverage > bCoverage ? 1 : 0);
+    }
+    else if (this->sortColumn != NAME) {
+        const std::size_t aCount = this->Count(a, this->sortColumn);
+        const std::size_t bCount = this->Count(b, this->sortColumn);
+        comparison = aCount < bCount ? -1 : (aCount > bCount ? 1 : 0);
+    }
+    if (comparison == 0) {
+        comparison = a->name.compare(b->name, Qt::CaseInsensitive);
+    }
+    return this->sortOrder == Qt::AscendingOrder ? comparison < 0 : comparison > 0;
+}
+
+void NavigationModel::SortChildren(Node* const node) {
+    std::stable_sort(node->children.begin(), node->children.end(), [this](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) {
+        return this->SortsBefore(a.get(), b.get());
+    });
+    for (std::size_t row = 0; row < node->children.size(); row++) {
+        node->children[row]->row = static_cast<int>(row);
+    }
+}
+
+void NavigationModel::UpdatePersistentIndexes() {
+    // Nodes stay put when they're reordered, only their rows change:
+    const QModelIndexList persistentIndexes = this->persistentIndexList();
+    for (const QModelIndex& persistentIndex : persistentIndexes) {
+        this->changePersistentIndex(persistentIndex, this->IndexFor(this->NodeFor(persistentIndex), persistentIndex.column()));
+    }
+}
+
+void NavigationModel::sort(const int column, const Qt::SortOrder order) {
+    TRACE_SCOPE("NavigationModel::sort");
+    this->sortColumn = column;
+    this->sortOrder = order;
+
+    emit this->layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    for (const std::pair<const std::string, Node*>& directory : this->directories) {
+        this->SortChildren(directory.second);
+    }
+    this->UpdatePersistentIndexes();
+    emit this->layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
@@ -0,0 +1,96 @@
+#ifndef NAVIGATIONMODEL_H
+#define NAVIGATIONMODEL_H
+#include <QAbstractItemModel>
+#include <QObject>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "directoryscanner.h"
+#include "memoryaccounting.h"
+#include "project.h"
+
+// The codebase's file tree for FileNavigationTree. Directories are listed by a background
+// DirectoryScanner the first time they're expanded (honouring .gitignore files and the
+// project's exclude patterns) and fill in batch by batch. Alongside each file and directory
+// are the number of annotations and bookmarks within it and how much of it has been reviewed,
+// read from the collections' and ReviewCoverage's running per-path totals. The reviewed
+// column's header shows the whole codebase's coverage.
+
+class NavigationModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        NAME,
+        ANNOTATIONS,
+        BOOKMARKS,
+        REVIEWED,
+        COLUMN_COUNT
+    };
+
+    // 'project' must outlive the model.
+    NavigationModel(const Project& project, QObject* const parent = nullptr);
+    ~NavigationModel();
+
+    // Drops everything and lists the codebase again (i.e. after its exclude patterns change).
+    void Rescan();
+    // Re-reads the counts shown for 'fileRef' and the directories above it.
+    void CountsChanged(const std::string& fileRef);
+    // Re-reads every count shown (i.e. after the project has been replaced).
+    void AllCountsChanged();
+
+    std::string FileRef(const QModelIndex& index) const;
+    bool IsDirectory(const QModelIndex& index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& index) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+private:
+    enum ListingState {
+        UNLISTED,
+        LISTING,
+        LISTED
+    };
+
+    struct Node {
+        QString name;
+        std::string fileRef;
+        bool isDirectory;
+        Node* parent;
+        int row;
+        ListingState listing;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    const Project& project;
+    std::unique_ptr<Node> root;
+    std::unordered_map<std::string, Node*> directories; // Listed/listing directories by fileRef.
+    std::unique_ptr<DirectoryScanner> scanner;
+    std::size_t generation = 0; // Batches from before the last Rescan() are dropped.
+    std::size_t nodeBytes = 0;
+    int sortColumn = NAME;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    MemoryAccounting::Account account;
+
+    Node* NodeFor(const QModelIndex& index) const;
+    QModelIndex IndexFor(const Node* node, int column) const;
+    std::size_t Count(const Node* node, int column) const;
+    // Fraction of the lines under 'path' that have been reviewed, -1 if none are known.
+    double Coverage(const std::string& path) const;
+    void ReceiveBatch(std::size_t batchGeneration, const std::string& directory,
+                      const std::vector<DirectoryScanner::Entry>& batch, bool complete);
+    bool SortsBefore(const Node* a, const Node* b) const;
+    // Reorders 'node's children by the current sort, call between layout change signals.
+    void SortChildren(Node* node);
+    void UpdatePersistentIndexes();
+};
+
+#endif // NAVIGATIONMODEL_H
@@ -0,0 +1,278 @@
+#include "pagedfile.h"
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include "cachefile.h"
+#include "textkernels.h"
+#include "tracing.h"
+
+namespace {
+    // Only the scan's own read buffer, not retained.
+    const static std::size_t ScanChunkSize = 1 << 20;
+
+    const static std::uint32_t IndexMagic = 0x4E494C4B; // "KLIN"
+    const static std::uint32_t IndexVersion = 1;
+}
+
+PagedFile::PagedFile(const std::string& path, const bool backgroundIndex, const std::filesystem::path& indexCachePath,
+                     ContentCache* const pageCache) :
+    path(path), indexCachePath(indexCachePath), pageCache(pageCache), fileSize(0), fileModified(0), checkpoints {0}, scannedBytes(0),
+    scannedNewlines(0), indexComplete(false), pageStream(path, std::ios::binary), account(MemoryAccounting::CACHES, path) {
+
+    // A missing/unreadable file reads as a single empty line:
+    std::error_code sizeError, modifiedError;
+    const std::uintmax_t size = std::filesystem::file_size(path, sizeError);
+    this->fileSize = sizeError || !this->pageStream.is_open() ? 0 : static_cast<std::uint64_t>(size);
+    this->fileModified = static_cast<std::int64_t>(std::filesystem::last_write_time(path, modifiedError).time_since_epoch().count());
+    if (this->fileSize == 0) {
+        this->indexComplete = true;
+    }
+    else if (!this->LoadIndex() && backgroundIndex) {
+        this->indexer = std::thread([this]() {
+            Tracing::SetThreadName("PagedFile indexer");
+            TRACE_SCOPE_DETAIL("PagedFile::Index", this->path);
+            std::ifstream scanStream(this->path, std::ios::binary);
+            this->ExtendIndex(scanStream, std::numeric_limits<std::size_t>::max());
+            if (this->IsIndexComplete()) {
+                this->SaveIndex();
+            }
+        });
+    }
+    this->UpdateAccounting();
+}
+
+PagedFile::~PagedFile() {
+    this->stopIndexing = true;
+    if (this->indexer.joinable()) {
+        this->indexer.join();
+    }
+}
+
+void PagedFile::ExtendIndex(std::ifstream& stream, const std::size_t line) {
+    std::string chunk(ScanChunkSize, '\0');
+    std::vector<std::uint64_t> newCheckpoints;
+    while (!this->stopIndexing) {
+        std::uint64_t offset = 0;
+        std::size_t newlines = 0;
+        {
+            const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+            if (this->indexComplete || this->scannedNewlines >= line) {
+                return;
+            }
+            offset = this->scannedBytes;
+            newlines = this->scannedNewlines;
+        }
+
+        // Scan the next chunk without holding the lock:
+        stream.clear();
+        stream.seekg(static_cast<std::streamoff>(offset));
+        stream.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        const std::size_t chunkLength = static_cast<std::size_t>(stream.gcount());
+        newCheckpoints.clear();
+        const char* position = chunk.data();
+        const char* const end = chunk.data() + chunkLength;
+        for (;;) {
+            // Skip straight to the newline ending the last line before the next checkpoint:
+            const std::size_t untilCheckpoint = PagedFile::IndexStride - newlines % PagedFile::IndexStride;
+            std::size_t found = 0;
+            const char* const newline = TextKernels::FindNthByte(position, end, '\n', untilCheckpoint, found);
+            newlines += found;
+            if (newline == nullptr) {
+                break;
+            }
+            position = newline + 1;
+            newCheckpoints.push_back(offset + static_cast<std::uint64_t>(position - chunk.data()));
+        }
+
+        // Only publish it if nobody else (the scanner or a reader) got there first:
+        const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+        if (this->scannedBytes != offset) {
+            continue;
+        }
+        this->checkpoints.insert(this->checkpoints.end(), newCheckpoints.cbegin(), newCheckpoints.cend());
+        this->scannedBytes = offset + chunkLength;
+        this->scannedNewlines = newlines;
+        if (chunkLength == 0 || this->scannedBytes >= this->fileSize) {
+            this->indexComplete = true;
+        }
+    }
+}
+
+bool PagedFile::LoadIndex() {
+    if (this->indexCachePath.empty()) {
+        return false;
+    }
+    TRACE_SCOPE_DETAIL("PagedFile::LoadIndex", this->path);
+    CacheFile::Reader indexFile(this->indexCachePath, IndexMagic, IndexVersion);
+    std::uint64_t size = 0, newlines = 0;
+    std::int64_t modified = 0;
+    std::vector<std::uint64_t> savedCheckpoints;
+    if (!indexFile.Read(size) || !indexFile.Read(modified) || !indexFile.Read(newlines) || !indexFile.ReadVector(savedCheckpoints) ||
+        size != this->fileSize || modified != this->fileModified ||
+        savedCheckpoints.size() != newlines / PagedFile::IndexStride + 1 || savedCheckpoints.front() != 0) {
+        return false; // Changed since (or never saved), it's rescanned.
+    }
+
+    const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+    this->checkpoints = std::move(savedCheckpoints);
+    this->scannedBytes = this->fileSize;
+    this->scannedNewlines = static_cast<std::size_t>(newlines);
+    this->indexComplete = true;
+    return true;
+}
+
+void PagedFile::SaveIndex() const {
+    if (this->indexCachePath.empty()) {
+        return;
+    }
+    TRACE_SCOPE_DETAIL("PagedFile::SaveIndex", this->path);
+    CacheFile::Writer indexFile(this->indexCachePath, IndexMagic, IndexVersion);
+    {
+        const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+        indexFile.Write(this->fileSize);
+        indexFile.Write(this->fileModified);
+        indexFile.Write(static_cast<std::uint64_t>(this->scannedNewlines));
+        indexFile.WriteVector(this->checkpoints);
+    }
+    indexFile.Commit();
+}
+
+bool PagedFile::HasLine(const std::size_t line) {
+    if (line < this->KnownLineCount()) {
+        return true;
+    }
+    // Scanning here would hold up the reader for as long as the scan takes in a large file, so
+    // that's left to the background scan if there is one:
+    if (this->IsIndexComplete() || this->indexer.joinable()) {
+        return false;
+    }
+
+    TRACE_SCOPE_DETAIL("PagedFile::HasLine", this->path);
+    std::ifstream scanStream(this->path, std::ios::binary);
+    this->ExtendIndex(scanStream, line);
+    return line < this->KnownLineCount();
+}
+
+std::vector<std::string> PagedFile::ReadLines(const std::size_t firstLine, const std::size_t count) {
+    std::vector<std::string> lines;
+    if (count == 0 || !this->HasLine(firstLine)) {
+        return lines;
+    }
+
+    std::uint64_t offset = 0;
+    {
+        const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+        offset = this->checkpoints[firstLine / PagedFile::IndexStride];
+    }
+    std::size_t linesToSkip = firstLine % PagedFile::IndexStride;
+
+    std::string currentLine;
+    const auto finishLine = [&lines, &currentLine]() {
+        if (!currentLine.empty() && currentLine.back() == '\r') {
+            currentLine.pop_back();
+        }
+        lines.push_back(std::move(currentLine));
+        currentLine.clear();
+    };
+    while (offset < this->fileSize) {
+        const std::shared_ptr<const std::string> page = this->GetPage(offset / PagedFile::PageSize);
+        const char* const pageData = page->data();
+        std::size_t position = static_cast<std::size_t>(offset % PagedFile::PageSize);
+        if (position >= page->size()) {
+            break; // The file shrank underneath us.
+        }
+        if (linesToSkip > 0) {
+            std::size_t found = 0;
+            const char* const newline = TextKernels::FindNthByte(pageData + position, pageData + page->size(), '\n', linesToSkip, found);
+            linesToSkip -= found;
+            position = newline != nullptr ? static_cast<std::size_t>(newline - pageData) + 1 : page->size();
+        }
+        while (linesToSkip == 0 && position < page->size()) {
+            const char* const newline = static_cast<const char*>(std::memchr(pageData + position, '\n', page->size() - position));
+            const std::size_t end = newline != nullptr ? static_cast<std::size_t>(newline - pageData) : page->size();
+            if (currentLine.size() < PagedFile::MaxLineLength) {
+                currentLine.append(pageData + position, std::min(end - position, PagedFile::MaxLineLength - currentLine.size()));
+            }
+            position = end + (newline != nullptr ? 1 : 0);
+            if (newline == nullptr) {
+                break;
+            }
+            finishLine();
+            if (lines.size() == count) {
+                return lines;
+            }
+        }
+        offset = (offset / PagedFile::PageSize) * PagedFile::PageSize + page->size();
+    }
+    // The last line doesn't have a terminator:
+    if (linesToSkip == 0) {
+        finishLine();
+    }
+    return lines;
+}
+
+bool PagedFile::IsIndexComplete() const {
+    const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+    return this->indexComplete;
+}
+
+std::size_t PagedFile::KnownLineCount() const {
+    const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+    return this->scannedNewlines + 1;
+}
+
+std::uint64_t PagedFile::Size() const {
+    return this->fileSize;
+}
+
+std::int64_t PagedFile::ModifiedTime() const {
+    return this->fileModified;
+}
+
+std::shared_ptr<const std::string> PagedFile::GetPage(const std::uint64_t pageIndex) {
+    // Shared pages are only reused whilst the file's size and modification time are unchanged:
+    const std::string cacheKey = this->pageCache == nullptr ? std::string() :
+        "page:" + this->path + '\n' + std::to_string(this->fileSize) + '\n' + std::to_string(this->fileModified) + '\n' +
+        std::to_string(pageIndex);
+    if (this->pageCache != nullptr) {
+        const std::shared_ptr<const std::string> cachedPage = this->pageCache->Get<std::string>(cacheKey);
+        if (cachedPage) {
+            return cachedPage;
+        }
+    }
+    for (std::list<std::pair<std::uint64_t, std::shared_ptr<const std::string>>>::iterator cachedPage = this->pages.begin();
+         cachedPage != this->pages.end(); ++cachedPage) {
+        if (cachedPage->first == pageIndex) {
+            this->pages.splice(this->pages.begin(), this->pages, cachedPage);
+            return this->pages.front().second;
+        }
+    }
+
+    TRACE_SCOPE_DETAIL("PagedFile::GetPage", this->path);
+    std::string page(PagedFile::PageSize, '\0');
+    this->pageStream.clear();
+    this->pageStream.seekg(static_cast<std::streamoff>(pageIndex * PagedFile::PageSize));
+    this->pageStream.read(page.data(), static_cast<std::streamsize>(page.size()));
+    page.resize(static_cast<std::size_t>(this->pageStream.gcount()));
+
+    if (this->pageCache != nullptr) {
+        const std::shared_ptr<const std::string> loadedPage = std::make_shared<const std::string>(std::move(page));
+        this->pageCache->Put(cacheKey, loadedPage, loadedPage->capacity());
+        return loadedPage;
+    }
+    this->pages.emplace_front(pageIndex, std::make_shared<const std::string>(std::move(page)));
+    if (this->pages.size() > PagedFile::MaxResidentPages) {
+        this->pages.pop_back();
+    }
+    this->UpdateAccounting();
+    return this->pages.front().second;
+}
+
+void PagedFile::UpdateAccounting() {
+    std::size_t indexBytes = 0;
+    {
+        const std::lock_guard<std::mutex> indexLock(this->indexMutex);
+        indexBytes = this->checkpoints.capacity() * sizeof(std::uint64_t);
+    }
+    this->account.Set(this->pages.size() * PagedFile::PageSize + indexBytes);
+}
@@ -0,0 +1,85 @@
+#ifndef PAGEDFILE_H
+#define PAGEDFILE_H
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "contentcache.h"
+#include "memoryaccounting.h"
+
+// Line-oriented access to a file of any size without reading it all in. The file is read in
+// fixed-size pages (of which only a handful are kept resident) and located through a sparse
+// index recording where every IndexStride'th line starts.
+//
+// The index is built by a background scan, lines can be read whilst it's still running as far
+// as it's got (see KnownLineCount()), never waiting on it. Without a background scan lookups
+// past the end of what's been indexed extend it themselves, on the reading thread. Reading is
+// meant for a single thread (e.g. the GUI's), the index may be shared with the scanner.
+// Given somewhere to cache it, a completed index is saved for the next session and restored
+// instead of rescanning for as long as the file's size and modification time are unchanged.
+// Pages are kept in a shared ContentCache if given one (and so held to its budget, alongside
+// those of every other file), otherwise the most recent MaxResidentPages are kept per file.
+
+class PagedFile {
+public:
+    const static std::size_t PageSize = 1 << 20;
+    const static std::size_t MaxResidentPages = 16;
+    const static std::size_t IndexStride = 1024; // Lines between recorded offsets.
+    const static std::size_t MaxLineLength = 1 << 16; // Longer lines are truncated when read.
+
+    explicit PagedFile(const std::string& path, bool backgroundIndex = true,
+                       const std::filesystem::path& indexCachePath = std::filesystem::path(),
+                       ContentCache* pageCache = nullptr);
+    ~PagedFile();
+    PagedFile(const PagedFile&) = delete;
+    PagedFile& operator=(const PagedFile&) = delete;
+
+    // Up to 'count' lines from 'firstLine' onwards (fewer at the end of the file) without their
+    // line terminators. Lines are counted like QString::split('\n'), so a trailing newline ends
+    // with an empty line. Nothing if 'firstLine' isn't known to exist (see HasLine()).
+    std::vector<std::string> ReadLines(std::size_t firstLine, std::size_t count);
+    // Whether 'line' is known to exist. With a background scan, only as far as it's got without
+    // waiting for it (false until then, so check IsIndexComplete()), otherwise having indexed
+    // up to 'line' first.
+    bool HasLine(std::size_t line);
+
+    bool IsIndexComplete() const;
+    // The number of lines once the index is complete, a lower bound before then.
+    std::size_t KnownLineCount() const;
+    std::uint64_t Size() const;
+    // As of when the file was opened, in the filesystem clock's ticks.
+    std::int64_t ModifiedTime() const;
+private:
+    const std::string path;
+    const std::filesystem::path indexCachePath;
+    ContentCache* const pageCache;
+    std::uint64_t fileSize;
+    std::int64_t fileModified;
+
+    mutable std::mutex indexMutex;
+    std::vector<std::uint64_t> checkpoints; // checkpoints[i] is the offset of line (i * IndexStride).
+    std::uint64_t scannedBytes;
+    std::size_t scannedNewlines;
+    bool indexComplete;
+    std::atomic<bool> stopIndexing {false};
+    std::thread indexer;
+
+    std::ifstream pageStream;
+    std::list<std::pair<std::uint64_t, std::shared_ptr<const std::string>>> pages; // Most recently used first, without a pageCache.
+    MemoryAccounting::Account account;
+
+    // Scans (with 'stream') until 'line' has been indexed or the file ends.
+    void ExtendIndex(std::ifstream& stream, std::size_t line);
+    bool LoadIndex();
+    void SaveIndex() const;
+    std::shared_ptr<const std::string> GetPage(std::uint64_t pageIndex);
+    void UpdateAccounting();
+};
+
+#endif // PAGEDFILE_H
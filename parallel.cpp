@@ -0,0 +1,152 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tracing.h"
+
+namespace {
+    // One call to For(): indexes are handed out from 'nextIndex' to whichever threads join in.
+    struct Batch {
+        std::size_t count;
+        const std::function<void(std::size_t)>* work;
+        std::atomic<std::size_t> nextIndex {0};
+        std::size_t finished = 0; // Indexes run (or abandoned after a failure), under 'mutex'.
+        std::mutex mutex;
+        std::condition_variable allFinished;
+        std::exception_ptr failure;
+
+        bool HasWork() const {
+            return this->nextIndex.load(std::memory_order_relaxed) < this->count;
+        }
+
+        // Runs indexes until there are none left to hand out.
+        void Run() {
+            for (std::size_t i = this->nextIndex++; i < this->count; i = this->nextIndex++) {
+                std::size_t done = 1;
+                std::exception_ptr thrown;
+                try {
+                    (*this->work)(i);
+                } catch (...) {
+                    thrown = std::current_exception();
+                    // Stop handing out work, whatever's not been handed out yet counts as done:
+                    const std::size_t unclaimed = this->nextIndex.exchange(this->count);
+                    done += unclaimed < this->count ? this->count - unclaimed : 0;
+                }
+                const std::lock_guard<std::mutex> batchLock(this->mutex);
+                if (thrown && !this->failure) {
+                    this->failure = thrown;
+                }
+                this->finished += done;
+                if (this->finished == this->count) {
+                    this->allFinished.notify_all();
+                }
+            }
+        }
+    };
+
+    // Every call to For() (from any thread, for any project) shares these WorkerCount() - 1
+    // workers, so concurrent calls don't each spawn their own. The calling thread always works
+    // through its own batch too, which keeps nested calls from waiting on workers that are
+    // themselves waiting, but means that with several callers at once each of them is busy
+    // alongside the workers.
+    class Pool {
+    public:
+        Pool() {
+            for (std::size_t i = 1; i < Parallel::WorkerCount(); i++) {
+                this->workers.emplace_back([this]() {
+                    Tracing::SetThreadName("Parallel worker");
+                    this->WorkerLoop();
+                });
+            }
+        }
+
+        ~Pool() {
+            {
+                const std::lock_guard<std::mutex> poolLock(this->mutex);
+                this->stopping = true;
+            }
+            this->workAvailable.notify_all();
+            for (std::thread& worker : this->workers) {
+                worker.join();
+            }
+        }
+
+        void Submit(const std::shared_ptr<Batch>& batch) {
+            if (this->workers.empty()) {
+                return;
+            }
+            {
+                const std::lock_guard<std::mutex> poolLock(this->mutex);
+                this->batches.push_back(batch);
+            }
+            this->workAvailable.notify_all();
+        }
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::deque<std::shared_ptr<Batch>> batches; // Oldest first, dropped once all handed out.
+        bool stopping = false;
+
+        void WorkerLoop() {
+            for (;;) {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> poolLock(this->mutex);
+                    this->workAvailable.wait(poolLock, [this, &batch]() {
+                        while (!this->batches.empty() && !this->batches.front()->HasWork()) {
+                            this->batches.pop_front();
+                        }
+                        if (!this->batches.empty()) {
+                            batch = this->batches.front();
+                        }
+                        return this->stopping || batch;
+                    });
+                    if (this->stopping) {
+                        return;
+                    }
+                }
+                batch->Run();
+            }
+        }
+    };
+
+    Pool& SharedPool() {
+        static Pool pool;
+        return pool;
+    }
+}
+
+std::size_t Parallel::WorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void Parallel::For(const std::size_t count, const std::function<void(std::size_t)>& work) {
+    if (count <= 1 || Parallel::WorkerCount() <= 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            work(i);
+        }
+        return;
+    }
+
+    const std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->work = &work;
+    SharedPool().Submit(batch);
+    batch->Run(); // The calling thread does its share too.
+
+    // Then waits for anything still running elsewhere:
+    std::unique_lock<std::mutex> batchLock(batch->mutex);
+    batch->allFinished.wait(batchLock, [&batch]() {
+        return batch->finished == batch->count;
+    });
+    if (batch->failure) {
+        std::rethrow_exception(batch->failure);
+    }
+}
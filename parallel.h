@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <cstddef>
+#include <functional>
+
+namespace Parallel {
+    // Calls 'work(i)' for every i in [0, count) spread across all cores and returns once
+    // they've all finished. The first exception thrown by 'work' is rethrown here. Calls from
+    // any thread (and nested calls) share one pool of WorkerCount() - 1 workers, the caller
+    // making up the last.
+    void For(std::size_t count, const std::function<void(std::size_t)>& work);
+
+    std::size_t WorkerCount();
+};
+
+#endif // PARALLEL_H
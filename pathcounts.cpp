@@ -0,0 +1,34 @@
+#include "pathcounts.h"
+
+void PathCounts::Add(const std::string& fileRef, const std::size_t count) {
+    this->counts[""] += count;
+    for (std::size_t slash = fileRef.find('/'); slash != std::string::npos; slash = fileRef.find('/', slash + 1)) {
+        this->counts[fileRef.substr(0, slash)] += count;
+    }
+    this->counts[fileRef] += count;
+}
+
+void PathCounts::Remove(const std::string& fileRef, const std::size_t count) {
+    const auto decrement = [this, count](const std::string& path) {
+        const std::unordered_map<std::string, std::size_t>::iterator pathCount = this->counts.find(path);
+        if (pathCount == this->counts.end()) {
+            return;
+        }
+        if (pathCount->second <= count) {
+            this->counts.erase(pathCount);
+        }
+        else {
+            pathCount->second -= count;
+        }
+    };
+    decrement("");
+    for (std::size_t slash = fileRef.find('/'); slash != std::string::npos; slash = fileRef.find('/', slash + 1)) {
+        decrement(fileRef.substr(0, slash));
+    }
+    decrement(fileRef);
+}
+
+std::size_t PathCounts::Get(const std::string& path) const {
+    const std::unordered_map<std::string, std::size_t>::const_iterator pathCount = this->counts.find(path);
+    return pathCount == this->counts.cend() ? 0 : pathCount->second;
+}
@@ -0,0 +1,20 @@
+#ifndef PATHCOUNTS_H
+#define PATHCOUNTS_H
+#include <string>
+#include <unordered_map>
+
+// How many items (annotations, bookmarks, ...) each file holds and, cumulatively, each
+// directory above it. Kept up to date as items come and go so that per-directory totals
+// never need a walk over the whole collection.
+
+class PathCounts {
+public:
+    void Add(const std::string& fileRef, std::size_t count = 1);
+    void Remove(const std::string& fileRef, std::size_t count = 1);
+    // Items in the file/directory 'path' (relative to the codebase, "" for all of it).
+    std::size_t Get(const std::string& path) const;
+private:
+    std::unordered_map<std::string, std::size_t> counts;
+};
+
+#endif // PATHCOUNTS_H
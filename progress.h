@@ -0,0 +1,14 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+#include <functional>
+#include <stdexcept>
+
+// Reports how far through a long-running operation (i.e. loading a project) it is, returning
+// false asks for the operation to be abandoned - in which case it throws OperationCancelled.
+typedef std::function<bool(std::size_t completed, std::size_t total)> ProgressCallback;
+
+struct OperationCancelled : public std::runtime_error {
+    OperationCancelled() : std::runtime_error("Operation cancelled") {}
+};
+
+#endif // PROGRESS_H
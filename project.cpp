@@ -1,17 +1,9 @@
-#include <QJsonArray>
+#include <QStandardPaths>
 #include "project.h"
+#include "cachefile.h"
 
-Project::Project(const std::filesystem::path& codebasePath) : codebasePath(codebasePath.string()) {
-    if (!std::filesystem::exists(codebasePath)) {
-        throw std::runtime_error("Invalid codebase path passed to Project::Project (constructor).");
-    }
-}
-
-Project::Project(const std::filesystem::path& basePath, const QJsonObject& projectJSON,
-                 Config::VR_Specifications specification) :
-        codebasePath(basePath), annotations(projectJSON, specification),
-        bookmarks(projectJSON, specification) {
-
+Project::Project(const std::filesystem::path& codebasePath) :
+    codebasePath(codebasePath.string()), attachments(std::make_shared<AttachmentStore>()) {
     if (!std::filesystem::exists(codebasePath)) {
         throw std::runtime_error("Invalid codebase path passed to Project::Project (constructor).");
     }
@@ -21,37 +13,38 @@ std::string Project::GetCodebasePath() const {
     return this->codebasePath;
 }
 
-QJsonObject Project::SerializeToJSON(const Config::VR_Specifications& specification) const {
-    QJsonObject result;
-
-    switch (specification) {
-        case Config::VR_Specifications::BLOCKS: {
-#define STRINGIFY(VAL) #VAL
-#define INSERT_COMPONENTS(NAME, CAPITALIZED_NAME) \
-            const std::unordered_map<std::string, std::vector<CAPITALIZED_NAME>> NAME##Map = this->NAME.GetRaw##CAPITALIZED_NAME##s(); \
-            QJsonObject NAME##Json; \
-            for (const std::pair<std::string, std::vector<CAPITALIZED_NAME>>& specificFile : NAME##Map) { \
-                QJsonObject fileObject; \
-                fileObject["file"] = specificFile.first.c_str(); \
-                QJsonArray NAME##Array; \
-                for (const CAPITALIZED_NAME& iterative##CAPITALIZED_NAME : specificFile.second) { \
-                    QJsonObject NAME##Object = iterative##CAPITALIZED_NAME.SerializeToJSON(specification); \
-                    NAME##Array.push_front(NAME##Object); \
-                } \
-                fileObject[STRINGIFY(NAME)] = NAME##Array; \
-                NAME##Json[specificFile.first.c_str()] = fileObject; \
-            } \
-            result[STRINGIFY(NAME)] = NAME##Json;
+std::filesystem::path Project::GetLineIndexCachePath(const std::filesystem::path& cacheDirectory, const std::string& fileRef,
+                                                     const std::string& path) {
+    std::error_code sizeError;
+    const std::uintmax_t size = std::filesystem::file_size(path, sizeError);
+    return sizeError || size <= Config::Paging::CachedIndexFileSize ? std::filesystem::path() :
+        cacheDirectory / "lines" / (CacheFile::HashName(fileRef) + ".idx");
+}
 
-            INSERT_COMPONENTS(annotations, Annotation)
-            INSERT_COMPONENTS(bookmarks, Bookmark)
-#undef INSERT_COMPONENTS
+std::filesystem::path Project::GetCacheDirectory() const {
+    // Keyed by a hash of the codebase's path:
+    const std::filesystem::path cacheDirectory =
+        std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "codebases" /
+        CacheFile::HashName(this->codebasePath);
+    std::error_code directoryError;
+    std::filesystem::create_directories(cacheDirectory, directoryError);
+    return cacheDirectory;
+}
 
-            break;
+Project::Snapshot Project::GetSnapshot() const {
+    // Coverage is kept for every file (for the line counts), only the reviewed ones are saved:
+    const std::shared_ptr<ReviewCoverage::Files> reviewedFiles = std::make_shared<ReviewCoverage::Files>();
+    for (const std::pair<const std::string, ReviewCoverage::File>& file : this->coverage.GetFiles()) {
+        if (!file.second.reviewed.Empty()) {
+            reviewedFiles->insert(file);
         }
-    default:
-        throw std::runtime_error("Unsupported serialization specification");
     }
-
-    return result;
+    return {
+        .codebasePath = this->codebasePath,
+        .excludePatterns = this->excludePatterns,
+        .annotations = this->annotations.GetSnapshot(),
+        .bookmarks = this->bookmarks.GetSnapshot(),
+        .coverage = reviewedFiles,
+        .attachments = this->attachments
+    };
 }
@@ -2,21 +2,46 @@
 #define PROJECT_H
 #include "bookmark.h"
 #include "annotation.h"
+#include "attachmentstore.h"
 #include "configuration.h"
-#include <QJsonObject>
+#include "progress.h"
+#include "reviewcoverage.h"
 #include <filesystem>
 
 class Project {
     std::string codebasePath;
 public:
+    // Everything saved with a project, frozen as of GetSnapshot(). Cheap to take (the annotations
+    // and bookmarks are shared, not copied) and safe to read on any thread, e.g. for exporting
+    // whilst editing carries on.
+    struct Snapshot {
+        std::string codebasePath;
+        std::vector<std::string> excludePatterns;
+        std::shared_ptr<const AnnotationCollection::Snapshot> annotations;
+        std::shared_ptr<const BookmarkCollection::Snapshot> bookmarks;
+        std::shared_ptr<const ReviewCoverage::Files> coverage; // Just the files with lines reviewed.
+        std::shared_ptr<const AttachmentStore> attachments;
+    };
+
+    // Saved projects are read (and written) by ProjectSerializer.
     Project(const std::filesystem::path& codebasePath);
-    Project(const std::filesystem::path& codebasePath, const QJsonObject& projectJSON,
-            Config::VR_Specifications specification);
 
     AnnotationCollection annotations;
     BookmarkCollection bookmarks;
+    // Paths hidden from navigation (.gitignore syntax, relative to the codebase), on top of the
+    // codebase's own .gitignore files.
+    std::vector<std::string> excludePatterns;
+    ReviewCoverage coverage;
+    // What the annotations' attachments refer to, shared by copies of the project.
+    std::shared_ptr<AttachmentStore> attachments;
     std::string GetCodebasePath() const;
-    QJsonObject SerializeToJSON(const Config::VR_Specifications& specification) const;
+    // Per-codebase directory (outside of the codebase) for indexes and other derived data.
+    std::filesystem::path GetCacheDirectory() const;
+    // Where 'fileRef' (at 'path') keeps its line index within 'cacheDirectory', empty if it's
+    // small enough to just rescan. Safe from any thread.
+    static std::filesystem::path GetLineIndexCachePath(const std::filesystem::path& cacheDirectory, const std::string& fileRef,
+                                                       const std::string& path);
+    Snapshot GetSnapshot() const;
 private:
 };
 
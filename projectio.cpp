@@ -0,0 +1,171 @@
+#include "projectio.h"
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <limits>
+#include "projectserializer.h"
+#include "tracing.h"
+
+namespace {
+    // Large enough to keep the read/write loops cheap, small enough to report progress/cancel promptly.
+    const static qint64 IOChunkSize = 4 * 1024 * 1024;
+
+    // The whole of the file at 'path', as the first 30% of loading it.
+    QByteArray ReadFile(const QString& path, ProjectIO::Job& job) {
+        job.SetStage("Reading");
+        QFile inputFile(path);
+        if (!inputFile.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error("Unable to open " + path.toStdString());
+        }
+        const qint64 fileSize = inputFile.size();
+        if (fileSize > std::numeric_limits<qsizetype>::max()) {
+            throw std::runtime_error(path.toStdString() + " is too large to load (" + std::to_string(fileSize) + " bytes)");
+        }
+        QByteArray fileBytes;
+        fileBytes.reserve(static_cast<qsizetype>(fileSize));
+        while (!inputFile.atEnd()) {
+            fileBytes.append(inputFile.read(IOChunkSize));
+            if (!job.ReportProgress(static_cast<std::size_t>(fileBytes.size()), static_cast<std::size_t>(fileSize), 0, 30)) {
+                throw OperationCancelled();
+            }
+        }
+        inputFile.close();
+        return fileBytes;
+    }
+
+    // Parses and builds the project read from 'path', as the rest (30-100%) of loading it.
+    std::unique_ptr<Project> BuildProject(const QByteArray& fileBytes, const QString& path, const std::string& codebasePath,
+                                          const Config::VR_Specifications specification, ProjectIO::Job& job) {
+        job.SetStage("Parsing");
+        std::unique_ptr<Project> project = ProjectSerializer::Read(fileBytes.constData(), static_cast<std::size_t>(fileBytes.size()),
+            codebasePath, specification,
+            [&job](const std::size_t completed, const std::size_t total) {
+                return job.ReportProgress(completed, total, 30, 100);
+            }
+        );
+        // Attachments are left where they are until they're opened:
+        if (specification != Config::VR_Specifications::SNIPPET) {
+            project->attachments->AddDirectory(AttachmentStore::DirectoryFor(path.toStdString()));
+        }
+        return project;
+    }
+}
+
+bool ProjectIO::Job::ReportProgress(const std::size_t completed, const std::size_t total,
+                                    const int fromPercent, const int toPercent) {
+    const int percent = total == 0 ? toPercent :
+        fromPercent + static_cast<int>(static_cast<double>(completed) / static_cast<double>(total) * (toPercent - fromPercent));
+    this->progressPercent.store(percent, std::memory_order_relaxed);
+    return !this->IsCancelled();
+}
+
+void ProjectIO::Job::SetStage(const std::string& stage) {
+    const std::lock_guard<std::mutex> stageLock(this->stageMutex);
+    this->stage = stage;
+}
+
+int ProjectIO::Job::GetProgress() const {
+    return this->progressPercent.load(std::memory_order_relaxed);
+}
+
+std::string ProjectIO::Job::GetStage() const {
+    const std::lock_guard<std::mutex> stageLock(this->stageMutex);
+    return this->stage;
+}
+
+void ProjectIO::Job::Cancel() {
+    this->cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool ProjectIO::Job::IsCancelled() const {
+    return this->cancelled.load(std::memory_order_relaxed);
+}
+
+void ProjectIO::Job::ThrowIfCancelled() const {
+    if (this->IsCancelled()) {
+        throw OperationCancelled();
+    }
+}
+
+std::unique_ptr<Project> ProjectIO::Load(const QString& path, const std::string& codebasePath,
+                                         const Config::VR_Specifications specification, Job& job) {
+    TRACE_SCOPE_DETAIL("ProjectIO::Load", path.toStdString());
+    return BuildProject(ReadFile(path, job), path, codebasePath, specification, job);
+}
+
+std::unique_ptr<Project> ProjectIO::Load(const QString& path, const std::string& codebasePath, Job& job) {
+    TRACE_SCOPE_DETAIL("ProjectIO::Load", path.toStdString());
+    const QByteArray fileBytes = ReadFile(path, job);
+    const Config::VR_Specifications specification =
+        ProjectSerializer::Detect(fileBytes.constData(), static_cast<std::size_t>(fileBytes.size()));
+    return BuildProject(fileBytes, path, codebasePath, specification, job);
+}
+
+void ProjectIO::Save(const Project::Snapshot& project, const QString& path,
+                     const Config::VR_Specifications specification, Job& job) {
+    TRACE_SCOPE_DETAIL("ProjectIO::Save", path.toStdString());
+
+    // Attachments first, so the project never refers to any that aren't there. Snippet's projects
+    // have them written into the annotations instead:
+    if (specification != Config::VR_Specifications::SNIPPET) {
+        job.SetStage("Writing attachments");
+        std::vector<std::string> attachmentIds;
+        project.annotations->ForEach([&attachmentIds](const std::string&, const std::vector<Annotation>& annotations) {
+            for (const Annotation& annotation : annotations) {
+                for (const Attachment& attachment : annotation.attachments) {
+                    attachmentIds.push_back(attachment.id);
+                }
+            }
+        });
+        std::sort(attachmentIds.begin(), attachmentIds.end());
+        attachmentIds.erase(std::unique(attachmentIds.begin(), attachmentIds.end()), attachmentIds.end());
+        project.attachments->Save(AttachmentStore::DirectoryFor(path.toStdString()), attachmentIds);
+        job.ThrowIfCancelled();
+    }
+
+    // Every format is streamed straight to the file rather than built up as a single document
+    // first. QSaveFile writes to a temporary file that's only renamed over 'path' by commit() so
+    // a failed or cancelled save never leaves a truncated project behind:
+    job.SetStage("Writing");
+    QSaveFile outputFile(path);
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("Unable to open " + path.toStdString() + " for writing");
+    }
+    try {
+        ProjectSerializer::Write(project, specification, outputFile,
+            [&job](const std::size_t completed, const std::size_t total) {
+                return job.ReportProgress(completed, total, 0, 100);
+            }
+        );
+    }
+    catch (...) {
+        outputFile.cancelWriting();
+        throw;
+    }
+    if (!outputFile.commit()) {
+        throw std::runtime_error("Unable to save " + path.toStdString());
+    }
+}
+
+void ProjectIO::SaveReport(const Project::Snapshot& project, const QString& path, const ReportGenerator::Options& options, Job& job) {
+    TRACE_SCOPE_DETAIL("ProjectIO::SaveReport", path.toStdString());
+    job.SetStage("Writing");
+    QSaveFile outputFile(path);
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("Unable to open " + path.toStdString() + " for writing");
+    }
+    try {
+        ReportGenerator::Write(project, options, outputFile,
+            [&job](const std::size_t completed, const std::size_t total) {
+                return job.ReportProgress(completed, total, 0, 100);
+            }
+        );
+    }
+    catch (...) {
+        outputFile.cancelWriting();
+        throw;
+    }
+    if (!outputFile.commit()) {
+        throw std::runtime_error("Unable to save " + path.toStdString());
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef PROJECTIO_H
+#define PROJECTIO_H
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "project.h"
+#include "reportgenerator.h"
+
+// Reading/writing project files, intended to be run off of the GUI thread. A Job is shared
+// between the worker running the operation and the GUI (which polls its progress and may
+// ask for it to be cancelled).
+
+namespace ProjectIO {
+    class Job {
+    public:
+        // Maps 'completed' out of 'total' onto [fromPercent, toPercent] of the whole job,
+        // returns false if the job has been cancelled.
+        bool ReportProgress(std::size_t completed, std::size_t total, int fromPercent, int toPercent);
+        void SetStage(const std::string& stage);
+
+        int GetProgress() const;
+        std::string GetStage() const;
+
+        void Cancel();
+        bool IsCancelled() const;
+        // Throws OperationCancelled if Cancel() has been called.
+        void ThrowIfCancelled() const;
+    private:
+        std::atomic<int> progressPercent {0};
+        std::atomic<bool> cancelled {false};
+        mutable std::mutex stageMutex;
+        std::string stage;
+    };
+
+    // Reads, parses and builds the project stored at 'path', throws on failure.
+    std::unique_ptr<Project> Load(const QString& path, const std::string& codebasePath,
+                                  Config::VR_Specifications specification, Job& job);
+    // As above, in whichever format the file's in (see ProjectSerializer::Detect()).
+    std::unique_ptr<Project> Load(const QString& path, const std::string& codebasePath, Job& job);
+
+    // Serializes 'project' and writes it to 'path' atomically (a temporary file is written and
+    // then renamed over 'path', which is left alone upon failure/cancellation), along with any of
+    // its attachments that aren't in AttachmentStore::DirectoryFor('path') yet. Throws on failure,
+    // including when an attachment it refers to can't be found.
+    void Save(const Project::Snapshot& project, const QString& path, Config::VR_Specifications specification, Job& job);
+    // Writes an audit report of 'project' to 'path', atomically like Save(). Throws on failure.
+    void SaveReport(const Project::Snapshot& project, const QString& path, const ReportGenerator::Options& options, Job& job);
+};
+
+#endif // PROJECTIO_H
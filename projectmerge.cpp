@@ -0,0 +1,370 @@
+#include "projectmerge.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include "tracing.h"
+
+namespace {
+    std::uint64_t HashContents(const std::string& contents, std::uint64_t hash = 14695981039346656037ULL) {
+        // FNV-1a (64-bit):
+        for (const char c : contents) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // A finding is its contents and whatever's attached to it (attachments' ids being their hashes):
+    std::uint64_t HashFinding(const Annotation& annotation) {
+        std::uint64_t hash = HashContents(annotation.contents);
+        for (const Attachment& attachment : annotation.attachments) {
+            hash = HashContents(attachment.id, hash);
+        }
+        return hash;
+    }
+
+    bool SameFinding(const Annotation& a, const Annotation& b) {
+        return a.contents == b.contents && std::equal(a.attachments.cbegin(), a.attachments.cend(),
+            b.attachments.cbegin(), b.attachments.cend(), [](const Attachment& x, const Attachment& y) {
+                return x.id == y.id;
+            });
+    }
+
+    // Orders findings whose hashes collide, so that identical ones still end up adjacent.
+    bool FindingLess(const Annotation& a, const Annotation& b) {
+        if (a.contents != b.contents) {
+            return a.contents < b.contents;
+        }
+        return std::lexicographical_compare(a.attachments.cbegin(), a.attachments.cend(),
+            b.attachments.cbegin(), b.attachments.cend(), [](const Attachment& x, const Attachment& y) {
+                return x.id < y.id;
+            });
+    }
+
+    // One annotation from one input, source 0 is the base (if there is one).
+    struct AnnotationEntry {
+        std::size_t lineRef;
+        std::uint64_t contentHash;
+        std::size_t source;
+        const Annotation* annotation;
+    };
+
+    struct BookmarkEntry {
+        std::size_t lineRef;
+        std::size_t source;
+    };
+
+    // The distinct contents that one source has on a line, kept sorted (by hash, then contents).
+    struct Version {
+        std::vector<std::uint64_t> hashes;
+        std::vector<const Annotation*> annotations;
+
+        // Hashes are only compared first, the findings themselves decide:
+        bool operator==(const Version& other) const {
+            if (this->hashes != other.hashes) {
+                return false;
+            }
+            for (std::size_t i = 0; i < this->annotations.size(); i++) {
+                if (!SameFinding(*this->annotations[i], *other.annotations[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool Contains(const std::uint64_t hash, const Annotation& annotation) const {
+            const std::pair<std::vector<std::uint64_t>::const_iterator, std::vector<std::uint64_t>::const_iterator> matches =
+                std::equal_range(this->hashes.cbegin(), this->hashes.cend(), hash);
+            for (std::vector<std::uint64_t>::const_iterator match = matches.first; match != matches.second; match++) {
+                if (SameFinding(*this->annotations[static_cast<std::size_t>(match - this->hashes.cbegin())], annotation)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // The variants combined into one annotation, which carries on from 'origin' (the base's
+    // annotation, or the first variant without one): its identity and history, with each variant
+    // recorded as a revision so none of them are lost once the conflict's resolved.
+    Annotation CombineConflict(const Annotation& origin, const std::vector<const Annotation*>& variants, const bool editedAndDeleted) {
+        std::string combined = "#" + ProjectMerge::ConflictKeyword + " between " +
+            std::to_string(variants.size()) + " version(s)" + (editedAndDeleted ? " (also deleted by another auditor)" : "") + ":";
+        std::vector<Attachment> attachments;
+        Annotation previous = origin;
+        for (std::size_t i = 0; i < variants.size(); i++) {
+            combined += "\n[" + std::to_string(i + 1) + "] " + variants[i]->contents;
+            for (const Attachment& attachment : variants[i]->attachments) {
+                if (std::find_if(attachments.cbegin(), attachments.cend(), [&attachment](const Attachment& existing) {
+                        return existing.id == attachment.id;
+                    }) == attachments.cend()) {
+                    attachments.push_back(attachment);
+                }
+            }
+            if (!SameFinding(*variants[i], origin)) {
+                Annotation variant = *variants[i];
+                variant.RecordRevision(previous, variant.history ? variant.history->LatestAuthor() : variant.author);
+                previous = std::move(variant);
+            }
+        }
+
+        Annotation conflict = origin;
+        conflict.contents = combined;
+        conflict.attachments = attachments;
+        for (const Annotation* const variant : variants) {
+            conflict.modifiedTimestamp = std::max(conflict.modifiedTimestamp, variant->modifiedTimestamp);
+        }
+        conflict.RecordRevision(previous, ProjectMerge::MergeAuthor);
+        return conflict;
+    }
+
+    void MergeFileAnnotations(std::vector<AnnotationEntry>& entries, const bool hasBase, const std::size_t sourceCount,
+                              std::vector<Annotation>& merged, ProjectMerge::Report& report) {
+        std::sort(entries.begin(), entries.end(), [](const AnnotationEntry& a, const AnnotationEntry& b) {
+            if (a.lineRef != b.lineRef) {
+                return a.lineRef < b.lineRef;
+            }
+            if (a.contentHash != b.contentHash) {
+                return a.contentHash < b.contentHash;
+            }
+            if (!SameFinding(*a.annotation, *b.annotation)) {
+                return FindingLess(*a.annotation, *b.annotation);
+            }
+            return a.source < b.source;
+        });
+
+        std::vector<Version> versions(sourceCount);
+        std::vector<const Annotation*> output;
+        std::vector<std::pair<std::uint64_t, const Annotation*>> sideFindings;
+        const std::size_t firstMerged = merged.size();
+        for (std::size_t groupStart = 0, groupEnd = 0; groupStart < entries.size(); groupStart = groupEnd) {
+            const std::size_t lineRef = entries[groupStart].lineRef;
+            for (Version& version : versions) {
+                version.hashes.clear();
+                version.annotations.clear();
+            }
+
+            // Every source's distinct contents on this line, entries are sorted by hash (then
+            // contents) so duplicates within a source are adjacent:
+            for (groupEnd = groupStart; groupEnd < entries.size() && entries[groupEnd].lineRef == lineRef; groupEnd++) {
+                const AnnotationEntry& entry = entries[groupEnd];
+                Version& version = versions[entry.source];
+                if (!version.hashes.empty() && version.hashes.back() == entry.contentHash &&
+                    SameFinding(*version.annotations.back(), *entry.annotation)) {
+                    continue;
+                }
+                version.hashes.push_back(entry.contentHash);
+                version.annotations.push_back(entry.annotation);
+            }
+
+            // The same (new) contents coming from more than one side is a duplicate finding:
+            const std::size_t firstSide = hasBase ? 1 : 0;
+            sideFindings.clear();
+            for (std::size_t source = firstSide; source < sourceCount; source++) {
+                const Version& version = versions[source];
+                for (std::size_t i = 0; i < version.hashes.size(); i++) {
+                    if (!hasBase || !versions[0].Contains(version.hashes[i], *version.annotations[i])) {
+                        sideFindings.emplace_back(version.hashes[i], version.annotations[i]);
+                    }
+                }
+            }
+            std::sort(sideFindings.begin(), sideFindings.end(), [](const std::pair<std::uint64_t, const Annotation*>& a,
+                                                                   const std::pair<std::uint64_t, const Annotation*>& b) {
+                return a.first != b.first ? a.first < b.first : FindingLess(*a.second, *b.second);
+            });
+            report.duplicates += sideFindings.size() - static_cast<std::size_t>(std::unique(sideFindings.begin(), sideFindings.end(),
+                [](const std::pair<std::uint64_t, const Annotation*>& a, const std::pair<std::uint64_t, const Annotation*>& b) {
+                    return a.first == b.first && SameFinding(*a.second, *b.second);
+                }) - sideFindings.begin());
+
+            // Work out which sides changed the line (relative to the base) and how:
+            std::vector<const Version*> changes;
+            bool anyDeleted = false;
+            for (std::size_t source = firstSide; source < sourceCount; source++) {
+                const Version& version = versions[source];
+                if (hasBase && version == versions[0]) {
+                    continue; // Unchanged.
+                }
+                if (!hasBase && version.hashes.empty()) {
+                    continue; // Two-way, this side just doesn't have anything here.
+                }
+                if (version.hashes.empty()) {
+                    anyDeleted = true;
+                }
+                if (std::find_if(changes.cbegin(), changes.cend(), [&version](const Version* const change) {
+                        return *change == version;
+                    }) == changes.cend()) {
+                    changes.push_back(&version);
+                }
+            }
+
+            output.clear();
+            if (changes.empty()) {
+                // Nobody changed the base:
+                output = versions[0].annotations;
+            }
+            else if (changes.size() == 1) {
+                // Every side that changed it agrees:
+                output = changes.front()->annotations;
+                if (hasBase && output.empty() && !versions[0].hashes.empty()) {
+                    report.deletions += versions[0].hashes.size();
+                }
+            }
+            else {
+                // Conflicting changes, combine every surviving version:
+                std::vector<const Annotation*> variants;
+                for (const Version* const change : changes) {
+                    for (std::size_t i = 0; i < change->hashes.size(); i++) {
+                        if (std::find_if(variants.cbegin(), variants.cend(), [&change, i](const Annotation* const variant) {
+                                return SameFinding(*variant, *change->annotations[i]);
+                            }) == variants.cend()) {
+                            variants.push_back(change->annotations[i]);
+                        }
+                    }
+                }
+                if (variants.size() == 1 && !anyDeleted) {
+                    output = variants;
+                }
+                else if (!variants.empty()) {
+                    const Annotation& origin = hasBase && versions[0].annotations.size() == 1 ?
+                        *versions[0].annotations.front() : *variants.front();
+                    merged.push_back(CombineConflict(origin, variants, anyDeleted));
+                    report.conflicts.push_back(ProjectMerge::Conflict {
+                        .fileRef = variants.front()->fileRef,
+                        .lineRef = lineRef,
+                        .versions = variants.size(),
+                        .editedAndDeleted = anyDeleted
+                    });
+                }
+            }
+            // Kept whole, with its identity, metadata and history:
+            for (const Annotation* const annotation : output) {
+                merged.push_back(*annotation);
+            }
+        }
+
+        // Look for the same finding having been left on different lines of this file:
+        std::vector<std::uint64_t> mergedHashes;
+        mergedHashes.reserve(merged.size() - firstMerged);
+        for (std::size_t i = firstMerged; i < merged.size(); i++) {
+            mergedHashes.push_back(HashFinding(merged[i]));
+        }
+        std::sort(mergedHashes.begin(), mergedHashes.end());
+        report.relocatedDuplicates += mergedHashes.size() -
+            static_cast<std::size_t>(std::unique(mergedHashes.begin(), mergedHashes.end()) - mergedHashes.begin());
+    }
+
+    void MergeFileBookmarks(std::vector<BookmarkEntry>& entries, const bool hasBase, const std::size_t sideCount,
+                            const std::string& fileRef, std::vector<Bookmark>& merged, ProjectMerge::Report& report) {
+        std::sort(entries.begin(), entries.end(), [](const BookmarkEntry& a, const BookmarkEntry& b) {
+            return a.lineRef != b.lineRef ? a.lineRef < b.lineRef : a.source < b.source;
+        });
+
+        for (std::size_t groupStart = 0, groupEnd = 0; groupStart < entries.size(); groupStart = groupEnd) {
+            const std::size_t lineRef = entries[groupStart].lineRef;
+            bool inBase = false;
+            std::vector<std::size_t> sidesWithBookmark;
+            for (groupEnd = groupStart; groupEnd < entries.size() && entries[groupEnd].lineRef == lineRef; groupEnd++) {
+                const std::size_t source = entries[groupEnd].source;
+                if (hasBase && source == 0) {
+                    inBase = true;
+                }
+                else if (sidesWithBookmark.empty() || sidesWithBookmark.back() != source) {
+                    sidesWithBookmark.push_back(source);
+                }
+            }
+
+            // A bookmark is just present or absent, so any side differing from the base wins:
+            bool keep = !sidesWithBookmark.empty();
+            if (hasBase && inBase) {
+                keep = sidesWithBookmark.size() == sideCount;
+            }
+            else if (!hasBase && sidesWithBookmark.size() > 1) {
+                report.duplicates += sidesWithBookmark.size() - 1;
+            }
+            if (keep) {
+                merged.push_back(Bookmark(fileRef, lineRef));
+            }
+        }
+    }
+}
+
+ProjectMerge::Report ProjectMerge::Merge(const Project* const base, const std::vector<const Project*>& sides, Project& result) {
+    TRACE_SCOPE("ProjectMerge::Merge");
+
+    ProjectMerge::Report report {};
+
+    std::vector<const Project*> sources;
+    if (base != nullptr) {
+        sources.push_back(base);
+    }
+    sources.insert(sources.end(), sides.cbegin(), sides.cend());
+    const bool hasBase = base != nullptr;
+
+    // Bucket everything by file:
+    std::vector<std::unordered_map<std::string, std::vector<Annotation>>> rawAnnotations;
+    std::vector<std::unordered_map<std::string, std::vector<Bookmark>>> rawBookmarks;
+    std::vector<std::string> files;
+    for (const Project* const source : sources) {
+        rawAnnotations.push_back(source->annotations.GetRawAnnotations());
+        rawBookmarks.push_back(source->bookmarks.GetRawBookmarks());
+        for (const std::pair<const std::string, std::vector<Annotation>>& file : rawAnnotations.back()) {
+            files.push_back(file.first);
+        }
+        for (const std::pair<const std::string, std::vector<Bookmark>>& file : rawBookmarks.back()) {
+            files.push_back(file.first);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::vector<Annotation> mergedAnnotations;
+    std::vector<Bookmark> mergedBookmarks;
+    std::vector<AnnotationEntry> annotationEntries;
+    std::vector<BookmarkEntry> bookmarkEntries;
+    for (const std::string& file : files) {
+        annotationEntries.clear();
+        bookmarkEntries.clear();
+        for (std::size_t source = 0; source < sources.size(); source++) {
+            const std::unordered_map<std::string, std::vector<Annotation>>::const_iterator fileAnnotations =
+                rawAnnotations[source].find(file);
+            if (fileAnnotations != rawAnnotations[source].cend()) {
+                for (const Annotation& annotation : fileAnnotations->second) {
+                    annotationEntries.push_back(AnnotationEntry {
+                        .lineRef = annotation.lineRef,
+                        .contentHash = HashFinding(annotation),
+                        .source = source,
+                        .annotation = &annotation
+                    });
+                }
+            }
+            const std::unordered_map<std::string, std::vector<Bookmark>>::const_iterator fileBookmarks =
+                rawBookmarks[source].find(file);
+            if (fileBookmarks != rawBookmarks[source].cend()) {
+                for (const Bookmark& bookmark : fileBookmarks->second) {
+                    bookmarkEntries.push_back(BookmarkEntry { .lineRef = bookmark.lineRef, .source = source });
+                }
+            }
+        }
+        MergeFileAnnotations(annotationEntries, hasBase, sources.size(), mergedAnnotations, report);
+        MergeFileBookmarks(bookmarkEntries, hasBase, sides.size(), file, mergedBookmarks, report);
+    }
+
+    report.annotations = mergedAnnotations.size();
+    report.bookmarks = mergedBookmarks.size();
+    result.annotations.AddNewAnnotations(std::move(mergedAnnotations));
+    result.bookmarks.AddBookmarks(std::move(mergedBookmarks));
+
+    for (const Project* const source : sources) {
+        result.attachments->Include(*source->attachments);
+        for (const std::pair<const std::string, ReviewCoverage::File>& file : source->coverage.GetFiles()) {
+            if (file.second.lineCount != 0) {
+                result.coverage.SetLineCount(file.first, file.second.lineCount);
+            }
+            for (const IntervalSet::Run& run : file.second.reviewed.Runs()) {
+                result.coverage.MarkReviewed(file.first, run.begin, run.end);
+            }
+        }
+    }
+    return report;
+}
@@ -0,0 +1,46 @@
+#ifndef PROJECTMERGE_H
+#define PROJECTMERGE_H
+#include <string>
+#include <vector>
+#include "project.h"
+
+// Combines several auditors' projects (of the same codebase) into one. Annotations are
+// matched on (file, line, contents) - the contents, with any attachments, by hash - by
+// sort-merging each file's annotations from every input rather than comparing the projects
+// pairwise.
+//
+// With a base (three-way) a side that matches the base is treated as unchanged, so edits
+// and deletions made by a single side win. Without one (two-way) everything is kept.
+// Either way, distinct contents on the same line from different sides are a conflict and
+// are combined into a single annotation tagged with #merge-conflict, which keeps the base's
+// identity and history with every version involved recorded in it. Annotations that aren't
+// in conflict are carried over whole. Review coverage is the union of every side's, a line
+// reviewed by anyone has been reviewed.
+
+namespace ProjectMerge {
+    const static std::string ConflictKeyword = "merge-conflict";
+    // Recorded as the author of the combined contents of a conflict.
+    const static std::string MergeAuthor = "blocks-merge";
+
+    struct Conflict {
+        std::string fileRef;
+        std::size_t lineRef;
+        std::size_t versions; // Distinct (non-deleted) contents involved.
+        bool editedAndDeleted; // At least one side deleted the annotation whilst another edited it.
+    };
+
+    struct Report {
+        std::size_t annotations; // In the merged project.
+        std::size_t bookmarks;
+        std::size_t duplicates; // Identical (file, line, contents) from more than one side.
+        std::size_t relocatedDuplicates; // Identical (file, contents) found on different lines.
+        std::size_t deletions; // Three-way only, base annotations removed by a side.
+        std::vector<Conflict> conflicts;
+    };
+
+    // Merges 'sides' (and 'base', which may be null for a two-way merge) into 'result',
+    // which should be empty.
+    Report Merge(const Project* const base, const std::vector<const Project*>& sides, Project& result);
+};
+
+#endif // PROJECTMERGE_H
@@ -0,0 +1,551 @@
+#include "projectserializer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "parallel.h"
+#include "recordschema.h"
+#include "tracing.h"
+
+namespace {
+    // Start of every binary project, "BLKP" and the version of its layout:
+    const static std::uint64_t BinaryMagic = 0x504B4C42;
+    const static std::uint64_t BinaryVersion = 3; // 2: Annotations' attachments, 3: their tags.
+
+    // Files' items, by path.
+    template<typename Item>
+    using Files = std::vector<std::pair<const std::string*, const std::vector<Item>*>>;
+
+    // Reports files/bytes done (and stops if cancelled).
+    class Progress {
+    public:
+        Progress(const ProgressCallback& callback, const std::size_t total) : callback(callback), total(total) {}
+
+        void Report(const std::size_t completed) const {
+            if (this->callback && !this->callback(completed, this->total)) {
+                throw OperationCancelled();
+            }
+        }
+    private:
+        const ProgressCallback& callback;
+        const std::size_t total;
+    };
+
+    void WriteBytes(QIODevice& output, const char* const data, const std::size_t length) {
+        if (output.write(data, static_cast<qint64>(length)) != static_cast<qint64>(length)) {
+            throw std::runtime_error("Unable to write project");
+        }
+    }
+
+    void WriteBytes(QIODevice& output, const std::string& bytes) {
+        WriteBytes(output, bytes.data(), bytes.size());
+    }
+
+    // Deterministic output (in path order). The snapshot owns every file's items for as long as
+    // it's held, so they're used in place.
+    template<typename Item>
+    Files<Item> SortedFiles(const typename SnapshotMap<Item>::Snapshot& snapshot) {
+        Files<Item> files;
+        files.reserve(snapshot.FileCount());
+        snapshot.ForEach([&files](const std::string& fileRef, const std::vector<Item>& items) {
+            if (!items.empty()) {
+                files.emplace_back(&fileRef, &items);
+            }
+        });
+        std::sort(files.begin(), files.end(),
+            [](const std::pair<const std::string*, const std::vector<Item>*>& a,
+               const std::pair<const std::string*, const std::vector<Item>*>& b) {
+                return *a.first < *b.first;
+            }
+        );
+        return files;
+    }
+
+    // Renders each of 'files' with 'render', a window at a time in parallel, and writes them in
+    // order. For JSON formats each file is rendered with a leading comma, the first one's dropped.
+    template<typename Format, typename Item, typename Render>
+    void WriteFiles(QIODevice& output, const Files<Item>& files, const Render& render,
+                    const Progress& progress, const std::size_t filesBefore) {
+        const std::size_t windowSize = Parallel::WorkerCount() * 8;
+        std::vector<std::string> renderedFiles(std::min(windowSize, files.size()));
+        bool firstFile = true;
+        for (std::size_t windowStart = 0; windowStart < files.size(); windowStart += windowSize) {
+            progress.Report(filesBefore + windowStart);
+
+            const std::size_t windowLength = std::min(windowSize, files.size() - windowStart);
+            Parallel::For(windowLength, [&](const std::size_t i) {
+                std::string& rendered = renderedFiles[i];
+                rendered.clear();
+                render(rendered, *files[windowStart + i].first, *files[windowStart + i].second);
+            });
+
+            for (std::size_t i = 0; i < windowLength; i++) {
+                const std::size_t skip = RecordSchema::IsJSON<Format> && firstFile ? 1 : 0;
+                WriteBytes(output, renderedFiles[i].data() + skip, renderedFiles[i].size() - skip);
+                firstFile = false;
+            }
+        }
+    }
+
+    // ,"<file>":{"file":"<file>","<itemsKey>":[...]}
+    template<typename Item>
+    void AppendBlocksFile(std::string& output, const char* const itemsKey, const std::string& fileRef, const std::vector<Item>& items) {
+        output += ',';
+        JSONWriter::AppendString(output, fileRef);
+        output += ":{\"file\":";
+        JSONWriter::AppendString(output, fileRef);
+        output += ",\"";
+        output += itemsKey;
+        output += "\":[";
+        for (std::size_t i = 0; i < items.size(); i++) {
+            if (i != 0) {
+                output += ',';
+            }
+            RecordSchema::AppendRecord<RecordSchema::Blocks>(output, items[i]);
+        }
+        output += "]}";
+    }
+
+    // <file><count><records...>
+    template<typename Item>
+    void AppendBinaryFile(std::string& output, const std::string& fileRef, const std::vector<Item>& items) {
+        BinaryCodec::AppendString(output, fileRef);
+        BinaryCodec::AppendUnsigned(output, items.size());
+        for (const Item& item : items) {
+            RecordSchema::AppendRecord<RecordSchema::Binary>(output, item);
+        }
+    }
+
+    // Only files with something reviewed are saved, the rest are recounted when the codebase is.
+    std::vector<const ReviewCoverage::Files::value_type*> SortedCoverage(const ReviewCoverage::Files& coverage) {
+        std::vector<const ReviewCoverage::Files::value_type*> files;
+        for (const ReviewCoverage::Files::value_type& file : coverage) {
+            if (!file.second.reviewed.Empty()) {
+                files.push_back(&file);
+            }
+        }
+        std::sort(files.begin(), files.end(),
+            [](const ReviewCoverage::Files::value_type* const a, const ReviewCoverage::Files::value_type* const b) {
+                return a->first < b->first;
+            }
+        );
+        return files;
+    }
+
+    // Snippet has no notion of attachments, so they're written out after the contents, each under
+    // a line naming it.
+    Annotation InlineAttachments(const Annotation& annotation, const AttachmentStore& attachments) {
+        Annotation inlined = annotation;
+        for (const Attachment& attachment : annotation.attachments) {
+            inlined.contents += "\n\n[" + attachment.name + "]\n" + attachments.Get(attachment.id);
+        }
+        inlined.attachments.clear();
+        return inlined;
+    }
+
+    template<typename Format>
+    void WriteProject(const Project::Snapshot& project, QIODevice& output, const ProgressCallback& callback);
+
+    template<>
+    void WriteProject<RecordSchema::Blocks>(const Project::Snapshot& project, QIODevice& output, const ProgressCallback& callback) {
+        const Files<Annotation> annotationFiles = SortedFiles<Annotation>(*project.annotations);
+        const Files<Bookmark> bookmarkFiles = SortedFiles<Bookmark>(*project.bookmarks);
+        const Progress progress(callback, annotationFiles.size() + bookmarkFiles.size());
+
+        WriteBytes(output, "{\"annotations\":{", 16);
+        WriteFiles<RecordSchema::Blocks>(output, annotationFiles,
+            [](std::string& rendered, const std::string& fileRef, const std::vector<Annotation>& annotations) {
+                AppendBlocksFile(rendered, "annotations", fileRef, annotations);
+            }, progress, 0
+        );
+        WriteBytes(output, "},\"bookmarks\":{", 15);
+        WriteFiles<RecordSchema::Blocks>(output, bookmarkFiles,
+            [](std::string& rendered, const std::string& fileRef, const std::vector<Bookmark>& bookmarks) {
+                AppendBlocksFile(rendered, "bookmarks", fileRef, bookmarks);
+            }, progress, annotationFiles.size()
+        );
+
+        // Runs are stored flattened, [begin, end, begin, end, ...]:
+        std::string rest = "},\"coverage\":{";
+        bool firstEntry = true;
+        for (const ReviewCoverage::Files::value_type* const file : SortedCoverage(*project.coverage)) {
+            if (!firstEntry) {
+                rest += ',';
+            }
+            firstEntry = false;
+            JSONWriter::AppendString(rest, file->first);
+            rest += ":{\"lines\":";
+            JSONWriter::AppendUnsigned(rest, file->second.lineCount);
+            rest += ",\"reviewed\":[";
+            bool firstRun = true;
+            for (const IntervalSet::Run& run : file->second.reviewed.Runs()) {
+                rest += firstRun ? "" : ",";
+                firstRun = false;
+                JSONWriter::AppendUnsigned(rest, run.begin);
+                rest += ',';
+                JSONWriter::AppendUnsigned(rest, run.end);
+            }
+            rest += "]}";
+        }
+        rest += "},\"excludes\":[";
+        firstEntry = true;
+        for (const std::string& excludePattern : project.excludePatterns) {
+            rest += firstEntry ? "" : ",";
+            firstEntry = false;
+            JSONWriter::AppendString(rest, excludePattern);
+        }
+        rest += "]}";
+        WriteBytes(output, rest);
+        progress.Report(annotationFiles.size() + bookmarkFiles.size());
+    }
+
+    template<>
+    void WriteProject<RecordSchema::Snippet>(const Project::Snapshot& project, QIODevice& output, const ProgressCallback& callback) {
+        // Snippet has no notion of bookmarks, coverage or excludes, just a flat list of annotations:
+        const Files<Annotation> annotationFiles = SortedFiles<Annotation>(*project.annotations);
+        const Progress progress(callback, annotationFiles.size());
+
+        WriteBytes(output, "{\"snippets\":[", 13);
+        WriteFiles<RecordSchema::Snippet>(output, annotationFiles,
+            [&project](std::string& rendered, const std::string&, const std::vector<Annotation>& annotations) {
+                for (const Annotation& annotation : annotations) {
+                    rendered += ',';
+                    if (annotation.attachments.empty()) {
+                        RecordSchema::AppendRecord<RecordSchema::Snippet>(rendered, annotation);
+                    }
+                    else {
+                        RecordSchema::AppendRecord<RecordSchema::Snippet>(rendered, InlineAttachments(annotation, *project.attachments));
+                    }
+                }
+            }, progress, 0
+        );
+        WriteBytes(output, "]}", 2);
+        progress.Report(annotationFiles.size());
+    }
+
+    template<>
+    void WriteProject<RecordSchema::Binary>(const Project::Snapshot& project, QIODevice& output, const ProgressCallback& callback) {
+        const Files<Annotation> annotationFiles = SortedFiles<Annotation>(*project.annotations);
+        const Files<Bookmark> bookmarkFiles = SortedFiles<Bookmark>(*project.bookmarks);
+        const Progress progress(callback, annotationFiles.size() + bookmarkFiles.size());
+
+        // Each section is a count then its entries:
+        std::string header;
+        BinaryCodec::AppendUnsigned(header, BinaryMagic);
+        BinaryCodec::AppendUnsigned(header, BinaryVersion);
+        BinaryCodec::AppendUnsigned(header, annotationFiles.size());
+        WriteBytes(output, header);
+        WriteFiles<RecordSchema::Binary>(output, annotationFiles, AppendBinaryFile<Annotation>, progress, 0);
+
+        std::string count;
+        BinaryCodec::AppendUnsigned(count, bookmarkFiles.size());
+        WriteBytes(output, count);
+        WriteFiles<RecordSchema::Binary>(output, bookmarkFiles, AppendBinaryFile<Bookmark>, progress, annotationFiles.size());
+
+        std::string rest;
+        BinaryCodec::AppendUnsigned(rest, project.excludePatterns.size());
+        for (const std::string& excludePattern : project.excludePatterns) {
+            BinaryCodec::AppendString(rest, excludePattern);
+        }
+        const std::vector<const ReviewCoverage::Files::value_type*> coverage = SortedCoverage(*project.coverage);
+        BinaryCodec::AppendUnsigned(rest, coverage.size());
+        for (const ReviewCoverage::Files::value_type* const file : coverage) {
+            BinaryCodec::AppendString(rest, file->first);
+            BinaryCodec::AppendUnsigned(rest, file->second.lineCount);
+            BinaryCodec::AppendUnsigned(rest, file->second.reviewed.Runs().size());
+            for (const IntervalSet::Run& run : file->second.reviewed.Runs()) {
+                BinaryCodec::AppendUnsigned(rest, run.begin);
+                BinaryCodec::AppendUnsigned(rest, run.end);
+            }
+        }
+        WriteBytes(output, rest);
+        progress.Report(annotationFiles.size() + bookmarkFiles.size());
+    }
+
+    // Records to be read into.
+    template<typename Item>
+    Item EmptyRecord();
+    template<>
+    Annotation EmptyRecord<Annotation>() {
+        return Annotation {};
+    }
+    template<>
+    Bookmark EmptyRecord<Bookmark>() {
+        return Bookmark("", 0);
+    }
+
+    // {"<file>": {"file": "<file>", "<itemsKey>": [...]}, ...}
+    template<typename Item>
+    void ReadBlocksFiles(JSONReader& input, const char* const itemsKey, std::vector<Item>& items, const Progress& progress) {
+        if (!input.TryBeginObject()) {
+            return;
+        }
+        std::string_view fileKey;
+        while (input.NextKey(fileKey)) {
+            std::string fileRef(fileKey);
+            const std::size_t firstItem = items.size();
+            if (!input.TryBeginObject()) {
+                continue;
+            }
+            std::string_view key;
+            while (input.NextKey(key)) {
+                if (key == "file") {
+                    input.ReadString(fileRef);
+                }
+                else if (key == itemsKey && input.TryBeginArray()) {
+                    while (input.NextElement()) {
+                        items.push_back(EmptyRecord<Item>());
+                        RecordSchema::ReadRecord<RecordSchema::Blocks>(input, items.back());
+                    }
+                }
+                else if (key != itemsKey) {
+                    input.Skip();
+                }
+            }
+            // The file may come after its items:
+            for (std::size_t i = firstItem; i < items.size(); i++) {
+                items[i].fileRef = fileRef;
+            }
+            progress.Report(input.Position());
+        }
+    }
+
+    // {"<file>": {"lines": n, "reviewed": [begin, end, ...]}, ...}
+    void ReadBlocksCoverage(JSONReader& input, ReviewCoverage& coverage) {
+        if (!input.TryBeginObject()) {
+            return;
+        }
+        std::string_view fileKey;
+        std::vector<std::size_t> runs;
+        while (input.NextKey(fileKey)) {
+            const std::string fileRef(fileKey);
+            if (!input.TryBeginObject()) {
+                continue;
+            }
+            std::size_t lineCount = 0;
+            runs.clear();
+            std::string_view key;
+            while (input.NextKey(key)) {
+                if (key == "lines") {
+                    lineCount = static_cast<std::size_t>(std::max<std::int64_t>(0, input.ReadInteger()));
+                }
+                else if (key == "reviewed" && input.TryBeginArray()) {
+                    while (input.NextElement()) {
+                        runs.push_back(static_cast<std::size_t>(std::max<std::int64_t>(0, input.ReadInteger())));
+                    }
+                }
+                else if (key != "reviewed") {
+                    input.Skip();
+                }
+            }
+            // The line count first, so the runs are clamped to it:
+            coverage.SetLineCount(fileRef, lineCount);
+            for (std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+                coverage.MarkReviewed(fileRef, runs[i], runs[i + 1]);
+            }
+        }
+    }
+
+    void ThrowIfTrailing(JSONReader& input) {
+        if (!input.AtEnd()) {
+            throw std::runtime_error("Invalid project file: unexpected data at byte " + std::to_string(input.Position()));
+        }
+    }
+
+    // Reads the project in 'data' into 'project', reporting progress by bytes parsed.
+    template<typename Format>
+    void ReadProject(const char* data, std::size_t length, Project& project, const Progress& progress);
+
+    template<>
+    void ReadProject<RecordSchema::Blocks>(const char* const data, const std::size_t length, Project& project,
+                                           const Progress& progress) {
+        JSONReader input(data, length);
+        std::vector<Annotation> annotations;
+        std::vector<Bookmark> bookmarks;
+        input.BeginObject();
+        std::string_view key;
+        while (input.NextKey(key)) {
+            if (key == "annotations") {
+                ReadBlocksFiles(input, "annotations", annotations, progress);
+            }
+            else if (key == "bookmarks") {
+                ReadBlocksFiles(input, "bookmarks", bookmarks, progress);
+            }
+            else if (key == "excludes" && input.TryBeginArray()) {
+                while (input.NextElement()) {
+                    project.excludePatterns.emplace_back();
+                    input.ReadString(project.excludePatterns.back());
+                }
+            }
+            else if (key == "coverage") {
+                ReadBlocksCoverage(input, project.coverage);
+            }
+            else if (key != "excludes") {
+                input.Skip();
+            }
+        }
+        ThrowIfTrailing(input);
+        progress.Report(length);
+
+        project.annotations.AddNewAnnotations(std::move(annotations));
+        project.bookmarks.AddBookmarks(std::move(bookmarks));
+    }
+
+    template<>
+    void ReadProject<RecordSchema::Snippet>(const char* const data, const std::size_t length, Project& project,
+                                            const Progress& progress) {
+        // A flat array of annotations, each naming its own file:
+        JSONReader input(data, length);
+        std::vector<Annotation> annotations;
+        input.BeginObject();
+        std::string_view key;
+        while (input.NextKey(key)) {
+            if (key == "snippets" && input.TryBeginArray()) {
+                while (input.NextElement()) {
+                    if (annotations.size() % 4096 == 0) {
+                        progress.Report(input.Position());
+                    }
+                    annotations.emplace_back();
+                    RecordSchema::ReadRecord<RecordSchema::Snippet>(input, annotations.back());
+                }
+            }
+            else if (key != "snippets") {
+                input.Skip();
+            }
+        }
+        ThrowIfTrailing(input);
+        progress.Report(length);
+
+        project.annotations.AddNewAnnotations(std::move(annotations));
+    }
+
+    // <count>(<file><count><records...>)...
+    template<typename Item>
+    void ReadBinaryFiles(BinaryCodec::Reader& input, std::vector<Item>& items, const Progress& progress) {
+        // Each file is at least its path's length and its count:
+        const std::uint64_t fileCount = input.ReadCount(sizeof(std::uint32_t) + sizeof(std::uint64_t));
+        std::string fileRef;
+        for (std::uint64_t file = 0; file < fileCount; file++) {
+            input.ReadString(fileRef);
+            const std::uint64_t itemCount = input.ReadCount(sizeof(std::uint64_t));
+            for (std::uint64_t i = 0; i < itemCount; i++) {
+                items.push_back(EmptyRecord<Item>());
+                items.back().fileRef = fileRef;
+                RecordSchema::ReadRecord<RecordSchema::Binary>(input, items.back());
+            }
+            progress.Report(input.Position());
+        }
+    }
+
+    template<>
+    void ReadProject<RecordSchema::Binary>(const char* const data, const std::size_t length, Project& project,
+                                           const Progress& progress) {
+        BinaryCodec::Reader input(data, length);
+        if (length < 2 * sizeof(std::uint64_t) || input.ReadUnsigned() != BinaryMagic) {
+            throw std::runtime_error("Invalid project file: not a binary Blocks project");
+        }
+        if (input.ReadUnsigned() != BinaryVersion) {
+            throw std::runtime_error("Unsupported project file: written by another version of Blocks");
+        }
+
+        std::vector<Annotation> annotations;
+        std::vector<Bookmark> bookmarks;
+        ReadBinaryFiles(input, annotations, progress);
+        ReadBinaryFiles(input, bookmarks, progress);
+
+        const std::uint64_t excludeCount = input.ReadCount(sizeof(std::uint32_t));
+        project.excludePatterns.resize(excludeCount);
+        for (std::string& excludePattern : project.excludePatterns) {
+            input.ReadString(excludePattern);
+        }
+        const std::uint64_t coverageCount = input.ReadCount(sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t));
+        std::string fileRef;
+        for (std::uint64_t file = 0; file < coverageCount; file++) {
+            input.ReadString(fileRef);
+            project.coverage.SetLineCount(fileRef, input.ReadUnsigned());
+            const std::uint64_t runCount = input.ReadCount(2 * sizeof(std::uint64_t));
+            for (std::uint64_t run = 0; run < runCount; run++) {
+                const std::uint64_t begin = input.ReadUnsigned();
+                project.coverage.MarkReviewed(fileRef, begin, input.ReadUnsigned());
+            }
+        }
+        if (!input.AtEnd()) {
+            throw std::runtime_error("Invalid project file: unexpected data at byte " + std::to_string(input.Position()));
+        }
+        progress.Report(length);
+
+        project.annotations.AddNewAnnotations(std::move(annotations));
+        project.bookmarks.AddBookmarks(std::move(bookmarks));
+    }
+}
+
+void ProjectSerializer::Write(const Project::Snapshot& project, const Config::VR_Specifications specification,
+                              QIODevice& output, const ProgressCallback& progress) {
+    TRACE_SCOPE("ProjectSerializer::Write");
+    switch (specification) {
+        case Config::VR_Specifications::BLOCKS:
+            WriteProject<RecordSchema::Blocks>(project, output, progress);
+            break;
+        case Config::VR_Specifications::SNIPPET:
+            WriteProject<RecordSchema::Snippet>(project, output, progress);
+            break;
+        case Config::VR_Specifications::BINARY:
+            WriteProject<RecordSchema::Binary>(project, output, progress);
+            break;
+        default:
+            throw std::runtime_error("Unsupported serialization specification");
+    }
+}
+
+Config::VR_Specifications ProjectSerializer::Detect(const char* const data, const std::size_t length) {
+    if (length >= sizeof(std::uint64_t)) {
+        std::uint64_t magic = 0;
+        std::memcpy(&magic, data, sizeof(magic));
+        if (magic == BinaryMagic) {
+            return Config::VR_Specifications::BINARY;
+        }
+    }
+    const auto skipWhitespace = [data, length](std::size_t position) {
+        while (position < length && std::isspace(static_cast<unsigned char>(data[position]))) {
+            position++;
+        }
+        return position;
+    };
+    const std::string snippetsKey = "\"snippets\"";
+    std::size_t position = skipWhitespace(0);
+    if (position < length && data[position] == '{') {
+        position = skipWhitespace(position + 1);
+        if (length - position >= snippetsKey.size() && snippetsKey.compare(0, snippetsKey.size(), data + position, snippetsKey.size()) == 0) {
+            return Config::VR_Specifications::SNIPPET;
+        }
+    }
+    return Config::VR_Specifications::BLOCKS;
+}
+
+std::unique_ptr<Project> ProjectSerializer::Read(const char* const data, const std::size_t length, const std::string& codebasePath,
+                                                 const Config::VR_Specifications specification, const ProgressCallback& progress) {
+    TRACE_SCOPE("ProjectSerializer::Read");
+    std::unique_ptr<Project> project = std::make_unique<Project>(codebasePath);
+    // Parsing (reported by bytes read) is the first 90%, adding what was read to the project the rest:
+    const ProgressCallback parseCallback = !progress ? ProgressCallback() :
+        [&progress](const std::size_t completed, const std::size_t total) {
+            return progress(total == 0 ? 0 : completed * 90 / total, 100);
+        };
+    const Progress parseProgress(parseCallback, length);
+    switch (specification) {
+        case Config::VR_Specifications::BLOCKS:
+            ReadProject<RecordSchema::Blocks>(data, length, *project, parseProgress);
+            break;
+        case Config::VR_Specifications::SNIPPET:
+            ReadProject<RecordSchema::Snippet>(data, length, *project, parseProgress);
+            break;
+        case Config::VR_Specifications::BINARY:
+            ReadProject<RecordSchema::Binary>(data, length, *project, parseProgress);
+            break;
+        default:
+            throw std::runtime_error("Unsupported serialization specification");
+    }
+    if (progress && !progress(100, 100)) {
+        throw OperationCancelled();
+    }
+    return project;
+}
@@ -0,0 +1,30 @@
+#ifndef PROJECTSERIALIZER_H
+#define PROJECTSERIALIZER_H
+#include <QIODevice>
+#include <memory>
+#include <string>
+#include "configuration.h"
+#include "progress.h"
+#include "project.h"
+
+// Whole projects in and out of each format: Blocks' own (JSON or binary, holding everything)
+// and Snippet's (SAND2019-10279R, annotations only: {"snippets": [...]}). The format is
+// dispatched on once per call, into code generated for it from RecordSchema. Writing renders
+// files in parallel a window at a time and writes them in order, so memory use is bounded by
+// the window rather than the size of the project. Blocks' formats only refer to annotations'
+// attachments (ProjectIO saves those alongside), Snippet's have them written into the contents.
+
+namespace ProjectSerializer {
+    // Streams 'project' to 'output', throws on failure.
+    void Write(const Project::Snapshot& project, Config::VR_Specifications specification, QIODevice& output,
+               const ProgressCallback& progress = nullptr);
+    // Builds the project of the codebase at 'codebasePath' stored in 'data', throws
+    // std::runtime_error if it's malformed.
+    std::unique_ptr<Project> Read(const char* data, std::size_t length, const std::string& codebasePath,
+                                  Config::VR_Specifications specification, const ProgressCallback& progress = nullptr);
+    // The format 'data' appears to be in: binary by its header, Snippet's by its top-level
+    // "snippets" key, otherwise Blocks' JSON. Read() checks it properly.
+    Config::VR_Specifications Detect(const char* data, std::size_t length);
+};
+
+#endif // PROJECTSERIALIZER_H
@@ -0,0 +1,58 @@
+#include "quickopendialog.h"
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+#include "configuration.h"
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+QuickOpenDialog::QuickOpenDialog(std::shared_ptr<FuzzyFinder> finder, QWidget* const parent) : QDialog(parent),
+    finder(std::move(finder)), queryEdit(new QLineEdit(this)), resultList(new QListWidget(this)) {
+    this->setWindowTitle("Go to File (" + QString::number(this->finder->PathCount()) + " files)");
+    this->queryEdit->setPlaceholderText("Type part of a path...");
+    this->queryEdit->installEventFilter(this);
+    this->resultList->setFocusPolicy(Qt::NoFocus);
+
+    QVBoxLayout* const layout = new QVBoxLayout(this);
+    layout->addWidget(this->queryEdit);
+    layout->addWidget(this->resultList);
+    this->resize(600, 400);
+
+    QObject::connect(this->queryEdit, SIGNAL(textEdited(QString)), this, SLOT(QueryEdited(QString)));
+    QObject::connect(this->queryEdit, SIGNAL(returnPressed()), this, SLOT(ChooseCurrent()));
+    QObject::connect(this->resultList, SIGNAL(itemDoubleClicked(QListWidgetItem*)), this, SLOT(ChooseCurrent()));
+}
+
+void QuickOpenDialog::QueryEdited(const QString& query) {
+    WATCHDOG_TRACE_SCOPE("QuickOpenDialog::QueryEdited");
+    // Spaces are only typed to separate parts of the query, paths rarely contain them:
+    const std::string pattern = QString(query).remove(' ').toStdString();
+    const std::vector<FuzzyFinder::Match> matches = this->finder->Find(pattern, Config::Navigation::QuickOpenResults);
+
+    this->resultList->clear();
+    for (const FuzzyFinder::Match& match : matches) {
+        this->resultList->addItem(QString::fromStdString(this->finder->Path(match.path)));
+    }
+    this->resultList->setCurrentRow(0);
+}
+
+void QuickOpenDialog::ChooseCurrent() {
+    const QListWidgetItem* const current = this->resultList->currentItem();
+    if (current == nullptr) {
+        return;
+    }
+    emit FileChosen(current->text());
+    this->accept();
+}
+
+bool QuickOpenDialog::eventFilter(QObject* const watched, QEvent* const event) {
+    // Keep typing in the query box while moving through the results:
+    if (watched == this->queryEdit && event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent*>(event)->key();
+        if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown) {
+            QCoreApplication::sendEvent(this->resultList, event);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
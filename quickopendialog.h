@@ -0,0 +1,32 @@
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+#include <QDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QObject>
+#include <QWidget>
+#include <memory>
+#include "fuzzyfinder.h"
+
+// The "go to file" palette, re-ranks the codebase's files against the query on every keystroke.
+// Up/Down move through the results while typing, Enter (or a double-click) picks one.
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    QuickOpenDialog(std::shared_ptr<FuzzyFinder> finder, QWidget* const parent = nullptr);
+signals:
+    void FileChosen(const QString& fileRef);
+private slots:
+    void QueryEdited(const QString& query);
+    void ChooseCurrent();
+private:
+    // Shared so that the catalogue can be replaced while the palette's open.
+    const std::shared_ptr<FuzzyFinder> finder;
+    QLineEdit* const queryEdit;
+    QListWidget* const resultList;
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+};
+
+#endif // QUICKOPENDIALOG_H
@@ -0,0 +1,227 @@
+#include "recordschema.h"
+#include <algorithm>
+
+void RecordSchema::AppendKeywords(std::string& output, const std::vector<std::string>& keywords) {
+    output += '[';
+    for (std::size_t i = 0; i < keywords.size(); i++) {
+        if (i != 0) {
+            output += ',';
+        }
+        JSONWriter::AppendString(output, keywords[i]);
+    }
+    output += ']';
+}
+
+void RecordSchema::ReadKeywords(JSONReader& input, std::vector<std::string>& keywords) {
+    if (!input.TryBeginArray()) {
+        return;
+    }
+    while (input.NextElement()) {
+        keywords.emplace_back();
+        input.ReadString(keywords.back());
+    }
+}
+
+void RecordSchema::AppendKeywords(std::string& output, const std::vector<std::string>& keywords, Binary) {
+    BinaryCodec::AppendUnsigned(output, keywords.size());
+    for (const std::string& keyword : keywords) {
+        BinaryCodec::AppendString(output, keyword);
+    }
+}
+
+void RecordSchema::ReadKeywords(BinaryCodec::Reader& input, std::vector<std::string>& keywords) {
+    // Each keyword is at least its length:
+    keywords.resize(input.ReadCount(sizeof(std::uint32_t)));
+    for (std::string& keyword : keywords) {
+        input.ReadString(keyword);
+    }
+}
+
+void RecordSchema::AppendHistory(std::string& output, const std::shared_ptr<const AnnotationHistory>& history, Blocks) {
+    // {"author": ..., "revisions": [...]}, full copies written as they are and deltas (being
+    // binary) in base64:
+    output += "{\"author\":";
+    JSONWriter::AppendString(output, history->LatestAuthor());
+    output += ",\"revisions\":[";
+    bool firstRevision = true;
+    for (const AnnotationHistory::StoredRevision& revision : history->GetStored()) {
+        output += firstRevision ? "{\"author\":" : ",{\"author\":";
+        firstRevision = false;
+        JSONWriter::AppendString(output, revision.author);
+        output += ",\"timestamp\":";
+        JSONWriter::AppendString(output, revision.timestamp);
+        if (revision.full) {
+            output += ",\"text\":";
+            JSONWriter::AppendString(output, revision.data);
+        }
+        else {
+            output += ",\"delta\":";
+            JSONWriter::AppendBase64(output, revision.data);
+        }
+        output += '}';
+    }
+    output += "]}";
+}
+
+void RecordSchema::ReadHistory(JSONReader& input, std::shared_ptr<const AnnotationHistory>& history) {
+    std::string latestAuthor;
+    std::vector<AnnotationHistory::StoredRevision> revisions;
+    std::string_view key;
+    if (!input.TryBeginObject()) {
+        return;
+    }
+    while (input.NextKey(key)) {
+        if (key == "author") {
+            input.ReadString(latestAuthor);
+        }
+        else if (key == "revisions" && input.TryBeginArray()) {
+            while (input.NextElement()) {
+                if (!input.TryBeginObject()) {
+                    continue;
+                }
+                AnnotationHistory::StoredRevision revision {};
+                revision.full = true; // Unless it has a "delta".
+                while (input.NextKey(key)) {
+                    if (key == "author") {
+                        input.ReadString(revision.author);
+                    }
+                    else if (key == "timestamp") {
+                        input.ReadString(revision.timestamp);
+                    }
+                    else if (key == "text") {
+                        input.ReadString(revision.data);
+                    }
+                    else if (key == "delta") {
+                        input.ReadBase64(revision.data);
+                        revision.full = false;
+                    }
+                    else {
+                        input.Skip();
+                    }
+                }
+                revisions.push_back(std::move(revision));
+            }
+        }
+        else if (key != "revisions") {
+            input.Skip();
+        }
+    }
+    history = AnnotationHistory::FromStored(std::move(latestAuthor), std::move(revisions));
+}
+
+void RecordSchema::AppendHistory(std::string& output, const std::shared_ptr<const AnnotationHistory>& history, Binary) {
+    // The number of earlier versions (0 for none), then who wrote the current one and each of them:
+    if (!history) {
+        BinaryCodec::AppendUnsigned(output, 0);
+        return;
+    }
+    BinaryCodec::AppendUnsigned(output, history->Count());
+    BinaryCodec::AppendString(output, history->LatestAuthor());
+    for (const AnnotationHistory::StoredRevision& revision : history->GetStored()) {
+        BinaryCodec::AppendString(output, revision.author);
+        BinaryCodec::AppendString(output, revision.timestamp);
+        BinaryCodec::AppendUnsigned(output, revision.full ? 1 : 0);
+        BinaryCodec::AppendString(output, revision.data);
+    }
+}
+
+void RecordSchema::ReadHistory(BinaryCodec::Reader& input, std::shared_ptr<const AnnotationHistory>& history) {
+    // Each revision is at least its three lengths and its flag:
+    const std::uint64_t count = input.ReadCount(3 * sizeof(std::uint32_t) + sizeof(std::uint64_t));
+    if (count == 0) {
+        return;
+    }
+    std::string latestAuthor;
+    input.ReadString(latestAuthor);
+    std::vector<AnnotationHistory::StoredRevision> revisions(count);
+    for (AnnotationHistory::StoredRevision& revision : revisions) {
+        input.ReadString(revision.author);
+        input.ReadString(revision.timestamp);
+        revision.full = input.ReadUnsigned() != 0;
+        input.ReadString(revision.data);
+    }
+    history = AnnotationHistory::FromStored(std::move(latestAuthor), std::move(revisions));
+}
+
+void RecordSchema::DropMentionedTags(Annotation& annotation) {
+    std::vector<std::string> tags = std::move(annotation.tags);
+    annotation.tags.clear();
+    annotation.UpdateKeywords();
+    for (std::string& tag : tags) {
+        if (!tag.empty() && std::find(annotation.keywords.cbegin(), annotation.keywords.cend(), tag) == annotation.keywords.cend() &&
+            std::find(annotation.tags.cbegin(), annotation.tags.cend(), tag) == annotation.tags.cend()) {
+            annotation.tags.push_back(std::move(tag));
+        }
+    }
+    // Recalculated (with the tags) when added to a collection:
+    annotation.keywords.clear();
+}
+
+void RecordSchema::AppendAttachments(std::string& output, const std::vector<Attachment>& attachments, Blocks) {
+    output += '[';
+    for (std::size_t i = 0; i < attachments.size(); i++) {
+        output += i == 0 ? "{\"id\":" : ",{\"id\":";
+        JSONWriter::AppendString(output, attachments[i].id);
+        output += ",\"name\":";
+        JSONWriter::AppendString(output, attachments[i].name);
+        output += ",\"size\":";
+        JSONWriter::AppendUnsigned(output, attachments[i].size);
+        output += ",\"lines\":";
+        JSONWriter::AppendUnsigned(output, attachments[i].lines);
+        output += '}';
+    }
+    output += ']';
+}
+
+void RecordSchema::ReadAttachments(JSONReader& input, std::vector<Attachment>& attachments) {
+    if (!input.TryBeginArray()) {
+        return;
+    }
+    std::string_view key;
+    while (input.NextElement()) {
+        if (!input.TryBeginObject()) {
+            continue;
+        }
+        Attachment attachment {};
+        while (input.NextKey(key)) {
+            if (key == "id") {
+                input.ReadString(attachment.id);
+            }
+            else if (key == "name") {
+                input.ReadString(attachment.name);
+            }
+            else if (key == "size") {
+                attachment.size = static_cast<std::size_t>(std::max<std::int64_t>(0, input.ReadInteger()));
+            }
+            else if (key == "lines") {
+                attachment.lines = static_cast<std::size_t>(std::max<std::int64_t>(0, input.ReadInteger()));
+            }
+            else {
+                input.Skip();
+            }
+        }
+        attachments.push_back(std::move(attachment));
+    }
+}
+
+void RecordSchema::AppendAttachments(std::string& output, const std::vector<Attachment>& attachments, Binary) {
+    BinaryCodec::AppendUnsigned(output, attachments.size());
+    for (const Attachment& attachment : attachments) {
+        BinaryCodec::AppendString(output, attachment.id);
+        BinaryCodec::AppendString(output, attachment.name);
+        BinaryCodec::AppendUnsigned(output, attachment.size);
+        BinaryCodec::AppendUnsigned(output, attachment.lines);
+    }
+}
+
+void RecordSchema::ReadAttachments(BinaryCodec::Reader& input, std::vector<Attachment>& attachments) {
+    // Each attachment is at least its two lengths and its two counts:
+    const std::uint64_t count = input.ReadCount(2 * sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t));
+    attachments.resize(count);
+    for (Attachment& attachment : attachments) {
+        input.ReadString(attachment.id);
+        input.ReadString(attachment.name);
+        attachment.size = input.ReadUnsigned();
+        attachment.lines = input.ReadUnsigned();
+    }
+}
@@ -0,0 +1,374 @@
+#ifndef RECORDSCHEMA_H
+#define RECORDSCHEMA_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include "annotation.h"
+#include "binarycodec.h"
+#include "bookmark.h"
+#include "jsonreader.h"
+#include "jsonwriter.h"
+
+// How Annotation and Bookmark records are laid out in each format they're saved in, described
+// at compile time: each Schema<Format, Record> lists its fields (which member, under what name,
+// when it's written) as a constexpr tuple, and AppendRecord()/ReadRecord() expand over it into
+// straight-line code for that format and record, with no per-record switching on the format
+// or building of intermediate objects. The project-level layout (files, excludes, coverage) is
+// ProjectSerializer's.
+//
+// Blocks and Snippet are JSON objects, keyed by field name, where optional fields can be left
+// out and fields can come in any order. Binary records are every field in order, unnamed.
+
+namespace RecordSchema {
+    // The formats:
+    struct Blocks {};
+    struct Snippet {}; // Sandia's SAND2019-10279R, annotations only.
+    struct Binary {};
+
+    template<typename Format>
+    constexpr bool IsJSON = !std::is_same<Format, Binary>::value;
+    template<typename Format>
+    using Source = std::conditional_t<IsJSON<Format>, JSONReader, BinaryCodec::Reader>;
+
+    enum class Presence {
+        ALWAYS,
+        UNLESS_EMPTY // Left out of JSON formats when empty/0.
+    };
+
+    // A member stored as it is (numbers being shifted up by 'offset' when stored).
+    template<typename Record, typename Value>
+    struct Field {
+        const char* name;
+        Value Record::* member;
+        Presence presence;
+        std::size_t offset;
+    };
+    template<typename Record, typename Value>
+    constexpr Field<Record, Value> Always(const char* name, Value Record::* member, const std::size_t offset = 0) {
+        return { name, member, Presence::ALWAYS, offset };
+    }
+    template<typename Record, typename Value>
+    constexpr Field<Record, Value> UnlessEmpty(const char* name, Value Record::* member) {
+        return { name, member, Presence::UNLESS_EMPTY, 0 };
+    }
+
+    // Anything else: written/read by functions of its own (in the format's encoding). These
+    // are (captureless) lambdas held by type rather than through function pointers, so that
+    // they're called directly and can be inlined into each record's expansion.
+    template<typename Record, typename Format, typename Present, typename Write, typename Read>
+    struct ComputedField {
+        const char* name;
+        Present present; // bool(const Record&), or nullptr to always write it.
+        Write write; // void(std::string& output, const Record&)
+        Read read; // void(Source<Format>& input, Record&), or nullptr to skip it when reading.
+    };
+    template<typename Record, typename Format, typename Present, typename Write, typename Read>
+    constexpr ComputedField<Record, Format, Present, Write, Read> Computed(const char* name, Present present, Write write, Read read) {
+        return { name, present, write, read };
+    }
+
+    // Each specialisation has 'Fields' and Finish(), run on each record once it's been read.
+    template<typename Format, typename Record>
+    struct Schema;
+
+    // Encodings of the fields that need them:
+    void AppendKeywords(std::string& output, const std::vector<std::string>& keywords);
+    void ReadKeywords(JSONReader& input, std::vector<std::string>& keywords);
+    void AppendKeywords(std::string& output, const std::vector<std::string>& keywords, Binary);
+    void ReadKeywords(BinaryCodec::Reader& input, std::vector<std::string>& keywords);
+    void AppendHistory(std::string& output, const std::shared_ptr<const AnnotationHistory>& history, Blocks);
+    void ReadHistory(JSONReader& input, std::shared_ptr<const AnnotationHistory>& history);
+    void AppendHistory(std::string& output, const std::shared_ptr<const AnnotationHistory>& history, Binary);
+    void ReadHistory(BinaryCodec::Reader& input, std::shared_ptr<const AnnotationHistory>& history);
+    void AppendAttachments(std::string& output, const std::vector<Attachment>& attachments, Blocks);
+    void ReadAttachments(JSONReader& input, std::vector<Attachment>& attachments);
+    void AppendAttachments(std::string& output, const std::vector<Attachment>& attachments, Binary);
+    void ReadAttachments(BinaryCodec::Reader& input, std::vector<Attachment>& attachments);
+    // Drops the Snippet tags (read into 'tags') that the contents already mention as #tags.
+    void DropMentionedTags(Annotation& annotation);
+
+    template<>
+    struct Schema<Blocks, Annotation> {
+        // Snippet's metadata is only written when present to keep Blocks' projects compact, as
+        // are the rest of range annotations' spans:
+        constexpr static auto Fields = std::make_tuple(
+            Always("line", &Annotation::lineRef),
+            Computed<Annotation, Blocks>(
+                "endLine",
+                [](const Annotation& annotation) { return annotation.endLineRef > annotation.lineRef; },
+                [](std::string& output, const Annotation& annotation) { JSONWriter::AppendUnsigned(output, annotation.endLineRef); },
+                [](JSONReader& input, Annotation& annotation) {
+                    const std::int64_t endLine = input.ReadInteger();
+                    annotation.endLineRef = endLine > 0 ? static_cast<std::size_t>(endLine) : 0;
+                }
+            ),
+            UnlessEmpty("startColumn", &Annotation::startColumn),
+            UnlessEmpty("endColumn", &Annotation::endColumn),
+            Always("contents", &Annotation::contents),
+            // Derived from the contents on loading, written for other tools' sake:
+            Computed<Annotation, Blocks>(
+                "keywords", nullptr,
+                [](std::string& output, const Annotation& annotation) { AppendKeywords(output, annotation.keywords); },
+                nullptr
+            ),
+            Computed<Annotation, Blocks>(
+                "tags",
+                [](const Annotation& annotation) { return !annotation.tags.empty(); },
+                [](std::string& output, const Annotation& annotation) { AppendKeywords(output, annotation.tags); },
+                [](JSONReader& input, Annotation& annotation) { ReadKeywords(input, annotation.tags); }
+            ),
+            UnlessEmpty("id", &Annotation::id),
+            UnlessEmpty("author", &Annotation::author),
+            UnlessEmpty("created", &Annotation::createdTimestamp),
+            UnlessEmpty("modified", &Annotation::modifiedTimestamp),
+            UnlessEmpty("version", &Annotation::fileVersion),
+            Computed<Annotation, Blocks>(
+                "history",
+                [](const Annotation& annotation) { return annotation.history != nullptr; },
+                [](std::string& output, const Annotation& annotation) { AppendHistory(output, annotation.history, Blocks()); },
+                [](JSONReader& input, Annotation& annotation) { ReadHistory(input, annotation.history); }
+            ),
+            // Just the references, the attachments themselves are kept alongside by AttachmentStore:
+            Computed<Annotation, Blocks>(
+                "attachments",
+                [](const Annotation& annotation) { return !annotation.attachments.empty(); },
+                [](std::string& output, const Annotation& annotation) { AppendAttachments(output, annotation.attachments, Blocks()); },
+                [](JSONReader& input, Annotation& annotation) { ReadAttachments(input, annotation.attachments); }
+            )
+        );
+        static void Finish(Annotation&) {}
+    };
+
+    template<>
+    struct Schema<Blocks, Bookmark> {
+        constexpr static auto Fields = std::make_tuple(
+            Always("line", &Bookmark::lineRef)
+        );
+        static void Finish(Bookmark&) {}
+    };
+
+    // Snippet has nowhere to keep attachments, ProjectSerializer writes them into the contents.
+    template<>
+    struct Schema<Snippet, Annotation> {
+        constexpr static auto Fields = std::make_tuple(
+            Always("id", &Annotation::id), // DB table index, often numeric when read.
+            Always("filename", &Annotation::fileRef), // Relative to the codebase.
+            Always("linenum", &Annotation::lineRef, 1), // Indexed from 1.
+            Always("txt", &Annotation::contents),
+            Always("author", &Annotation::author),
+            Always("timestamp", &Annotation::modifiedTimestamp),
+            Always("ctimestamp", &Annotation::createdTimestamp),
+            Computed<Annotation, Snippet>(
+                "tags", nullptr,
+                [](std::string& output, const Annotation& annotation) { AppendKeywords(output, annotation.UniqueKeywords()); },
+                [](JSONReader& input, Annotation& annotation) { ReadKeywords(input, annotation.tags); }
+            ),
+            Always("version", &Annotation::fileVersion) // Of the *file*, not of Blocks or Snippet.
+        );
+        static void Finish(Annotation& annotation) {
+            DropMentionedTags(annotation);
+        }
+    };
+
+    template<>
+    struct Schema<Binary, Annotation> {
+        // 'fileRef' is stored once per file and 'keywords' rebuilt from the contents (and 'tags').
+        constexpr static auto Fields = std::make_tuple(
+            Always("line", &Annotation::lineRef),
+            Always("endLine", &Annotation::endLineRef),
+            Always("startColumn", &Annotation::startColumn),
+            Always("endColumn", &Annotation::endColumn),
+            Always("contents", &Annotation::contents),
+            Always("id", &Annotation::id),
+            Always("author", &Annotation::author),
+            Always("created", &Annotation::createdTimestamp),
+            Always("modified", &Annotation::modifiedTimestamp),
+            Always("version", &Annotation::fileVersion),
+            Computed<Annotation, Binary>(
+                "tags", nullptr,
+                [](std::string& output, const Annotation& annotation) { AppendKeywords(output, annotation.tags, Binary()); },
+                [](BinaryCodec::Reader& input, Annotation& annotation) { ReadKeywords(input, annotation.tags); }
+            ),
+            Computed<Annotation, Binary>(
+                "history", nullptr,
+                [](std::string& output, const Annotation& annotation) { AppendHistory(output, annotation.history, Binary()); },
+                [](BinaryCodec::Reader& input, Annotation& annotation) { ReadHistory(input, annotation.history); }
+            ),
+            Computed<Annotation, Binary>(
+                "attachments", nullptr,
+                [](std::string& output, const Annotation& annotation) { AppendAttachments(output, annotation.attachments, Binary()); },
+                [](BinaryCodec::Reader& input, Annotation& annotation) { ReadAttachments(input, annotation.attachments); }
+            )
+        );
+        static void Finish(Annotation&) {}
+    };
+
+    template<>
+    struct Schema<Binary, Bookmark> {
+        constexpr static auto Fields = std::make_tuple(
+            Always("line", &Bookmark::lineRef)
+        );
+        static void Finish(Bookmark&) {}
+    };
+
+    namespace Detail {
+        template<typename Record, typename Value>
+        bool IsPresent(const Record& record, const Field<Record, Value>& field) {
+            if (field.presence == Presence::ALWAYS) {
+                return true;
+            }
+            if constexpr (std::is_same<Value, std::string>::value) {
+                return !(record.*field.member).empty();
+            }
+            else {
+                return record.*field.member != 0;
+            }
+        }
+        template<typename Record, typename Format, typename Present, typename Write, typename Read>
+        bool IsPresent(const Record& record, const ComputedField<Record, Format, Present, Write, Read>& field) {
+            if constexpr (std::is_null_pointer<Present>::value) {
+                return true;
+            }
+            else {
+                return field.present(record);
+            }
+        }
+
+        // Field names are plain identifiers, so they're written without escaping:
+        inline void AppendKey(std::string& output, const char* const name, char& separator) {
+            output += separator;
+            separator = ',';
+            output += '"';
+            output += name;
+            output += "\":";
+        }
+
+        template<typename Record, typename Value>
+        void AppendJSON(std::string& output, const Record& record, const Field<Record, Value>& field, char& separator) {
+            if (!IsPresent(record, field)) {
+                return;
+            }
+            AppendKey(output, field.name, separator);
+            if constexpr (std::is_same<Value, std::string>::value) {
+                JSONWriter::AppendString(output, record.*field.member);
+            }
+            else {
+                JSONWriter::AppendUnsigned(output, record.*field.member + field.offset);
+            }
+        }
+        template<typename Record, typename Format, typename Present, typename Write, typename Read>
+        void AppendJSON(std::string& output, const Record& record, const ComputedField<Record, Format, Present, Write, Read>& field,
+                        char& separator) {
+            if (!IsPresent(record, field)) {
+                return;
+            }
+            AppendKey(output, field.name, separator);
+            field.write(output, record);
+        }
+
+        template<typename Record, typename Value>
+        void AppendBinary(std::string& output, const Record& record, const Field<Record, Value>& field) {
+            if constexpr (std::is_same<Value, std::string>::value) {
+                BinaryCodec::AppendString(output, record.*field.member);
+            }
+            else {
+                BinaryCodec::AppendUnsigned(output, record.*field.member + field.offset);
+            }
+        }
+        template<typename Record, typename Format, typename Present, typename Write, typename Read>
+        void AppendBinary(std::string& output, const Record& record, const ComputedField<Record, Format, Present, Write, Read>& field) {
+            field.write(output, record);
+        }
+
+        // Reads 'field' if it's the one named 'key'.
+        template<typename Record, typename Value>
+        bool ReadJSON(JSONReader& input, Record& record, const Field<Record, Value>& field, const std::string_view key) {
+            if (key != field.name) {
+                return false;
+            }
+            if constexpr (std::is_same<Value, std::string>::value) {
+                input.ReadString(record.*field.member);
+            }
+            else {
+                // Anything that would be before the first line/column is taken to be on it:
+                const std::int64_t value = input.ReadInteger();
+                record.*field.member = value > static_cast<std::int64_t>(field.offset) ?
+                    static_cast<Value>(value - static_cast<std::int64_t>(field.offset)) : 0;
+            }
+            return true;
+        }
+        template<typename Record, typename Format, typename Present, typename Write, typename Read>
+        bool ReadJSON(JSONReader& input, Record& record, const ComputedField<Record, Format, Present, Write, Read>& field,
+                      const std::string_view key) {
+            if (key != field.name) {
+                return false;
+            }
+            if constexpr (std::is_null_pointer<Read>::value) {
+                input.Skip();
+            }
+            else {
+                field.read(input, record);
+            }
+            return true;
+        }
+
+        template<typename Record, typename Value>
+        void ReadBinary(BinaryCodec::Reader& input, Record& record, const Field<Record, Value>& field) {
+            if constexpr (std::is_same<Value, std::string>::value) {
+                input.ReadString(record.*field.member);
+            }
+            else {
+                record.*field.member = static_cast<Value>(input.ReadUnsigned() - field.offset);
+            }
+        }
+        template<typename Record, typename Format, typename Present, typename Write, typename Read>
+        void ReadBinary(BinaryCodec::Reader& input, Record& record, const ComputedField<Record, Format, Present, Write, Read>& field) {
+            field.read(input, record);
+        }
+    };
+
+    // Appends 'record' to 'output' in 'Format'.
+    template<typename Format, typename Record>
+    void AppendRecord(std::string& output, const Record& record) {
+        if constexpr (IsJSON<Format>) {
+            char separator = '{';
+            std::apply([&](const auto&... fields) {
+                (Detail::AppendJSON(output, record, fields, separator), ...);
+            }, Schema<Format, Record>::Fields);
+            output += separator == '{' ? "{}" : "}";
+        }
+        else {
+            std::apply([&](const auto&... fields) {
+                (Detail::AppendBinary(output, record, fields), ...);
+            }, Schema<Format, Record>::Fields);
+        }
+    }
+
+    // Reads the next record from 'input' into 'record' (which fields missing from JSON formats
+    // are left as), throws std::runtime_error if it's malformed.
+    template<typename Format, typename Record>
+    void ReadRecord(Source<Format>& input, Record& record) {
+        if constexpr (IsJSON<Format>) {
+            input.BeginObject();
+            std::string_view key;
+            while (input.NextKey(key)) {
+                const bool known = std::apply([&](const auto&... fields) {
+                    return (Detail::ReadJSON(input, record, fields, key) || ...);
+                }, Schema<Format, Record>::Fields);
+                if (!known) {
+                    input.Skip();
+                }
+            }
+        }
+        else {
+            std::apply([&](const auto&... fields) {
+                (Detail::ReadBinary(input, record, fields), ...);
+            }, Schema<Format, Record>::Fields);
+        }
+        Schema<Format, Record>::Finish(record);
+    }
+};
+
+#endif // RECORDSCHEMA_H
@@ -0,0 +1,280 @@
+#include "reportgenerator.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <unordered_set>
+#include "pagedfile.h"
+#include "parallel.h"
+#include "tracing.h"
+
+namespace {
+    // Everything found in one file, used in place from the snapshot.
+    struct FileFindings {
+        std::string fileRef;
+        const std::vector<Annotation>* annotations;
+        const std::vector<Bookmark>* bookmarks;
+    };
+
+    // Either an annotation (by its index within the file) or a bookmark.
+    struct Finding {
+        const Annotation* annotation; // Null for bookmarks.
+        std::size_t annotationIndex;
+        std::size_t lineRef;
+        std::size_t endLineRef;
+    };
+
+    const static std::string HTMLStyle =
+        "body{font-family:sans-serif;margin:2em;}"
+        "pre{background:#f6f6f6;padding:0.5em;overflow-x:auto;}"
+        "pre.note{background:#eef;white-space:pre-wrap;}"
+        "mark{background:#dde;display:inline-block;width:100%;}"
+        ".attachment{color:#555;font-style:italic;}"
+        ".kind{color:#888;font-weight:normal;font-size:0.8em;}";
+
+    void AppendEscaped(std::string& output, const std::string& text) {
+        for (const char c : text) {
+            switch (c) {
+                case '&': output += "&amp;"; break;
+                case '<': output += "&lt;"; break;
+                case '>': output += "&gt;"; break;
+                case '"': output += "&quot;"; break;
+                default: output += c; break;
+            }
+        }
+    }
+
+    std::string Anchor(const std::size_t fileIndex, const std::size_t annotationIndex) {
+        return "f" + std::to_string(fileIndex) + "-a" + std::to_string(annotationIndex);
+    }
+
+    std::string LineSpan(const Finding& finding) {
+        return finding.endLineRef > finding.lineRef ?
+            "Lines " + std::to_string(finding.lineRef) + "-" + std::to_string(finding.endLineRef) : "Line " + std::to_string(finding.lineRef);
+    }
+
+    std::size_t LongestBacktickRun(const std::string& text) {
+        std::size_t longestRun = 0;
+        std::size_t run = 0;
+        for (const char c : text) {
+            run = c == '`' ? run + 1 : 0;
+            longestRun = std::max(longestRun, run);
+        }
+        return longestRun;
+    }
+
+    // A Markdown code fence longer than any run of backticks in 'lines'.
+    std::string Fence(const std::vector<std::string>& lines) {
+        std::size_t longestRun = 0;
+        for (const std::string& line : lines) {
+            longestRun = std::max(longestRun, LongestBacktickRun(line));
+        }
+        return std::string(std::max<std::size_t>(3, longestRun + 1), '`');
+    }
+
+    // 'text' as an inline Markdown code span, delimited by more backticks than it contains in a
+    // row. Text that starts or ends with a backtick is padded with a space either side, which
+    // Markdown strips again, so that it isn't taken as part of the delimiter.
+    std::string CodeSpan(const std::string& text) {
+        const std::string delimiter(LongestBacktickRun(text) + 1, '`');
+        const bool padded = !text.empty() && (text.front() == '`' || text.back() == '`');
+        return padded ? delimiter + " " + text + " " + delimiter : delimiter + text + delimiter;
+    }
+
+    void RenderFile(std::string& output, const FileFindings& file, const std::size_t fileIndex, const std::string& codebasePath,
+                    const ReportGenerator::Options& options) {
+        std::vector<Finding> findings;
+        findings.reserve(file.annotations->size() + file.bookmarks->size());
+        for (std::size_t i = 0; i < file.annotations->size(); i++) {
+            const Annotation& annotation = (*file.annotations)[i];
+            findings.push_back(Finding {
+                .annotation = &annotation, .annotationIndex = i, .lineRef = annotation.lineRef, .endLineRef = annotation.endLineRef
+            });
+        }
+        for (const Bookmark& bookmark : *file.bookmarks) {
+            findings.push_back(Finding { .annotation = nullptr, .annotationIndex = 0, .lineRef = bookmark.lineRef, .endLineRef = bookmark.lineRef });
+        }
+        // Annotations before bookmarks on the same line:
+        std::stable_sort(findings.begin(), findings.end(), [](const Finding& a, const Finding& b) {
+            return a.lineRef < b.lineRef;
+        });
+
+        const bool html = options.format == ReportGenerator::Format::HTML;
+        if (html) {
+            output += "<section><h3>";
+            AppendEscaped(output, file.fileRef);
+            output += "</h3>\n";
+        }
+        else {
+            output += "### " + CodeSpan(file.fileRef) + "\n\n";
+        }
+
+        // Findings are in line order, so this is a single pass over the file:
+        const std::string path = codebasePath + file.fileRef;
+        PagedFile pagedFile(path, false, Project::GetLineIndexCachePath(options.cacheDirectory, file.fileRef, path));
+        for (const Finding& finding : findings) {
+            const std::string kind = finding.annotation != nullptr ? "annotation" : "bookmark";
+            if (html) {
+                output += finding.annotation != nullptr ? "<article id=\"" + Anchor(fileIndex, finding.annotationIndex) + "\">" : "<article>";
+                output += "<h4>" + LineSpan(finding) + " <span class=\"kind\">" + kind + "</span></h4>\n";
+                if (finding.annotation != nullptr) {
+                    output += "<pre class=\"note\">";
+                    AppendEscaped(output, finding.annotation->contents);
+                    output += "</pre>\n";
+                    for (const Attachment& attachment : finding.annotation->attachments) {
+                        output += "<p class=\"attachment\">Attached: ";
+                        AppendEscaped(output, AttachmentStore::Describe(attachment));
+                        output += "</p>\n";
+                    }
+                }
+            }
+            else {
+                output += "#### " + LineSpan(finding) + " (" + kind + ")\n\n";
+                if (finding.annotation != nullptr) {
+                    output += "> ";
+                    for (const char c : finding.annotation->contents) {
+                        output += c;
+                        if (c == '\n') {
+                            output += "> ";
+                        }
+                    }
+                    output += "\n\n";
+                    for (const Attachment& attachment : finding.annotation->attachments) {
+                        output += "Attached: " + CodeSpan(AttachmentStore::Describe(attachment)) + "\n\n";
+                    }
+                }
+            }
+
+            // The finding's lines and some context either side, the finding's own marked:
+            const std::size_t firstLine = finding.lineRef > options.contextLines ? finding.lineRef - options.contextLines : 0;
+            const std::vector<std::string> lines = pagedFile.ReadLines(firstLine, finding.endLineRef + options.contextLines + 1 - firstLine);
+            const std::size_t numberWidth = std::to_string(firstLine + lines.size()).size();
+            const std::string fence = html ? "" : Fence(lines);
+            output += html ? "<pre class=\"code\">" : fence + "\n";
+            for (std::size_t i = 0; i < lines.size(); i++) {
+                const std::size_t line = firstLine + i;
+                const bool marked = line >= finding.lineRef && line <= finding.endLineRef;
+                std::string number = std::to_string(line);
+                number.insert(0, numberWidth - number.size(), ' ');
+                if (html) {
+                    output += marked ? "<mark>" : "";
+                    output += number + " | ";
+                    AppendEscaped(output, lines[i]);
+                    output += marked ? "</mark>\n" : "\n";
+                }
+                else {
+                    output += (marked ? ">" : " ") + number + " | " + lines[i] + "\n";
+                }
+            }
+            output += html ? "</pre></article>\n" : fence + "\n\n";
+        }
+        if (html) {
+            output += "</section>\n";
+        }
+    }
+}
+
+void ReportGenerator::Write(const Project::Snapshot& project, const Options& options, QIODevice& output, const ProgressCallback& progress) {
+    TRACE_SCOPE("ReportGenerator::Write");
+    const bool html = options.format == Format::HTML;
+
+    // Every file with something in it, in path order:
+    std::vector<FileFindings> files;
+    std::unordered_set<std::string> seenFiles;
+    project.annotations->ForEach([&](const std::string& fileRef, const std::vector<Annotation>&) {
+        if (seenFiles.insert(fileRef).second) {
+            files.push_back(FileFindings { .fileRef = fileRef, .annotations = nullptr, .bookmarks = nullptr });
+        }
+    });
+    project.bookmarks->ForEach([&](const std::string& fileRef, const std::vector<Bookmark>&) {
+        if (seenFiles.insert(fileRef).second) {
+            files.push_back(FileFindings { .fileRef = fileRef, .annotations = nullptr, .bookmarks = nullptr });
+        }
+    });
+    std::sort(files.begin(), files.end(), [](const FileFindings& a, const FileFindings& b) {
+        return a.fileRef < b.fileRef;
+    });
+    for (FileFindings& file : files) {
+        file.annotations = &project.annotations->Get(file.fileRef);
+        file.bookmarks = &project.bookmarks->Get(file.fileRef);
+    }
+
+    const auto writeBytes = [&output](const std::string& bytes) {
+        if (output.write(bytes.data(), static_cast<qint64>(bytes.size())) != static_cast<qint64>(bytes.size())) {
+            throw std::runtime_error("Unable to write the report");
+        }
+    };
+
+    // The summary and tag index only need the annotations themselves, not the files:
+    std::map<std::string, std::vector<std::pair<std::size_t /* File Index */, std::size_t /* Annotation Index */>>> tags;
+    for (std::size_t fileIndex = 0; fileIndex < files.size(); fileIndex++) {
+        for (std::size_t i = 0; i < files[fileIndex].annotations->size(); i++) {
+            for (const std::string& keyword : (*files[fileIndex].annotations)[i].UniqueKeywords()) {
+                tags[keyword].emplace_back(fileIndex, i);
+            }
+        }
+    }
+    const std::string summary = std::to_string(project.annotations->ItemCount()) + " annotation(s) and " +
+        std::to_string(project.bookmarks->ItemCount()) + " bookmark(s) in " + std::to_string(files.size()) + " file(s)";
+    std::string rendered;
+    if (html) {
+        rendered += "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Review report</title><style>" + HTMLStyle +
+                    "</style></head><body>\n<h1>Review report</h1>\n<p>" + summary + " of <code>";
+        AppendEscaped(rendered, project.codebasePath);
+        rendered += "</code>.</p>\n<h2>Tags</h2>\n<ul>\n";
+    }
+    else {
+        rendered += "# Review report\n\n" + summary + " of " + CodeSpan(project.codebasePath) + ".\n\n## Tags\n\n";
+    }
+    for (const std::pair<const std::string, std::vector<std::pair<std::size_t, std::size_t>>>& tag : tags) {
+        if (html) {
+            rendered += "<li><code>#";
+            AppendEscaped(rendered, tag.first);
+            rendered += "</code> (" + std::to_string(tag.second.size()) + "):";
+        }
+        else {
+            rendered += "- " + CodeSpan("#" + tag.first) + " (" + std::to_string(tag.second.size()) + "):";
+        }
+        for (std::size_t i = 0; i < tag.second.size(); i++) {
+            const FileFindings& file = files[tag.second[i].first];
+            const std::string location = file.fileRef + ":" + std::to_string((*file.annotations)[tag.second[i].second].lineRef);
+            rendered += i == 0 ? " " : ", ";
+            if (html) {
+                rendered += "<a href=\"#" + Anchor(tag.second[i].first, tag.second[i].second) + "\">";
+                AppendEscaped(rendered, location);
+                rendered += "</a>";
+            }
+            else {
+                rendered += CodeSpan(location);
+            }
+        }
+        rendered += html ? "</li>\n" : "\n";
+        // Flushed as it goes, a big project's index is far from small:
+        if (rendered.size() > PagedFile::PageSize) {
+            writeBytes(rendered);
+            rendered.clear();
+        }
+    }
+    rendered += html ? "</ul>\n<h2>Files</h2>\n" : "\n## Files\n\n";
+    writeBytes(rendered);
+
+    const std::size_t windowSize = Parallel::WorkerCount() * 8;
+    std::vector<std::string> renderedFiles(windowSize);
+    for (std::size_t windowStart = 0; windowStart < files.size(); windowStart += windowSize) {
+        if (progress && !progress(windowStart, files.size())) {
+            throw OperationCancelled();
+        }
+
+        const std::size_t windowLength = std::min(windowSize, files.size() - windowStart);
+        Parallel::For(windowLength, [&](const std::size_t i) {
+            renderedFiles[i].clear();
+            RenderFile(renderedFiles[i], files[windowStart + i], windowStart + i, project.codebasePath, options);
+        });
+        for (std::size_t i = 0; i < windowLength; i++) {
+            writeBytes(renderedFiles[i]);
+        }
+    }
+    writeBytes(html ? "</body></html>\n" : "");
+    if (progress) {
+        progress(files.size(), files.size());
+    }
+}
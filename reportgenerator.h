@@ -0,0 +1,30 @@
+#ifndef REPORTGENERATOR_H
+#define REPORTGENERATOR_H
+#include <QIODevice>
+#include <filesystem>
+#include "progress.h"
+#include "project.h"
+
+// Audit reports: every annotation and bookmark in a project alongside the code around it, as
+// HTML or Markdown. Findings are grouped by file (in path order, each file's by line) after an
+// index of the annotations by tag. Like ProjectSerializer, files are rendered in parallel a
+// window at a time and written in order, so memory use is bounded by the window rather than
+// the size of the project. Each file is read through a PagedFile, reusing its cached line index
+// if it has one.
+
+namespace ReportGenerator {
+    enum class Format {
+        HTML,
+        MARKDOWN
+    };
+
+    struct Options {
+        Format format;
+        std::size_t contextLines; // Either side of each finding.
+        std::filesystem::path cacheDirectory; // The project's, for line indexes.
+    };
+
+    void Write(const Project::Snapshot& project, const Options& options, QIODevice& output, const ProgressCallback& progress = nullptr);
+};
+
+#endif // REPORTGENERATOR_H
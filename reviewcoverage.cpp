@@ -0,0 +1,159 @@
+#include "reviewcoverage.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include "parallel.h"
+#include "textkernels.h"
+#include "tracing.h"
+
+namespace {
+    // Bytes read at a time when counting lines.
+    const static std::size_t CountingBufferSize = 1 << 20;
+
+    // Reviewed lines that count towards the totals.
+    std::size_t CountedLines(const ReviewCoverage::File& file) {
+        return file.lineCount == 0 ? 0 : file.reviewed.Count();
+    }
+
+    std::size_t EntryBytes(const std::string& fileRef, const ReviewCoverage::File& file) {
+        return sizeof(ReviewCoverage::Files::value_type) + MemoryAccounting::StringHeapBytes(fileRef) + file.reviewed.HeapBytes();
+    }
+}
+
+ReviewCoverage::ReviewCoverage() : account(MemoryAccounting::COLLECTIONS, "review coverage") {}
+
+std::size_t ReviewCoverage::MarkReviewed(const std::string& fileRef, const std::size_t firstLine, std::size_t endLine) {
+    Files::iterator fileEntry = this->files.find(fileRef);
+    if (fileEntry == this->files.end()) {
+        fileEntry = this->files.emplace(fileRef, File()).first;
+        this->heapBytes += EntryBytes(fileRef, fileEntry->second);
+    }
+    File& file = fileEntry->second;
+    if (file.lineCount != 0) {
+        endLine = std::min(endLine, file.lineCount);
+    }
+
+    const std::size_t countedBefore = CountedLines(file);
+    const std::size_t lineCountBefore = file.lineCount;
+    const std::size_t bytesBefore = EntryBytes(fileRef, file);
+    const std::size_t added = file.reviewed.Insert(firstLine, endLine);
+    this->Update(fileEntry, countedBefore, lineCountBefore, bytesBefore);
+    return added;
+}
+
+std::size_t ReviewCoverage::MarkUnreviewed(const std::string& fileRef, const std::size_t firstLine, const std::size_t endLine) {
+    const Files::iterator fileEntry = this->files.find(fileRef);
+    if (fileEntry == this->files.end()) {
+        return 0;
+    }
+    File& file = fileEntry->second;
+
+    const std::size_t countedBefore = CountedLines(file);
+    const std::size_t lineCountBefore = file.lineCount;
+    const std::size_t bytesBefore = EntryBytes(fileRef, file);
+    const std::size_t removed = file.reviewed.Erase(firstLine, endLine);
+    this->Update(fileEntry, countedBefore, lineCountBefore, bytesBefore);
+    return removed;
+}
+
+void ReviewCoverage::SetLineCount(const std::string& fileRef, const std::size_t lineCount) {
+    Files::iterator fileEntry = this->files.find(fileRef);
+    if (fileEntry == this->files.end()) {
+        if (lineCount == 0) {
+            return;
+        }
+        fileEntry = this->files.emplace(fileRef, File()).first;
+        this->heapBytes += EntryBytes(fileRef, fileEntry->second);
+    }
+    File& file = fileEntry->second;
+    if (file.lineCount == lineCount) {
+        return;
+    }
+
+    const std::size_t countedBefore = CountedLines(file);
+    const std::size_t lineCountBefore = file.lineCount;
+    const std::size_t bytesBefore = EntryBytes(fileRef, file);
+    file.lineCount = lineCount;
+    if (lineCount != 0) {
+        file.reviewed.Erase(lineCount, std::numeric_limits<std::size_t>::max());
+    }
+    this->Update(fileEntry, countedBefore, lineCountBefore, bytesBefore);
+}
+
+void ReviewCoverage::Update(const Files::iterator fileEntry, const std::size_t countedBefore,
+                            const std::size_t lineCountBefore, const std::size_t bytesBefore) {
+    const std::string& fileRef = fileEntry->first;
+    const File& file = fileEntry->second;
+
+    const std::size_t counted = CountedLines(file);
+    if (counted > countedBefore) {
+        this->reviewedLines.Add(fileRef, counted - countedBefore);
+    }
+    else if (counted < countedBefore) {
+        this->reviewedLines.Remove(fileRef, countedBefore - counted);
+    }
+    if (file.lineCount != lineCountBefore) {
+        if (lineCountBefore != 0) {
+            this->knownLines.Remove(fileRef, lineCountBefore);
+        }
+        if (file.lineCount != 0) {
+            this->knownLines.Add(fileRef, file.lineCount);
+        }
+    }
+
+    this->heapBytes = this->heapBytes - bytesBefore + EntryBytes(fileRef, file);
+    // Nothing left worth keeping:
+    if (file.lineCount == 0 && file.reviewed.Empty()) {
+        this->heapBytes -= EntryBytes(fileRef, file);
+        this->files.erase(fileEntry);
+    }
+    this->account.Set(this->heapBytes);
+}
+
+const IntervalSet& ReviewCoverage::GetReviewed(const std::string& fileRef) const {
+    const static IntervalSet nothingReviewed;
+    const Files::const_iterator fileEntry = this->files.find(fileRef);
+    return fileEntry == this->files.cend() ? nothingReviewed : fileEntry->second.reviewed;
+}
+
+const ReviewCoverage::Files& ReviewCoverage::GetFiles() const {
+    return this->files;
+}
+
+std::size_t ReviewCoverage::ReviewedUnder(const std::string& path) const {
+    return this->reviewedLines.Get(path);
+}
+
+std::size_t ReviewCoverage::LinesUnder(const std::string& path) const {
+    return this->knownLines.Get(path);
+}
+
+std::vector<std::size_t> ReviewCoverage::CountLines(const std::string& codebasePath, const std::vector<std::string>& fileRefs,
+                                                    const std::atomic<bool>& cancelled) {
+    TRACE_SCOPE("ReviewCoverage::CountLines");
+    std::vector<std::size_t> lineCounts(fileRefs.size(), 0);
+    Parallel::For(fileRefs.size(), [&](const std::size_t i) {
+        if (cancelled) {
+            return;
+        }
+        std::ifstream file(codebasePath + fileRefs[i], std::ios::binary);
+        if (!file) {
+            return;
+        }
+        // Lines end with a '\n' bar the last, which only counts if there's something on it:
+        thread_local std::vector<char> buffer(CountingBufferSize);
+        std::size_t newlines = 0;
+        char lastByte = '\n';
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const std::size_t read = static_cast<std::size_t>(file.gcount());
+            if (read == 0) {
+                break;
+            }
+            newlines += TextKernels::CountByte(buffer.data(), buffer.data() + read, '\n');
+            lastByte = buffer[read - 1];
+        }
+        lineCounts[i] = newlines + (lastByte != '\n' ? 1 : 0);
+    });
+    return lineCounts;
+}
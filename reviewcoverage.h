@@ -0,0 +1,60 @@
+#ifndef REVIEWCOVERAGE_H
+#define REVIEWCOVERAGE_H
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "configuration.h"
+#include "intervalset.h"
+#include "memoryaccounting.h"
+#include "pathcounts.h"
+
+// Which lines of each file have been reviewed (scrolled past or explicitly marked in a
+// CodeEditor), as an IntervalSet per file. Alongside are running per-path totals of reviewed
+// and known lines, updated by every change, so a file's or directory's (or the codebase's)
+// coverage is a pair of lookups however big it is.
+//
+// A file's lines only count towards the totals once its length is known (SetLineCount()),
+// until then whatever's been reviewed in it is kept but not reported.
+
+class ReviewCoverage {
+public:
+    struct File {
+        std::size_t lineCount = 0; // 0 until known.
+        IntervalSet reviewed;
+    };
+    typedef std::unordered_map<std::string /* File Path */, File> Files;
+
+    ReviewCoverage();
+
+    // Marks/unmarks the lines [firstLine, endLine) of 'fileRef' (clamped to its length, once
+    // known), returns the number of lines that changed.
+    std::size_t MarkReviewed(const std::string& fileRef, std::size_t firstLine, std::size_t endLine);
+    std::size_t MarkUnreviewed(const std::string& fileRef, std::size_t firstLine, std::size_t endLine);
+    // Lines reviewed past the (new) end of the file are dropped.
+    void SetLineCount(const std::string& fileRef, std::size_t lineCount);
+
+    const IntervalSet& GetReviewed(const std::string& fileRef) const;
+    const Files& GetFiles() const;
+    // Reviewed/known lines in the file/directory 'path' ("" for the whole codebase).
+    std::size_t ReviewedUnder(const std::string& path) const;
+    std::size_t LinesUnder(const std::string& path) const;
+
+    // Lines in each of 'fileRefs' (relative to 'codebasePath'), counted the way SetLineCount()
+    // expects, 0 for anything unreadable. Split across all cores, stops early once 'cancelled'.
+    static std::vector<std::size_t> CountLines(const std::string& codebasePath, const std::vector<std::string>& fileRefs,
+                                               const std::atomic<bool>& cancelled);
+private:
+    Files files;
+    PathCounts reviewedLines;
+    PathCounts knownLines;
+    std::size_t heapBytes = 0;
+    MemoryAccounting::Account account;
+
+    // Applies the difference between a file as it is and as it was (counting 'countedBefore'
+    // reviewed lines out of 'lineCountBefore', taking 'bytesBefore') to the totals and
+    // accounting, dropping the file if there's nothing left to know about it.
+    void Update(Files::iterator fileEntry, std::size_t countedBefore, std::size_t lineCountBefore, std::size_t bytesBefore);
+};
+
+#endif // REVIEWCOVERAGE_H
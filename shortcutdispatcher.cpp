@@ -0,0 +1,51 @@
+#include "shortcutdispatcher.h"
+#include <QMetaObject>
+
+ShortcutDispatcher::ShortcutDispatcher(QWidget* const host) : QObject(host), host(host) {}
+
+QAction* ShortcutDispatcher::AddAction(const std::string& name, const QKeySequence& keys) {
+    std::unique_ptr<QAction>& action = this->bindings[name];
+    if (action) {
+        this->host->removeAction(action.get());
+        this->targetedSlots.erase(action.get());
+    }
+    action = std::make_unique<QAction>(this->host);
+    action->setShortcut(keys);
+    // Anywhere in the window, subwindows included:
+    action->setShortcutContext(Qt::WindowShortcut);
+    this->host->addAction(action.get());
+    return action.get();
+}
+
+void ShortcutDispatcher::Bind(const std::string& name, const QKeySequence& keys, QObject* const receiver, const char* const slot) {
+    QObject::connect(this->AddAction(name, keys), SIGNAL(triggered()), receiver, slot);
+}
+
+void ShortcutDispatcher::BindTargeted(const std::string& name, const QKeySequence& keys, const char* const slotName) {
+    QAction* const action = this->AddAction(name, keys);
+    this->targetedSlots[action] = QByteArray(slotName);
+    QObject::connect(action, SIGNAL(triggered()), this, SLOT(DispatchTargeted()));
+    this->UpdateTargetedEnabled();
+}
+
+void ShortcutDispatcher::SetTarget(QObject* const target) {
+    this->target = target;
+    this->UpdateTargetedEnabled();
+}
+
+void ShortcutDispatcher::UpdateTargetedEnabled() {
+    for (const std::pair<QAction* const, QByteArray>& targeted : this->targetedSlots) {
+        const bool hasSlot = !this->target.isNull() &&
+            this->target->metaObject()->indexOfSlot((targeted.second + "()").constData()) != -1;
+        targeted.first->setEnabled(hasSlot);
+    }
+}
+
+void ShortcutDispatcher::DispatchTargeted() {
+    QAction* const action = qobject_cast<QAction*>(this->sender());
+    const std::unordered_map<QAction*, QByteArray>::const_iterator targeted = this->targetedSlots.find(action);
+    if (targeted == this->targetedSlots.cend() || this->target.isNull()) {
+        return;
+    }
+    QMetaObject::invokeMethod(this->target.data(), targeted->second.constData());
+}
@@ -0,0 +1,38 @@
+#ifndef SHORTCUTDISPATCHER_H
+#define SHORTCUTDISPATCHER_H
+#include <QAction>
+#include <QKeySequence>
+#include <QObject>
+#include <QPointer>
+#include <QWidget>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Every keyboard shortcut of a window, each a single QAction on the window itself however many
+// subwindows it has. Plain bindings call a fixed receiver. Targeted bindings call the slot of
+// the same name on the current target (e.g. the active editor), and are disabled whilst there's
+// no target with that slot so that their keys reach whichever widget has focus instead.
+class ShortcutDispatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ShortcutDispatcher(QWidget* const host);
+
+    void Bind(const std::string& name, const QKeySequence& keys, QObject* const receiver, const char* const slot);
+    void BindTargeted(const std::string& name, const QKeySequence& keys, const char* const slotName);
+    // Null for none.
+    void SetTarget(QObject* const target);
+private slots:
+    void DispatchTargeted();
+private:
+    QWidget* const host;
+    std::unordered_map<std::string, std::unique_ptr<QAction>> bindings;
+    std::unordered_map<QAction*, QByteArray /* Slot Name */> targetedSlots;
+    QPointer<QObject> target;
+
+    QAction* AddAction(const std::string& name, const QKeySequence& keys);
+    void UpdateTargetedEnabled();
+};
+
+#endif // SHORTCUTDISPATCHER_H
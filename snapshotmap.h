@@ -0,0 +1,169 @@
+#ifndef SNAPSHOTMAP_H
+#define SNAPSHOTMAP_H
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Per-file lists of items (annotations, bookmarks) that any number of threads can read whilst
+// a single writer (the GUI thread) edits them, without readers ever waiting on an edit.
+//
+// Nothing a reader can reach is ever modified: an edit copies the lists it touches, changes the
+// copies and publishes a new Snapshot that shares every other file's list with the last one.
+// Files are spread over ShardCount shards so that only the touched shards' tables are copied
+// too, and edits to many files (or many edits to one) are gathered by a Batch into a single
+// copy of each and a single publish. Readers pick up the current Snapshot with one atomic load
+// and have a consistent view for as long as they hold on to it, whatever's edited meanwhile;
+// superseded lists are freed once the last snapshot referencing them is released.
+//
+// That load and the publishing store are std::atomic_load()/std::atomic_store() on the
+// shared_ptr, which the standard library implements with a small internal spinlock/mutex (held
+// only for the pointer copy, never during an edit) rather than lock-free. They're deprecated
+// from C++20 in favour of std::atomic<std::shared_ptr>, which is no more lock-free.
+
+template<typename T>
+class SnapshotMap {
+public:
+    typedef std::vector<T> Items;
+    const static std::size_t ShardCount = 64;
+
+    class Snapshot {
+    public:
+        // 'fileRef''s items (as they were last set), empty if it has none.
+        const Items& Get(const std::string& fileRef) const {
+            const std::shared_ptr<const Shard>& shard = this->shards[SnapshotMap::ShardOf(fileRef)];
+            if (!shard) {
+                return Snapshot::NoItems;
+            }
+            const typename Shard::const_iterator file = shard->find(fileRef);
+            return file == shard->cend() ? Snapshot::NoItems : *file->second;
+        }
+        // Calls 'visit(fileRef, items)' for every file that has items, in no particular order.
+        void ForEach(const std::function<void(const std::string&, const Items&)>& visit) const {
+            for (const std::shared_ptr<const Shard>& shard : this->shards) {
+                if (!shard) {
+                    continue;
+                }
+                for (const std::pair<const std::string, std::shared_ptr<const Items>>& file : *shard) {
+                    visit(file.first, *file.second);
+                }
+            }
+        }
+        std::size_t FileCount() const {
+            return this->fileCount;
+        }
+        std::size_t ItemCount() const {
+            return this->itemCount;
+        }
+    private:
+        typedef std::unordered_map<std::string, std::shared_ptr<const Items>> Shard;
+        const inline static Items NoItems {};
+
+        std::array<std::shared_ptr<const Shard>, ShardCount> shards; // Null until a file's added to them.
+        std::size_t fileCount = 0;
+        std::size_t itemCount = 0;
+        friend class SnapshotMap;
+    };
+
+    SnapshotMap() : current(std::make_shared<const Snapshot>()) {}
+    // Copies share the other's current snapshot, they only part ways once either is edited.
+    SnapshotMap(const SnapshotMap& other) : current(other.Current()) {}
+    SnapshotMap& operator=(const SnapshotMap& other) {
+        std::atomic_store(&this->current, other.Current());
+        return *this;
+    }
+
+    // Safe from any thread.
+    std::shared_ptr<const Snapshot> Current() const {
+        return std::atomic_load(&this->current);
+    }
+
+    // Writer only. Edits gathered from the snapshot current when it's created and published
+    // together by Publish(), each touched file's items being copied just once.
+    class Batch {
+    public:
+        explicit Batch(SnapshotMap& map) : map(map), base(map.Current()) {}
+
+        // The snapshot the batch started from, i.e. without its edits.
+        const Snapshot& Base() const {
+            return *this->base;
+        }
+        // 'fileRef''s items as edited so far in this batch, for editing in place.
+        Items& Edit(const std::string& fileRef) {
+            typename std::unordered_map<std::string, Items>::iterator file = this->edits.find(fileRef);
+            if (file == this->edits.end()) {
+                file = this->edits.emplace(fileRef, this->base->Get(fileRef)).first;
+            }
+            return file->second;
+        }
+        // Publishes every edit as one new snapshot (a file left without items is dropped),
+        // returns the files edited.
+        std::vector<std::string> Publish() {
+            std::vector<std::string> fileRefs;
+            if (this->edits.empty()) {
+                return fileRefs;
+            }
+            std::vector<std::pair<std::string, Items>> published;
+            fileRefs.reserve(this->edits.size());
+            published.reserve(this->edits.size());
+            for (std::pair<const std::string, Items>& edit : this->edits) {
+                fileRefs.push_back(edit.first);
+                published.emplace_back(edit.first, std::move(edit.second));
+            }
+            this->edits.clear();
+            this->map.Set(std::move(published));
+            return fileRefs;
+        }
+    private:
+        SnapshotMap& map;
+        const std::shared_ptr<const Snapshot> base;
+        std::unordered_map<std::string, Items> edits;
+    };
+
+    // Writer only. Replaces the items of every file in 'edits' (a file left without any is
+    // dropped) and publishes the result as one new snapshot.
+    void Set(std::vector<std::pair<std::string, Items>> edits) {
+        const std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>(*this->Current());
+        std::array<std::shared_ptr<typename Snapshot::Shard>, ShardCount> copiedShards;
+        for (std::pair<std::string, Items>& edit : edits) {
+            const std::size_t shardIndex = SnapshotMap::ShardOf(edit.first);
+            std::shared_ptr<typename Snapshot::Shard>& shard = copiedShards[shardIndex];
+            if (!shard) {
+                // First edit in this shard, the old table may still be in use by readers:
+                shard = next->shards[shardIndex] ? std::make_shared<typename Snapshot::Shard>(*next->shards[shardIndex]) :
+                                                   std::make_shared<typename Snapshot::Shard>();
+                next->shards[shardIndex] = shard;
+            }
+
+            const typename Snapshot::Shard::iterator existing = shard->find(edit.first);
+            if (existing != shard->end()) {
+                next->fileCount--;
+                next->itemCount -= existing->second->size();
+                shard->erase(existing);
+            }
+            if (!edit.second.empty()) {
+                next->fileCount++;
+                next->itemCount += edit.second.size();
+                shard->emplace(std::move(edit.first), std::make_shared<const Items>(std::move(edit.second)));
+            }
+        }
+        std::atomic_store(&this->current, std::shared_ptr<const Snapshot>(next));
+    }
+    void Set(std::string fileRef, Items items) {
+        std::vector<std::pair<std::string, Items>> edits;
+        edits.emplace_back(std::move(fileRef), std::move(items));
+        this->Set(std::move(edits));
+    }
+private:
+    std::shared_ptr<const Snapshot> current; // Only ever accessed atomically.
+
+    static std::size_t ShardOf(const std::string& fileRef) {
+        return std::hash<std::string>()(fileRef) % ShardCount;
+    }
+};
+
+#endif // SNAPSHOTMAP_H
@@ -0,0 +1,222 @@
+#include "stallwatchdog.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+    std::uint64_t NowMs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count());
+    }
+
+    void CopyDetail(char* const destination, const char* const source, const std::size_t sourceLength) {
+        const std::size_t copyLength = std::min(sourceLength, Watchdog::MaxDetailLength);
+        std::memcpy(destination, source + (sourceLength - copyLength), copyLength);
+        destination[copyLength] = '\0';
+    }
+
+    // Only the watched thread opens activity scopes, so it's the sole writer of the current
+    // activity, which the watchdog thread reads as a seqlock: the sequence is odd whilst a
+    // write is in progress, and a read is retried if the sequence moved underneath it.
+    thread_local bool isWatchedThread = false;
+    thread_local const Watchdog::ActivityScope* innermostScope = nullptr;
+    std::atomic<std::uint32_t> activitySequence {0};
+    std::atomic<const char*> currentOperation {nullptr};
+    std::array<std::atomic<char>, Watchdog::MaxDetailLength + 1> currentDetail {};
+
+    void PublishActivity(const char* const operation, const char* const detail) {
+        const std::uint32_t sequence = activitySequence.load(std::memory_order_relaxed);
+        activitySequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        currentOperation.store(operation, std::memory_order_relaxed);
+        std::size_t i = 0;
+        do {
+            currentDetail[i].store(detail[i], std::memory_order_relaxed);
+        } while (detail[i++] != '\0');
+        activitySequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    void ReadActivity(std::string& operation, std::string& detail) {
+        for (;;) {
+            const std::uint32_t sequence = activitySequence.load(std::memory_order_acquire);
+            if (sequence % 2 != 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            const char* const currentOperationName = currentOperation.load(std::memory_order_relaxed);
+            operation = currentOperationName == nullptr ? "" : currentOperationName;
+            detail.clear();
+            for (const std::atomic<char>& character : currentDetail) {
+                const char value = character.load(std::memory_order_relaxed);
+                if (value == '\0') {
+                    break;
+                }
+                detail.push_back(value);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (activitySequence.load(std::memory_order_relaxed) == sequence) {
+                return;
+            }
+        }
+    }
+
+    std::atomic<std::uint64_t> lastHeartbeatMs {0};
+    std::atomic<std::size_t> projectAnnotations {0};
+    std::atomic<std::size_t> projectBookmarks {0};
+
+    std::mutex reportMutex;
+    std::chrono::milliseconds stallThreshold {0};
+    std::array<std::size_t, Watchdog::HistogramBounds.size() + 1> histogram {};
+    std::deque<Watchdog::StallRecord> recordedStalls;
+    bool stallInProgress = false;
+
+    std::mutex threadMutex;
+    std::condition_variable stopCondition;
+    bool stopRequested = false;
+    std::thread watchdogThread;
+
+    std::size_t BucketFor(const std::chrono::milliseconds duration) {
+        const std::array<std::uint32_t, Watchdog::HistogramBounds.size()>::const_iterator bound =
+            std::upper_bound(Watchdog::HistogramBounds.cbegin(), Watchdog::HistogramBounds.cend(),
+                             static_cast<std::uint32_t>(std::min<std::int64_t>(duration.count(), UINT32_MAX)));
+        return static_cast<std::size_t>(bound - Watchdog::HistogramBounds.cbegin());
+    }
+
+    void WatchLoop(const std::chrono::milliseconds threshold) {
+        // Poll a few times per threshold so that stalls are measured reasonably accurately:
+        const std::chrono::milliseconds pollInterval = std::max(threshold / 4, std::chrono::milliseconds(10));
+        const std::uint64_t thresholdMs = static_cast<std::uint64_t>(threshold.count());
+
+        bool inStall = false;
+        std::uint64_t stallStartMs = 0;
+        Watchdog::StallRecord pendingRecord;
+
+        std::unique_lock<std::mutex> threadLock(threadMutex);
+        while (!stopCondition.wait_for(threadLock, pollInterval, []{ return stopRequested; })) {
+            const std::uint64_t nowMs = NowMs();
+            const std::uint64_t heartbeatMs = lastHeartbeatMs.load(std::memory_order_acquire);
+
+            if (!inStall && nowMs - heartbeatMs > thresholdMs) {
+                // The event loop has stopped turning over, note what it's stuck doing:
+                inStall = true;
+                stallStartMs = heartbeatMs;
+                pendingRecord.began = std::chrono::system_clock::now() - std::chrono::milliseconds(nowMs - heartbeatMs);
+                ReadActivity(pendingRecord.operation, pendingRecord.detail);
+                pendingRecord.projectAnnotations = projectAnnotations.load(std::memory_order_relaxed);
+                pendingRecord.projectBookmarks = projectBookmarks.load(std::memory_order_relaxed);
+
+                const std::lock_guard<std::mutex> reportLock(reportMutex);
+                stallInProgress = true;
+            }
+            else if (inStall && heartbeatMs != stallStartMs) {
+                // It's turning over again:
+                inStall = false;
+                pendingRecord.duration = std::chrono::milliseconds(heartbeatMs - stallStartMs);
+
+                const std::lock_guard<std::mutex> reportLock(reportMutex);
+                stallInProgress = false;
+                ++histogram[BucketFor(pendingRecord.duration)];
+                recordedStalls.push_back(pendingRecord);
+                if (recordedStalls.size() > Watchdog::MaxRecordedStalls) {
+                    recordedStalls.pop_front();
+                }
+            }
+        }
+    }
+}
+
+Watchdog::ActivityScope::ActivityScope(const char* operation) noexcept :
+    active(isWatchedThread), outer(innermostScope), operation(operation) {
+    if (!this->active) {
+        return;
+    }
+    this->detail[0] = '\0';
+    innermostScope = this;
+    PublishActivity(this->operation, this->detail);
+}
+
+Watchdog::ActivityScope::ActivityScope(const char* operation, const std::string& detail) noexcept :
+    active(isWatchedThread), outer(innermostScope), operation(operation) {
+    if (!this->active) {
+        return;
+    }
+    CopyDetail(this->detail, detail.data(), detail.length());
+    innermostScope = this;
+    PublishActivity(this->operation, this->detail);
+}
+
+Watchdog::ActivityScope::~ActivityScope() {
+    if (!this->active) {
+        return;
+    }
+    innermostScope = this->outer;
+    if (this->outer == nullptr) {
+        PublishActivity(nullptr, "");
+    }
+    else {
+        PublishActivity(this->outer->operation, this->outer->detail);
+    }
+}
+
+void Watchdog::Start(const std::chrono::milliseconds threshold) {
+    Watchdog::Stop();
+
+    isWatchedThread = true;
+    lastHeartbeatMs.store(NowMs(), std::memory_order_release);
+    {
+        const std::lock_guard<std::mutex> reportLock(reportMutex);
+        stallThreshold = threshold;
+        stallInProgress = false;
+    }
+    {
+        const std::lock_guard<std::mutex> threadLock(threadMutex);
+        stopRequested = false;
+    }
+    watchdogThread = std::thread(WatchLoop, threshold);
+}
+
+void Watchdog::Stop() {
+    if (!watchdogThread.joinable()) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> threadLock(threadMutex);
+        stopRequested = true;
+    }
+    stopCondition.notify_all();
+    watchdogThread.join();
+}
+
+void Watchdog::Heartbeat() {
+    lastHeartbeatMs.store(NowMs(), std::memory_order_release);
+}
+
+void Watchdog::SetProjectSize(const std::size_t annotations, const std::size_t bookmarks) {
+    projectAnnotations.store(annotations, std::memory_order_relaxed);
+    projectBookmarks.store(bookmarks, std::memory_order_relaxed);
+}
+
+Watchdog::Report Watchdog::GetReport() {
+    const std::lock_guard<std::mutex> reportLock(reportMutex);
+    return Watchdog::Report {
+        .threshold = stallThreshold,
+        .histogram = histogram,
+        .stalls = std::vector<Watchdog::StallRecord>(recordedStalls.cbegin(), recordedStalls.cend()),
+        .stallInProgress = stallInProgress
+    };
+}
+
+std::string Watchdog::HistogramBucketLabel(const std::size_t bucket) {
+    if (bucket >= Watchdog::HistogramBounds.size()) {
+        return ">= " + std::to_string(Watchdog::HistogramBounds.back()) + "ms";
+    }
+    if (bucket == 0) {
+        return "< " + std::to_string(Watchdog::HistogramBounds.front()) + "ms";
+    }
+    return std::to_string(Watchdog::HistogramBounds[bucket - 1]) + "-" + std::to_string(Watchdog::HistogramBounds[bucket]) + "ms";
+}
@@ -0,0 +1,85 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tracing.h"
+
+// Detects when the GUI thread's event loop hasn't turned over for longer than a threshold.
+// The GUI thread calls Heartbeat() from a repeating timer, and a separate watchdog thread
+// notices when those heartbeats stop arriving. Each stall is attributed to whichever
+// ActivityScope (opened via the WATCHDOG_SCOPE* macros) was innermost on the GUI thread at
+// the time, along with the size of the project that was loaded. Scopes are only opened at
+// coarse entry points from the event loop (slots, dialogs, loading a file): opening or
+// closing one doesn't lock, but still copies its detail into a slot the watchdog thread
+// polls, which isn't compiled out like tracing is. WATCHDOG_TRACE_SCOPE* opens both an
+// activity scope and a trace span, evaluating the detail once for the two.
+
+namespace Watchdog {
+    // Upper bounds (in ms, exclusive) of the stall duration histogram's buckets, the
+    // final bucket catches everything longer than the last bound.
+    const static std::array<std::uint32_t, 7> HistogramBounds = {
+        250, 500, 1000, 2500, 5000, 10000, 30000
+    };
+    // Most recent stalls retained (in full) for the report.
+    const static std::size_t MaxRecordedStalls = 256;
+    // Longest activity detail (typically a file path) retained, the tail is kept.
+    const static std::size_t MaxDetailLength = 63;
+
+    struct StallRecord {
+        std::chrono::system_clock::time_point began;
+        std::chrono::milliseconds duration;
+        std::string operation; // Empty if nothing instrumented was active.
+        std::string detail;
+        std::size_t projectAnnotations;
+        std::size_t projectBookmarks;
+    };
+
+    struct Report {
+        std::chrono::milliseconds threshold;
+        std::array<std::size_t, HistogramBounds.size() + 1> histogram;
+        std::vector<StallRecord> stalls; // Oldest first.
+        bool stallInProgress;
+    };
+
+    // Marks the innermost operation running on the watched (GUI) thread, scopes opened on
+    // any other thread are ignored.
+    class ActivityScope {
+    public:
+        explicit ActivityScope(const char* operation) noexcept;
+        ActivityScope(const char* operation, const std::string& detail) noexcept;
+        ~ActivityScope();
+
+        ActivityScope(const ActivityScope&) = delete;
+        ActivityScope& operator=(const ActivityScope&) = delete;
+    private:
+        bool active;
+        const ActivityScope* outer; // Restored as the current activity when this one closes.
+        const char* operation;
+        char detail[MaxDetailLength + 1];
+    };
+
+    // Starts watching the calling thread, which must be the one running the event loop.
+    void Start(std::chrono::milliseconds threshold);
+    void Stop();
+    void Heartbeat();
+
+    void SetProjectSize(std::size_t annotations, std::size_t bookmarks);
+
+    Report GetReport();
+    std::string HistogramBucketLabel(std::size_t bucket);
+};
+
+#define WATCHDOG_CONCAT_IMPL(A, B) A##B
+#define WATCHDOG_CONCAT(A, B) WATCHDOG_CONCAT_IMPL(A, B)
+#define WATCHDOG_SCOPE(NAME) Watchdog::ActivityScope WATCHDOG_CONCAT(activityScope, __LINE__)(NAME)
+#define WATCHDOG_SCOPE_DETAIL(NAME, DETAIL) Watchdog::ActivityScope WATCHDOG_CONCAT(activityScope, __LINE__)(NAME, DETAIL)
+#define WATCHDOG_TRACE_SCOPE(NAME) WATCHDOG_SCOPE(NAME); TRACE_SCOPE(NAME)
+#define WATCHDOG_TRACE_SCOPE_DETAIL(NAME, DETAIL) \
+    const std::string& WATCHDOG_CONCAT(activityDetail, __LINE__) = (DETAIL); \
+    WATCHDOG_SCOPE_DETAIL(NAME, WATCHDOG_CONCAT(activityDetail, __LINE__)); \
+    TRACE_SCOPE_DETAIL(NAME, WATCHDOG_CONCAT(activityDetail, __LINE__))
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,661 @@
+#include "symbolindex.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <string_view>
+#include <unordered_set>
+#include "cachefile.h"
+#include "parallel.h"
+#include "tracing.h"
+
+namespace {
+    const static std::uint32_t IndexMagic = 0x4D59534B; // "KSYM"
+    const static std::uint32_t IndexVersion = 1;
+
+    const static std::unordered_set<std::string_view> SourceExtensions = {
+        ".c", ".cc", ".cpp", ".cxx", ".c++", ".h", ".hh", ".hpp", ".hxx", ".h++", ".inl", ".ipp", ".tpp", ".m", ".mm"
+    };
+
+    const static std::unordered_set<std::string_view> Keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+        "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr",
+        "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "final", "float",
+        "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not",
+        "not_eq", "nullptr", "operator", "or", "or_eq", "override", "private", "protected", "public", "register",
+        "reinterpret_cast", "requires", "restrict", "return", "short", "signed", "sizeof", "static", "static_assert",
+        "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef",
+        "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+        "xor", "xor_eq", "_Bool", "_Noreturn", "_Static_assert", "_Thread_local"
+    };
+
+    // Allowed between a function's parameter list and its body.
+    const static std::unordered_set<std::string_view> FunctionQualifiers = {
+        "const", "volatile", "noexcept", "override", "final", "mutable", "&", "&&", "throw"
+    };
+
+    struct Token {
+        enum Kind {
+            IDENTIFIER,
+            PUNCTUATION,
+            DEFINE // A '#define' directive, the next identifier is the macro's name.
+        } kind;
+        std::string_view text;
+        std::uint32_t line;
+    };
+
+    inline bool IsIdentifierStart(const char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    inline bool IsIdentifierChar(const char c) {
+        return IsIdentifierStart(c) || std::isdigit(static_cast<unsigned char>(c));
+    }
+
+    class Lexer {
+    public:
+        explicit Lexer(const std::string& contents) : source(contents) {}
+
+        std::vector<Token> Tokenize() {
+            std::vector<Token> tokens;
+            bool lineStart = true; // Only whitespace since the last newline.
+            while (this->position < this->source.size()) {
+                const char c = this->source[this->position];
+                if (c == '\n') {
+                    ++this->line;
+                    ++this->position;
+                    lineStart = true;
+                    continue;
+                }
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    ++this->position;
+                    continue;
+                }
+                if (c == '\\' && this->Peek(1) == '\n') {
+                    // Line continuation:
+                    this->position += 2;
+                    ++this->line;
+                    continue;
+                }
+
+                const bool directiveAllowed = lineStart;
+                lineStart = false;
+                if (c == '/' && this->Peek(1) == '/') {
+                    this->SkipLineComment();
+                }
+                else if (c == '/' && this->Peek(1) == '*') {
+                    this->SkipBlockComment();
+                }
+                else if (c == '#' && directiveAllowed) {
+                    this->LexDirective(tokens);
+                }
+                else if (c == '"' || c == '\'') {
+                    this->SkipQuoted(c);
+                }
+                else if (IsIdentifierStart(c)) {
+                    this->LexIdentifier(tokens);
+                }
+                else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                         (c == '.' && std::isdigit(static_cast<unsigned char>(this->Peek(1))))) {
+                    this->SkipNumber();
+                }
+                else {
+                    const std::size_t length =
+                        (c == ':' && this->Peek(1) == ':') || (c == '-' && this->Peek(1) == '>') ||
+                        (c == '&' && this->Peek(1) == '&') ? 2 : 1;
+                    tokens.push_back(Token { Token::PUNCTUATION, std::string_view(this->source).substr(this->position, length), this->line });
+                    this->position += length;
+                }
+            }
+            return tokens;
+        }
+    private:
+        const std::string& source;
+        std::size_t position = 0;
+        std::uint32_t line = 0;
+
+        char Peek(const std::size_t offset) const {
+            return this->position + offset < this->source.size() ? this->source[this->position + offset] : '\0';
+        }
+
+        void SkipLineComment() {
+            while (this->position < this->source.size() && this->source[this->position] != '\n') {
+                if (this->source[this->position] == '\\' && this->Peek(1) == '\n') {
+                    ++this->line;
+                    ++this->position;
+                }
+                ++this->position;
+            }
+        }
+
+        void SkipBlockComment() {
+            const std::size_t end = this->source.find("*/", this->position + 2);
+            const std::size_t stop = end == std::string::npos ? this->source.size() : end + 2;
+            this->line += static_cast<std::uint32_t>(std::count(this->source.cbegin() + this->position, this->source.cbegin() + stop, '\n'));
+            this->position = stop;
+        }
+
+        void SkipQuoted(const char quote) {
+            ++this->position;
+            while (this->position < this->source.size()) {
+                const char c = this->source[this->position];
+                if (c == '\\') {
+                    if (this->Peek(1) == '\n') {
+                        ++this->line;
+                    }
+                    this->position += 2;
+                    continue;
+                }
+                if (c == '\n') {
+                    return; // Unterminated, don't swallow the rest of the file.
+                }
+                ++this->position;
+                if (c == quote) {
+                    return;
+                }
+            }
+        }
+
+        void SkipRawString() {
+            // R"delimiter( ... )delimiter"
+            const std::size_t open = this->source.find('(', this->position);
+            if (open == std::string::npos) {
+                this->position = this->source.size();
+                return;
+            }
+            const std::string terminator = ")" + this->source.substr(this->position + 1, open - this->position - 1) + "\"";
+            const std::size_t end = this->source.find(terminator, open);
+            const std::size_t stop = end == std::string::npos ? this->source.size() : end + terminator.size();
+            this->line += static_cast<std::uint32_t>(std::count(this->source.cbegin() + this->position, this->source.cbegin() + stop, '\n'));
+            this->position = stop;
+        }
+
+        void SkipNumber() {
+            while (this->position < this->source.size()) {
+                const char c = this->source[this->position];
+                const char previous = this->position > 0 ? this->source[this->position - 1] : '\0';
+                if (IsIdentifierChar(c) || c == '.' || c == '\'' ||
+                    ((c == '+' || c == '-') && (previous == 'e' || previous == 'E' || previous == 'p' || previous == 'P'))) {
+                    ++this->position;
+                }
+                else {
+                    break;
+                }
+            }
+        }
+
+        void LexIdentifier(std::vector<Token>& tokens) {
+            const std::size_t start = this->position;
+            while (this->position < this->source.size() && IsIdentifierChar(this->source[this->position])) {
+                ++this->position;
+            }
+            const std::string_view identifier = std::string_view(this->source).substr(start, this->position - start);
+
+            // Encoding prefixes of string/character literals:
+            const char next = this->Peek(0);
+            if (next == '"' || next == '\'') {
+                const static std::unordered_set<std::string_view> prefixes = { "L", "u", "U", "u8" };
+                const static std::unordered_set<std::string_view> rawPrefixes = { "R", "LR", "uR", "UR", "u8R" };
+                if (next == '"' && rawPrefixes.count(identifier) != 0) {
+                    this->SkipRawString();
+                    return;
+                }
+                if (prefixes.count(identifier) != 0) {
+                    this->SkipQuoted(next);
+                    return;
+                }
+            }
+            tokens.push_back(Token { Token::IDENTIFIER, identifier, this->line });
+        }
+
+        void LexDirective(std::vector<Token>& tokens) {
+            ++this->position; // '#'
+            while (this->position < this->source.size() &&
+                   (this->source[this->position] == ' ' || this->source[this->position] == '\t')) {
+                ++this->position;
+            }
+            const std::size_t start = this->position;
+            while (this->position < this->source.size() && IsIdentifierChar(this->source[this->position])) {
+                ++this->position;
+            }
+            const std::string_view directive = std::string_view(this->source).substr(start, this->position - start);
+            if (directive == "define") {
+                tokens.push_back(Token { Token::DEFINE, directive, this->line });
+            }
+            else if (directive == "include" || directive == "include_next" || directive == "import" || directive == "pragma" ||
+                     directive == "error" || directive == "warning" || directive == "line") {
+                // Nothing that names a symbol:
+                this->SkipLineComment();
+            }
+            // Otherwise (#if, #ifdef...) the rest of the line is lexed as usual.
+        }
+    };
+
+    bool IsPunctuation(const std::vector<Token>& tokens, const std::size_t index, const std::string_view text) {
+        return index < tokens.size() && tokens[index].kind == Token::PUNCTUATION && tokens[index].text == text;
+    }
+
+    // The index just past the bracket matching the one at 'open' (or the end).
+    std::size_t SkipBalanced(const std::vector<Token>& tokens, std::size_t open) {
+        const std::string_view opening = tokens[open].text;
+        const std::string_view closing = opening == "(" ? ")" : opening == "{" ? "}" : "]";
+        std::size_t depth = 0;
+        for (; open < tokens.size(); open++) {
+            if (tokens[open].kind != Token::PUNCTUATION) {
+                continue;
+            }
+            if (tokens[open].text == opening) {
+                ++depth;
+            }
+            else if (tokens[open].text == closing && --depth == 0) {
+                return open + 1;
+            }
+        }
+        return tokens.size();
+    }
+
+    bool IsLikelyMacro(const std::string_view name) {
+        return std::none_of(name.cbegin(), name.cend(), [](const char c) {
+            return std::islower(static_cast<unsigned char>(c));
+        });
+    }
+
+    // Flags the tokens that define something.
+    std::vector<bool> MarkDefinitions(const std::vector<Token>& tokens) {
+        std::vector<bool> definitions(tokens.size(), false);
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            if (token.kind == Token::DEFINE) {
+                if (i + 1 < tokens.size() && tokens[i + 1].kind == Token::IDENTIFIER) {
+                    definitions[i + 1] = true;
+                }
+                continue;
+            }
+            if (token.kind != Token::IDENTIFIER) {
+                continue;
+            }
+
+            if (token.text == "class" || token.text == "struct" || token.text == "union" ||
+                token.text == "enum" || token.text == "namespace") {
+                // The (possibly qualified) name runs up until the body or base clause:
+                std::size_t nameIndex = tokens.size();
+                std::size_t end = i + 1;
+                for (; end < tokens.size(); end++) {
+                    if (tokens[end].kind == Token::IDENTIFIER) {
+                        if (Keywords.count(tokens[end].text) == 0) {
+                            nameIndex = end;
+                        }
+                        else if (tokens[end].text != "class" && tokens[end].text != "struct" && tokens[end].text != "final") {
+                            break;
+                        }
+                    }
+                    else if (!IsPunctuation(tokens, end, "::")) {
+                        break;
+                    }
+                }
+                const bool hasBody = IsPunctuation(tokens, end, "{") || IsPunctuation(tokens, end, ":");
+                if (nameIndex == tokens.size() || !hasBody) {
+                    continue;
+                }
+                definitions[nameIndex] = true;
+
+                if (token.text == "enum") {
+                    // Enumerators, each being the first identifier of a comma separated entry:
+                    std::size_t body = end;
+                    while (body < tokens.size() && !IsPunctuation(tokens, body, "{") && !IsPunctuation(tokens, body, ";")) {
+                        ++body;
+                    }
+                    if (!IsPunctuation(tokens, body, "{")) {
+                        continue;
+                    }
+                    const std::size_t bodyEnd = SkipBalanced(tokens, body);
+                    bool expectingEnumerator = true;
+                    std::size_t depth = 0;
+                    for (std::size_t j = body + 1; j + 1 < bodyEnd; j++) {
+                        if (tokens[j].kind == Token::PUNCTUATION) {
+                            if (tokens[j].text == "(" || tokens[j].text == "{") {
+                                ++depth;
+                            }
+                            else if (tokens[j].text == ")" || tokens[j].text == "}") {
+                                --depth;
+                            }
+                            else if (tokens[j].text == "," && depth == 0) {
+                                expectingEnumerator = true;
+                            }
+                        }
+                        else if (expectingEnumerator && tokens[j].kind == Token::IDENTIFIER) {
+                            definitions[j] = true;
+                            expectingEnumerator = false;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            if (token.text == "typedef") {
+                // The last top-level identifier before the ';', or the '(*name)' of a function pointer:
+                std::size_t nameIndex = tokens.size();
+                std::size_t pointerName = tokens.size();
+                for (std::size_t j = i + 1; j < tokens.size() && !IsPunctuation(tokens, j, ";");) {
+                    if (IsPunctuation(tokens, j, "(") || IsPunctuation(tokens, j, "{") || IsPunctuation(tokens, j, "[")) {
+                        if (pointerName == tokens.size() && IsPunctuation(tokens, j, "(") && IsPunctuation(tokens, j + 1, "*") &&
+                            j + 2 < tokens.size() && tokens[j + 2].kind == Token::IDENTIFIER) {
+                            pointerName = j + 2;
+                        }
+                        j = SkipBalanced(tokens, j);
+                        continue;
+                    }
+                    if (tokens[j].kind == Token::IDENTIFIER && Keywords.count(tokens[j].text) == 0) {
+                        nameIndex = j;
+                    }
+                    ++j;
+                }
+                if (pointerName != tokens.size()) {
+                    definitions[pointerName] = true;
+                }
+                else if (nameIndex != tokens.size()) {
+                    definitions[nameIndex] = true;
+                }
+                continue;
+            }
+
+            if (token.text == "using") {
+                if (i + 2 < tokens.size() && tokens[i + 1].kind == Token::IDENTIFIER && IsPunctuation(tokens, i + 2, "=")) {
+                    definitions[i + 1] = true;
+                }
+                continue;
+            }
+
+            // A function definition: name(...) [qualifiers] { or name(...) : initializers {
+            if (Keywords.count(token.text) != 0 || !IsPunctuation(tokens, i + 1, "(") || IsLikelyMacro(token.text)) {
+                continue;
+            }
+            if (i > 0 && (IsPunctuation(tokens, i - 1, ".") || IsPunctuation(tokens, i - 1, "->") ||
+                          IsPunctuation(tokens, i - 1, "~"))) {
+                continue;
+            }
+            std::size_t after = SkipBalanced(tokens, i + 1);
+            while (after < tokens.size() && FunctionQualifiers.count(tokens[after].text) != 0) {
+                after = IsPunctuation(tokens, after + 1, "(") ? SkipBalanced(tokens, after + 1) : after + 1;
+            }
+            if (IsPunctuation(tokens, after, "->")) {
+                // Trailing return type:
+                while (after < tokens.size() && !IsPunctuation(tokens, after, "{") && !IsPunctuation(tokens, after, ";")) {
+                    ++after;
+                }
+            }
+            if (IsPunctuation(tokens, after, "{") ||
+                (IsPunctuation(tokens, after, ":") && after + 1 < tokens.size() && tokens[after + 1].kind == Token::IDENTIFIER)) {
+                definitions[i] = true;
+            }
+        }
+        return definitions;
+    }
+}
+
+SymbolIndex::SymbolIndex(const std::string& codebasePath, const std::filesystem::path& indexPath) :
+    codebasePath(codebasePath), indexPath(indexPath), snapshot(std::make_shared<const Snapshot>()),
+    account(MemoryAccounting::CACHES, "symbol index") {}
+
+void SymbolIndex::LexFile(const std::string& contents, FileEntry& entry) {
+    const std::vector<Token> tokens = Lexer(contents).Tokenize();
+    const std::vector<bool> definitions = MarkDefinitions(tokens);
+
+    std::unordered_map<std::string_view, std::uint32_t> nameIndexes;
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (token.kind != Token::IDENTIFIER || Keywords.count(token.text) != 0) {
+            continue;
+        }
+        const std::pair<std::unordered_map<std::string_view, std::uint32_t>::iterator, bool> nameIndex =
+            nameIndexes.emplace(token.text, static_cast<std::uint32_t>(entry.names.size()));
+        if (nameIndex.second) {
+            entry.names.emplace_back(token.text);
+        }
+        entry.occurrences.push_back(Occurrence {
+            .name = nameIndex.first->second,
+            .line = token.line | (definitions[i] ? DefinitionFlag : 0)
+        });
+    }
+}
+
+bool SymbolIndex::Update() {
+    const std::lock_guard<std::mutex> updateLock(this->updateMutex);
+    TRACE_SCOPE_DETAIL("SymbolIndex::Update", this->codebasePath);
+    this->cancelled = false;
+
+    // What was indexed before, from the current snapshot or else from the last session (which is
+    // served straight away whilst the codebase is rescanned):
+    std::shared_ptr<const Snapshot> previousSnapshot = this->GetSnapshot();
+    if (previousSnapshot->files.empty()) {
+        std::size_t indexBytes = 0;
+        previousSnapshot = SymbolIndex::BuildSnapshot(this->LoadFromDisk(), indexBytes);
+        {
+            const std::lock_guard<std::mutex> snapshotLock(this->snapshotMutex);
+            this->snapshot = previousSnapshot;
+        }
+        this->account.Set(indexBytes);
+    }
+    std::unordered_map<std::string, const FileEntry*> previousEntries;
+    for (const FileEntry& previousEntry : previousSnapshot->files) {
+        previousEntries.emplace(previousEntry.fileRef, &previousEntry);
+    }
+
+    // Gather the sources (skipping hidden directories such as .git):
+    struct Candidate {
+        std::filesystem::path path;
+        std::string fileRef;
+        std::uint64_t size;
+        std::int64_t modified;
+    };
+    std::vector<Candidate> candidates;
+    std::error_code iterationError;
+    for (std::filesystem::recursive_directory_iterator entry(this->codebasePath,
+             std::filesystem::directory_options::skip_permission_denied, iterationError), end;
+         entry != end; entry.increment(iterationError)) {
+        if (iterationError || this->cancelled) {
+            break;
+        }
+        std::error_code statusError;
+        const std::string filename = entry->path().filename().string();
+        if (entry->is_directory(statusError)) {
+            if (!filename.empty() && filename[0] == '.') {
+                entry.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (!entry->is_regular_file(statusError) ||
+            SourceExtensions.count(entry->path().extension().string()) == 0) {
+            continue;
+        }
+        const std::string fullPath = entry->path().string();
+        candidates.push_back(Candidate {
+            .path = entry->path(),
+            .fileRef = fullPath.substr(std::min(this->codebasePath.length(), fullPath.length())),
+            .size = static_cast<std::uint64_t>(entry->file_size(statusError)),
+            .modified = static_cast<std::int64_t>(entry->last_write_time(statusError).time_since_epoch().count())
+        });
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.fileRef < b.fileRef;
+    });
+
+    // Re-lex whatever changed:
+    std::vector<FileEntry> files(candidates.size());
+    std::atomic<bool> anyChanged {candidates.size() != previousEntries.size()};
+    Parallel::For(candidates.size(), [&](const std::size_t i) {
+        if (this->cancelled) {
+            return;
+        }
+        const Candidate& candidate = candidates[i];
+        const std::unordered_map<std::string, const FileEntry*>::const_iterator previousEntry = previousEntries.find(candidate.fileRef);
+        const FileEntry* const previous = previousEntry == previousEntries.cend() ? nullptr : previousEntry->second;
+        if (previous != nullptr && previous->size == candidate.size && previous->modified == candidate.modified) {
+            files[i] = *previous;
+            return;
+        }
+        anyChanged = true; // If only to record the new modification time.
+
+        std::ifstream sourceFile(candidate.path, std::ios::binary);
+        const std::string contents((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+        const std::uint64_t contentHash = CacheFile::Hash(contents.data(), contents.size());
+        if (previous != nullptr && previous->contentHash == contentHash) {
+            // Touched but not changed:
+            files[i] = *previous;
+            files[i].size = candidate.size;
+            files[i].modified = candidate.modified;
+            return;
+        }
+
+        FileEntry& entry = files[i];
+        entry.fileRef = candidate.fileRef;
+        entry.size = candidate.size;
+        entry.modified = candidate.modified;
+        entry.contentHash = contentHash;
+        SymbolIndex::LexFile(contents, entry);
+    });
+    if (this->cancelled) {
+        return false;
+    }
+    previousEntries.clear();
+    previousSnapshot.reset();
+
+    std::size_t indexBytes = 0;
+    const std::shared_ptr<const Snapshot> newSnapshot = SymbolIndex::BuildSnapshot(std::move(files), indexBytes);
+    if (anyChanged) {
+        this->SaveToDisk(newSnapshot->files);
+    }
+    {
+        const std::lock_guard<std::mutex> snapshotLock(this->snapshotMutex);
+        this->snapshot = newSnapshot;
+    }
+    this->account.Set(indexBytes);
+    return true;
+}
+
+std::shared_ptr<const SymbolIndex::Snapshot> SymbolIndex::BuildSnapshot(std::vector<FileEntry> files, std::size_t& indexBytes) {
+    // Invert it into per-name postings for lookups:
+    const std::shared_ptr<Snapshot> newSnapshot = std::make_shared<Snapshot>();
+    indexBytes = 0;
+    std::vector<std::vector<Posting>*> namePostings;
+    for (std::size_t fileIndex = 0; fileIndex < files.size(); fileIndex++) {
+        const FileEntry& file = files[fileIndex];
+        namePostings.clear();
+        for (const std::string& name : file.names) {
+            namePostings.push_back(&newSnapshot->postings[name]);
+            indexBytes += MemoryAccounting::StringHeapBytes(name) + sizeof(std::string);
+        }
+        for (const Occurrence& occurrence : file.occurrences) {
+            namePostings[occurrence.name]->push_back(Posting {
+                .file = static_cast<std::uint32_t>(fileIndex),
+                .line = occurrence.line
+            });
+        }
+        indexBytes += file.occurrences.capacity() * sizeof(Occurrence) + sizeof(FileEntry);
+    }
+    for (const std::pair<const std::string, std::vector<Posting>>& postings : newSnapshot->postings) {
+        indexBytes += postings.second.capacity() * sizeof(Posting) + sizeof(postings) + MemoryAccounting::StringHeapBytes(postings.first);
+    }
+    newSnapshot->files = std::move(files);
+    return newSnapshot;
+}
+
+void SymbolIndex::Cancel() {
+    this->cancelled = true;
+}
+
+std::shared_ptr<const SymbolIndex::Snapshot> SymbolIndex::GetSnapshot() const {
+    const std::lock_guard<std::mutex> snapshotLock(this->snapshotMutex);
+    return this->snapshot;
+}
+
+std::vector<SymbolIndex::Location> SymbolIndex::FindDefinitions(const std::string& name) const {
+    const std::shared_ptr<const Snapshot> currentSnapshot = this->GetSnapshot();
+    std::vector<Location> locations;
+    const std::unordered_map<std::string, std::vector<Posting>>::const_iterator postings = currentSnapshot->postings.find(name);
+    if (postings == currentSnapshot->postings.cend()) {
+        return locations;
+    }
+    for (const Posting& posting : postings->second) {
+        if ((posting.line & DefinitionFlag) != 0) {
+            locations.push_back(Location {
+                .fileRef = currentSnapshot->files[posting.file].fileRef,
+                .lineRef = posting.line & ~DefinitionFlag,
+                .isDefinition = true
+            });
+        }
+    }
+    return locations;
+}
+
+std::vector<SymbolIndex::Location> SymbolIndex::FindReferences(const std::string& name, const std::size_t limit) const {
+    const std::shared_ptr<const Snapshot> currentSnapshot = this->GetSnapshot();
+    std::vector<Location> locations;
+    const std::unordered_map<std::string, std::vector<Posting>>::const_iterator postings = currentSnapshot->postings.find(name);
+    if (postings == currentSnapshot->postings.cend()) {
+        return locations;
+    }
+    for (std::size_t i = 0; i < postings->second.size() && locations.size() < limit; i++) {
+        const Posting& posting = postings->second[i];
+        locations.push_back(Location {
+            .fileRef = currentSnapshot->files[posting.file].fileRef,
+            .lineRef = posting.line & ~DefinitionFlag,
+            .isDefinition = (posting.line & DefinitionFlag) != 0
+        });
+    }
+    return locations;
+}
+
+std::size_t SymbolIndex::FileCount() const {
+    return this->GetSnapshot()->files.size();
+}
+
+std::vector<SymbolIndex::FileEntry> SymbolIndex::LoadFromDisk() const {
+    TRACE_SCOPE("SymbolIndex::LoadFromDisk");
+    CacheFile::Reader indexFile(this->indexPath, IndexMagic, IndexVersion);
+    std::uint64_t fileCount = 0;
+    if (!indexFile.Read(fileCount)) {
+        return {}; // Missing, from another version or corrupt, everything gets re-indexed.
+    }
+    std::vector<FileEntry> files;
+    for (std::uint64_t fileIndex = 0; fileIndex < fileCount; fileIndex++) {
+        FileEntry& file = files.emplace_back();
+        std::uint32_t nameCount = 0;
+        if (!indexFile.ReadString(file.fileRef) || !indexFile.Read(file.size) || !indexFile.Read(file.modified) ||
+            !indexFile.Read(file.contentHash) || !indexFile.Read(nameCount)) {
+            return {};
+        }
+        for (std::uint32_t nameIndex = 0; nameIndex < nameCount; nameIndex++) {
+            if (!indexFile.ReadString(file.names.emplace_back())) {
+                return {};
+            }
+        }
+        if (!indexFile.ReadVector(file.occurrences)) {
+            return {};
+        }
+        for (const Occurrence& occurrence : file.occurrences) {
+            if (occurrence.name >= nameCount) {
+                return {};
+            }
+        }
+    }
+    return files;
+}
+
+void SymbolIndex::SaveToDisk(const std::vector<FileEntry>& files) const {
+    TRACE_SCOPE("SymbolIndex::SaveToDisk");
+    CacheFile::Writer indexFile(this->indexPath, IndexMagic, IndexVersion);
+    indexFile.Write(static_cast<std::uint64_t>(files.size()));
+    for (const FileEntry& file : files) {
+        indexFile.WriteString(file.fileRef);
+        indexFile.Write(file.size);
+        indexFile.Write(file.modified);
+        indexFile.Write(file.contentHash);
+        indexFile.Write(static_cast<std::uint32_t>(file.names.size()));
+        for (const std::string& name : file.names) {
+            indexFile.WriteString(name);
+        }
+        indexFile.WriteVector(file.occurrences);
+    }
+    indexFile.Commit(); // Failing just means a full re-index next session.
+}
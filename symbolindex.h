@@ -0,0 +1,85 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "memoryaccounting.h"
+
+// Definitions and references of every identifier in the codebase's C/C++ sources, found with a
+// lightweight lexer (comments, strings and the preprocessor are understood, definitions are
+// recognised heuristically: functions with bodies, classes/structs/unions/enums/namespaces,
+// enumerators, macros, typedefs and using aliases).
+//
+// The index is kept on disk between sessions. Updating it re-lexes only the files whose
+// contents (by hash) changed since, the rest are carried over. Lookups are served from an
+// immutable in-memory snapshot so they never wait on an update, the first update of a session
+// starts by publishing the last session's index as it was saved.
+
+class SymbolIndex {
+public:
+    struct Location {
+        std::string fileRef;
+        std::size_t lineRef;
+        bool isDefinition;
+    };
+
+    SymbolIndex(const std::string& codebasePath, const std::filesystem::path& indexPath);
+
+    // Rescans the codebase (across all cores) and saves the result, blocking until done. Safe to
+    // call from a worker thread whilst lookups are being made. Returns false if cancelled.
+    bool Update();
+    void Cancel();
+
+    std::vector<Location> FindDefinitions(const std::string& name) const;
+    std::vector<Location> FindReferences(const std::string& name, std::size_t limit) const;
+    std::size_t FileCount() const;
+private:
+    // One occurrence of a name in a file, 'line' has DefinitionFlag set for definitions.
+    struct Occurrence {
+        std::uint32_t name; // Index into the file's names.
+        std::uint32_t line;
+    };
+    const static std::uint32_t DefinitionFlag = 1u << 31;
+
+    struct FileEntry {
+        std::string fileRef;
+        std::uint64_t size;
+        std::int64_t modified;
+        std::uint64_t contentHash;
+        std::vector<std::string> names;
+        std::vector<Occurrence> occurrences;
+    };
+
+    struct Posting {
+        std::uint32_t file; // Index into Snapshot::files.
+        std::uint32_t line;
+    };
+
+    struct Snapshot {
+        std::vector<FileEntry> files;
+        std::unordered_map<std::string, std::vector<Posting>> postings;
+    };
+
+    const std::string codebasePath;
+    const std::filesystem::path indexPath;
+
+    mutable std::mutex snapshotMutex;
+    std::shared_ptr<const Snapshot> snapshot;
+    std::mutex updateMutex; // One Update() at a time.
+    std::atomic<bool> cancelled {false};
+    MemoryAccounting::Account account;
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+    // 'indexBytes' is set to its (approximate) size in memory.
+    static std::shared_ptr<const Snapshot> BuildSnapshot(std::vector<FileEntry> files, std::size_t& indexBytes);
+    std::vector<FileEntry> LoadFromDisk() const;
+    void SaveToDisk(const std::vector<FileEntry>& files) const;
+    static void LexFile(const std::string& contents, FileEntry& entry);
+};
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,209 @@
+#include "tagtrie.h"
+#include <algorithm>
+
+namespace {
+    template<typename NodeType>
+    bool RanksBefore(const NodeType* const a, const NodeType* const b) {
+        return a->uses != b->uses ? a->uses > b->uses : a->keyword < b->keyword;
+    }
+
+    std::size_t CommonPrefixLength(const std::string& a, const std::string& b, const std::size_t bOffset) {
+        std::size_t length = 0;
+        while (length < a.size() && bOffset + length < b.size() && a[length] == b[bOffset + length]) {
+            length++;
+        }
+        return length;
+    }
+}
+
+TagTrie::TagTrie() : root(std::make_unique<Node>()), account(MemoryAccounting::COLLECTIONS, "tag trie") {
+    this->UpdateAccounting();
+}
+
+TagTrie::TagTrie(const TagTrie& other) : TagTrie() {
+    std::vector<const Node*> pending = { other.root.get() };
+    while (!pending.empty()) {
+        const Node* const node = pending.back();
+        pending.pop_back();
+        if (node->uses > 0) {
+            this->Add(node->keyword, node->uses);
+        }
+        for (const std::unique_ptr<Node>& child : node->children) {
+            pending.push_back(child.get());
+        }
+    }
+}
+
+TagTrie& TagTrie::operator=(TagTrie other) {
+    std::swap(this->root, other.root);
+    std::swap(this->keywordCount, other.keywordCount);
+    std::swap(this->nodeCount, other.nodeCount);
+    std::swap(this->keywordBytes, other.keywordBytes);
+    this->UpdateAccounting();
+    other.UpdateAccounting();
+    return *this;
+}
+
+template<typename NodeType>
+auto TagTrie::FindChild(NodeType& node, const char first) {
+    return std::lower_bound(node.children.begin(), node.children.end(), first,
+        [](const std::unique_ptr<Node>& child, const char character) {
+            return child->edge[0] < character;
+        }
+    );
+}
+
+void TagTrie::RefreshBest(Node& node) {
+    std::vector<const Node*> candidates;
+    if (node.uses > 0) {
+        candidates.push_back(&node);
+    }
+    for (const std::unique_ptr<Node>& child : node.children) {
+        candidates.insert(candidates.end(), child->best.begin(), child->best.end());
+    }
+    const std::size_t kept = candidates.size() < TagTrie::MaxCompletions ? candidates.size() : TagTrie::MaxCompletions;
+    std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), RanksBefore<Node>);
+    node.best.assign(candidates.begin(), candidates.begin() + kept);
+}
+
+void TagTrie::Add(const std::string& keyword, const std::size_t uses) {
+    if (keyword.empty() || uses == 0) {
+        return;
+    }
+
+    std::vector<Node*> path = { this->root.get() };
+    std::size_t matched = 0;
+    while (matched < keyword.size()) {
+        Node* const node = path.back();
+        const auto childIter = TagTrie::FindChild(*node, keyword[matched]);
+        if (childIter == node->children.end() || (*childIter)->edge[0] != keyword[matched]) {
+            std::unique_ptr<Node> leaf = std::make_unique<Node>();
+            leaf->edge = keyword.substr(matched);
+            path.push_back(leaf.get());
+            node->children.insert(childIter, std::move(leaf));
+            this->nodeCount++;
+            break;
+        }
+
+        Node* const child = childIter->get();
+        const std::size_t common = CommonPrefixLength(child->edge, keyword, matched);
+        if (common < child->edge.size()) {
+            // The keyword diverges (or ends) part way along the edge, split it:
+            std::unique_ptr<Node> middle = std::make_unique<Node>();
+            middle->edge = child->edge.substr(0, common);
+            child->edge.erase(0, common);
+            middle->children.push_back(std::move(*childIter));
+            *childIter = std::move(middle);
+            this->nodeCount++;
+        }
+        path.push_back(childIter->get());
+        matched += common;
+    }
+
+    Node* const terminal = path.back();
+    if (terminal->uses == 0) {
+        terminal->keyword = keyword;
+        this->keywordCount++;
+        this->keywordBytes += keyword.size() * 2;
+    }
+    terminal->uses += uses;
+
+    for (auto nodeIter = path.rbegin(); nodeIter != path.rend(); nodeIter++) {
+        TagTrie::RefreshBest(**nodeIter);
+    }
+    this->UpdateAccounting();
+}
+
+void TagTrie::Remove(const std::string& keyword, const std::size_t uses) {
+    if (keyword.empty() || uses == 0) {
+        return;
+    }
+
+    std::vector<Node*> path = { this->root.get() };
+    std::size_t matched = 0;
+    while (matched < keyword.size()) {
+        Node* const node = path.back();
+        const auto childIter = TagTrie::FindChild(*node, keyword[matched]);
+        if (childIter == node->children.end() || keyword.compare(matched, (*childIter)->edge.size(), (*childIter)->edge) != 0) {
+            return;
+        }
+        matched += (*childIter)->edge.size();
+        path.push_back(childIter->get());
+    }
+
+    Node* const terminal = path.back();
+    if (terminal->uses == 0) {
+        return;
+    }
+    terminal->uses -= std::min(uses, terminal->uses);
+    if (terminal->uses == 0) {
+        terminal->keyword.clear();
+        terminal->keyword.shrink_to_fit();
+        this->keywordCount--;
+        this->keywordBytes -= keyword.size() * 2;
+
+        // Drop the node if nothing hangs off of it any more, and fold away whichever node is
+        // then left with a single child and no keyword of its own so edges stay compressed:
+        const auto replaceWithOnlyChild = [&path](Node* const node) {
+            Node* const parent = path[path.size() - 2];
+            std::unique_ptr<Node>& slot = *TagTrie::FindChild(*parent, node->edge[0]);
+            std::unique_ptr<Node> onlyChild = std::move(node->children.front());
+            onlyChild->edge.insert(0, node->edge);
+            slot = std::move(onlyChild);
+            path.pop_back();
+        };
+        if (terminal->children.empty()) {
+            Node* const parent = path[path.size() - 2];
+            parent->children.erase(TagTrie::FindChild(*parent, terminal->edge[0]));
+            path.pop_back();
+            this->nodeCount--;
+            if (path.size() > 1 && parent->uses == 0 && parent->children.size() == 1) {
+                replaceWithOnlyChild(parent);
+                this->nodeCount--;
+            }
+        }
+        else if (terminal->children.size() == 1) {
+            replaceWithOnlyChild(terminal);
+            this->nodeCount--;
+        }
+    }
+
+    for (auto nodeIter = path.rbegin(); nodeIter != path.rend(); nodeIter++) {
+        TagTrie::RefreshBest(**nodeIter);
+    }
+    this->UpdateAccounting();
+}
+
+std::vector<TagTrie::Completion> TagTrie::Complete(const std::string& prefix) const {
+    const Node* node = this->root.get();
+    std::size_t matched = 0;
+    while (matched < prefix.size()) {
+        const auto childIter = TagTrie::FindChild(*node, prefix[matched]);
+        if (childIter == node->children.end() || (*childIter)->edge[0] != prefix[matched]) {
+            return {};
+        }
+        const std::size_t common = CommonPrefixLength((*childIter)->edge, prefix, matched);
+        if (matched + common < prefix.size() && common < (*childIter)->edge.size()) {
+            return {};
+        }
+        matched += common;
+        node = childIter->get();
+    }
+
+    std::vector<Completion> completions;
+    completions.reserve(node->best.size());
+    for (const Node* const best : node->best) {
+        completions.push_back({ .keyword = best->keyword, .uses = best->uses });
+    }
+    return completions;
+}
+
+std::size_t TagTrie::KeywordCount() const {
+    return this->keywordCount;
+}
+
+void TagTrie::UpdateAccounting() {
+    // Estimate, each node's best list is assumed to be full:
+    this->account.Set(this->nodeCount * (sizeof(Node) + sizeof(std::unique_ptr<Node>) + TagTrie::MaxCompletions * sizeof(const Node*)) +
+                      this->keywordBytes);
+}
@@ -0,0 +1,55 @@
+#ifndef TAGTRIE_H
+#define TAGTRIE_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "memoryaccounting.h"
+
+// Keywords (#tags) and how many annotations use each, stored in a compressed prefix trie
+// (radix tree) for completion. Every node caches the MaxCompletions most used keywords
+// beneath it, so a completion is a walk down the prefix plus a copy of that list no matter
+// how many keywords share the prefix. Updates only refresh the caches along one path.
+
+class TagTrie {
+public:
+    const static std::size_t MaxCompletions = 10;
+
+    struct Completion {
+        std::string keyword;
+        std::size_t uses;
+    };
+
+    TagTrie();
+    TagTrie(const TagTrie& other);
+    TagTrie(TagTrie&& other) = default;
+    TagTrie& operator=(TagTrie other);
+
+    void Add(const std::string& keyword, std::size_t uses = 1);
+    void Remove(const std::string& keyword, std::size_t uses = 1);
+
+    // The most used keywords starting with 'prefix', most used first (then alphabetically).
+    std::vector<Completion> Complete(const std::string& prefix) const;
+    std::size_t KeywordCount() const;
+private:
+    struct Node {
+        std::string edge; // Label of the edge leading into this node.
+        std::string keyword; // The full keyword, if one ends here.
+        std::size_t uses = 0; // Zero if no keyword ends here.
+        std::vector<std::unique_ptr<Node>> children; // Sorted by the first character of their edges.
+        std::vector<const Node*> best; // Most used keyword nodes in this subtree.
+    };
+
+    std::unique_ptr<Node> root;
+    std::size_t keywordCount = 0;
+    std::size_t nodeCount = 1;
+    std::size_t keywordBytes = 0;
+    MemoryAccounting::Account account;
+
+    // The child whose edge would start with 'first' (or where it'd be inserted).
+    template<typename NodeType>
+    static auto FindChild(NodeType& node, char first);
+    static void RefreshBest(Node& node);
+    void UpdateAccounting();
+};
+
+#endif // TAGTRIE_H
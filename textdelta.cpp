@@ -0,0 +1,128 @@
+#include "textdelta.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    // Shortest run of the base worth copying rather than inserting, as a copy costs a couple of
+    // varints.
+    const static std::size_t BlockLength = 8;
+
+    void WriteVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    std::uint64_t ReadVarint(const std::string& in, std::size_t& position) {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (position >= in.size()) {
+                break;
+            }
+            const unsigned char byte = static_cast<unsigned char>(in[position++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Truncated text delta");
+    }
+
+    void WriteCopy(std::string& out, const std::size_t offset, const std::size_t length) {
+        if (length != 0) {
+            WriteVarint(out, static_cast<std::uint64_t>(length) << 1 | 1);
+            WriteVarint(out, offset);
+        }
+    }
+
+    void WriteInsert(std::string& out, const char* const bytes, const std::size_t length) {
+        if (length != 0) {
+            WriteVarint(out, static_cast<std::uint64_t>(length) << 1);
+            out.append(bytes, length);
+        }
+    }
+}
+
+std::string TextDelta::Encode(const std::string& base, const std::string& target) {
+    std::string delta;
+    std::size_t prefix = 0;
+    const std::size_t shorter = std::min(base.size(), target.size());
+    while (prefix < shorter && base[prefix] == target[prefix]) {
+        prefix++;
+    }
+    std::size_t suffix = 0;
+    while (suffix < shorter - prefix && base[base.size() - 1 - suffix] == target[target.size() - 1 - suffix]) {
+        suffix++;
+    }
+    WriteCopy(delta, 0, prefix);
+
+    // Index the base's blocks (each starting position's first occurrence) and then walk the
+    // changed part of the target, extending any block found there as far as it goes:
+    const std::size_t targetEnd = target.size() - suffix;
+    const std::string_view baseView(base);
+    std::unordered_map<std::string_view, std::size_t> blocks;
+    if (targetEnd - prefix >= BlockLength) {
+        blocks.reserve(base.size());
+        for (std::size_t i = 0; i + BlockLength <= base.size(); i++) {
+            blocks.emplace(baseView.substr(i, BlockLength), i);
+        }
+    }
+    const std::string_view targetView(target);
+    std::size_t pending = prefix; // Start of the bytes not yet copied or inserted.
+    std::size_t position = prefix;
+    while (position + BlockLength <= targetEnd) {
+        const std::unordered_map<std::string_view, std::size_t>::const_iterator found =
+            blocks.find(targetView.substr(position, BlockLength));
+        if (found == blocks.cend()) {
+            position++;
+            continue;
+        }
+        std::size_t offset = found->second, length = BlockLength;
+        while (position + length < targetEnd && offset + length < base.size() &&
+               base[offset + length] == target[position + length]) {
+            length++;
+        }
+        // Take back whatever matching bytes were about to be inserted:
+        while (position > pending && offset > 0 && base[offset - 1] == target[position - 1]) {
+            position--;
+            offset--;
+            length++;
+        }
+        WriteInsert(delta, target.data() + pending, position - pending);
+        WriteCopy(delta, offset, length);
+        position += length;
+        pending = position;
+    }
+    WriteInsert(delta, target.data() + pending, targetEnd - pending);
+    WriteCopy(delta, base.size() - suffix, suffix);
+    return delta;
+}
+
+std::string TextDelta::Apply(const std::string& base, const std::string& delta) {
+    std::string target;
+    std::size_t position = 0;
+    while (position < delta.size()) {
+        const std::uint64_t operation = ReadVarint(delta, position);
+        const std::uint64_t length = operation >> 1;
+        if (operation & 1) {
+            const std::uint64_t offset = ReadVarint(delta, position);
+            if (offset > base.size() || length > base.size() - offset) {
+                throw std::runtime_error("Text delta copies from outside of its base");
+            }
+            target.append(base, static_cast<std::size_t>(offset), static_cast<std::size_t>(length));
+        }
+        else {
+            if (length > delta.size() - position) {
+                throw std::runtime_error("Truncated text delta");
+            }
+            target.append(delta, position, static_cast<std::size_t>(length));
+            position += static_cast<std::size_t>(length);
+        }
+    }
+    return target;
+}
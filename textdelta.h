@@ -0,0 +1,19 @@
+#ifndef TEXTDELTA_H
+#define TEXTDELTA_H
+#include <string>
+
+// Byte-level deltas between two versions of a text: a sequence of copies out of the 'base'
+// version and literal insertions which together rebuild the 'target'. Any common prefix and
+// suffix are copied whole, the rest is matched a block at a time against an index of the
+// base's blocks so that moved or repeated passages are copied rather than stored again.
+//
+// Encoded as varints: (length << 1 | 1) then the base offset for a copy, (length << 1) then
+// the bytes themselves for an insertion.
+
+namespace TextDelta {
+    std::string Encode(const std::string& base, const std::string& target);
+    // Throws std::runtime_error if 'delta' is malformed or reaches outside of 'base'.
+    std::string Apply(const std::string& base, const std::string& delta);
+};
+
+#endif // TEXTDELTA_H
@@ -0,0 +1,443 @@
+#include "textindex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    bool IsWordByte(const unsigned char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+    }
+
+    bool StartsWith(const std::string& text, const std::string& prefix) {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // Rough heap footprints of each part of the index, for memory accounting:
+    const static std::size_t NodeOverhead = 4 * sizeof(void*);
+
+    template<typename T>
+    std::size_t VectorBytes(const std::vector<T>& vector) {
+        return vector.capacity() * sizeof(T);
+    }
+
+    std::size_t LocationBytes(const std::string& fileRef) {
+        return sizeof(std::pair<const std::pair<std::string, std::size_t>, std::vector<std::uint32_t>>) + NodeOverhead +
+               MemoryAccounting::StringHeapBytes(fileRef) + sizeof(std::uint32_t);
+    }
+}
+
+TextIndex::TextIndex() : account(MemoryAccounting::COLLECTIONS, "text index") {}
+
+TextIndex::TextIndex(const TextIndex& other) : TextIndex() {
+    const std::lock_guard<std::mutex> otherLock(other.mutex);
+    this->dictionary = other.dictionary;
+    this->terms = other.terms;
+    this->documents = other.documents;
+    this->documentsAt = other.documentsAt;
+    this->documentCount = other.documentCount;
+    this->removedCount = other.removedCount;
+    this->totalLength = other.totalLength;
+    this->heapBytes = other.heapBytes;
+    this->account.Set(this->heapBytes);
+}
+
+TextIndex::TextIndex(TextIndex&& other) : TextIndex() {
+    const std::lock_guard<std::mutex> otherLock(other.mutex);
+    this->Swap(other);
+}
+
+TextIndex& TextIndex::operator=(TextIndex other) {
+    // 'other' is this call's own, so only this index needs locking:
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    this->Swap(other);
+    return *this;
+}
+
+void TextIndex::Swap(TextIndex& other) {
+    std::swap(this->dictionary, other.dictionary);
+    std::swap(this->terms, other.terms);
+    std::swap(this->documents, other.documents);
+    std::swap(this->documentsAt, other.documentsAt);
+    std::swap(this->documentCount, other.documentCount);
+    std::swap(this->removedCount, other.removedCount);
+    std::swap(this->totalLength, other.totalLength);
+    std::swap(this->heapBytes, other.heapBytes);
+    this->account.Set(this->heapBytes);
+    other.account.Set(other.heapBytes);
+}
+
+std::vector<std::string> TextIndex::Tokenize(const std::string& text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (const unsigned char c : text) {
+        if (IsWordByte(c)) {
+            word += static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+        }
+        else if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+bool TextIndex::Matches(const std::vector<Clause>& clauses, const std::string& text) {
+    const std::vector<std::string> words = TextIndex::Tokenize(text);
+    for (const Clause& clause : clauses) {
+        const bool matched = clause.prefix ?
+            std::any_of(words.cbegin(), words.cend(), [&clause](const std::string& word) { return StartsWith(word, clause.terms.front()); }) :
+            std::search(words.cbegin(), words.cend(), clause.terms.cbegin(), clause.terms.cend()) != words.cend();
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextIndex::Add(const std::string& fileRef, const std::size_t lineRef, const std::string& id, const std::string& text) {
+    const std::vector<std::string> words = TextIndex::Tokenize(text);
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    const DocumentId document = static_cast<DocumentId>(this->documents.size());
+
+    // Each distinct word's positions are appended together, so they're grouped up first:
+    std::vector<std::uint32_t> byWord(words.size());
+    for (std::size_t i = 0; i < words.size(); i++) {
+        byWord[i] = static_cast<std::uint32_t>(i);
+    }
+    std::sort(byWord.begin(), byWord.end(), [&words](const std::uint32_t a, const std::uint32_t b) {
+        const int order = words[a].compare(words[b]);
+        return order != 0 ? order < 0 : a < b;
+    });
+    // Documents are numbered in the order they're added, so each posting list stays sorted:
+    for (std::size_t groupStart = 0; groupStart < byWord.size();) {
+        const std::string& word = words[byWord[groupStart]];
+        std::size_t groupEnd = groupStart + 1;
+        while (groupEnd < byWord.size() && words[byWord[groupEnd]] == word) {
+            groupEnd++;
+        }
+
+        std::unordered_map<std::string, PostingList>::iterator entry = this->dictionary.find(word);
+        if (entry == this->dictionary.end()) {
+            entry = this->dictionary.emplace(word, PostingList()).first;
+            this->terms.insert(word);
+            this->heapBytes += sizeof(std::pair<const std::string, PostingList>) + sizeof(std::string) + 2 * NodeOverhead +
+                               2 * MemoryAccounting::StringHeapBytes(word);
+        }
+        PostingList& postings = entry->second;
+        const std::size_t bytesBefore = VectorBytes(postings.documents) + VectorBytes(postings.ends) + VectorBytes(postings.positions);
+        postings.documents.push_back(document);
+        postings.positions.insert(postings.positions.end(), byWord.cbegin() + static_cast<std::ptrdiff_t>(groupStart),
+                                  byWord.cbegin() + static_cast<std::ptrdiff_t>(groupEnd));
+        postings.ends.push_back(static_cast<std::uint32_t>(postings.positions.size()));
+        this->heapBytes += VectorBytes(postings.documents) + VectorBytes(postings.ends) + VectorBytes(postings.positions) - bytesBefore;
+        groupStart = groupEnd;
+    }
+
+    const std::size_t documentsBytesBefore = VectorBytes(this->documents);
+    this->documents.push_back(Document {
+        .fileRef = fileRef, .lineRef = lineRef, .id = id, .length = static_cast<std::uint32_t>(words.size()), .removed = false
+    });
+    this->heapBytes += VectorBytes(this->documents) - documentsBytesBefore +
+                       MemoryAccounting::StringHeapBytes(fileRef) + MemoryAccounting::StringHeapBytes(id);
+    std::vector<DocumentId>& atLocation = this->documentsAt[{ fileRef, lineRef }];
+    if (atLocation.empty()) {
+        this->heapBytes += LocationBytes(fileRef);
+    }
+    atLocation.push_back(document);
+    this->documentCount++;
+    this->totalLength += words.size();
+    this->account.Set(this->heapBytes);
+}
+
+void TextIndex::Remove(const std::string& fileRef, const std::size_t lineRef, const std::string& id, const std::string& text) {
+    const std::vector<std::string> words = TextIndex::Tokenize(text);
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    const std::map<std::pair<std::string, std::size_t>, std::vector<DocumentId>>::iterator atLocation =
+        this->documentsAt.find({ fileRef, lineRef });
+    if (atLocation == this->documentsAt.end()) {
+        return;
+    }
+
+    // Only an identical annotation will do, any of them being as good as another:
+    const std::vector<DocumentId>::iterator removed = std::find_if(atLocation->second.begin(), atLocation->second.end(),
+        [this, &id, &words](const DocumentId candidate) {
+            return this->documents[candidate].id == id && this->Holds(candidate, words);
+        });
+    if (removed == atLocation->second.end()) {
+        return;
+    }
+    const DocumentId document = *removed;
+    atLocation->second.erase(removed);
+    if (atLocation->second.empty()) {
+        this->heapBytes -= LocationBytes(fileRef);
+        this->documentsAt.erase(atLocation);
+    }
+
+    // Its postings stay (until compacted), counted so that words no one uses any more are dropped:
+    std::vector<std::string> distinctWords = words;
+    std::sort(distinctWords.begin(), distinctWords.end());
+    distinctWords.erase(std::unique(distinctWords.begin(), distinctWords.end()), distinctWords.end());
+    for (const std::string& word : distinctWords) {
+        const std::unordered_map<std::string, PostingList>::iterator entry = this->dictionary.find(word);
+        PostingList& postings = entry->second;
+        if (++postings.removed == postings.documents.size()) {
+            this->heapBytes -= VectorBytes(postings.documents) + VectorBytes(postings.ends) + VectorBytes(postings.positions) +
+                               sizeof(std::pair<const std::string, PostingList>) + sizeof(std::string) + 2 * NodeOverhead +
+                               2 * MemoryAccounting::StringHeapBytes(word);
+            this->dictionary.erase(entry);
+            this->terms.erase(word);
+        }
+    }
+
+    Document& removedDocument = this->documents[document];
+    this->heapBytes -= MemoryAccounting::StringHeapBytes(removedDocument.fileRef) + MemoryAccounting::StringHeapBytes(removedDocument.id);
+    this->totalLength -= removedDocument.length;
+    removedDocument = Document { .fileRef = "", .lineRef = 0, .id = "", .length = 0, .removed = true };
+    this->documentCount--;
+    this->removedCount++;
+    // Once they're the majority, so each removal pays for (at most) two documents' compaction:
+    if (this->removedCount > this->documentCount) {
+        this->Compact();
+    }
+    this->account.Set(this->heapBytes);
+}
+
+bool TextIndex::Holds(const DocumentId document, const std::vector<std::string>& words) const {
+    if (this->documents[document].length != words.size()) {
+        return false;
+    }
+    // Every position taken by the word that's there:
+    for (std::size_t position = 0; position < words.size(); position++) {
+        const std::unordered_map<std::string, PostingList>::const_iterator entry = this->dictionary.find(words[position]);
+        if (entry == this->dictionary.cend()) {
+            return false;
+        }
+        const PostingList& postings = entry->second;
+        const std::vector<DocumentId>::const_iterator posting = std::lower_bound(postings.documents.cbegin(), postings.documents.cend(), document);
+        if (posting == postings.documents.cend() || *posting != document) {
+            return false;
+        }
+        const std::size_t index = static_cast<std::size_t>(posting - postings.documents.cbegin());
+        const std::uint32_t* const positions = postings.positions.data();
+        if (!std::binary_search(positions + (index == 0 ? 0 : postings.ends[index - 1]), positions + postings.ends[index],
+                                static_cast<std::uint32_t>(position))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextIndex::Compact() {
+    // Renumbering in order keeps every posting list sorted. Capacities are kept, so only the
+    // documents' footprint changes:
+    const DocumentId Dropped = std::numeric_limits<DocumentId>::max();
+    std::vector<DocumentId> renumbered(this->documents.size(), Dropped);
+    DocumentId kept = 0;
+    for (std::size_t document = 0; document < this->documents.size(); document++) {
+        if (!this->documents[document].removed) {
+            renumbered[document] = kept;
+            this->documents[kept++] = std::move(this->documents[document]);
+        }
+    }
+    this->documents.resize(kept);
+    this->removedCount = 0;
+
+    for (std::pair<const std::string, PostingList>& entry : this->dictionary) {
+        PostingList& postings = entry.second;
+        std::size_t keptPostings = 0;
+        std::uint32_t keptPositions = 0;
+        std::uint32_t start = 0;
+        // Everything only ever moves down, so it's done in place:
+        for (std::size_t i = 0; i < postings.documents.size(); i++) {
+            const std::uint32_t end = postings.ends[i];
+            if (renumbered[postings.documents[i]] != Dropped) {
+                std::copy(postings.positions.cbegin() + start, postings.positions.cbegin() + end,
+                          postings.positions.begin() + keptPositions);
+                keptPositions += end - start;
+                postings.documents[keptPostings] = renumbered[postings.documents[i]];
+                postings.ends[keptPostings] = keptPositions;
+                keptPostings++;
+            }
+            start = end;
+        }
+        postings.documents.resize(keptPostings);
+        postings.ends.resize(keptPostings);
+        postings.positions.resize(keptPositions);
+        postings.removed = 0;
+    }
+    for (std::pair<const std::pair<std::string, std::size_t>, std::vector<DocumentId>>& atLocation : this->documentsAt) {
+        for (DocumentId& document : atLocation.second) {
+            document = renumbered[document];
+        }
+    }
+}
+
+TextIndex::Matched TextIndex::Match(const Clause& clause) const {
+    Matched matched;
+    if (clause.terms.empty()) {
+        return matched;
+    }
+
+    if (clause.prefix) {
+        // Every word starting with the prefix, combined per document. Short prefixes can expand
+        // to most of the dictionary, so the frequencies are summed in a table of every document
+        // (no more than twice as many as there are, thanks to Compact()) rather than sorting
+        // what could be most of the index's postings:
+        const std::string& prefix = clause.terms.front();
+        std::vector<std::uint32_t> frequencies;
+        for (std::set<std::string>::const_iterator term = this->terms.lower_bound(prefix);
+             term != this->terms.cend() && StartsWith(*term, prefix); ++term) {
+            if (frequencies.empty()) {
+                frequencies.resize(this->documents.size(), 0);
+            }
+            const PostingList& postings = this->dictionary.at(*term);
+            for (std::size_t i = 0; i < postings.documents.size(); i++) {
+                frequencies[postings.documents[i]] += postings.ends[i] - (i == 0 ? 0 : postings.ends[i - 1]);
+            }
+        }
+        for (std::size_t document = 0; document < frequencies.size(); document++) {
+            if (frequencies[document] > 0 && !this->documents[document].removed) {
+                matched.emplace_back(static_cast<DocumentId>(document), frequencies[document]);
+            }
+        }
+        return matched;
+    }
+
+    std::vector<const PostingList*> lists;
+    for (const std::string& term : clause.terms) {
+        const std::unordered_map<std::string, PostingList>::const_iterator entry = this->dictionary.find(term);
+        if (entry == this->dictionary.cend()) {
+            return matched;
+        }
+        lists.push_back(&entry->second);
+    }
+    if (lists.size() == 1) {
+        const PostingList& postings = *lists.front();
+        matched.reserve(postings.documents.size() - postings.removed);
+        for (std::size_t i = 0; i < postings.documents.size(); i++) {
+            if (!this->documents[postings.documents[i]].removed) {
+                matched.emplace_back(postings.documents[i], postings.ends[i] - (i == 0 ? 0 : postings.ends[i - 1]));
+            }
+        }
+        return matched;
+    }
+
+    // A phrase: documents using every term (each list's cursor only moves forwards), then
+    // the positions at which they appear one after another.
+    std::vector<std::size_t> cursors(lists.size(), 0);
+    std::vector<std::pair<const std::uint32_t*, const std::uint32_t*>> termPositions(lists.size());
+    const PostingList& first = *lists.front();
+    for (std::size_t i = 0; i < first.documents.size(); i++) {
+        const DocumentId document = first.documents[i];
+        bool usesEvery = !this->documents[document].removed;
+        for (std::size_t term = 0; term < lists.size() && usesEvery; term++) {
+            const PostingList& postings = *lists[term];
+            cursors[term] = static_cast<std::size_t>(std::lower_bound(postings.documents.cbegin() + static_cast<std::ptrdiff_t>(cursors[term]),
+                                                                      postings.documents.cend(), document) - postings.documents.cbegin());
+            usesEvery = cursors[term] < postings.documents.size() && postings.documents[cursors[term]] == document;
+            if (usesEvery) {
+                const std::uint32_t* const positions = postings.positions.data();
+                termPositions[term] = { positions + (cursors[term] == 0 ? 0 : postings.ends[cursors[term] - 1]), positions + postings.ends[cursors[term]] };
+            }
+        }
+        if (!usesEvery) {
+            continue;
+        }
+
+        std::uint32_t occurrences = 0;
+        for (const std::uint32_t* position = termPositions.front().first; position != termPositions.front().second; ++position) {
+            bool consecutive = true;
+            for (std::size_t term = 1; term < termPositions.size() && consecutive; term++) {
+                consecutive = std::binary_search(termPositions[term].first, termPositions[term].second, *position + static_cast<std::uint32_t>(term));
+            }
+            occurrences += consecutive ? 1 : 0;
+        }
+        if (occurrences > 0) {
+            matched.emplace_back(document, occurrences);
+        }
+    }
+    return matched;
+}
+
+std::vector<TextIndex::Hit> TextIndex::Search(const std::vector<Clause>& clauses) const {
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    std::vector<Matched> clauseMatches;
+    for (const Clause& clause : clauses) {
+        clauseMatches.push_back(this->Match(clause));
+        if (clauseMatches.back().empty()) {
+            return {};
+        }
+    }
+    if (clauseMatches.empty()) {
+        return {};
+    }
+
+    // BM25: each clause's rarity (inverse document frequency), times its frequency within the
+    // document saturated by K1 and normalised by the document's length against the average:
+    const double documentCount = static_cast<double>(this->documentCount);
+    const double averageLength = std::max(1.0, static_cast<double>(this->totalLength) / documentCount);
+    std::sort(clauseMatches.begin(), clauseMatches.end(), [](const Matched& a, const Matched& b) {
+        return a.size() < b.size();
+    });
+    std::vector<double> rarities;
+    for (const Matched& matched : clauseMatches) {
+        const double matchingDocuments = static_cast<double>(matched.size());
+        rarities.push_back(std::log(1.0 + (documentCount - matchingDocuments + 0.5) / (matchingDocuments + 0.5)));
+    }
+
+    // Candidates come from the most selective clause, each looked up in the others:
+    std::vector<std::pair<double /* Score */, DocumentId>> scored;
+    scored.reserve(clauseMatches.front().size());
+    for (const std::pair<DocumentId, std::uint32_t>& candidate : clauseMatches.front()) {
+        const double lengthNorm = K1 * (1 - B + B * this->documents[candidate.first].length / averageLength);
+        double score = rarities.front() * (candidate.second * (K1 + 1)) / (candidate.second + lengthNorm);
+        bool matchesAll = true;
+        for (std::size_t i = 1; i < clauseMatches.size() && matchesAll; i++) {
+            const Matched::const_iterator match = std::lower_bound(clauseMatches[i].cbegin(), clauseMatches[i].cend(),
+                std::make_pair(candidate.first, std::uint32_t(0)));
+            matchesAll = match != clauseMatches[i].cend() && match->first == candidate.first;
+            if (matchesAll) {
+                score += rarities[i] * (match->second * (K1 + 1)) / (match->second + lengthNorm);
+            }
+        }
+        if (matchesAll) {
+            scored.emplace_back(score, candidate.first);
+        }
+    }
+
+    // Ties (common amongst short annotations) stay in the order they were added:
+    std::sort(scored.begin(), scored.end(), [](const std::pair<double, DocumentId>& a, const std::pair<double, DocumentId>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    std::vector<Hit> hits;
+    hits.reserve(scored.size());
+    for (const std::pair<double, DocumentId>& match : scored) {
+        const Document& document = this->documents[match.second];
+        hits.push_back(Hit { .fileRef = document.fileRef, .lineRef = document.lineRef, .id = document.id, .score = match.first });
+    }
+    return hits;
+}
+
+std::size_t TextIndex::Estimate(const std::vector<Clause>& clauses) const {
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    std::size_t estimate = this->documentCount;
+    for (const Clause& clause : clauses) {
+        if (clause.prefix) {
+            continue;
+        }
+        // A phrase can't be in more annotations than its rarest word:
+        for (const std::string& term : clause.terms) {
+            const std::unordered_map<std::string, PostingList>::const_iterator entry = this->dictionary.find(term);
+            estimate = std::min(estimate, entry == this->dictionary.cend() ? 0 : entry->second.documents.size() - entry->second.removed);
+        }
+    }
+    return estimate;
+}
+
+std::size_t TextIndex::DocumentCount() const {
+    const std::lock_guard<std::mutex> indexLock(this->mutex);
+    return this->documentCount;
+}
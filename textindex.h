@@ -0,0 +1,106 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "memoryaccounting.h"
+
+// Full-text index over annotation contents: an inverted index from every word to the
+// annotations using it (in the order they were added) and the positions it appears at within
+// each, so that phrases can be matched without re-reading the text. The words are also kept
+// sorted for prefix queries. Updated in place as annotations come and go, and searches rank
+// what they find with BM25 (term frequency, saturated by K1 and normalised by the
+// annotation's length against the average, weighted by how rare each term is).
+//
+// Words are runs of letters, digits, '_' and any non-ASCII (UTF-8) bytes, compared ignoring
+// (ASCII) case.
+//
+// Safe to search from any thread whilst being updated on another.
+
+class TextIndex {
+public:
+    // One part of a search, all of which must match.
+    struct Clause {
+        std::vector<std::string> terms; // Folded words, consecutive for a phrase.
+        bool prefix = false; // The single term matches any word starting with it.
+    };
+
+    struct Hit {
+        std::string fileRef;
+        std::size_t lineRef;
+        std::string id;
+        double score;
+    };
+
+    TextIndex();
+    TextIndex(const TextIndex& other);
+    TextIndex(TextIndex&& other);
+    TextIndex& operator=(TextIndex other);
+
+    static std::vector<std::string> Tokenize(const std::string& text);
+    // Whether 'text' satisfies every one of 'clauses', without the index.
+    static bool Matches(const std::vector<Clause>& clauses, const std::string& text);
+
+    // Annotations are identified by where they are, their id and their text, as there may be
+    // several on a line (sharing an id if copied, or having none). Remove() needs the same text
+    // the annotation was added with.
+    void Add(const std::string& fileRef, std::size_t lineRef, const std::string& id, const std::string& text);
+    void Remove(const std::string& fileRef, std::size_t lineRef, const std::string& id, const std::string& text);
+
+    // Everything matching all of 'clauses' (of which there should be at least one), best first.
+    std::vector<Hit> Search(const std::vector<Clause>& clauses) const;
+    // At most how many annotations Search() would find, from the posting lists' sizes alone.
+    std::size_t Estimate(const std::vector<Clause>& clauses) const;
+    std::size_t DocumentCount() const;
+private:
+    typedef std::uint32_t DocumentId;
+    const inline static double K1 = 1.2;
+    const inline static double B = 0.75;
+
+    // Documents using a word (ascending) and where they use it. Each document's positions
+    // (ascending) are a slice of 'positions' ending at its entry in 'ends', kept flat as most
+    // words appear just once in an annotation. Removed documents are only dropped from the
+    // lists by Compact(), so that removing one is never linear in how common its words are.
+    struct PostingList {
+        std::vector<DocumentId> documents;
+        std::vector<std::uint32_t> ends;
+        std::vector<std::uint32_t> positions;
+        std::uint32_t removed = 0; // Of 'documents'.
+    };
+    // A clause's matches: documents (ascending) and how many times each matched.
+    typedef std::vector<std::pair<DocumentId, std::uint32_t /* Frequency */>> Matched;
+
+    struct Document {
+        std::string fileRef;
+        std::size_t lineRef;
+        std::string id;
+        std::uint32_t length; // In words.
+        bool removed;
+    };
+
+    std::unordered_map<std::string, PostingList> dictionary;
+    std::set<std::string> terms; // The dictionary's words, in order.
+    // By DocumentId, removed ones left behind (emptied) until they outnumber the rest.
+    std::vector<Document> documents;
+    std::map<std::pair<std::string /* File Path */, std::size_t /* Line */>, std::vector<DocumentId>> documentsAt;
+    std::size_t documentCount = 0;
+    std::size_t removedCount = 0;
+    std::size_t totalLength = 0;
+    std::size_t heapBytes = 0;
+    MemoryAccounting::Account account;
+    mutable std::mutex mutex;
+
+    // Everything but the locks and accounts, whose owners are to be locked already.
+    void Swap(TextIndex& other);
+    // Whether 'document' is exactly 'words', according to the posting lists.
+    bool Holds(DocumentId document, const std::vector<std::string>& words) const;
+    // Drops the removed documents, renumbering the rest (in the same order).
+    void Compact();
+    Matched Match(const Clause& clause) const;
+};
+
+#endif // TEXTINDEX_H
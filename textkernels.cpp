@@ -0,0 +1,523 @@
+#include "textkernels.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEXTKERNELS_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 versions are compiled alongside the baseline ones and chosen at runtime:
+#define TEXTKERNELS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+    inline unsigned Popcount(std::uint32_t mask) {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_popcount(mask));
+#else
+        unsigned count = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    inline unsigned TrailingZeros(const std::uint32_t mask) {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned zeros = 0;
+        for (std::uint32_t remaining = mask; (remaining & 1) == 0; remaining >>= 1) {
+            ++zeros;
+        }
+        return zeros;
+#endif
+    }
+
+    // The 'n'th set bit (from 1) of 'mask', which must have at least 'n' set.
+    inline unsigned NthSetBit(std::uint32_t mask, std::size_t n) {
+        while (--n > 0) {
+            mask &= mask - 1;
+        }
+        return TrailingZeros(mask);
+    }
+
+    inline bool IsHTMLSpecial(const char c) {
+        return c == '<' || c == '>' || c == '&' || c == '"';
+    }
+
+    std::size_t CountByteScalar(const char* const begin, const char* const end, const char byte) {
+        return static_cast<std::size_t>(std::count(begin, end, byte));
+    }
+
+    const char* FindNthByteScalar(const char* position, const char* const end, const char byte,
+                                  const std::size_t n, std::size_t& found) {
+        for (; position < end; ++position) {
+            if (*position == byte && ++found == n) {
+                return position;
+            }
+        }
+        return nullptr;
+    }
+
+    const char* MatchSubsequenceScalar(const char* position, const char* const end,
+                                       const char* pattern, const char* const patternEnd) {
+        for (; position < end; ++position) {
+            if (*position == *pattern && ++pattern == patternEnd) {
+                return position + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    // Where MatchSubsequences() is up to, carried from the vectorised loop into the scalar tail.
+    struct SubsequenceScan {
+        const char* const pattern;
+        const char* const patternEnd;
+        const char separator;
+        std::vector<TextKernels::SubsequenceMatch>& matches;
+        std::size_t record;
+        const char* next; // Next pattern byte to find in the current record.
+        const char* matchEnd; // Set once the whole pattern's been found in the current record.
+
+        // The separator ending the current record has been reached.
+        inline void EndRecord() {
+            if (this->matchEnd != nullptr) {
+                this->matches.push_back({ .record = this->record, .end = this->matchEnd });
+            }
+            this->record++;
+            this->next = this->pattern;
+            this->matchEnd = nullptr;
+        }
+
+        // The current pattern byte is at 'position'.
+        inline void MatchByte(const char* const position) {
+            if (++this->next == this->patternEnd) {
+                this->matchEnd = position + 1;
+            }
+        }
+    };
+
+    void MatchSubsequencesScalar(const char* position, const char* const end, SubsequenceScan& scan) {
+        for (; position < end; ++position) {
+            if (*position == scan.separator) {
+                scan.EndRecord();
+            }
+            else if (scan.matchEnd == nullptr && *position == *scan.next) {
+                scan.MatchByte(position);
+            }
+        }
+    }
+
+    // Handles one byte that isn't plain ASCII: an HTML special or the start of a multibyte
+    // sequence. Returns the number of input bytes consumed.
+    std::size_t DecodeSpecial(const unsigned char* const position, const unsigned char* const end,
+                              char16_t*& output, const bool escapeHTML) {
+        const unsigned char lead = *position;
+        if (lead < 0x80) {
+            const char* entity = nullptr;
+            switch (lead) {
+                case '<': entity = "&lt;"; break;
+                case '>': entity = "&gt;"; break;
+                case '&': entity = "&amp;"; break;
+                case '"': entity = "&quot;"; break;
+            }
+            if (escapeHTML && entity != nullptr) {
+                for (; *entity != '\0'; ++entity) {
+                    *output++ = static_cast<char16_t>(*entity);
+                }
+            }
+            else {
+                *output++ = static_cast<char16_t>(lead);
+            }
+            return 1;
+        }
+
+        const std::size_t sequenceLength = TextKernels::UTF8SequenceLength(position, end);
+        if (sequenceLength == 0) {
+            *output++ = 0xFFFD; // Replacement character.
+            return 1;
+        }
+        std::uint32_t codePoint = lead & (0xFF >> (sequenceLength + 1));
+        for (std::size_t i = 1; i < sequenceLength; i++) {
+            codePoint = (codePoint << 6) | (position[i] & 0x3F);
+        }
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            *output++ = static_cast<char16_t>(0xD800 + (codePoint >> 10));
+            *output++ = static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else {
+            *output++ = static_cast<char16_t>(codePoint);
+        }
+        return sequenceLength;
+    }
+
+    std::size_t DecodeUTF8Scalar(const unsigned char* position, const unsigned char* const end,
+                                 char16_t* output, const bool escapeHTML) {
+        char16_t* const outputStart = output;
+        while (position < end) {
+            if (*position < 0x80 && !(escapeHTML && IsHTMLSpecial(static_cast<char>(*position)))) {
+                *output++ = static_cast<char16_t>(*position++);
+            }
+            else {
+                position += DecodeSpecial(position, end, output, escapeHTML);
+            }
+        }
+        return static_cast<std::size_t>(output - outputStart);
+    }
+
+#ifdef TEXTKERNELS_SSE2
+    std::size_t CountByteSSE2(const char* position, const char* const end, const char byte) {
+        const __m128i needle = _mm_set1_epi8(byte);
+        std::size_t count = 0;
+        for (; end - position >= 16; position += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+            count += Popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle))));
+        }
+        return count + CountByteScalar(position, end, byte);
+    }
+
+    const char* FindNthByteSSE2(const char* position, const char* const end, const char byte,
+                                const std::size_t n, std::size_t& found) {
+        const __m128i needle = _mm_set1_epi8(byte);
+        for (; end - position >= 16; position += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+            const std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+            const unsigned blockCount = Popcount(mask);
+            if (found + blockCount >= n) {
+                const std::size_t remaining = n - found;
+                found = n;
+                return position + NthSetBit(mask, remaining);
+            }
+            found += blockCount;
+        }
+        return FindNthByteScalar(position, end, byte, n, found);
+    }
+
+    const char* MatchSubsequenceSSE2(const char* position, const char* const end,
+                                     const char* pattern, const char* const patternEnd) {
+        for (; end - position >= 16; position += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+            // Several pattern bytes may match within one block, each after the last:
+            std::uint32_t passed = 0;
+            for (;;) {
+                const std::uint32_t mask = static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(*pattern)))) & ~passed;
+                if (mask == 0) {
+                    break;
+                }
+                const unsigned matched = TrailingZeros(mask);
+                if (++pattern == patternEnd) {
+                    return position + matched + 1;
+                }
+                passed = (2u << matched) - 1;
+            }
+        }
+        return MatchSubsequenceScalar(position, end, pattern, patternEnd);
+    }
+
+    void MatchSubsequencesSSE2(const char* position, const char* const end, SubsequenceScan& scan) {
+        const __m128i separator = _mm_set1_epi8(scan.separator);
+        for (; end - position >= 16; position += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+            const std::uint32_t separators = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, separator)));
+            // Step from event to event (the next pattern byte or the end of a record) within the block:
+            std::uint32_t passed = 0;
+            for (;;) {
+                const std::uint32_t patternBytes = scan.matchEnd != nullptr ? 0 :
+                    static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(*scan.next))));
+                const std::uint32_t events = (separators | patternBytes) & ~passed;
+                if (events == 0) {
+                    break;
+                }
+                const unsigned event = TrailingZeros(events);
+                if ((separators >> event) & 1) {
+                    scan.EndRecord();
+                }
+                else {
+                    scan.MatchByte(position + event);
+                }
+                passed = (2u << event) - 1;
+            }
+        }
+        MatchSubsequencesScalar(position, end, scan);
+    }
+
+    // Bytes of 'block' that need more than widening: non-ASCII and (optionally) HTML specials.
+    inline std::uint32_t SpecialMaskSSE2(const __m128i block, const bool escapeHTML) {
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(block)); // High bit set.
+        if (escapeHTML) {
+            const __m128i specials = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('<')), _mm_cmpeq_epi8(block, _mm_set1_epi8('>'))),
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('&')), _mm_cmpeq_epi8(block, _mm_set1_epi8('"')))
+            );
+            mask |= static_cast<std::uint32_t>(_mm_movemask_epi8(specials));
+        }
+        return mask;
+    }
+
+    std::size_t DecodeUTF8SSE2(const unsigned char* position, const unsigned char* const end,
+                               char16_t* output, const bool escapeHTML) {
+        char16_t* const outputStart = output;
+        const __m128i zero = _mm_setzero_si128();
+        while (end - position >= 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+            const std::uint32_t mask = SpecialMaskSSE2(block, escapeHTML);
+            // Widen all 16 regardless, 'output' always has room for at least that many units
+            // and anything past the plain prefix is overwritten below:
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_unpacklo_epi8(block, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 8), _mm_unpackhi_epi8(block, zero));
+            if (mask == 0) {
+                position += 16;
+                output += 16;
+                continue;
+            }
+            const unsigned plainLength = TrailingZeros(mask);
+            position += plainLength;
+            output += plainLength;
+            position += DecodeSpecial(position, end, output, escapeHTML);
+        }
+        return static_cast<std::size_t>(output - outputStart) + DecodeUTF8Scalar(position, end, output, escapeHTML);
+    }
+#endif
+
+#ifdef TEXTKERNELS_AVX2
+    bool HasAVX2() {
+        const static bool hasAVX2 = __builtin_cpu_supports("avx2");
+        return hasAVX2;
+    }
+
+    __attribute__((target("avx2")))
+    std::size_t CountByteAVX2(const char* position, const char* const end, const char byte) {
+        const __m256i needle = _mm256_set1_epi8(byte);
+        std::size_t count = 0;
+        for (; end - position >= 32; position += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+            count += Popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle))));
+        }
+        return count + CountByteSSE2(position, end, byte);
+    }
+
+    __attribute__((target("avx2")))
+    const char* FindNthByteAVX2(const char* position, const char* const end, const char byte,
+                                const std::size_t n, std::size_t& found) {
+        const __m256i needle = _mm256_set1_epi8(byte);
+        for (; end - position >= 32; position += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+            const std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+            const unsigned blockCount = Popcount(mask);
+            if (found + blockCount >= n) {
+                const std::size_t remaining = n - found;
+                found = n;
+                return position + NthSetBit(mask, remaining);
+            }
+            found += blockCount;
+        }
+        return FindNthByteSSE2(position, end, byte, n, found);
+    }
+
+    __attribute__((target("avx2")))
+    const char* MatchSubsequenceAVX2(const char* position, const char* const end,
+                                     const char* pattern, const char* const patternEnd) {
+        for (; end - position >= 32; position += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+            std::uint32_t passed = 0;
+            for (;;) {
+                const std::uint32_t mask = static_cast<std::uint32_t>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(*pattern)))) & ~passed;
+                if (mask == 0) {
+                    break;
+                }
+                const unsigned matched = TrailingZeros(mask);
+                if (++pattern == patternEnd) {
+                    return position + matched + 1;
+                }
+                passed = (2u << matched) - 1; // All ones (wrapping) once bit 31 has matched.
+            }
+        }
+        return MatchSubsequenceSSE2(position, end, pattern, patternEnd);
+    }
+
+    __attribute__((target("avx2")))
+    void MatchSubsequencesAVX2(const char* position, const char* const end, SubsequenceScan& scan) {
+        const __m256i separator = _mm256_set1_epi8(scan.separator);
+        for (; end - position >= 32; position += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+            const std::uint32_t separators = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, separator)));
+            std::uint32_t passed = 0;
+            for (;;) {
+                const std::uint32_t patternBytes = scan.matchEnd != nullptr ? 0 :
+                    static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(*scan.next))));
+                const std::uint32_t events = (separators | patternBytes) & ~passed;
+                if (events == 0) {
+                    break;
+                }
+                const unsigned event = TrailingZeros(events);
+                if ((separators >> event) & 1) {
+                    scan.EndRecord();
+                }
+                else {
+                    scan.MatchByte(position + event);
+                }
+                passed = (2u << event) - 1;
+            }
+        }
+        MatchSubsequencesSSE2(position, end, scan);
+    }
+
+    __attribute__((target("avx2")))
+    std::size_t DecodeUTF8AVX2(const unsigned char* position, const unsigned char* const end,
+                               char16_t* output, const bool escapeHTML) {
+        char16_t* const outputStart = output;
+        while (end - position >= 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+            std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(block));
+            if (escapeHTML) {
+                const __m256i specials = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('<')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('>'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('&')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')))
+                );
+                mask |= static_cast<std::uint32_t>(_mm256_movemask_epi8(specials));
+            }
+            // As with SSE2, widen everything and only keep the plain prefix:
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1)));
+            if (mask == 0) {
+                position += 32;
+                output += 32;
+                continue;
+            }
+            const unsigned plainLength = TrailingZeros(mask);
+            position += plainLength;
+            output += plainLength;
+            position += DecodeSpecial(position, end, output, escapeHTML);
+        }
+        return static_cast<std::size_t>(output - outputStart) + DecodeUTF8SSE2(position, end, output, escapeHTML);
+    }
+#endif
+}
+
+std::size_t TextKernels::CountByte(const char* const begin, const char* const end, const char byte) {
+#if defined(TEXTKERNELS_AVX2)
+    return HasAVX2() ? CountByteAVX2(begin, end, byte) : CountByteSSE2(begin, end, byte);
+#elif defined(TEXTKERNELS_SSE2)
+    return CountByteSSE2(begin, end, byte);
+#else
+    return CountByteScalar(begin, end, byte);
+#endif
+}
+
+const char* TextKernels::FindNthByte(const char* const begin, const char* const end, const char byte,
+                                     const std::size_t n, std::size_t& found) {
+    found = 0;
+    if (n == 0) {
+        return nullptr;
+    }
+#if defined(TEXTKERNELS_AVX2)
+    return HasAVX2() ? FindNthByteAVX2(begin, end, byte, n, found) : FindNthByteSSE2(begin, end, byte, n, found);
+#elif defined(TEXTKERNELS_SSE2)
+    return FindNthByteSSE2(begin, end, byte, n, found);
+#else
+    return FindNthByteScalar(begin, end, byte, n, found);
+#endif
+}
+
+const char* TextKernels::MatchSubsequence(const char* const begin, const char* const end,
+                                          const char* const pattern, const std::size_t patternLength) {
+    if (patternLength == 0) {
+        return begin;
+    }
+#if defined(TEXTKERNELS_AVX2)
+    return HasAVX2() ? MatchSubsequenceAVX2(begin, end, pattern, pattern + patternLength) :
+                       MatchSubsequenceSSE2(begin, end, pattern, pattern + patternLength);
+#elif defined(TEXTKERNELS_SSE2)
+    return MatchSubsequenceSSE2(begin, end, pattern, pattern + patternLength);
+#else
+    return MatchSubsequenceScalar(begin, end, pattern, pattern + patternLength);
+#endif
+}
+
+void TextKernels::MatchSubsequences(const char* const begin, const char* const end, const char separator,
+                                    const char* const pattern, const std::size_t patternLength,
+                                    const std::size_t firstRecord, std::vector<SubsequenceMatch>& matches) {
+    if (patternLength == 0) {
+        return;
+    }
+    SubsequenceScan scan {
+        .pattern = pattern,
+        .patternEnd = pattern + patternLength,
+        .separator = separator,
+        .matches = matches,
+        .record = firstRecord,
+        .next = pattern,
+        .matchEnd = nullptr
+    };
+#if defined(TEXTKERNELS_AVX2)
+    if (HasAVX2()) {
+        MatchSubsequencesAVX2(begin, end, scan);
+    }
+    else {
+        MatchSubsequencesSSE2(begin, end, scan);
+    }
+#elif defined(TEXTKERNELS_SSE2)
+    MatchSubsequencesSSE2(begin, end, scan);
+#else
+    MatchSubsequencesScalar(begin, end, scan);
+#endif
+}
+
+std::size_t TextKernels::UTF8SequenceLength(const unsigned char* const begin, const unsigned char* const end) {
+    const unsigned char lead = *begin;
+    if (lead < 0x80) {
+        return 1;
+    }
+
+    // The valid range of the second byte depends on the lead (ruling out overlong forms,
+    // surrogates and anything past U+10FFFF), the rest are plain continuation bytes:
+    std::size_t length = 0;
+    unsigned char secondMin = 0x80, secondMax = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        secondMin = lead == 0xE0 ? 0xA0 : 0x80;
+        secondMax = lead == 0xED ? 0x9F : 0xBF;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        secondMin = lead == 0xF0 ? 0x90 : 0x80;
+        secondMax = lead == 0xF4 ? 0x8F : 0xBF;
+    }
+    else {
+        return 0;
+    }
+
+    if (end - begin < static_cast<std::ptrdiff_t>(length) || begin[1] < secondMin || begin[1] > secondMax) {
+        return 0;
+    }
+    for (std::size_t i = 2; i < length; i++) {
+        if ((begin[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+std::size_t TextKernels::DecodeUTF8(const char* const data, const std::size_t length,
+                                    char16_t* const output, const bool escapeHTML) {
+    const unsigned char* const begin = reinterpret_cast<const unsigned char*>(data);
+#if defined(TEXTKERNELS_AVX2)
+    return HasAVX2() ? DecodeUTF8AVX2(begin, begin + length, output, escapeHTML) :
+                       DecodeUTF8SSE2(begin, begin + length, output, escapeHTML);
+#elif defined(TEXTKERNELS_SSE2)
+    return DecodeUTF8SSE2(begin, begin + length, output, escapeHTML);
+#else
+    return DecodeUTF8Scalar(begin, begin + length, output, escapeHTML);
+#endif
+}
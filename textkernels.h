@@ -0,0 +1,57 @@
+#ifndef TEXTKERNELS_H
+#define TEXTKERNELS_H
+#include <QString>
+#include <cstddef>
+#include <vector>
+
+// Byte-level text routines used on the file loading and search paths, working directly on raw (UTF-8)
+// buffers. On x86-64 they use SSE2, or AVX2 where the CPU supports it (picked at runtime),
+// everywhere else they fall back to scalar code.
+
+namespace TextKernels {
+    // The number of occurrences of 'byte' in [begin, end).
+    std::size_t CountByte(const char* begin, const char* end, char byte);
+
+    // The 'n'th (counting from 1) occurrence of 'byte' in [begin, end), or nullptr if there
+    // are fewer than 'n'. 'found' is set to the number of occurrences seen (up to 'n').
+    const char* FindNthByte(const char* begin, const char* end, char byte, std::size_t n, std::size_t& found);
+
+    // One past the last byte of the leftmost occurrence of 'pattern' as a subsequence of
+    // [begin, end) (its bytes in order, not necessarily adjacent), or nullptr if there's none.
+    const char* MatchSubsequence(const char* begin, const char* end, const char* pattern, std::size_t patternLength);
+
+    struct SubsequenceMatch {
+        std::size_t record; // Counting from the 'firstRecord' passed in.
+        const char* end; // As MatchSubsequence().
+    };
+
+    // MatchSubsequence() over every 'separator'-terminated record in [begin, end) in a single
+    // pass, appending a SubsequenceMatch to 'matches' for each record that matches. Far cheaper
+    // than a call per record when records are short. 'pattern' mustn't contain 'separator'.
+    void MatchSubsequences(const char* begin, const char* end, char separator, const char* pattern,
+                           std::size_t patternLength, std::size_t firstRecord, std::vector<SubsequenceMatch>& matches);
+
+    // The length of the well-formed UTF-8 sequence starting at 'begin' (1 to 4), or 0 if it's
+    // malformed (overlong, a surrogate, out of range or truncated).
+    std::size_t UTF8SequenceLength(const unsigned char* begin, const unsigned char* end);
+
+    // The most UTF-16 code units DecodeUTF8() can write for 'length' bytes.
+    constexpr std::size_t MaxDecodedLength(const std::size_t length, const bool escapeHTML) {
+        return length * (escapeHTML ? 6 : 1); // '"' becomes "&quot;"
+    }
+
+    // Decodes UTF-8 to UTF-16 (malformed sequences become U+FFFD, as QString::fromUtf8 does),
+    // optionally escaping it for HTML like QString::toHtmlEscaped. 'output' must have room for
+    // MaxDecodedLength(length, escapeHTML) units, returns the number of units written.
+    std::size_t DecodeUTF8(const char* data, std::size_t length, char16_t* output, bool escapeHTML);
+
+    // DecodeUTF8() straight onto the end of 'output'.
+    inline void AppendUTF8(QString& output, const char* const data, const std::size_t length, const bool escapeHTML) {
+        const qsizetype start = output.size();
+        output.resize(start + static_cast<qsizetype>(MaxDecodedLength(length, escapeHTML)));
+        const std::size_t written = DecodeUTF8(data, length, reinterpret_cast<char16_t*>(output.data()) + start, escapeHTML);
+        output.resize(start + static_cast<qsizetype>(written));
+    }
+};
+
+#endif // TEXTKERNELS_H
@@ -0,0 +1,164 @@
+#include "tracing.h"
+#include "memoryaccounting.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // One per thread, only ever written to by its owning thread. The head counter is
+    // published with release semantics after each event so that a dumping thread can
+    // tell which slots may have been overwritten whilst it was copying them.
+    struct ThreadRing {
+        std::atomic<std::uint64_t> head {0};
+        std::uint32_t threadIndex = 0;
+        std::string threadName;
+        Tracing::Event events[Tracing::RingCapacity];
+    };
+
+    // Rings are registered once per thread (the only time a lock is taken) and are kept
+    // alive by the registry after their thread exits so that their spans can still be dumped.
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<ThreadRing>> registry;
+
+    ThreadRing& LocalRing() {
+        thread_local std::shared_ptr<ThreadRing> localRing;
+        if (!localRing) {
+            localRing = std::make_shared<ThreadRing>();
+            MemoryAccounting::Allocate(MemoryAccounting::DIAGNOSTICS, sizeof(ThreadRing)); // Never released.
+            const std::lock_guard<std::mutex> registryLock(registryMutex);
+            localRing->threadIndex = static_cast<std::uint32_t>(registry.size() + 1);
+            registry.push_back(localRing);
+        }
+        return *localRing;
+    }
+
+    std::uint64_t NowNs() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch
+        ).count());
+    }
+
+    void CopyDetail(char* const destination, const std::string& detail) {
+        // Keep the tail of overly long details since it's the most specific part of a path.
+        const std::size_t copyLength = std::min(detail.length(), Tracing::MaxDetailLength);
+        std::memcpy(destination, detail.data() + (detail.length() - copyLength), copyLength);
+        destination[copyLength] = '\0';
+    }
+
+    void WriteJSONString(std::ostream& output, const char* const str) {
+        output << '"';
+        for (const char* c = str; *c != '\0'; c++) {
+            switch (*c) {
+                case '"': output << "\\\""; break;
+                case '\\': output << "\\\\"; break;
+                case '\n': output << "\\n"; break;
+                case '\t': output << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        output << ' ';
+                    }
+                    else {
+                        output << *c;
+                    }
+                    break;
+            }
+        }
+        output << '"';
+    }
+}
+
+Tracing::Span::Span(const char* name) noexcept : name(name), startNs(NowNs()) {
+    this->detail[0] = '\0';
+}
+
+Tracing::Span::Span(const char* name, const std::string& detail) noexcept : name(name), startNs(NowNs()) {
+    CopyDetail(this->detail, detail);
+}
+
+Tracing::Span::~Span() {
+    ThreadRing& ring = LocalRing();
+    const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Tracing::Event& slot = ring.events[head % Tracing::RingCapacity];
+    slot.name = this->name;
+    slot.startNs = this->startNs;
+    slot.durationNs = NowNs() - this->startNs;
+    std::memcpy(slot.detail, this->detail, sizeof(slot.detail));
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracing::SetThreadName(const std::string& name) {
+    if (!Tracing::Enabled()) {
+        return; // Avoid allocating a ring that will never be written to.
+    }
+    ThreadRing& ring = LocalRing();
+    const std::lock_guard<std::mutex> registryLock(registryMutex);
+    ring.threadName = name;
+}
+
+bool Tracing::DumpChromeTrace(const std::string& path) {
+    std::ofstream output(path, std::ios::out | std::ios::trunc);
+    if (!output.is_open()) {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        const std::lock_guard<std::mutex> registryLock(registryMutex);
+        rings = registry;
+    }
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool firstEvent = true;
+    std::vector<Tracing::Event> copiedEvents;
+    for (const std::shared_ptr<ThreadRing>& ring : rings) {
+        // Copy out the retained window and then discard anything the owning thread
+        // may have overwritten whilst we were copying it, including the slot it may be
+        // part way through writing at 'headAfter'.
+        const std::uint64_t headBefore = ring->head.load(std::memory_order_acquire);
+        const std::uint64_t firstIndex = headBefore > Tracing::RingCapacity ? headBefore - Tracing::RingCapacity : 0;
+        copiedEvents.clear();
+        for (std::uint64_t i = firstIndex; i < headBefore; i++) {
+            copiedEvents.push_back(ring->events[i % Tracing::RingCapacity]);
+        }
+        const std::uint64_t headAfter = ring->head.load(std::memory_order_acquire);
+        const std::uint64_t overwritten = headAfter >= Tracing::RingCapacity ? headAfter - Tracing::RingCapacity + 1 : 0;
+        const std::size_t skipCount = static_cast<std::size_t>(
+            std::min<std::uint64_t>(overwritten > firstIndex ? overwritten - firstIndex : 0, copiedEvents.size())
+        );
+
+        std::string threadName;
+        {
+            const std::lock_guard<std::mutex> registryLock(registryMutex);
+            threadName = ring->threadName.empty() ? "Thread " + std::to_string(ring->threadIndex) : ring->threadName;
+        }
+        output << (firstEvent ? "" : ",") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+               << ring->threadIndex << ",\"args\":{\"name\":";
+        WriteJSONString(output, threadName.c_str());
+        output << "}}";
+        firstEvent = false;
+
+        for (std::size_t i = skipCount; i < copiedEvents.size(); i++) {
+            const Tracing::Event& event = copiedEvents[i];
+            output << ",{\"ph\":\"X\",\"cat\":\"blocks\",\"pid\":1,\"tid\":" << ring->threadIndex << ",\"name\":";
+            WriteJSONString(output, event.name);
+            // Trace-event timestamps are in (fractional) microseconds:
+            output << ",\"ts\":" << event.startNs / 1000 << '.' << (event.startNs % 1000) / 100
+                   << ",\"dur\":" << event.durationNs / 1000 << '.' << (event.durationNs % 1000) / 100;
+            if (event.detail[0] != '\0') {
+                output << ",\"args\":{\"detail\":";
+                WriteJSONString(output, event.detail);
+                output << '}';
+            }
+            output << '}';
+        }
+    }
+    output << "]}";
+
+    return output.good();
+}
@@ -0,0 +1,69 @@
+#ifndef TRACING_H
+#define TRACING_H
+#include <cstdint>
+#include <string>
+
+// Scoped timing spans for working out where the time goes (e.g. during a slow reload).
+// Spans are only compiled in when BLOCKS_TRACING is defined (see Blocks.pro), otherwise the
+// TRACE_* macros expand to nothing (their arguments aren't evaluated). Attributing stalls is
+// the watchdog's own WATCHDOG_SCOPE*, see stallwatchdog.h.
+//
+// Every thread records into its own fixed-size ring buffer that only it writes to, so
+// recording a span never takes a lock - the oldest spans are simply overwritten.
+// DumpChromeTrace() writes everything currently buffered as trace-event JSON which can be
+// loaded into chrome://tracing or https://ui.perfetto.dev.
+
+namespace Tracing {
+    // Number of spans retained per thread before the oldest are overwritten.
+    const static std::size_t RingCapacity = 8192;
+    // Longest 'detail' (typically a file path) retained per span, the tail is kept.
+    const static std::size_t MaxDetailLength = 63;
+
+    struct Event {
+        const char* name; // Always a string literal.
+        std::uint64_t startNs;
+        std::uint64_t durationNs;
+        char detail[MaxDetailLength + 1];
+    };
+
+    class Span {
+    public:
+        explicit Span(const char* name) noexcept;
+        Span(const char* name, const std::string& detail) noexcept;
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        const char* name;
+        std::uint64_t startNs;
+        char detail[MaxDetailLength + 1];
+    };
+
+    constexpr bool Enabled() {
+#ifdef BLOCKS_TRACING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Labels the calling thread in dumped traces (i.e. "GUI").
+    void SetThreadName(const std::string& name);
+
+    // Writes every buffered span (from all threads) to 'path', returns false if the file
+    // couldn't be written. When tracing is compiled out this writes an empty trace.
+    bool DumpChromeTrace(const std::string& path);
+};
+
+#define TRACE_CONCAT_IMPL(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_IMPL(A, B)
+#ifdef BLOCKS_TRACING
+#define TRACE_SCOPE(NAME) Tracing::Span TRACE_CONCAT(traceSpan, __LINE__)(NAME)
+#define TRACE_SCOPE_DETAIL(NAME, DETAIL) Tracing::Span TRACE_CONCAT(traceSpan, __LINE__)(NAME, DETAIL)
+#else
+#define TRACE_SCOPE(NAME)
+#define TRACE_SCOPE_DETAIL(NAME, DETAIL)
+#endif
+
+#endif // TRACING_H
@@ -2,14 +2,13 @@
 #define UTILS_H
 #include "annotation.h"
 #include "bookmark.h"
+#include "shortcutdispatcher.h"
 
-#define NEW_KEYBIND(ACTION_STRNAME, ACTION_KEYSEQ, ACTION_SLOT, TARGET) \
-    generalActionUniquePtr = std::make_unique<QAction>(this); \
-    generalActionPtr = generalActionUniquePtr.get(); \
-    generalActionPtr->setShortcut(ACTION_KEYSEQ); \
-    generalActionPtr->setShortcutContext(Qt::WidgetWithChildrenShortcut); \
-    QObject::connect(generalActionPtr, SIGNAL(triggered()), SLOT(ACTION_SLOT())); \
-    TARGET->addAction(generalActionPtr); \
-    this->keyBindings[ACTION_STRNAME].push_back(std::move(generalActionUniquePtr));
+#define NEW_KEYBIND(ACTION_STRNAME, ACTION_KEYSEQ, ACTION_SLOT, DISPATCHER) \
+    DISPATCHER.Bind(ACTION_STRNAME, ACTION_KEYSEQ, this, SLOT(ACTION_SLOT()));
+
+// Calls ACTION_SLOT on the dispatcher's current target.
+#define NEW_TARGETED_KEYBIND(ACTION_STRNAME, ACTION_KEYSEQ, ACTION_SLOT, DISPATCHER) \
+    DISPATCHER.BindTargeted(ACTION_STRNAME, ACTION_KEYSEQ, #ACTION_SLOT);
 
 #endif // UTILS_H
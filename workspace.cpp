@@ -0,0 +1,53 @@
+#include "workspace.h"
+#include <stdexcept>
+#include "tracing.h"
+
+Workspace::Workspace(const std::size_t cacheBudget) : cache(cacheBudget, "workspace cache") {}
+
+std::string Workspace::NormalisePath(const std::string& codebasePath) {
+    return codebasePath.empty() || codebasePath.back() == '/' ? codebasePath : codebasePath + '/';
+}
+
+Project& Workspace::Open(const std::string& codebasePath) {
+    TRACE_SCOPE_DETAIL("Workspace::Open", codebasePath);
+    Project* const existing = this->Find(codebasePath);
+    if (existing != nullptr) {
+        return *existing;
+    }
+    this->projects.push_back(std::make_unique<Project>(Workspace::NormalisePath(codebasePath)));
+    const Project& project = *this->projects.back();
+    this->symbolIndexes.push_back(std::make_shared<SymbolIndex>(project.GetCodebasePath(), project.GetCacheDirectory() / "symbols.idx"));
+    return *this->projects.back();
+}
+
+Project* Workspace::Find(const std::string& codebasePath) const {
+    const std::string normalisedPath = Workspace::NormalisePath(codebasePath);
+    for (const std::unique_ptr<Project>& project : this->projects) {
+        if (project->GetCodebasePath() == normalisedPath) {
+            return project.get();
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Project*> Workspace::GetProjects() const {
+    std::vector<Project*> openProjects;
+    openProjects.reserve(this->projects.size());
+    for (const std::unique_ptr<Project>& project : this->projects) {
+        openProjects.push_back(project.get());
+    }
+    return openProjects;
+}
+
+std::shared_ptr<SymbolIndex> Workspace::GetSymbolIndex(const Project& project) const {
+    for (std::size_t i = 0; i < this->projects.size(); i++) {
+        if (this->projects[i].get() == &project) {
+            return this->symbolIndexes[i];
+        }
+    }
+    throw std::invalid_argument("Project for " + project.GetCodebasePath() + " isn't in the workspace");
+}
+
+ContentCache& Workspace::GetCache() const {
+    return this->cache;
+}
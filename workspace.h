@@ -0,0 +1,44 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "configuration.h"
+#include "contentcache.h"
+#include "project.h"
+#include "symbolindex.h"
+
+// The codebases open side by side (e.g. a library and its consumers), each its own Project with
+// its own annotations, bookmarks and coverage. What they read and render goes through one
+// shared ContentCache, and their parallel work through Parallel's one pool of workers, so a
+// second codebase costs its own data and nothing more. Projects stay where they are once
+// opened (other objects keep references to them) for the workspace's lifetime, as do their
+// symbol indexes.
+
+class Workspace {
+public:
+    explicit Workspace(std::size_t cacheBudget = Config::Workspace::CacheBudget);
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    // The project for the codebase at 'codebasePath', opened (empty) if it isn't already.
+    // Throws std::runtime_error if there's no such directory.
+    Project& Open(const std::string& codebasePath);
+    // Null if the codebase at 'codebasePath' isn't open.
+    Project* Find(const std::string& codebasePath) const;
+    // Every open project, in the order opened.
+    std::vector<Project*> GetProjects() const;
+    // The symbol index of 'project', which must be one of the workspace's.
+    std::shared_ptr<SymbolIndex> GetSymbolIndex(const Project& project) const;
+    // Shared (and synchronised) however the workspace is reached.
+    ContentCache& GetCache() const;
+private:
+    std::vector<std::unique_ptr<Project>> projects;
+    std::vector<std::shared_ptr<SymbolIndex>> symbolIndexes; // Alongside 'projects'.
+    mutable ContentCache cache;
+
+    // With the trailing separator that projects' paths are joined to file refs with.
+    static std::string NormalisePath(const std::string& codebasePath);
+};
+
+#endif // WORKSPACE_H